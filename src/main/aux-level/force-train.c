@@ -35,6 +35,7 @@ This program trains (and validates) machine learning models
 #include "../../modules/cross-level/konami-cl.h"
 #include "../../modules/cross-level/string-cl.h"
 #include "../../modules/cross-level/utils-cl.h"
+#include "../../modules/cross-level/bintable-cl.h"
 #include "../../modules/aux-level/param-train-aux.h"
 #include "../../modules/aux-level/train-aux.h"
 
@@ -124,6 +125,9 @@ int n_sample_train, n_sample_val;
 int n_response_vars;
 double **t_features  = NULL;
 double **t_response  = NULL;
+bintable_t b_features, b_response;
+bool binary_features, binary_response;
+float  **rows = NULL;
 float   *r_response  = NULL;
 int     *c_response  = NULL;
 float **features_train  = NULL;
@@ -133,6 +137,8 @@ float **features_val  = NULL;
 float  *r_response_val  = NULL;
 int    *c_response_val  = NULL;
 bool    *is_train  = NULL;
+int     *idx  = NULL;
+rng_t rng;
 FILE   *flog = NULL;
 
 Ptr<StatModel> model;
@@ -161,7 +167,12 @@ time_t TIME;
 
 
   // read response variable
-  if ((t_response = read_table_deprecated(train->f_response, 
+  if ((binary_response = is_bintable(train->f_response))){
+    if (open_bintable(train->f_response, &b_response) != SUCCESS){
+      printf("unable to read response file. "); return FAILURE;}
+    n_sample = b_response.nrow;
+    n_response_vars = b_response.ncol;
+  } else if ((t_response = read_table_deprecated(train->f_response, 
       &n_sample, &n_response_vars)) == NULL){
     printf("unable to read response file. "); return FAILURE;}
 
@@ -176,10 +187,19 @@ time_t TIME;
   alloc((void**)&c_response, n_sample, sizeof(int));
   alloc((void**)&r_response, n_sample, sizeof(float));
 
-  for (s=0; s<n_sample; s++){
+  if (binary_response){
 
-    c_response[s] = (int)t_response[s][train->response_var-1];
-    r_response[s] = (float)t_response[s][train->response_var-1];
+    gather_bintable_col(&b_response, train->response_var-1, r_response);
+    for (s=0; s<n_sample; s++) c_response[s] = (int)r_response[s];
+
+  } else {
+
+    for (s=0; s<n_sample; s++){
+
+      c_response[s] = (int)t_response[s][train->response_var-1];
+      r_response[s] = (float)t_response[s][train->response_var-1];
+
+    }
 
   }
 
@@ -188,7 +208,12 @@ time_t TIME;
 
 
   // read features
-  if ((t_features = read_table_deprecated(train->f_feature, 
+  if ((binary_features = is_bintable(train->f_feature))){
+    if (open_bintable(train->f_feature, &b_features) != SUCCESS){
+      printf("unable to read feature file. "); return FAILURE;}
+    n_sample2 = b_features.nrow;
+    n_feature = b_features.ncol;
+  } else if ((t_features = read_table_deprecated(train->f_feature, 
     &n_sample2, &n_feature)) == NULL){
   printf("unable to read feature file. "); return FAILURE;}
 
@@ -197,6 +222,13 @@ time_t TIME;
     printf("number of samples in feature (%d) and response (%d) files are different..\n",
       n_sample2, n_sample); return FAILURE;}
 
+  if (binary_features && binary_response && 
+      !same_bintable_rows(&b_features, &b_response)){
+    printf("blocks or coordinates in feature and response files are different.\n");
+    return FAILURE;}
+
+  if (binary_response) close_bintable(&b_response);
+
 
 
   alloc_2DC((void***)&features_train, n_sample_train, n_feature, sizeof(float));
@@ -208,32 +240,48 @@ time_t TIME;
   alloc((void**)&r_response_val, n_sample_val, sizeof(float));
 
   alloc((void**)&is_train, n_sample, sizeof(bool));
+  alloc((void**)&rows, n_sample, sizeof(float*));
+  alloc((void**)&idx, n_sample, sizeof(int));
+
+  // seed random number generator, use clock if no seed was given
+  if (train->seed == 0) train->seed = (int)(time(NULL) % INT_MAX);
+  fprintf(flog, "random seed: %d\n", train->seed);
 
-  srand(time(NULL));
-  for (k=0; k<n_sample_train; k++){
-    if (train->random_split){
-      do {
-        s = rand() % n_sample;
-      } while (is_train[s]);
-    } else s = k;
-    is_train[s] = true;
+  for (s=0; s<n_sample; s++) idx[s] = s;
+  if (train->random_split){
+    init_rng(&rng, train->seed);
+    shuffle(&rng, idx, n_sample);
   }
+  for (k=0; k<n_sample_train; k++) is_train[idx[k]] = true;
 
   for (s=0, k=0, j=0; s<n_sample; s++){
     fprintf(flog, "sample: %d, train: %d\n", s, is_train[s]);
     if (is_train[s]){
-      for (f=0; f<n_feature; f++) features_train[k][f] = t_features[s][f]/10000.0;
+      rows[s] = features_train[k];
       r_response_train[k] = r_response[s];
       c_response_train[k] = c_response[s];
       k++;
     } else {
-      for (f=0; f<n_feature; f++) features_val[j][f] = t_features[s][f]/10000.0;
+      rows[s] = features_val[j];
       r_response_val[j] = r_response[s];
       c_response_val[j] = c_response[s];
       j++;
     }
   }
 
+  // copy features into training or validation rows
+  if (binary_features){
+    gather_bintable(&b_features, rows);
+    for (s=0; s<n_sample; s++){
+      for (f=0; f<n_feature; f++) rows[s][f] = rows[s][f]/10000.0;
+    }
+    close_bintable(&b_features);
+  } else {
+    for (s=0; s<n_sample; s++){
+      for (f=0; f<n_feature; f++) rows[s][f] = t_features[s][f]/10000.0;
+    }
+  }
+
 
   fprintf(flog, "\n");
   fprintf(flog, "Loaded %d samples and %d features\n", n_sample, n_feature);
@@ -245,6 +293,17 @@ time_t TIME;
   class_priors(c_response, n_sample, train);
 
 
+  // select hyper-parameters by cross-validation
+  if (train->kfold > 1){
+    if (cross_validate(features_train, r_response_train, c_response_train, 
+          n_sample_train, n_feature, train, flog) != SUCCESS){
+      printf("cross-validation failed. "); return FAILURE;}
+  }
+
+  // random state of the model only depends on seed
+  theRNG() = RNG((unsigned long long)train->seed);
+
+
   Mat trainingDataMat(n_sample_train, n_feature, CV_32F, features_train[0]);
   Mat r_labelsMat(n_sample_train, 1, CV_32F, r_response_train);
   Mat c_labelsMat(n_sample_train, 1, CV_32S, c_response_train);
@@ -290,8 +349,8 @@ time_t TIME;
   fprintf(flog, "____________________________________________________________________\n");
 
 
-  free_2D((void**)t_features, n_sample);
-  free_2D((void**)t_response, n_sample);
+  if (!binary_features) free_2D((void**)t_features, n_sample);
+  if (!binary_response) free_2D((void**)t_response, n_sample);
   free((void*)c_response);
   free((void*)r_response);
   free_2DC((void**)features_train);
@@ -301,6 +360,8 @@ time_t TIME;
   free((void*)c_response_val);
   free((void*)r_response_val);
   free((void*)is_train);
+  free((void*)idx);
+  free((void*)rows);
   free_param_train(train);
 
   fproctime_print(flog, "\nTraining", TIME);
@@ -37,8 +37,10 @@ This program is the FORCE Higher Level Processing System
 #include "../../modules/cross-level/tile-cl.h"
 #include "../../modules/cross-level/konami-cl.h"
 #include "../../modules/cross-level/cite-cl.h"
+#include "../../modules/cross-level/gdalcache-cl.h"
 #include "../../modules/higher-level/progress-hl.h"
 #include "../../modules/higher-level/tasks-hl.h"
+#include "../../modules/higher-level/stream-hl.h"
 #include "../../modules/higher-level/param-hl.h"
 
 /** Geospatial Data Abstraction Library (GDAL) **/
@@ -140,6 +142,7 @@ int         *nprod    = NULL;
 GDALDriverH driver;
 progress_t  pro;
 off_t ibytes = 0, obytes = 0;
+size_t pool, mem;
 
 
   /** INITIALIZING
@@ -193,8 +196,13 @@ off_t ibytes = 0, obytes = 0;
 
 
   // enable nested threading
-  if (omp_get_thread_limit() < (phl->ithread+phl->othread+phl->cthread)){
-    printf("Number of threads exceeds system limit\n"); return FAILURE;}
+  if (phl->stream){
+    if (omp_get_thread_limit() < (phl->sreader*phl->ithread+phl->cthread+phl->swriter*phl->othread)){
+      printf("Number of threads exceeds system limit\n"); return FAILURE;}
+  } else {
+    if (omp_get_thread_limit() < (phl->ithread+phl->othread+phl->cthread)){
+      printf("Number of threads exceeds system limit\n"); return FAILURE;}
+  }
   omp_set_nested(true);
   omp_set_max_active_levels(2);
 
@@ -207,29 +215,30 @@ off_t ibytes = 0, obytes = 0;
   // register GDAL drivers
   GDALAllRegister();
   if ((driver = GDALGetDriverByName("JP2ECW")) != NULL) GDALDeregisterDriver(driver);
+
+  // keep input datasets open across chunks
+  init_gdalcache(0);
+
+  // re-use the memory of image bricks across chunks, the pool is limited
+  // to the memory of the chunks in flight and to 1/4 of available memory
+  pool = SLAB_POOL_BYTES;
+  if (phl->stream && phl->smemory > 0 && 
+      phl->smemory*1024.0*1024.0*1024.0 < pool) pool = (size_t)(phl->smemory*1024.0*1024.0*1024.0);
+  if ((mem = available_memory()) > 0 && mem/4 < pool) pool = mem/4;
+  init_slab_pool(pool);
   
 
   /** LOOP OVER ALL CHUNKS
   +** *******************************************************************/
 
-  while (progress(&pro)){
-
-    if (phl->stream){
+  if (phl->stream){
 
-      #pragma omp parallel num_threads(3) shared(ARD1,ARD2,MASK,OUTPUT,aux,nprod,nt1,nt2,pro,cube,phl) reduction(+: ibytes, obytes) default(none)
-      {
+    stream_higher_level(&pro, &ibytes, &obytes, MASK, ARD1, ARD2, nt1, nt2, 
+      cube, phl, aux, OUTPUT, nprod);
 
-        if (omp_get_thread_num() == 0){
-          read_higher_level(&pro, &ibytes, MASK, ARD1, ARD2, nt1, nt2, cube, phl);
-        } else if (omp_get_thread_num() == 1){
-          compute_higher_level(&pro, MASK, ARD1, ARD2, nt1, nt2, cube, phl, aux, OUTPUT, nprod);
-        } else {
-          output_higher_level(&pro, &obytes, OUTPUT, nprod, phl);
-        }
-
-      }
+  } else {
 
-    } else {
+    while (progress(&pro)){
 
       read_higher_level(&pro, &ibytes, MASK, ARD1, ARD2, nt1, nt2, cube, phl);
       compute_higher_level(&pro, MASK, ARD1, ARD2, nt1, nt2, cube, phl, aux, OUTPUT, nprod);
@@ -259,6 +268,9 @@ off_t ibytes = 0, obytes = 0;
   free_datacube(cube);
   free_aux(phl, aux);
   free_param_higher(phl);
+  free_gdalcache();
+  free_ard_index();
+  free_slab_pool();
 
   #ifndef FORCE_DEBUG
   CPLPopErrorHandler();
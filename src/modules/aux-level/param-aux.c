@@ -1126,6 +1126,35 @@ void write_par_hl_thread(FILE *fp, bool verbose){
   }
   fprintf(fp, "STREAMING = TRUE\n");
 
+  if (verbose){
+    fprintf(fp, "# When streaming, chunks are passed through a work queue. Multiple readers\n");
+    fprintf(fp, "# and writers can work on different chunks at the same time, and the\n");
+    fprintf(fp, "# processing team picks up any chunk that was completely read. Each reader\n");
+    fprintf(fp, "# uses NTHREAD_READ, each writer NTHREAD_WRITE threads. The total number\n");
+    fprintf(fp, "# of threads is thus STREAMING_READERS * NTHREAD_READ + NTHREAD_COMPUTE +\n");
+    fprintf(fp, "# STREAMING_WRITERS * NTHREAD_WRITE.\n");
+    fprintf(fp, "# Type: Integer. Valid range: [1,...\n");
+  }
+  fprintf(fp, "STREAMING_READERS = 1\n");
+  fprintf(fp, "STREAMING_WRITERS = 1\n");
+
+  if (verbose){
+    fprintf(fp, "# Maximum number of chunks that are in flight at the same time, i.e. that\n");
+    fprintf(fp, "# are being read, waiting for processing, being processed, waiting for\n");
+    fprintf(fp, "# output, or being written. Each chunk in flight holds memory. Use at least\n");
+    fprintf(fp, "# 3 to overlap reading, computing and writing.\n");
+    fprintf(fp, "# Type: Integer. Valid range: [1,...\n");
+  }
+  fprintf(fp, "STREAMING_CHUNKS = 3\n");
+
+  if (verbose){
+    fprintf(fp, "# Maximum memory (in GB) that the chunks in flight may hold. No new chunk\n");
+    fprintf(fp, "# is read if this would be exceeded. At least one chunk is always processed.\n");
+    fprintf(fp, "# Use 0 to disable this limit.\n");
+    fprintf(fp, "# Type: Float. Valid range: [0,...\n");
+  }
+  fprintf(fp, "STREAMING_MEMORY = 0\n");
+
   if (verbose){
     fprintf(fp, "# This module will display progress information on screen. By default, the\n");
     fprintf(fp, "# progress information overwrites itself to produce a pretty displayal. \n");
@@ -1647,6 +1676,19 @@ void write_par_hl_pyp(FILE *fp, bool verbose){
   }
   fprintf(fp, "PYTHON_TYPE = PIXEL\n");
 
+  if (verbose){
+    fprintf(fp, "# Hand the data to the python UDF without copying? If TRUE, the input array is a \n");
+    fprintf(fp, "# read-only view of FORCE's memory (or a plain copy if the memory is not contiguous),\n");
+    fprintf(fp, "# and nodata values are not substituted. Instead, the data mask is passed as an \n");
+    fprintf(fp, "# additional boolean array [nDates, nrows, ncols] (None in the TSA submodule):\n");
+    fprintf(fp, "#     ``def forcepy_pixel(inarray, outarray, dates, sensors, bandnames, nodata, nproc, mask):``\n");
+    fprintf(fp, "#     ``def forcepy_block(inblock, outblock, dates, sensors, bandnames, nodata, nproc, mask):``\n");
+    fprintf(fp, "# The output array of the BLOCK function is a view of FORCE's output memory.\n");
+    fprintf(fp, "# Do not keep references to these arrays after the function has returned.\n");
+    fprintf(fp, "# Type: Logical. Valid values: {TRUE,FALSE}\n");
+  }
+  fprintf(fp, "PYTHON_ZERO_COPY = FALSE\n");
+
   if (verbose){
     fprintf(fp, "# Output the results provided by the python UDF? If TRUE, FILE_PYTHON must exist.\n");
     fprintf(fp, "# Type: Logical. Valid values: {TRUE,FALSE}\n");
@@ -1725,6 +1767,17 @@ void write_par_hl_stm(FILE *fp, bool verbose){
   }
   fprintf(fp, "STM = Q25 Q50 Q75 AVG STD\n");
 
+  if (verbose){
+    fprintf(fp, "# Tolerance for computing quantiles (including the IQR). If 0, quantiles are\n");
+    fprintf(fp, "# exact. If > 0, quantiles are approximated with a histogram, whose bins are\n");
+    fprintf(fp, "# 2 x tolerance + 1 wide. The approximated quantiles deviate by no more than\n");
+    fprintf(fp, "# the tolerance from the exact quantiles (in the unit of the data, e.g.\n");
+    fprintf(fp, "# reflectance x 10000). The memory is independent of the length of the time \n");
+    fprintf(fp, "# series, and this might be faster for very long, dense time series.\n");
+    fprintf(fp, "# Type: Integer. Valid range: [0,32767]\n");
+  }
+  fprintf(fp, "STM_QUANTILE_TOLERANCE = 0\n");
+
   return;
 }
 
@@ -2371,6 +2424,15 @@ void write_par_hl_smp(FILE *fp, bool verbose){
   }
   fprintf(fp, "PROJECTED = FALSE\n");
 
+  if (verbose){
+    fprintf(fp, "# Write the sampled features and responses as binary tables (TRUE), or as\n");
+    fprintf(fp, "# text tables (FALSE)? Binary tables are faster to write and read, and hold\n");
+    fprintf(fp, "# the feature names and coordinates, too. They can be used with force-train.\n");
+    fprintf(fp, "# FILE_COORDINATES is always written as text table.\n");
+    fprintf(fp, "# Type: Logical. Valid values: {TRUE,FALSE}\n");
+  }
+  fprintf(fp, "BINARY_SAMPLE = FALSE\n");
+
   return;
 }
 
@@ -2510,7 +2572,8 @@ void write_par_aux_train(FILE *fp, bool verbose){
     fprintf(fp, "# The file needs to be a table with features in columns, and samples in rows.\n");
     fprintf(fp, "# Column delimiter is whitespace. The same number of features must be given\n");
     fprintf(fp, "# for each sample. Do not include a header. The samples need to match the\n");
-    fprintf(fp, "# response file.\n");
+    fprintf(fp, "# response file. Binary sample tables (BINARY_SAMPLE in force-higher-level)\n");
+    fprintf(fp, "# are detected automatically.\n");
     fprintf(fp, "# Type: full file path\n");
   }
   fprintf(fp, "FILE_FEATURES = NULL\n");
@@ -2519,6 +2582,7 @@ void write_par_aux_train(FILE *fp, bool verbose){
     fprintf(fp, "# File that is holding the response for training (class labels or numeric\n");
     fprintf(fp, "# values). The file needs to be a table with one column, and samples in rows.\n");
     fprintf(fp, "# Do not include a header. The samples need to match the feature file.\n");
+    fprintf(fp, "# Binary sample tables are detected automatically.\n");
     fprintf(fp, "# Type: full file path\n");
   }
   fprintf(fp, "FILE_RESPONSE = NULL\n");
@@ -2539,6 +2603,14 @@ void write_par_aux_train(FILE *fp, bool verbose){
   }
   fprintf(fp, "FILE_LOG = NULL\n");
 
+  if (verbose){
+    fprintf(fp, "# File for storing the cross-validation results, i.e. the accuracy of each\n");
+    fprintf(fp, "# set of hyper-parameters in each fold (overall accuracy in %%, or RMSE).\n");
+    fprintf(fp, "# This file will be overwritten if it exists. Only used if CV_KFOLD > 1.\n");
+    fprintf(fp, "# Type: full file path\n");
+  }
+  fprintf(fp, "FILE_CV = NULL\n");
+
   fprintf(fp, "\n# TRAINING\n");
   fprintf(fp, "# ------------------------------------------------------------------------\n");
 
@@ -2564,6 +2636,25 @@ void write_par_aux_train(FILE *fp, bool verbose){
   }
   fprintf(fp, "RANDOM_SPLIT = TRUE\n");
 
+  if (verbose){
+    fprintf(fp, "# Seed for the random split and for the cross-validation folds. Training\n");
+    fprintf(fp, "# is reproducible when the same seed is used. If set to 0, the seed is\n");
+    fprintf(fp, "# derived from the clock, and written to the logfile.\n");
+    fprintf(fp, "# Type: Integer. Valid range: [0,...\n");
+  }
+  fprintf(fp, "RANDOM_SEED = 0\n");
+
+  if (verbose){
+    fprintf(fp, "# Number of folds for cross-validating the hyper-parameters. If > 1, the\n");
+    fprintf(fp, "# training samples are divided into CV_KFOLD subsets, and models are trained\n");
+    fprintf(fp, "# for each set of hyper-parameters (RF_NFEATURE_GRID and RF_DT_MAXDEPTH_GRID,\n");
+    fprintf(fp, "# or SVM_C_GRID and SVM_GAMMA_GRID) and each fold in parallel. The best set\n");
+    fprintf(fp, "# is used to train the final model with all training samples. If 0, no\n");
+    fprintf(fp, "# cross-validation is done (SVM_KFOLD is used for Support Vector Machines).\n");
+    fprintf(fp, "# Type: Integer. Valid values: 0 or [2,...\n");
+  }
+  fprintf(fp, "CV_KFOLD = 0\n");
+
   if (verbose){
     fprintf(fp, "# Machine learning method. Currently implemented are Random Forest and\n");
     fprintf(fp, "# Support Vector Machines, both in regression and classification flavors.\n");
@@ -2648,6 +2739,20 @@ void write_par_aux_train(FILE *fp, bool verbose){
   }
   fprintf(fp, "RF_DT_REG_ACCURACY = 0.01\n");
 
+  if (verbose){
+    fprintf(fp, "# Candidates for RF_NFEATURE, which are evaluated by cross-validation.\n");
+    fprintf(fp, "# Only used if CV_KFOLD > 1. If set to 0, RF_NFEATURE is used.\n");
+    fprintf(fp, "# Type: Integer list. Valid range: [0,...\n");
+  }
+  fprintf(fp, "RF_NFEATURE_GRID = 0\n");
+
+  if (verbose){
+    fprintf(fp, "# Candidates for RF_DT_MAXDEPTH, which are evaluated by cross-validation.\n");
+    fprintf(fp, "# Only used if CV_KFOLD > 1. If set to 0, RF_DT_MAXDEPTH is used.\n");
+    fprintf(fp, "# Type: Integer list. Valid range: [0,...\n");
+  }
+  fprintf(fp, "RF_DT_MAXDEPTH_GRID = 0\n");
+
   fprintf(fp, "\n# SUPPORT VECTOR MACHINE PARAMETERS\n");
   fprintf(fp, "# ------------------------------------------------------------------------\n");
   fprintf(fp, "# This block only applies if method is Support Vector Machine\n");
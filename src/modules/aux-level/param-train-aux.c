@@ -44,9 +44,12 @@ void register_train(params_t *params, par_train_t *train){
   register_char_par(params,     "FILE_RESPONSE",         _CHAR_TEST_EXIST_, &train->f_response);
   register_char_par(params,     "FILE_MODEL",            _CHAR_TEST_NONE_,  &train->f_model);
   register_char_par(params,     "FILE_LOG",              _CHAR_TEST_NONE_,  &train->f_log);
+  register_char_par(params,     "FILE_CV",               _CHAR_TEST_NONE_,  &train->f_cv);
   register_int_par(params,      "RESPONSE_VARIABLE",     1, INT_MAX, &train->response_var);
   register_float_par(params,    "PERCENT_TRAIN",         0.001, 100, &train->per_train);
   register_bool_par(params,     "RANDOM_SPLIT",          &train->random_split);
+  register_int_par(params,      "RANDOM_SEED",           0, INT_MAX, &train->seed);
+  register_int_par(params,      "CV_KFOLD",              0, INT_MAX, &train->kfold);
   register_charvec_par(params,  "FEATURE_WEIGHTS",       _CHAR_TEST_NONE_, &train->class_weights, &train->nclass_weights);
   register_enum_par(params,     "ML_METHOD",             _TAGGED_ENUM_ML_, _ML_LENGTH_, &train->method);
   register_int_par(params,      "RF_NTREE",              0, INT_MAX, &train->rf.ntree);
@@ -55,6 +58,8 @@ void register_train(params_t *params, par_train_t *train){
   register_bool_par(params,     "RF_FEATURE_IMPORTANCE", &train->rf.feature_importance);
   register_int_par(params,      "RF_DT_MINSAMPLE",       0, INT_MAX, &train->rf.dt.min_sample);
   register_int_par(params,      "RF_DT_MAXDEPTH",        0, INT_MAX, &train->rf.dt.max_depth);
+  register_intvec_par(params,   "RF_NFEATURE_GRID",      0, INT_MAX, &train->rf.feature_subset_grid, &train->rf.nfeature_subset_grid);
+  register_intvec_par(params,   "RF_DT_MAXDEPTH_GRID",   0, INT_MAX, &train->rf.dt.max_depth_grid, &train->rf.dt.nmax_depth_grid);
   register_float_par(params,    "RF_DT_REG_ACCURACY",    0, INT_MAX, &train->rf.dt.reg_accuracy);
   register_int_par(params,      "SVM_MAXITER",           0, INT_MAX, &train->sv.max_iter);
   register_float_par(params,    "SVM_ACCURACY",          0, INT_MAX, &train->sv.accuracy);
@@ -157,6 +162,11 @@ float sum = 0.0, tol=0.01;
   if (train->sv.Gammagrid[_MIN_] > train->sv.Gammagrid[_MAX_]){
     printf("SVM_GAMMA_GRID looks odd It needs to be a list of 3 floats: minVal maxVal logStep.\n"); return FAILURE;}
 
+  if (train->kfold == 1){
+    printf("CV_KFOLD needs to be 0 (no cross-validation) or > 1.\n"); return FAILURE;}
+  if (train->kfold > 1 && strcmp(train->f_cv, "NULL") == 0){
+    printf("FILE_CV needs to be given for cross-validation.\n"); return FAILURE;}
+
   if (train->nclass_weights == 1){
     if (strcmp(train->class_weights[0], "EQUALIZED")        != 0 && 
         strcmp(train->class_weights[0], "PROPORTIONAL")     != 0 && 
@@ -48,6 +48,8 @@ typedef struct {
   float *Gammagrid;
   int nCgrid, nGammagrid;
   float P;
+  float C;     // C, if selected by cross-validation
+  float gamma; // gamma, if selected by cross-validation
 } par_sv_t;
 
 // decision tree parameters
@@ -55,6 +57,8 @@ typedef struct {
   int min_sample;
   int max_depth;
   float reg_accuracy;
+  int *max_depth_grid;
+  int nmax_depth_grid;
 } par_dt_t;
 
 // random forest parameters
@@ -63,6 +67,8 @@ typedef struct {
   float oob_accuracy;
   int feature_subset;
   int feature_importance;
+  int *feature_subset_grid;
+  int nfeature_subset_grid;
   par_dt_t dt;
 } par_rf_t;
 
@@ -74,6 +80,9 @@ typedef struct {
   char *f_response;
   char *f_model;
   char *f_log;
+  char *f_cv;
+  int seed;
+  int kfold;
   par_sv_t sv;
   par_rf_t rf;
   int method;
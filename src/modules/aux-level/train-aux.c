@@ -28,13 +28,12 @@ This file contains functions for training machine learning models
 #include "train-aux.h"
 
 
-/** This function trains a Support Vector Machine model
---- TrainData: training data
+/** This function creates and parameterizes a Support Vector Machine 
++++ model
 --- train:     train parameters
-+++ Return:    model
++++ Return:    untrained model
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-Ptr<StatModel> train_svm(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp){
-int i;
+Ptr<SVM> setup_svm(par_train_t *train){
 
 
   Ptr<SVM> svm = SVM::create();
@@ -73,29 +72,56 @@ int i;
     svm->setClassWeights(priors);
   }
 
-  ParamGrid Cgrid = SVM::getDefaultGrid(SVM::C);
-  ParamGrid Gammagrid = SVM::getDefaultGrid(SVM::GAMMA);
+  return svm;
+}
+
 
-  Cgrid.minVal = train->sv.Cgrid[0]; 
-  Cgrid.maxVal = train->sv.Cgrid[1];
-  Cgrid.logStep = train->sv.Cgrid[2]; 
-  Gammagrid.minVal = train->sv.Gammagrid[0]; 
-  Gammagrid.maxVal = train->sv.Gammagrid[1];
-  Gammagrid.logStep = train->sv.Gammagrid[2]; 
+/** This function trains a Support Vector Machine model. If C and gamma 
++++ were selected by cross-validation, the model is trained with these,
++++ otherwise the grids are searched by OpenCV.
+--- TrainData: training data
+--- train:     train parameters
++++ Return:    model
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+Ptr<StatModel> train_svm(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp){
+int i;
+
+
+  Ptr<SVM> svm = setup_svm(train);
+
+  if (train->kfold > 1){
+
+    svm->setC(train->sv.C);
+    svm->setGamma(train->sv.gamma);
+    svm->train(TrainData, 0);
+
+  } else {
 
-  ParamGrid Pgrid = SVM::getDefaultGrid(SVM::P); Pgrid.logStep = 0; Pgrid.minVal = 1e3; Pgrid.maxVal = 1e3;
-  ParamGrid Nugrid = SVM::getDefaultGrid(SVM::NU); Nugrid.logStep = 0; Nugrid.minVal = 1e3; Nugrid.maxVal = 1e3;
-  ParamGrid Coefgrid = SVM::getDefaultGrid(SVM::COEF); Coefgrid.logStep = 0; Coefgrid.minVal = 1e3; Coefgrid.maxVal = 1e3;
-  ParamGrid Degreegrid = SVM::getDefaultGrid(SVM::DEGREE); Degreegrid.logStep = 0; Degreegrid.minVal = 1e3; Degreegrid.maxVal = 1e3;
+    ParamGrid Cgrid = SVM::getDefaultGrid(SVM::C);
+    ParamGrid Gammagrid = SVM::getDefaultGrid(SVM::GAMMA);
 
-  svm->trainAuto(TrainData, train->sv.kfold, Cgrid, Gammagrid, Pgrid, Nugrid, Coefgrid, Degreegrid, false);
+    Cgrid.minVal = train->sv.Cgrid[0]; 
+    Cgrid.maxVal = train->sv.Cgrid[1];
+    Cgrid.logStep = train->sv.Cgrid[2]; 
+    Gammagrid.minVal = train->sv.Gammagrid[0]; 
+    Gammagrid.maxVal = train->sv.Gammagrid[1];
+    Gammagrid.logStep = train->sv.Gammagrid[2]; 
+
+    ParamGrid Pgrid = SVM::getDefaultGrid(SVM::P); Pgrid.logStep = 0; Pgrid.minVal = 1e3; Pgrid.maxVal = 1e3;
+    ParamGrid Nugrid = SVM::getDefaultGrid(SVM::NU); Nugrid.logStep = 0; Nugrid.minVal = 1e3; Nugrid.maxVal = 1e3;
+    ParamGrid Coefgrid = SVM::getDefaultGrid(SVM::COEF); Coefgrid.logStep = 0; Coefgrid.minVal = 1e3; Coefgrid.maxVal = 1e3;
+    ParamGrid Degreegrid = SVM::getDefaultGrid(SVM::DEGREE); Degreegrid.logStep = 0; Degreegrid.minVal = 1e3; Degreegrid.maxVal = 1e3;
+
+    svm->trainAuto(TrainData, train->sv.kfold, Cgrid, Gammagrid, Pgrid, Nugrid, Coefgrid, Degreegrid, false);
+
+  }
 
   fprintf(fp, "\nSupport Vector Machine parameters\n");
   fprintf(fp, "--------------------------------------------------------------------\n");
   fprintf(fp, "Termination type: %d\n", svm->getTermCriteria().type);
   fprintf(fp, "max iterations: %d\n", svm->getTermCriteria().maxCount);
   fprintf(fp, "accuracy: %f\n", svm->getTermCriteria().epsilon);
-  fprintf(fp, "k-fold CV: %d\n", train->sv.kfold);
+  fprintf(fp, "k-fold CV: %d\n", (train->kfold > 1) ? train->kfold : train->sv.kfold);
   fprintf(fp, "P: %f\n", svm->getP());
   fprintf(fp, "C: %f\n", svm->getC());
   fprintf(fp, "Gamma: %f\n", svm->getGamma());
@@ -115,18 +141,15 @@ int i;
 }
 
 
-/** This function trains a Random Forest model
---- TrainData: training data
+/** This function creates and parameterizes a Random Forest model
 --- train:     train parameters
-+++ Return:    model
+--- n_feature: number of features
++++ Return:    untrained model
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-Ptr<StatModel> train_rf(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp){
-int v, i;
-int n_feature;
+Ptr<RTrees> setup_rf(par_train_t *train, int n_feature){
 
 
   Ptr<RTrees> rf = RTrees::create();
-  n_feature = TrainData->getNVars();
 
 
   // parameterize forest
@@ -179,6 +202,21 @@ int n_feature;
     rf->setPriors(priors);
   }
 
+  return rf;
+}
+
+
+/** This function trains a Random Forest model
+--- TrainData: training data
+--- train:     train parameters
++++ Return:    model
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+Ptr<StatModel> train_rf(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp){
+int v, i;
+
+
+  Ptr<RTrees> rf = setup_rf(train, TrainData->getNVars());
+
 
   fprintf(fp, "\nRandom Forest parameters\n");
   fprintf(fp, "--------------------------------------------------------------------\n");
@@ -375,3 +413,279 @@ size_t correct = 0;
   return;
 }
 
+
+/** This function builds the grid of hyper-parameters, which is evaluated
++++ by cross-validation. For Random Forests, all combinations of 
++++ RF_NFEATURE_GRID and RF_DT_MAXDEPTH_GRID are used. If a grid is left
++++ at 0, the parameter is not tuned, and RF_NFEATURE or RF_DT_MAXDEPTH is 
++++ used instead. For Support Vector
++++ Machines, all combinations of SVM_C_GRID and SVM_GAMMA_GRID are used 
++++ (minVal, minVal*logStep, ... < maxVal).
+--- train:  train parameters
+--- grid:   hyper-parameter sets (returned)
++++ Return: number of hyper-parameter sets
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hyper_grid(par_train_t *train, hyper_t **grid){
+hyper_t *hyper = NULL;
+int i, j, k = 0, nc = 0, ng = 0;
+int *nfeature = NULL, *max_depth = NULL;
+double val;
+
+
+  if (train->method == _ML_RFR_ || train->method == _ML_RFC_){
+
+    nc        = train->rf.nfeature_subset_grid;
+    nfeature  = train->rf.feature_subset_grid;
+    ng        = train->rf.dt.nmax_depth_grid;
+    max_depth = train->rf.dt.max_depth_grid;
+
+    // grid was left at 0, use scalar parameter
+    if (nc == 1 && nfeature[0] == 0){
+      nfeature = &train->rf.feature_subset;
+    }
+
+    if (ng == 1 && max_depth[0] == 0){
+      max_depth = &train->rf.dt.max_depth;
+    }
+
+    alloc((void**)&hyper, nc*ng, sizeof(hyper_t));
+
+    for (i=0; i<nc; i++){
+    for (j=0; j<ng; j++){
+      hyper[k].nfeature  = nfeature[i];
+      hyper[k].max_depth = max_depth[j];
+      k++;
+    }
+    }
+
+  } else {
+
+    for (val=train->sv.Cgrid[_MIN_], nc=1; train->sv.Cgrid[2] > 1 && 
+         val*train->sv.Cgrid[2] < train->sv.Cgrid[_MAX_]; val*=train->sv.Cgrid[2]) nc++;
+    for (val=train->sv.Gammagrid[_MIN_], ng=1; train->sv.Gammagrid[2] > 1 && 
+         val*train->sv.Gammagrid[2] < train->sv.Gammagrid[_MAX_]; val*=train->sv.Gammagrid[2]) ng++;
+
+    alloc((void**)&hyper, nc*ng, sizeof(hyper_t));
+
+    for (i=0; i<nc; i++){
+    for (j=0; j<ng; j++){
+      hyper[k].C     = train->sv.Cgrid[_MIN_]*pow(train->sv.Cgrid[2], i);
+      hyper[k].gamma = train->sv.Gammagrid[_MIN_]*pow(train->sv.Gammagrid[2], j);
+      k++;
+    }
+    }
+
+  }
+
+
+  *grid = hyper;
+  return k;
+}
+
+
+/** This function sets one hyper-parameter set in the train parameters
+--- train:  train parameters (modified)
+--- hyper:  hyper-parameter set
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void set_hyper(par_train_t *train, hyper_t *hyper){
+
+
+  if (train->method == _ML_RFR_ || train->method == _ML_RFC_){
+    train->rf.feature_subset = hyper->nfeature;
+    train->rf.dt.max_depth   = hyper->max_depth;
+  } else {
+    train->sv.C     = hyper->C;
+    train->sv.gamma = hyper->gamma;
+  }
+
+  return;
+}
+
+
+/** This function performs a k-fold cross-validation for each set of 
++++ hyper-parameters. All models (sets x folds) are trained in parallel.
++++ The folds, and the random state of each model, only depend on the 
++++ seed, i.e. the results are reproducible, and independent of the num-
++++ ber of threads. The accuracy of each model is written to FILE_CV, and
++++ the best hyper-parameters (highest mean overall accuracy, or lowest
++++ mean RMSE) are set in the train parameters.
+--- features:   features
+--- r_response: response (regression)
+--- c_response: response (classification)
+--- n_sample:   number of samples
+--- n_feature:  number of features
+--- train:      train parameters (best hyper-parameters are set)
+--- fp:         log file
++++ Return:     SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int cross_validate(float **features, float *r_response, int *c_response, int n_sample, int n_feature, par_train_t *train, FILE *fp){
+hyper_t *grid = NULL;
+int nset, ntask, t, h, k, s, i, best = 0;
+int kfold = train->kfold;
+int *fold = NULL, *idx = NULL;
+int nthread_cv;
+bool regression;
+double **score = NULL, *mean = NULL;
+rng_t rng;
+FILE *fcv = NULL;
+
+
+  if (n_sample < kfold){
+    printf("less samples (%d) than folds (%d). ", n_sample, kfold); return FAILURE;}
+
+  if ((nset = hyper_grid(train, &grid)) < 1){
+    printf("empty hyper-parameter grid. "); return FAILURE;}
+
+  regression = (train->method == _ML_SVR_ || train->method == _ML_RFR_);
+
+
+  /** assign samples to folds **/
+
+  alloc((void**)&idx,  n_sample, sizeof(int));
+  alloc((void**)&fold, n_sample, sizeof(int));
+
+  for (s=0; s<n_sample; s++) idx[s] = s;
+  init_rng(&rng, train->seed);
+  shuffle(&rng, idx, n_sample);
+  for (i=0; i<n_sample; i++) fold[idx[i]] = i % kfold;
+
+  free((void*)idx);
+
+
+  /** train and validate all models **/
+
+  ntask = nset*kfold;
+  alloc_2D((void***)&score, nset, kfold, sizeof(double));
+
+  Mat samples(n_sample, n_feature, CV_32F, features[0]);
+  Mat labels = regression ? Mat(n_sample, 1, CV_32F, r_response) : Mat(n_sample, 1, CV_32S, c_response);
+
+  // models are trained in parallel, do not nest OpenCV threads
+  nthread_cv = getNumThreads();
+  setNumThreads(1);
+
+  #pragma omp parallel for schedule(dynamic) private(h, k, s, i) shared(ntask, nset, kfold, n_sample, n_feature, regression, grid, fold, features, r_response, c_response, score, samples, labels, train) default(none)
+  for (t=0; t<ntask; t++){
+
+    par_train_t hyper_train = *train;
+    Ptr<StatModel> model;
+    int n_fold = 0, correct = 0, pred_c;
+    double sum = 0, pred_r;
+
+    h = t / kfold;
+    k = t % kfold;
+
+    set_hyper(&hyper_train, &grid[h]);
+
+    for (s=0; s<n_sample; s++) n_fold += (fold[s] == k);
+
+    Mat sample_idx(n_sample-n_fold, 1, CV_32S);
+    for (s=0, i=0; s<n_sample; s++){
+      if (fold[s] != k) sample_idx.at<int>(i++, 0) = s;
+    }
+
+    Ptr<TrainData> data = TrainData::create(samples, ROW_SAMPLE, labels, noArray(), sample_idx);
+
+    // random state only depends on seed and model
+    theRNG() = RNG((unsigned long long)train->seed + t + 1);
+
+    if (train->method == _ML_RFR_ || train->method == _ML_RFC_){
+      model = setup_rf(&hyper_train, n_feature);
+    } else {
+      Ptr<SVM> svm = setup_svm(&hyper_train);
+      svm->setC(hyper_train.sv.C);
+      svm->setGamma(hyper_train.sv.gamma);
+      model = svm;
+    }
+
+    model->train(data, 0);
+
+    for (s=0; s<n_sample; s++){
+
+      if (fold[s] != k) continue;
+
+      Mat sampleMat(1, n_feature, CV_32F, features[s]);
+
+      if (regression){
+        pred_r = model->predict(sampleMat);
+        sum += (pred_r-r_response[s])*(pred_r-r_response[s]);
+      } else {
+        pred_c = model->predict(sampleMat);
+        correct += (pred_c == c_response[s]);
+      }
+
+    }
+
+    if (regression){
+      score[h][k] = sqrt(sum/n_fold);
+    } else {
+      score[h][k] = 100.0*correct/n_fold;
+    }
+
+  }
+
+  setNumThreads(nthread_cv);
+
+
+  /** select best hyper-parameters **/
+
+  alloc((void**)&mean, nset, sizeof(double));
+
+  for (h=0; h<nset; h++){
+    for (k=0; k<kfold; k++) mean[h] += score[h][k];
+    mean[h] /= kfold;
+    if ((regression && mean[h] < mean[best]) || (!regression && mean[h] > mean[best])) best = h;
+  }
+
+
+  /** write accuracy table **/
+
+  if ((fcv = fopen(train->f_cv, "w")) == NULL){
+    printf("unable to open %s. ", train->f_cv); 
+    free((void*)grid); free((void*)fold); free((void*)mean); free_2D((void**)score, nset);
+    return FAILURE;}
+
+  if (regression) fprintf(fcv, "# RMSE\n"); else fprintf(fcv, "# OA [%%]\n");
+
+  if (train->method == _ML_RFR_ || train->method == _ML_RFC_){
+    fprintf(fcv, "set,nfeature,max_depth");
+  } else {
+    fprintf(fcv, "set,C,gamma");
+  }
+  for (k=0; k<kfold; k++) fprintf(fcv, ",fold_%d", k+1);
+  fprintf(fcv, ",mean,best\n");
+
+  for (h=0; h<nset; h++){
+    if (train->method == _ML_RFR_ || train->method == _ML_RFC_){
+      fprintf(fcv, "%d,%d,%d", h+1, grid[h].nfeature, grid[h].max_depth);
+    } else {
+      fprintf(fcv, "%d,%g,%g", h+1, grid[h].C, grid[h].gamma);
+    }
+    for (k=0; k<kfold; k++) fprintf(fcv, ",%.4f", score[h][k]);
+    fprintf(fcv, ",%.4f,%d\n", mean[h], h == best);
+  }
+
+  fclose(fcv);
+
+
+  fprintf(fp, "\nCross-validation\n");
+  fprintf(fp, "--------------------------------------------------------------------\n");
+  fprintf(fp, "k-fold CV: %d\n", kfold);
+  fprintf(fp, "seed: %d\n", train->seed);
+  fprintf(fp, "hyper-parameter sets: %d\n", nset);
+  fprintf(fp, "best set: %d, mean %s: %.4f\n", best+1, regression ? "RMSE" : "OA", mean[best]);
+  fprintf(fp, "accuracy table: %s\n", train->f_cv);
+  fprintf(fp, "____________________________________________________________________\n");
+
+
+  set_hyper(train, &grid[best]);
+
+  free((void*)grid);
+  free((void*)fold);
+  free((void*)mean);
+  free_2D((void**)score, nset);
+
+  return SUCCESS;
+}
+
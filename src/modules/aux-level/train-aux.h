@@ -45,11 +45,24 @@ using namespace cv::ml;
 extern "C" {
 #endif
 
+// set of hyper-parameters
+typedef struct {
+  int nfeature;  // RF: number of features at split
+  int max_depth; // RF: max. depth of trees
+  double C;      // SVM: C
+  double gamma;  // SVM: gamma
+} hyper_t;
+
+Ptr<SVM> setup_svm(par_train_t *train);
+Ptr<RTrees> setup_rf(par_train_t *train, int n_feature);
 Ptr<StatModel> train_svm(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp);
 Ptr<StatModel> train_rf(Ptr<TrainData> TrainData, par_train_t *train, FILE *fp);
 void class_priors(int *c_response, int n_sample, par_train_t *train);
 void predict_regression(float **features, float *response, Ptr<StatModel> model, int n_sample, int n_feature, FILE *fp);
 void predict_classification(float **features, int *response, Ptr<StatModel> model, int n_sample, int n_feature, FILE *fp);
+int hyper_grid(par_train_t *train, hyper_t **grid);
+void set_hyper(par_train_t *train, hyper_t *hyper);
+int cross_validate(float **features, float *r_response, int *c_response, int n_sample, int n_feature, par_train_t *train, FILE *fp);
 
 #ifdef __cplusplus
 }
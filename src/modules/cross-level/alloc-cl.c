@@ -27,6 +27,16 @@ This file contains general functions for memory allocation / deallocation
 
 #include "alloc-cl.h"
 
+#include <sys/mman.h> // memory management declarations
+
+
+// idle slabs, kept for re-use
+static void  *slab_pool[SLAB_POOL_NUM];
+static size_t slab_pool_size[SLAB_POOL_NUM];
+static size_t slab_pool_bytes = 0;
+static size_t slab_pool_max = 0; // pooling is disabled by default
+static int    slab_pool_n = 0;
+
 
 /** Allocate array
 +++ This function allocates a block of memory, and initializes it with 0.
@@ -81,8 +91,10 @@ void  *arr  = NULL;
 void **arr_ = NULL;
 int i;
 
+  // keep at least one pointer, such that the block can be freed if n1 = 0
   alloc((void**)&arr, n1*n2, size);
-  alloc((void**)&arr_, n1, sizeof(void*));
+  alloc((void**)&arr_, (n1 > 0) ? n1 : 1, sizeof(void*));
+  arr_[0] = arr;
   for (i=0; i<n1; i++) arr_[i] = (char*)arr + (size_t)i*n2*size;
 
   *ptr = arr_;
@@ -202,8 +214,10 @@ int i;
 
   if (n1_now == n1 && n2_now == n2) return;
 
-  re_alloc((void**)&arr, n1_now*n2_now, n1*n2, size);  
-  re_alloc((void**)&arr_, n1_now, n1, sizeof(void*));
+  // keep at least one element and pointer, see alloc_2DC
+  re_alloc((void**)&arr, n1_now*n2_now, (n1*n2 > 0) ? n1*n2 : 1, size);  
+  re_alloc((void**)&arr_, (n1_now > 0) ? n1_now : 1, (n1 > 0) ? n1 : 1, sizeof(void*));
+  arr_[0] = arr;
   for (i=0; i<n1; i++) arr_[i] = (char*)arr + (size_t)i*n2*size;
 
   *ptr = arr_;
@@ -307,3 +321,335 @@ int i, j;
   return;
 } 
 
+
+/** Allocate aligned memory block
++++ This function allocates a block of memory, which is aligned to the
++++ given number of bytes, and initializes it with 0.
+--- ptr:    Pointer to the memory block
+--- bytes:  Number of bytes (multiple of align)
+--- align:  Alignment in bytes (power of two)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+static void alloc_aligned(void **ptr, size_t bytes, size_t align){
+void *arr = NULL;
+
+  if (posix_memalign(&arr, align, bytes) != 0){
+    printf("unable to allocate memory!\n"); exit(1);}
+
+  memset(arr, 0, bytes);
+
+  *ptr = arr;
+  return;
+}
+
+
+/** Initialize arena
++++ This function initializes an arena, i.e. one block of memory, from 
++++ which short-lived scratch arrays are taken by bumping a pointer. The
++++ arrays are not freed individually, but all at once by resetting the 
++++ arena. If the block is full, the arena grows on the next reset.
+--- arena:  arena
+--- size:   initial size of memory block in bytes (may be 0)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_arena(arena_t *arena, size_t size){
+
+  arena->mem    = NULL;
+  arena->size   = size;
+  arena->used   = 0;
+  arena->peak   = 0;
+  arena->spill  = NULL;
+  arena->nspill = 0;
+
+  if (size > 0){
+    arena->size = (size + ARENA_ALIGN-1) / ARENA_ALIGN * ARENA_ALIGN;
+    alloc_aligned((void**)&arena->mem, arena->size, ARENA_ALIGN);
+  }
+
+  return;
+}
+
+
+/** Reset arena
++++ This function releases all arrays of an arena at once. If the memory
++++ block was too small since the last reset, it is enlarged such that
++++ the same requests fit into one block.
+--- arena:  arena
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void reset_arena(arena_t *arena){
+int i;
+
+
+  if (arena->nspill > 0){
+
+    for (i=0; i<arena->nspill; i++) free(arena->spill[i]);
+    free((void*)arena->spill);
+    arena->spill  = NULL;
+    arena->nspill = 0;
+
+    if (arena->mem != NULL) free((void*)arena->mem);
+    arena->size = arena->peak;
+    alloc_aligned((void**)&arena->mem, arena->size, ARENA_ALIGN);
+
+  }
+
+  arena->used = 0;
+  arena->peak = 0;
+
+  return;
+}
+
+
+/** Free arena
++++ This function deallocates the memory of an arena.
+--- arena:  arena
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_arena(arena_t *arena){
+int i;
+
+  for (i=0; i<arena->nspill; i++) free(arena->spill[i]);
+  if (arena->spill != NULL) free((void*)arena->spill);
+  if (arena->mem   != NULL) free((void*)arena->mem);
+
+  init_arena(arena, 0);
+
+  return;
+}
+
+
+/** Allocate array from arena
++++ This function takes a block of memory from an arena, and initializes 
++++ it with 0. The block is aligned to ARENA_ALIGN bytes. It must not be 
++++ freed, but is released by reset_arena or free_arena.
+--- arena:  arena
+--- ptr:    Pointer to the memory block
+--- n:      Number of elements to allocate
+--- size:   Size of each element
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void arena_alloc(arena_t *arena, void **ptr, size_t n, size_t size){
+size_t bytes = (n*size + ARENA_ALIGN-1) / ARENA_ALIGN * ARENA_ALIGN;
+void *arr = NULL;
+
+
+  if (bytes == 0) bytes = ARENA_ALIGN;
+
+  arena->peak += bytes;
+
+  if (arena->mem != NULL && arena->used+bytes <= arena->size){
+    arr = arena->mem + arena->used;
+    memset(arr, 0, bytes);
+    arena->used += bytes;
+  } else {
+    re_alloc((void**)&arena->spill, arena->nspill, arena->nspill+1, sizeof(void*));
+    alloc_aligned(&arr, bytes, ARENA_ALIGN);
+    arena->spill[arena->nspill++] = arr;
+  }
+
+  *ptr = arr;
+  return;
+}
+
+
+/** Allocate 2D-array from arena
++++ This function takes blocks of memory from an arena, and initializes
++++ them with 0. See arena_alloc.
+--- arena:  arena
+--- ptr:    Pointer to the memory block
+--- n1:     Number of elements to allocate (1st dimension)
+--- n2:     Number of elements to allocate (2nd dimension)
+--- size:   Size of each element
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void arena_alloc_2D(arena_t *arena, void ***ptr, size_t n1, size_t n2, size_t size){
+void **arr = NULL;
+size_t i;
+
+  arena_alloc(arena, (void**)&arr, n1, sizeof(void*));
+  for (i=0; i<n1; i++) arena_alloc(arena, (void**)&arr[i], n2, size);
+
+  *ptr = arr;
+  return;
+}
+
+
+/** Allocate 3D-array from arena
++++ This function takes blocks of memory from an arena, and initializes
++++ them with 0. See arena_alloc.
+--- arena:  arena
+--- ptr:    Pointer to the memory block
+--- n1:     Number of elements to allocate (1st dimension)
+--- n2:     Number of elements to allocate (2nd dimension)
+--- n3:     Number of elements to allocate (3nd dimension)
+--- size:   Size of each element
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void arena_alloc_3D(arena_t *arena, void ****ptr, size_t n1, size_t n2, size_t n3, size_t size){
+void ***arr = NULL;
+size_t i;
+
+  arena_alloc(arena, (void**)&arr, n1, sizeof(void**));
+  for (i=0; i<n1; i++) arena_alloc_2D(arena, (void***)&arr[i], n2, n3, size);
+
+  *ptr = arr;
+  return;
+}
+
+
+/** Size of slab
++++ This function rounds the size of a slab up to the alignment, or to
++++ a multiple of the huge page size for large slabs.
+--- bytes:  Number of requested bytes
++++ Return: Size of slab in bytes
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+static size_t slab_size(size_t bytes){
+size_t unit = (bytes >= SLAB_HUGE) ? SLAB_HUGE : SLAB_ALIGN;
+
+  if (bytes == 0) bytes = SLAB_ALIGN;
+
+  return (bytes + unit-1) / unit * unit;
+}
+
+
+/** Allocate slab
++++ This function allocates a large block of memory (slab), and initia-
++++ lizes it with 0. The slab is aligned to SLAB_ALIGN bytes, and large
++++ slabs to the huge page size, for which transparent huge pages are
++++ requested. If a slab of the same size was released before, it is 
++++ taken from the pool instead of allocating new memory.
+--- ptr:    Pointer to the memory block
+--- bytes:  Number of bytes
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void alloc_slab(void **ptr, size_t bytes){
+size_t size = slab_size(bytes);
+void *arr = NULL;
+int i;
+
+
+  #pragma omp critical (slab_pool)
+  {
+    for (i=slab_pool_n-1; i>=0; i--){
+      if (slab_pool_size[i] == size){
+        arr = slab_pool[i];
+        slab_pool_bytes -= size;
+        slab_pool_n--;
+        memmove(slab_pool+i,      slab_pool+i+1,      (slab_pool_n-i)*sizeof(void*));
+        memmove(slab_pool_size+i, slab_pool_size+i+1, (slab_pool_n-i)*sizeof(size_t));
+        break;
+      }
+    }
+  }
+
+  if (arr != NULL){
+    memset(arr, 0, size);
+    *ptr = arr;
+    return;
+  }
+
+  if (size >= SLAB_HUGE){
+    alloc_aligned(&arr, size, SLAB_HUGE);
+    #ifdef MADV_HUGEPAGE
+    madvise(arr, size, MADV_HUGEPAGE);
+    #endif
+  } else {
+    alloc_aligned(&arr, size, SLAB_ALIGN);
+  }
+
+  *ptr = arr;
+  return;
+}
+
+
+/** Free slab
++++ This function releases a slab to the pool, such that it can be re-
++++ used. If the pool is full, the oldest slabs are freed. If pooling is
++++ disabled, the slab is freed right away.
+--- ptr:    Pointer to the memory block
+--- bytes:  Number of bytes, as requested with alloc_slab
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_slab(void *ptr, size_t bytes){
+size_t size = slab_size(bytes);
+void *evict[SLAB_POOL_NUM+1];
+int i, n = 0;
+
+
+  if (ptr == NULL) return;
+
+  #pragma omp critical (slab_pool)
+  {
+    if (size > slab_pool_max){
+      evict[n++] = ptr;
+    } else {
+      while (slab_pool_n > 0 && 
+            (slab_pool_n == SLAB_POOL_NUM || slab_pool_bytes+size > slab_pool_max)){
+        evict[n++] = slab_pool[0];
+        slab_pool_bytes -= slab_pool_size[0];
+        slab_pool_n--;
+        memmove(slab_pool,      slab_pool+1,      slab_pool_n*sizeof(void*));
+        memmove(slab_pool_size, slab_pool_size+1, slab_pool_n*sizeof(size_t));
+      }
+      slab_pool[slab_pool_n] = ptr;
+      slab_pool_size[slab_pool_n] = size;
+      slab_pool_bytes += size;
+      slab_pool_n++;
+    }
+  }
+
+  for (i=0; i<n; i++) free(evict[i]);
+
+  return;
+}
+
+
+/** Initialize slab pool
++++ This function enables the pool, and sets the maximum number of bytes
++++ that may be held by idle slabs. Idle slabs that exceed the new limit
++++ are freed. Use 0 to disable the pool.
+--- bytes:  Maximum number of bytes
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_slab_pool(size_t bytes){
+void *evict[SLAB_POOL_NUM];
+int i, n = 0;
+
+
+  #pragma omp critical (slab_pool)
+  {
+    slab_pool_max = bytes;
+    while (slab_pool_n > 0 && slab_pool_bytes > slab_pool_max){
+      evict[n++] = slab_pool[0];
+      slab_pool_bytes -= slab_pool_size[0];
+      slab_pool_n--;
+      memmove(slab_pool,      slab_pool+1,      slab_pool_n*sizeof(void*));
+      memmove(slab_pool_size, slab_pool_size+1, slab_pool_n*sizeof(size_t));
+    }
+  }
+
+  for (i=0; i<n; i++) free(evict[i]);
+
+  return;
+}
+
+
+/** Free slab pool
++++ This function frees all idle slabs of the pool.
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_slab_pool(){
+int i;
+
+
+  #pragma omp critical (slab_pool)
+  {
+    for (i=0; i<slab_pool_n; i++) free(slab_pool[i]);
+    slab_pool_n = 0;
+    slab_pool_bytes = 0;
+  }
+
+  return;
+}
+
@@ -37,6 +37,28 @@ Allocation header
 extern "C" {
 #endif
 
+// alignment of slabs in bytes
+#define SLAB_ALIGN 64
+// slabs of this size or larger are backed by (transparent) huge pages
+#define SLAB_HUGE 2097152
+// maximum number of idle slabs in pool
+#define SLAB_POOL_NUM 1024
+// default maximum number of bytes held by idle slabs in pool
+#define SLAB_POOL_BYTES 2147483648UL
+
+// alignment of arena allocations in bytes
+#define ARENA_ALIGN 64
+
+// arena for short-lived scratch memory, which is released at once
+typedef struct {
+  char  *mem;    // memory block
+  size_t size;   // size of memory block in bytes
+  size_t used;   // used bytes of memory block
+  size_t peak;   // bytes requested since last reset
+  void **spill;  // overflow blocks if memory block is full
+  int nspill;    // number of overflow blocks
+} arena_t;
+
 void alloc(void **ptr, size_t n, size_t size);
 void alloc_2D(void ***ptr, size_t n1, size_t n2, size_t size);
 void alloc_3D(void ****ptr, size_t n1, size_t n2, size_t n3, size_t size);
@@ -48,6 +70,16 @@ void re_alloc_2DC(void ***ptr, size_t n1_now, size_t n2_now, size_t n1, size_t n
 void free_2D(void **ptr, size_t n);
 void free_3D(void ***ptr, size_t n1, size_t n2);
 void free_2DC(void **ptr);
+void alloc_slab(void **ptr, size_t bytes);
+void free_slab(void *ptr, size_t bytes);
+void init_slab_pool(size_t bytes);
+void free_slab_pool();
+void init_arena(arena_t *arena, size_t size);
+void reset_arena(arena_t *arena);
+void free_arena(arena_t *arena);
+void arena_alloc(arena_t *arena, void **ptr, size_t n, size_t size);
+void arena_alloc_2D(arena_t *arena, void ***ptr, size_t n1, size_t n2, size_t size);
+void arena_alloc_3D(arena_t *arena, void ****ptr, size_t n1, size_t n2, size_t n3, size_t size);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,474 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2022 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for reading and writing binary sample tables
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "bintable-cl.h"
+
+#include <fcntl.h>    // file control options
+#include <unistd.h>   // standard symbolic constants and types
+#include <sys/mman.h> // memory management declarations
+#include <sys/stat.h> // file status
+
+
+size_t bintable_block_bytes(int64_t nrow, int ncol);
+int read_bintable_header(FILE *fp, bintable_header_t *header);
+int bintable_data_end(FILE *fp, bintable_header_t *header, off_t *end);
+
+
+/** This function computes the size of one block in bytes
+--- nrow:   number of rows in block
+--- ncol:   number of columns
++++ Return: size of block
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t bintable_block_bytes(int64_t nrow, int ncol){
+size_t bytes;
+
+  bytes = sizeof(int64_t) + nrow*2*sizeof(double) + nrow*ncol*sizeof(float);
+
+  // pad to 8 bytes
+  return (bytes+7) / 8 * 8;
+}
+
+
+/** This function reads and checks the header of a binary sample table
+--- fp:     file pointer (positioned at the beginning)
+--- header: file header (returned)
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_bintable_header(FILE *fp, bintable_header_t *header){
+
+
+  if (fread(header, sizeof(bintable_header_t), 1, fp) != 1){
+    printf("unable to read header of binary table. "); return FAILURE;}
+
+  if (strncmp(header->magic, BINTABLE_MAGIC, 8) != 0){
+    printf("file is not a binary table. "); return FAILURE;}
+
+  if (header->version != BINTABLE_VERSION){
+    printf("unsupported version of binary table (%d). ", header->version); return FAILURE;}
+
+  return SUCCESS;
+}
+
+
+/** This function computes the end of the blocks that are accounted for
++++ in the file header. Bytes after this offset were left by an append that
++++ failed or was interrupted, and are not part of the table.
+--- fp:     file pointer
+--- header: file header
+--- end:    offset after the last block (returned)
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int bintable_data_end(FILE *fp, bintable_header_t *header, off_t *end){
+off_t offset, size;
+int64_t b, n;
+
+
+  if (fseeko(fp, 0, SEEK_END) != 0 || (size = ftello(fp)) < 0){
+    printf("unable to determine size of binary table. "); return FAILURE;}
+
+  offset = sizeof(bintable_header_t) + (off_t)header->ncol*BINTABLE_NAME_LEN;
+
+  for (b=0; b<header->nblock; b++){
+
+    if (offset + (off_t)sizeof(int64_t) > size ||
+        fseeko(fp, offset, SEEK_SET) != 0 ||
+        fread(&n, sizeof(int64_t), 1, fp) != 1 || n < 0 ||
+        offset + (off_t)bintable_block_bytes(n, header->ncol) > size){
+      printf("binary table is truncated. "); return FAILURE;}
+
+    offset += bintable_block_bytes(n, header->ncol);
+
+  }
+
+  if (offset > size){
+    printf("binary table is truncated. "); return FAILURE;}
+
+  *end = offset;
+  return SUCCESS;
+}
+
+
+/** This function checks whether a file is a binary sample table
+--- fname:  filename
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool is_bintable(char *fname){
+FILE *fp = NULL;
+char magic[8];
+bool is = false;
+
+
+  if ((fp = fopen(fname, "rb")) == NULL) return false;
+
+  if (fread(magic, 8, 1, fp) == 1 && strncmp(magic, BINTABLE_MAGIC, 8) == 0) is = true;
+
+  fclose(fp);
+
+  return is;
+}
+
+
+/** This function appends the allowed rows of a table to a binary sample
++++ table as one new block. The file is created if it does not exist. The
++++ block is written after the blocks that are accounted for in the file
++++ header, i.e. leftovers of a failed append are overwritten. The header
++++ is updated after the block was written. The caller needs to hold the
++++ lock of the file, see append_bintable.
+--- fname:     filename
+--- tab:       table (nrow x ncol)
+--- coords:    coordinates (nrow x 2, X/Y)
+--- allow:     rows to append (nrow)
+--- nrow:      number of rows
+--- ncol:      number of columns
+--- col_names: column names (ncol)
+--- nodata:    nodata value
++++ Return:    SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int write_bintable(char *fname, double **tab, double **coords, bool *allow, int nrow, int ncol, char **col_names, float nodata){
+bintable_header_t header;
+FILE *fp = NULL;
+char *block = NULL;
+char name[BINTABLE_NAME_LEN];
+int64_t n = 0;
+double *x = NULL, *y = NULL;
+float *data = NULL;
+size_t bytes;
+off_t end;
+int row, col, k;
+
+
+  for (row=0; row<nrow; row++) n += allow[row];
+
+  if (n == 0) return SUCCESS;
+
+
+  /** copy the allowed rows into a column-major block **/
+
+  bytes = bintable_block_bytes(n, ncol);
+  alloc((void**)&block, bytes, 1);
+
+  memcpy(block, &n, sizeof(int64_t));
+  x    = (double*)(block + sizeof(int64_t));
+  y    = x + n;
+  data = (float*)(y + n);
+
+  for (row=0, k=0; row<nrow; row++){
+
+    if (!allow[row]) continue;
+
+    x[k] = coords[row][_X_];
+    y[k] = coords[row][_Y_];
+    for (col=0; col<ncol; col++) data[col*n+k] = (float)tab[row][col];
+    k++;
+
+  }
+
+
+  /** append block after the last valid block **/
+
+  if ((fp = fopen(fname, "r+b")) != NULL){
+
+    if (read_bintable_header(fp, &header) != SUCCESS){
+      printf("cannot append to %s. ", fname);
+      fclose(fp); free((void*)block); return FAILURE;}
+
+    if (header.ncol != ncol){
+      printf("number of columns in %s (%d) does not match (%d). ", fname, header.ncol, ncol);
+      fclose(fp); free((void*)block); return FAILURE;}
+
+    if (bintable_data_end(fp, &header, &end) != SUCCESS){
+      printf("cannot append to %s. ", fname);
+      fclose(fp); free((void*)block); return FAILURE;}
+
+  } else {
+
+    if ((fp = fopen(fname, "w+b")) == NULL){
+      printf("unable to create %s. ", fname);
+      free((void*)block); return FAILURE;}
+
+    memset(&header, 0, sizeof(bintable_header_t));
+    memcpy(header.magic, BINTABLE_MAGIC, 8);
+    header.version = BINTABLE_VERSION;
+    header.ncol    = ncol;
+    header.nodata  = nodata;
+
+    if (fwrite(&header, sizeof(bintable_header_t), 1, fp) != 1){
+      printf("unable to write header of %s. ", fname);
+      fclose(fp); free((void*)block); return FAILURE;}
+
+    for (col=0; col<ncol; col++){
+      memset(name, 0, BINTABLE_NAME_LEN);
+      copy_string(name, BINTABLE_NAME_LEN, col_names[col]);
+      if (fwrite(name, BINTABLE_NAME_LEN, 1, fp) != 1){
+        printf("unable to write header of %s. ", fname);
+        fclose(fp); free((void*)block); return FAILURE;}
+    }
+
+    end = sizeof(bintable_header_t) + (off_t)ncol*BINTABLE_NAME_LEN;
+
+  }
+
+  // discard leftovers of a failed append
+  if (fflush(fp) != 0 || ftruncate(fileno(fp), end) != 0 || fseeko(fp, end, SEEK_SET) != 0){
+    printf("unable to append to %s. ", fname);
+    fclose(fp); free((void*)block); return FAILURE;}
+
+  if (fwrite(block, bytes, 1, fp) != 1 || fflush(fp) != 0){
+    printf("unable to append to %s. ", fname);
+    fclose(fp); free((void*)block); return FAILURE;}
+
+  free((void*)block);
+
+  // the header is updated after the block was written
+  header.nrow += n;
+  header.nblock++;
+
+  if (fseeko(fp, 0, SEEK_SET) != 0 || 
+      fwrite(&header, sizeof(bintable_header_t), 1, fp) != 1){
+    printf("unable to update header of %s. ", fname);
+    fclose(fp); return FAILURE;}
+
+  if (fclose(fp) != 0){
+    printf("unable to update header of %s. ", fname);
+    return FAILURE;}
+
+  return SUCCESS;
+}
+
+
+/** This function appends the allowed rows of a table to a binary sample
++++ table as one new block, see write_bintable. The file is locked while 
++++ appending, thus multiple threads or processes can append to the same
++++ file.
+--- fname:     filename
+--- tab:       table (nrow x ncol)
+--- coords:    coordinates (nrow x 2, X/Y)
+--- allow:     rows to append (nrow)
+--- nrow:      number of rows
+--- ncol:      number of columns
+--- col_names: column names (ncol)
+--- nodata:    nodata value
++++ Return:    SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int append_bintable(char *fname, double **tab, double **coords, bool *allow, int nrow, int ncol, char **col_names, float nodata){
+char *lock = NULL;
+int64_t n = 0;
+int row, err;
+
+
+  for (row=0; row<nrow; row++) n += allow[row];
+
+  if (n == 0) return SUCCESS;
+
+  if ((lock = lock_file(fname, lock_timeout(bintable_block_bytes(n, ncol)))) == NULL) return FAILURE;
+
+  err = write_bintable(fname, tab, coords, allow, nrow, ncol, col_names, nodata);
+
+  unlock_file(lock);
+
+  return err;
+}
+
+
+/** This function memory-maps a binary sample table. Only the blocks that
++++ are accounted for in the file header are used.
+--- fname:  filename
+--- table:  binary table (returned)
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int open_bintable(char *fname, bintable_t *table){
+bintable_header_t header;
+struct stat st;
+size_t offset;
+int64_t n, nrow = 0;
+int b, col;
+
+
+  memset(table, 0, sizeof(bintable_t));
+  table->fd = -1;
+
+  if ((table->fd = open(fname, O_RDONLY)) < 0){
+    printf("unable to open %s. ", fname); return FAILURE;}
+
+  if (fstat(table->fd, &st) != 0 || (size_t)st.st_size < sizeof(bintable_header_t)){
+    printf("unable to read %s. ", fname); close_bintable(table); return FAILURE;}
+
+  table->size = st.st_size;
+
+  if ((table->map = (char*)mmap(NULL, table->size, PROT_READ, MAP_SHARED, table->fd, 0)) == MAP_FAILED){
+    table->map = NULL;
+    printf("unable to map %s. ", fname); close_bintable(table); return FAILURE;}
+
+  memcpy(&header, table->map, sizeof(bintable_header_t));
+
+  if (strncmp(header.magic, BINTABLE_MAGIC, 8) != 0 || header.version != BINTABLE_VERSION){
+    printf("%s is not a binary table. ", fname); close_bintable(table); return FAILURE;}
+
+  table->ncol   = header.ncol;
+  table->nrow   = header.nrow;
+  table->nblock = header.nblock;
+  table->nodata = header.nodata;
+
+  offset = sizeof(bintable_header_t) + (size_t)table->ncol*BINTABLE_NAME_LEN;
+
+  if (offset > table->size){
+    printf("%s is truncated. ", fname); close_bintable(table); return FAILURE;}
+
+  alloc((void**)&table->col_names, table->ncol, sizeof(char*));
+  for (col=0; col<table->ncol; col++){
+    table->col_names[col] = table->map + sizeof(bintable_header_t) + (size_t)col*BINTABLE_NAME_LEN;
+  }
+
+  alloc((void**)&table->block_nrow, table->nblock, sizeof(int64_t));
+  alloc((void**)&table->block_x,    table->nblock, sizeof(double*));
+  alloc((void**)&table->block_y,    table->nblock, sizeof(double*));
+  alloc((void**)&table->block_data, table->nblock, sizeof(float*));
+
+  for (b=0; b<table->nblock; b++){
+
+    if (offset + sizeof(int64_t) > table->size){
+      printf("%s is truncated. ", fname); close_bintable(table); return FAILURE;}
+
+    memcpy(&n, table->map + offset, sizeof(int64_t));
+
+    if (n < 0 || offset + bintable_block_bytes(n, table->ncol) > table->size){
+      printf("%s is truncated. ", fname); close_bintable(table); return FAILURE;}
+
+    table->block_nrow[b] = n;
+    table->block_x[b]    = (double*)(table->map + offset + sizeof(int64_t));
+    table->block_y[b]    = table->block_x[b] + n;
+    table->block_data[b] = (float*)(table->block_y[b] + n);
+
+    offset += bintable_block_bytes(n, table->ncol);
+    nrow += n;
+
+  }
+
+  if (nrow != table->nrow){
+    printf("number of rows in %s is inconsistent. ", fname); close_bintable(table); return FAILURE;}
+
+  return SUCCESS;
+}
+
+
+/** This function unmaps a binary sample table
+--- table:  binary table
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void close_bintable(bintable_t *table){
+
+
+  if (table->map != NULL) munmap(table->map, table->size);
+  if (table->fd >= 0) close(table->fd);
+
+  if (table->col_names  != NULL) free((void*)table->col_names);
+  if (table->block_nrow != NULL) free((void*)table->block_nrow);
+  if (table->block_x    != NULL) free((void*)table->block_x);
+  if (table->block_y    != NULL) free((void*)table->block_y);
+  if (table->block_data != NULL) free((void*)table->block_data);
+
+  memset(table, 0, sizeof(bintable_t));
+  table->fd = -1;
+
+  return;
+}
+
+
+/** This function copies a binary sample table into rows. The rows can be
++++ scattered in memory, e.g. to split the table on the fly.
+--- table:  binary table
+--- rows:   destination of each row (nrow x ncol)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void gather_bintable(bintable_t *table, float **rows){
+int64_t row0, k, n;
+int b, col;
+float *data = NULL;
+
+
+  for (b=0, row0=0; b<table->nblock; b++){
+
+    n = table->block_nrow[b];
+
+    for (col=0; col<table->ncol; col++){
+      data = table->block_data[b] + col*n;
+      for (k=0; k<n; k++) rows[row0+k][col] = data[k];
+    }
+
+    row0 += n;
+
+  }
+
+  return;
+}
+
+
+/** This function copies one column of a binary sample table
+--- table:  binary table
+--- col:    column
+--- dst:    destination (nrow)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void gather_bintable_col(bintable_t *table, int col, float *dst){
+int64_t row0, n;
+int b;
+
+
+  for (b=0, row0=0; b<table->nblock; b++){
+
+    n = table->block_nrow[b];
+    memcpy(dst+row0, table->block_data[b] + col*n, n*sizeof(float));
+    row0 += n;
+
+  }
+
+  return;
+}
+
+
+/** This function checks whether two binary sample tables hold the same
++++ samples, i.e. the same blocks with the same coordinates. This is the
++++ case for the feature and response tables of one sampling run.
+--- a:      binary table
+--- b:      binary table
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool same_bintable_rows(bintable_t *a, bintable_t *b){
+int k;
+
+
+  if (a->nrow != b->nrow || a->nblock != b->nblock) return false;
+
+  for (k=0; k<a->nblock; k++){
+    if (a->block_nrow[k] != b->block_nrow[k]) return false;
+    if (memcmp(a->block_x[k], b->block_x[k], a->block_nrow[k]*sizeof(double)) != 0) return false;
+    if (memcmp(a->block_y[k], b->block_y[k], a->block_nrow[k]*sizeof(double)) != 0) return false;
+  }
+
+  return true;
+}
+
@@ -0,0 +1,100 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2022 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Binary sample table header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef BINTABLE_CL_H
+#define BINTABLE_CL_H
+
+#include <stdio.h>   // core input and output functions
+#include <stdlib.h>  // standard general utilities library
+#include <string.h>  // string handling functions
+#include <stdbool.h> // boolean data type
+#include <stdint.h>  // fixed width integer types
+
+#include "../cross-level/const-cl.h"
+#include "../cross-level/alloc-cl.h"
+#include "../cross-level/string-cl.h"
+#include "../cross-level/lock-cl.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A binary sample table consists of a file header, followed by ncol
++++ column names of BINTABLE_NAME_LEN bytes, and by a sequence of blocks.
++++ Each block holds an int64 with the number of rows n, the n X and n Y
++++ coordinates (float64), and ncol columns of n values (float32), i.e.
++++ the data are stored column by column within each block. Blocks are
++++ padded to 8 bytes. All values are in native byte order.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#define BINTABLE_MAGIC "FORCEBTB"
+#define BINTABLE_VERSION 1
+#define BINTABLE_NAME_LEN 64
+
+// file header of binary sample table
+typedef struct {
+  char    magic[8]; // BINTABLE_MAGIC
+  int32_t version;  // BINTABLE_VERSION
+  int32_t ncol;     // number of columns
+  int64_t nrow;     // number of rows (all blocks)
+  int64_t nblock;   // number of blocks
+  float   nodata;   // nodata value
+  int32_t reserved; // padding
+} bintable_header_t;
+
+// memory-mapped binary sample table
+typedef struct {
+  int fd;              // file descriptor
+  char *map;           // mapped file
+  size_t size;         // size of mapped file
+  int ncol;            // number of columns
+  int64_t nrow;        // number of rows
+  int nblock;          // number of blocks
+  float nodata;        // nodata value
+  char **col_names;    // column names
+  int64_t *block_nrow; // number of rows in each block
+  double **block_x;    // X-coordinates of each block
+  double **block_y;    // Y-coordinates of each block
+  float **block_data;  // column-major data of each block
+} bintable_t;
+
+bool is_bintable(char *fname);
+int write_bintable(char *fname, double **tab, double **coords, bool *allow, int nrow, int ncol, char **col_names, float nodata);
+int append_bintable(char *fname, double **tab, double **coords, bool *allow, int nrow, int ncol, char **col_names, float nodata);
+int open_bintable(char *fname, bintable_t *table);
+void close_bintable(bintable_t *table);
+void gather_bintable(bintable_t *table, float **rows);
+void gather_bintable_col(bintable_t *table, int col, float *dst);
+bool same_bintable_rows(bintable_t *a, bintable_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
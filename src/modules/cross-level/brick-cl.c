@@ -36,6 +36,11 @@ This file contains functions for organizing bricks in memory, and output
 #include "ogr_spatialref.h" // coordinate systems services
 
 
+void ***band_memory(brick_t *brick);
+void alloc_bands(void ***ptr, int nb, size_t stride, int nbyte, size_t *slab);
+void free_bands(void **ptr, size_t slab);
+
+
 /** This function allocates a brick
 --- nb:       number of bands
 --- nc:       number of cells
@@ -227,7 +232,67 @@ int nb;
 }
 
 
-/** This function allocates the bandwise information in a brick
+/** This function returns the band pointers of a brick for its datatype
+--- brick:  brick
++++ Return: band pointers, or NULL if there is no datatype
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void ***band_memory(brick_t *brick){
+
+  switch (get_brick_datatype(brick)){
+    case _DT_SHORT_:  return (void***)&brick->vshort;
+    case _DT_SMALL_:  return (void***)&brick->vsmall;
+    case _DT_FLOAT_:  return (void***)&brick->vfloat;
+    case _DT_INT_:    return (void***)&brick->vint;
+    case _DT_USHORT_: return (void***)&brick->vushort;
+    default:          return NULL;
+  }
+
+}
+
+
+/** This function allocates the band memory of a brick as one slab, and
++++ sets the band pointers into the slab. 
+--- ptr:    band pointers (returned)
+--- nb:     number of bands
+--- stride: number of cells between bands
+--- nbyte:  number of bytes per cell
+--- slab:   number of bytes of slab (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void alloc_bands(void ***ptr, int nb, size_t stride, int nbyte, size_t *slab){
+char  *arr  = NULL;
+void **arr_ = NULL;
+int b;
+
+  // keep at least one pointer, such that the slab can be freed if nb = 0
+  *slab = (size_t)nb*stride*nbyte;
+  alloc_slab((void**)&arr, *slab);
+  alloc((void**)&arr_, (nb > 0) ? nb : 1, sizeof(void*));
+  arr_[0] = arr;
+  for (b=0; b<nb; b++) arr_[b] = arr + (size_t)b*stride*nbyte;
+
+  *ptr = arr_;
+  return;
+}
+
+
+/** This function releases the band memory of a brick
+--- ptr:    band pointers
+--- slab:   number of bytes of slab
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_bands(void **ptr, size_t slab){
+
+  free_slab(ptr[0], slab);
+  free((void*)ptr);
+
+  return;
+}
+
+
+/** This function allocates the bandwise information in a brick. All 
++++ bands are held in one slab, and each band starts at a SLAB_ALIGN-
++++ byte boundary, i.e. the bands are get_brick_stride cells apart.
 --- brick:    brick (modified)
 --- nb:       number of bands
 --- nc:       number of cells
@@ -246,33 +311,32 @@ int nbyte;
     case _DT_SHORT_:
       set_brick_datatype(brick, _DT_SHORT_);
       set_brick_byte(brick, (nbyte = sizeof(short)));
-      alloc_2D((void***)&brick->vshort, nb, nc, nbyte);
       break;
     case _DT_SMALL_:
       set_brick_datatype(brick, _DT_SMALL_);
       set_brick_byte(brick, (nbyte = sizeof(small)));
-      alloc_2D((void***)&brick->vsmall, nb, nc, nbyte);
       break;
     case _DT_FLOAT_:
       set_brick_datatype(brick, _DT_FLOAT_);
       set_brick_byte(brick, (nbyte = sizeof(float)));
-      alloc_2D((void***)&brick->vfloat, nb, nc, nbyte);
       break;
     case _DT_INT_:
       set_brick_datatype(brick, _DT_INT_);
       set_brick_byte(brick, (nbyte = sizeof(int)));
-      alloc_2D((void***)&brick->vint, nb, nc, nbyte);
       break;
     case _DT_USHORT_:
       set_brick_datatype(brick, _DT_USHORT_);
       set_brick_byte(brick, (nbyte = sizeof(ushort)));
-      alloc_2D((void***)&brick->vushort, nb, nc, nbyte);
       break;
     default:
       printf("unknown datatype for allocating brick. ");
       return FAILURE;
   }
 
+  brick->stride = ((size_t)nc*nbyte + SLAB_ALIGN-1) / SLAB_ALIGN * SLAB_ALIGN / nbyte;
+
+  alloc_bands(band_memory(brick), nb, brick->stride, nbyte, &brick->slab);
+
   return SUCCESS;
 }
 
@@ -283,33 +347,30 @@ int nbyte;
 +++ Return:   SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int reallocate_brick_bands(brick_t *brick, int nb){
+int b;
 int nbyte = get_brick_byte(brick);
 int nb0 = get_brick_nbands(brick);
-int nc0 = get_brick_ncells(brick);
 int nc  = get_brick_ncells(brick);
-int datatype = get_brick_datatype(brick);
+void ***ptr = band_memory(brick);
+void **arr0 = NULL;
+size_t stride0 = brick->stride;
+size_t slab0   = brick->slab;
+size_t ncopy;
 
 
-  switch (datatype){
-    case _DT_SHORT_:
-      re_alloc_2D((void***)&brick->vshort, nb0, nc0, nb, nc, nbyte);
-      break;
-    case _DT_SMALL_:
-      re_alloc_2D((void***)&brick->vsmall, nb0, nc0, nb, nc, nbyte);
-      break;
-    case _DT_FLOAT_:
-      re_alloc_2D((void***)&brick->vfloat, nb0, nc0, nb, nc, nbyte);
-      break;
-    case _DT_INT_:
-      re_alloc_2D((void***)&brick->vint, nb0, nc0, nb, nc, nbyte);
-      break;
-    case _DT_USHORT_:
-      re_alloc_2D((void***)&brick->vushort, nb0, nc0, nb, nc, nbyte);
-      break;
-    default:
-      printf("unknown datatype for allocating brick. ");
-      return FAILURE;
-  }
+  if (ptr == NULL){
+    printf("unknown datatype for allocating brick. ");
+    return FAILURE;}
+
+  arr0  = *ptr;
+  ncopy = ((size_t)nc < stride0) ? (size_t)nc : stride0;
+
+  brick->stride = ((size_t)nc*nbyte + SLAB_ALIGN-1) / SLAB_ALIGN * SLAB_ALIGN / nbyte;
+  alloc_bands(ptr, nb, brick->stride, nbyte, &brick->slab);
+
+  for (b=0; b<nb && b<nb0; b++) memcpy((*ptr)[b], arr0[b], ncopy*nbyte);
+
+  free_bands(arr0, slab0);
 
   return SUCCESS;
 }
@@ -344,23 +405,22 @@ void copy_brick_band(brick_t *brick, int b, brick_t *from, int b_from){
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void free_brick_bands(brick_t *brick){
-int nb;
 
   if (brick == NULL) return;
-  
-  nb = get_brick_nbands(brick);
 
-  if (brick->vshort  != NULL) free_2D((void**)brick->vshort,  nb); 
-  if (brick->vsmall  != NULL) free_2D((void**)brick->vsmall,  nb); 
-  if (brick->vfloat  != NULL) free_2D((void**)brick->vfloat,  nb); 
-  if (brick->vint    != NULL) free_2D((void**)brick->vint,    nb); 
-  if (brick->vushort != NULL) free_2D((void**)brick->vushort, nb); 
+  if (brick->vshort  != NULL) free_bands((void**)brick->vshort,  brick->slab); 
+  if (brick->vsmall  != NULL) free_bands((void**)brick->vsmall,  brick->slab); 
+  if (brick->vfloat  != NULL) free_bands((void**)brick->vfloat,  brick->slab); 
+  if (brick->vint    != NULL) free_bands((void**)brick->vint,    brick->slab); 
+  if (brick->vushort != NULL) free_bands((void**)brick->vushort, brick->slab); 
   
   brick->vshort  = NULL;
   brick->vsmall  = NULL;  
   brick->vfloat  = NULL;  
   brick->vint    = NULL;  
   brick->vushort = NULL;  
+  brick->stride  = 0;
+  brick->slab    = 0;
 
   return;
 }
@@ -556,6 +616,8 @@ int i;
   brick->vint    = NULL;
   brick->vushort = NULL;
   brick->vsmall   = NULL;
+  brick->stride  = 0;
+  brick->slab    = 0;
 
   return;  
 }
@@ -812,11 +874,9 @@ int i = 0;
 
 
   // output path
-  if ((lock = (char*)CPLLockFile(brick->dname, 60)) == NULL){
-    printf("Unable to lock directory %s (timeout: %ds). ", brick->dname, 60);
-    return FAILURE;}
+  if ((lock = lock_file(brick->dname, 60)) == NULL) return FAILURE;
   createdir(brick->dname);
-  CPLUnlockFile(lock);
+  unlock_file(lock);
   lock = NULL;
 
   // provenance file
@@ -842,9 +902,7 @@ int i = 0;
 
     timeout = lock_timeout(get_brick_size(brick));
 
-    if ((lock = (char*)CPLLockFile(fname, timeout)) == NULL){
-      printf("Unable to lock file %s (timeout: %fs, nx/ny: %d/%d). ", fname, timeout, brick->nx, brick->ny);
-      return FAILURE;}
+    if ((lock = lock_file(fname, timeout)) == NULL) return FAILURE;
 
 
     // mosaicking into existing file
@@ -1051,14 +1109,12 @@ int i = 0;
     GDALClose(fp);
 
   
-    CPLUnlockFile(lock);
+    unlock_file(lock);
   
     // write provenance info
     if (brick->nprovenance > 0 && brick->chunk <= 0){
 
-      if ((lock = (char*)CPLLockFile(provname, timeout)) == NULL){
-        printf("Unable to lock file %s (timeout: %fs). ", provname, timeout);
-        return FAILURE;}
+      if ((lock = lock_file(provname, timeout)) == NULL) return FAILURE;
 
       if (fileexist(provname)){
 
@@ -1085,7 +1141,7 @@ int i = 0;
 
       fclose(fprov);
 
-      CPLUnlockFile(lock);
+      unlock_file(lock);
 
     }
   
@@ -1132,6 +1188,8 @@ double src_geotran[6];
 double dst_geotran[6];
 short *src_ = NULL;
 short **buf_ = NULL;
+short **dst_ = NULL;
+size_t dst_slab;
 short nodata;
 int src_nx, src_ny, src_nc;
 int dst_nx, dst_ny, dst_nc;
@@ -1244,6 +1302,9 @@ char **papszWarpOptions = NULL;
   #endif
 
 
+  // band memory of warped brick, the bands need to be back-to-back for the warper
+  alloc_bands((void***)&dst_, nb, dst_nc, sizeof(short), &dst_slab);
+
   // iterate over chunks of bands (this is more expensive than warping all bands at once,
   // but way less expensive than each band at once. it helps to stay below RAM limit of 8GB
   for (b=0; b<nb; b+=chunk_nb){
@@ -1269,8 +1330,8 @@ char **papszWarpOptions = NULL;
       printf("could not create image to image transformer. "); return FAILURE;}
 
 
-    // buffer to hold warped image
-    alloc_2DC((void***)&buf_, chunk_nb, dst_nc, sizeof(short));
+    // the warped bands of this chunk are contiguous in the new band memory
+    buf_ = dst_ + b;
     for (b_=0; b_<chunk_nb; b_++){
       if ((nodata = get_brick_nodata(src, b+b_)) != 0){
         #pragma omp parallel shared(b_, dst_nc, buf_, nodata) default(none) 
@@ -1346,12 +1407,7 @@ char **papszWarpOptions = NULL;
     GDALDestroyGenImgProjTransformer(wopt->pTransformerArg);
     GDALDestroyWarpOptions(wopt);
   
-    for (b_=0; b_<chunk_nb; b_++){
-      re_alloc((void**)&src->vshort[b_+b], src_nc, dst_nc, sizeof(short));
-      memmove(src->vshort[b_+b], buf_[b_], dst_nc*sizeof(short));
-    }
-
-    free((void*)buf_[0]); free((void*)buf_); buf_ = NULL;
+    buf_ = NULL;
 
     GDALClose(dst_dataset);
 
@@ -1363,6 +1419,12 @@ char **papszWarpOptions = NULL;
 
   GDALClose(src_dataset);
 
+  // replace band memory
+  free_bands((void**)src->vshort, src->slab);
+  src->vshort = dst_;
+  src->stride = dst_nc;
+  src->slab   = dst_slab;
+
 
   // update geo metadata
   set_brick_geotran(src, dst_geotran);
@@ -2284,6 +2346,17 @@ size_t size = 0;
 }
 
 
+/** This function returns the number of cells between the bands of a 
++++ brick, i.e. band b starts at band 0 + b*stride
+--- brick:  brick
++++ Return: stride
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t get_brick_stride(brick_t *brick){
+
+  return brick->stride;
+}
+
+
 /** This function sets the number of columns in chunk of a brick
 --- brick:  brick
 --- cx:     number of columns in chunk
@@ -100,6 +100,8 @@ typedef struct {
   int    **vint;         // data (z/xy flattened by line)
   ushort **vushort;      // data (z/xy flattened by line)
   small  **vsmall;       // data (z/xy flattened by line)
+  size_t stride;         // number of cells between bands
+  size_t slab;           // number of bytes of band memory
     
 } brick_t;
 
@@ -163,6 +165,7 @@ int      get_brick_nrows(brick_t *brick);
 void     set_brick_ncells(brick_t *brick, int nc);
 int      get_brick_ncells(brick_t *brick);
 size_t   get_brick_size(brick_t *brick);
+size_t   get_brick_stride(brick_t *brick);
 void     set_brick_chunkncols(brick_t *brick, int cx);
 int      get_brick_chunkncols(brick_t *brick);
 void     set_brick_chunknrows(brick_t *brick, int cy);
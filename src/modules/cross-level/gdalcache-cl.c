@@ -0,0 +1,356 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric 
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2025 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for caching open GDAL dataset handles.
+Opening a dataset (header parsing, open syscalls) is expensive on network
+file systems, and the same files are opened over and over again when a 
+tile is processed in several chunks. Handles are kept open in a cache of
+bounded size, and the least recently used handle is closed when the cache
+is full. GDAL handles must not be used by several threads at the same 
+time. Therefore, a handle is checked out exclusively. If a file is 
+requested while its cached handle is in use, another handle is opened.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "gdalcache-cl.h"
+
+#include <stdint.h>  // integer types
+#include <sys/resource.h> // resource operations
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+
+#define GDALCACHE_MAX_FILES 65536 // never use more file descriptors than this
+
+typedef struct {
+  char file[NPOW_10];   // filename
+  GDALDatasetH dataset; // open dataset handle
+  bool busy;            // is the handle checked out?
+  int fnext;            // next entry in filename chain
+  int hnext;            // next entry in handle chain
+  int prev, next;       // neighbors in LRU list
+} gdalcache_entry_t;
+
+typedef struct {
+  omp_lock_t lock;
+  gdalcache_entry_t *entry;
+  int *fbucket;         // hash buckets, keyed by filename
+  int *hbucket;         // hash buckets, keyed by handle
+  int nbucket;          // number of hash buckets
+  int capacity;         // maximum number of cached handles
+  int n;                // number of cached handles
+  int head, tail;       // most and least recently used entry
+} gdalcache_t;
+
+gdalcache_t *gdalcache = NULL;
+
+
+int gdalcache_hash_file(const char *file);
+int gdalcache_hash_handle(GDALDatasetH dataset);
+void gdalcache_unlink(int k);
+void gdalcache_touch(int k);
+
+
+/** This function computes the hash bucket of a filename
+--- file:   filename
++++ Return: hash bucket
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int gdalcache_hash_file(const char *file){
+unsigned long hash = 5381;
+int c;
+
+
+  while ((c = *file++)) hash = ((hash << 5) + hash) + c;
+
+  return (int)(hash % gdalcache->nbucket);
+}
+
+
+/** This function computes the hash bucket of a dataset handle
+--- dataset: dataset handle
++++ Return:  hash bucket
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int gdalcache_hash_handle(GDALDatasetH dataset){
+uintptr_t hash = (uintptr_t)dataset;
+
+
+  hash = (hash >> 4) ^ (hash >> 16);
+
+  return (int)(hash % gdalcache->nbucket);
+}
+
+
+/** This function removes an entry from the hash chains and from the LRU
++++ list. The cache must be locked.
+--- k:      entry
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void gdalcache_unlink(int k){
+gdalcache_entry_t *entry = gdalcache->entry;
+int *link = NULL;
+
+
+  link = &gdalcache->fbucket[gdalcache_hash_file(entry[k].file)];
+  while (*link != k) link = &entry[*link].fnext;
+  *link = entry[k].fnext;
+
+  link = &gdalcache->hbucket[gdalcache_hash_handle(entry[k].dataset)];
+  while (*link != k) link = &entry[*link].hnext;
+  *link = entry[k].hnext;
+
+  if (entry[k].prev >= 0) entry[entry[k].prev].next = entry[k].next; else gdalcache->head = entry[k].next;
+  if (entry[k].next >= 0) entry[entry[k].next].prev = entry[k].prev; else gdalcache->tail = entry[k].prev;
+
+  entry[k].prev = entry[k].next = -1;
+
+  return;
+}
+
+
+/** This function moves an entry to the front of the LRU list. The cache 
++++ must be locked.
+--- k:      entry
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void gdalcache_touch(int k){
+gdalcache_entry_t *entry = gdalcache->entry;
+
+
+  if (gdalcache->head == k) return;
+
+  // detach
+  if (entry[k].prev >= 0) entry[entry[k].prev].next = entry[k].next;
+  if (entry[k].next >= 0) entry[entry[k].next].prev = entry[k].prev; else gdalcache->tail = entry[k].prev;
+
+  // prepend
+  entry[k].prev = -1;
+  entry[k].next = gdalcache->head;
+  if (gdalcache->head >= 0) entry[gdalcache->head].prev = k;
+  gdalcache->head = k;
+
+  return;
+}
+
+
+/** This function initializes the dataset cache. If the capacity is not
++++ given, it is derived from the open file limit, which is raised to the
++++ hard limit if possible. Half of the file descriptors are left for 
++++ output and other purposes. Without initialization, datasets are not 
++++ cached, i.e. open_gdalcache and close_gdalcache fall back to plain 
++++ GDALOpenEx and GDALClose.
+--- capacity: maximum number of cached handles (0: automatic)
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_gdalcache(int capacity){
+struct rlimit limit;
+int k;
+
+
+  if (gdalcache != NULL) return;
+
+  if (capacity <= 0){
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < GDALCACHE_MAX_FILES &&
+       (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > limit.rlim_cur)){
+      limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > GDALCACHE_MAX_FILES) 
+                     ? GDALCACHE_MAX_FILES : limit.rlim_max;
+      if (setrlimit(RLIMIT_NOFILE, &limit) != 0) getrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > GDALCACHE_MAX_FILES){
+      capacity = GDALCACHE_MAX_FILES/2;
+    } else {
+      capacity = (int)(limit.rlim_cur/2);
+    }
+
+  }
+
+  if (capacity < 1) return;
+
+  #ifdef FORCE_DEBUG
+  printf("caching up to %d GDAL datasets\n", capacity);
+  #endif
+
+  alloc((void**)&gdalcache, 1, sizeof(gdalcache_t));
+  alloc((void**)&gdalcache->entry, capacity, sizeof(gdalcache_entry_t));
+
+  gdalcache->capacity = capacity;
+  gdalcache->nbucket  = 2*capacity+1;
+  gdalcache->n        = 0;
+  gdalcache->head     = -1;
+  gdalcache->tail     = -1;
+
+  alloc((void**)&gdalcache->fbucket, gdalcache->nbucket, sizeof(int));
+  alloc((void**)&gdalcache->hbucket, gdalcache->nbucket, sizeof(int));
+  for (k=0; k<gdalcache->nbucket; k++) gdalcache->fbucket[k] = gdalcache->hbucket[k] = -1;
+
+  omp_init_lock(&gdalcache->lock);
+
+  return;
+}
+
+
+/** This function opens a dataset read-only, and checks out the handle. A
++++ cached handle is re-used if it is not in use by another thread. The
++++ handle must be returned with close_gdalcache.
+--- file:   filename
++++ Return: dataset handle (NULL if the file could not be opened)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+GDALDatasetH open_gdalcache(const char *file){
+gdalcache_entry_t *entry = NULL;
+GDALDatasetH dataset = NULL;
+GDALDatasetH victim  = NULL;
+int f, h, k;
+
+
+  if (gdalcache == NULL) return GDALOpenEx(file, GDAL_OF_READONLY, NULL, NULL, NULL);
+
+  entry = gdalcache->entry;
+
+  omp_set_lock(&gdalcache->lock);
+
+  f = gdalcache_hash_file(file);
+
+  for (k=gdalcache->fbucket[f]; k>=0; k=entry[k].fnext){
+    if (!entry[k].busy && strcmp(entry[k].file, file) == 0){
+      entry[k].busy = true;
+      gdalcache_touch(k);
+      omp_unset_lock(&gdalcache->lock);
+      return entry[k].dataset;
+    }
+  }
+
+  omp_unset_lock(&gdalcache->lock);
+
+
+  // open outside of the lock, this is the expensive part
+  if ((dataset = GDALOpenEx(file, GDAL_OF_READONLY, NULL, NULL, NULL)) == NULL) return NULL;
+
+  // filenames that do not fit are not cached
+  if (strlen(file) >= NPOW_10) return dataset;
+
+
+  omp_set_lock(&gdalcache->lock);
+
+  if (gdalcache->n < gdalcache->capacity){
+    k = gdalcache->n++;
+  } else {
+    // evict the least recently used handle that is not in use
+    for (k=gdalcache->tail; k>=0 && entry[k].busy; k=entry[k].prev);
+    if (k < 0){
+      omp_unset_lock(&gdalcache->lock);
+      return dataset;
+    }
+    victim = entry[k].dataset;
+    gdalcache_unlink(k);
+  }
+
+  copy_string(entry[k].file, NPOW_10, file);
+  entry[k].dataset = dataset;
+  entry[k].busy = true;
+
+  f = gdalcache_hash_file(file);
+  h = gdalcache_hash_handle(dataset);
+  entry[k].fnext = gdalcache->fbucket[f]; gdalcache->fbucket[f] = k;
+  entry[k].hnext = gdalcache->hbucket[h]; gdalcache->hbucket[h] = k;
+
+  entry[k].prev = -1;
+  entry[k].next = gdalcache->head;
+  if (gdalcache->head >= 0) entry[gdalcache->head].prev = k;
+  gdalcache->head = k;
+  if (gdalcache->tail < 0) gdalcache->tail = k;
+
+  omp_unset_lock(&gdalcache->lock);
+
+  if (victim != NULL) GDALClose(victim);
+
+  return dataset;
+}
+
+
+/** This function returns a dataset handle that was checked out with 
++++ open_gdalcache. Cached handles stay open, all others are closed.
+--- dataset: dataset handle
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void close_gdalcache(GDALDatasetH dataset){
+gdalcache_entry_t *entry = NULL;
+int k;
+
+
+  if (dataset == NULL) return;
+
+  if (gdalcache == NULL){
+    GDALClose(dataset);
+    return;
+  }
+
+  entry = gdalcache->entry;
+
+  omp_set_lock(&gdalcache->lock);
+
+  for (k=gdalcache->hbucket[gdalcache_hash_handle(dataset)]; k>=0; k=entry[k].hnext){
+    if (entry[k].dataset == dataset){
+      entry[k].busy = false;
+      omp_unset_lock(&gdalcache->lock);
+      return;
+    }
+  }
+
+  omp_unset_lock(&gdalcache->lock);
+
+  GDALClose(dataset);
+
+  return;
+}
+
+
+/** This function closes all cached datasets, and frees the cache. All
++++ handles must have been returned before.
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_gdalcache(){
+int k;
+
+
+  if (gdalcache == NULL) return;
+
+  for (k=0; k<gdalcache->n; k++){
+    if (gdalcache->entry[k].busy) printf("warning: GDAL dataset %s is still in use.\n", gdalcache->entry[k].file);
+    GDALClose(gdalcache->entry[k].dataset);
+  }
+
+  omp_destroy_lock(&gdalcache->lock);
+
+  free((void*)gdalcache->entry);
+  free((void*)gdalcache->fbucket);
+  free((void*)gdalcache->hbucket);
+  free((void*)gdalcache);
+  gdalcache = NULL;
+
+  return;
+}
+
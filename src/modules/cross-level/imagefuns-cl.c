@@ -299,6 +299,45 @@ int nx, ny;
 
 /** This function computes the distance transformation, i.e. the pixel 
 +++ distance of any FALSE cell to its next TRUE cell.
+--- image:  Binary image (only use with 0/1)
+--- nx:     number of columns
+--- ny:     number of rows
++++ Return: distance transformed image
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+ushort *dist_transform_(small *image, int nx, int ny){
+
+  return truncated_dist_transform_(image, nx, ny, 0);
+}
+
+
+/** This function computes the truncated distance transformation, i.e. 
++++ the pixel distance of any FALSE cell to its next TRUE cell. Distances
++++ larger than max are set to max. Brick entry point
+--- brick:  brick with binary image (only use with 0/1)
+--- b:      band
+--- max:    maximum distance (0 = no truncation)
++++ Return: distance transformed image
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+ushort *truncated_dist_transform(brick_t *brick, int b, int max){
+small *image = NULL;
+int nx, ny;
+
+  if ((image = get_band_small(brick, b)) == NULL) return NULL;
+
+  nx = get_brick_ncols(brick);
+  ny = get_brick_nrows(brick);
+
+  return truncated_dist_transform_(image, nx, ny, max);
+}
+
+
+/** This function computes the truncated distance transformation, i.e. 
++++ the pixel distance of any FALSE cell to its next TRUE cell. Distances
++++ larger than max are set to max. The column scans are done in strips
++++ of DT_STRIP columns, which are walked row by row, such that memory is
++++ accessed contiguously. When truncating, the column distances are cap-
++++ ped at max, and rows without any TRUE cell within max rows are skip-
++++ ped. Distances below max are identical to the full transformation.
 +++-----------------------------------------------------------------------
 +++ Meijster, A., Roerdink, J.B.T.M., Hesselink, W.H. (2006). A general 
 +++ algorithm for computing distance transforms in linear time. Computa-
@@ -307,42 +346,60 @@ int nx, ny;
 --- image:  Binary image (only use with 0/1)
 --- nx:     number of columns
 --- ny:     number of rows
+--- max:    maximum distance (0 = no truncation)
 +++ Return: distance transformed image
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-ushort *dist_transform_(small *image, int nx, int ny){
-int x, y, q, w, u;
+ushort *truncated_dist_transform_(small *image, int nx, int ny, int max){
+int x, y, x0, x1, q, w, u, g, d;
+int cap;
+bool far;
 int *s = NULL;
 int *t = NULL;
 ushort *G = NULL;
 ushort *distance = NULL;
 
 
+  if (max < 0){
+    printf("maximum distance must be >= 0. "); return NULL;}
+
+  cap = (max > 0) ? max : INT_MAX;
+
   alloc((void**)&distance, nx*ny, sizeof(ushort));
   alloc((void**)&G, nx*ny, sizeof(ushort));
 
   /** first phase **/
   
-  #pragma omp parallel private(y) shared(nx, ny, image, G) default(none) 
+  #pragma omp parallel private(x, x1, y, g) shared(nx, ny, cap, image, G) default(none) 
   {
 
     #pragma omp for schedule(static)
-    for (x=0; x<nx; x++){
+    for (x0=0; x0<nx; x0+=DT_STRIP){
+
+      x1 = (x0+DT_STRIP < nx) ? x0+DT_STRIP : nx;
 
       // scan 1
-      if (image[x]) G[x] = 0; else G[x] = nx+ny;
+      g = (nx+ny < cap) ? nx+ny : cap;
+      for (x=x0; x<x1; x++){
+        if (image[x]) G[x] = 0; else G[x] = g;
+      }
       
       for (y=1; y<ny; y++){
-        if (image[y*nx+x]){
-          G[y*nx+x] = 0;
-        } else {
-          G[y*nx+x] = 1 + G[(y-1)*nx+x];
+        for (x=x0; x<x1; x++){
+          if (image[y*nx+x]){
+            G[y*nx+x] = 0;
+          } else {
+            g = 1 + G[(y-1)*nx+x];
+            G[y*nx+x] = (g < cap) ? g : cap;
+          }
         }
       }
 
       // scan 2    
       for (y=ny-2; y>=0; y--){
-        if (G[(y+1)*nx+x] < G[y*nx+x]){
-          G[y*nx+x] = 1 + G[(y+1)*nx+x];
+        for (x=x0; x<x1; x++){
+          if (G[(y+1)*nx+x] < G[y*nx+x]){
+            G[y*nx+x] = 1 + G[(y+1)*nx+x];
+          }
         }
       }
 
@@ -353,7 +410,7 @@ ushort *distance = NULL;
   
   /** second phase **/
   
-  #pragma omp parallel private(u, s, t, q, w) shared(nx, ny, image, G, distance) default(none) 
+  #pragma omp parallel private(u, s, t, q, w, d, far) shared(nx, ny, max, cap, image, G, distance) default(none) 
   {
     
     // allocate s and t
@@ -362,6 +419,15 @@ ushort *distance = NULL;
 
     #pragma omp for schedule(static)
     for (y=0; y<ny; y++){
+
+      // no TRUE cell within max rows, all distances are truncated
+      if (max > 0){
+        for (u=0, far=true; u<nx && far; u++) far = (G[y*nx+u] >= cap);
+        if (far){
+          for (u=0; u<nx; u++) distance[y*nx+u] = (ushort)cap;
+          continue;
+        }
+      }
     
       q = 0; s[0] = 0; t[0] = 0;
     
@@ -386,7 +452,8 @@ ushort *distance = NULL;
     
       // scan 4
       for (u=nx-1; u>=0; u--){
-        distance[y*nx+u] = (ushort) sqrt(dt_dfun(nx, u, s[q], y, G));
+        d = (int) sqrt(dt_dfun(nx, u, s[q], y, G));
+        distance[y*nx+u] = (ushort) ((d < cap) ? d : cap);
         if (u == t[q]) q--;
       }
     
@@ -37,6 +37,10 @@ Image methods header
 #include "../cross-level/queue-cl.h"
 
 
+// number of columns per strip in the distance transformation
+#define DT_STRIP 128
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,6 +54,8 @@ int majorfill(brick_t *brick, int b);
 int majorfill_(small *image, int nx, int ny);
 ushort *dist_transform(brick_t *brick, int b);
 ushort *dist_transform_(small *image, int nx, int ny);
+ushort *truncated_dist_transform(brick_t *brick, int b, int max);
+ushort *truncated_dist_transform_(small *image, int nx, int ny, int max);
 int dt_dfun(int nx, int x, int i, int y, ushort *G);
 int dt_Sep(int nx, int i, int u, int y, ushort *G);
 int connectedcomponents(brick_t *brick, int b_brick, brick_t *segmentation, int b_segmentation);
@@ -27,22 +27,49 @@ This file contains a public interface for locking files
 
 #include "lock-cl.h"
 
-/** Geospatial Data Abstraction Library (GDAL) **/
-#include "cpl_multiproc.h" // CPL Multi-Threading
+#include <math.h>   // common mathematical functions
 
+/** C POSIX library **/
+#include <errno.h>  // error numbers
+#include <fcntl.h>  // file control options
+#include <unistd.h> // standard symbolic constants and types 
 
-/** Lock a file
+
+#define LOCK_WAIT 500000 // microseconds to sleep while the file is locked
+
+
+/** Lock a file. The lockfile is created atomically (O_EXCL), thus the 
++++ lock is safe between threads and processes.
 --- fname:   filename
 --- timeout: try to lock the file for a maximum time of x seconds
 +++ Return:  filename of lockfile
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 char *lock_file(char *fname, int timeout){
 char *lock = NULL;
+size_t size;
+double waited = 0;
+int fd;
+
+
+  size = strlen(fname) + 6;
+  alloc((void**)&lock, size, sizeof(char));
+  snprintf(lock, size, "%s.lock", fname);
+
+  while ((fd = open(lock, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0){
+
+    if (errno != EEXIST || waited >= timeout){
+      printf("Unable to lock file (timeout: %ds): %s\n", timeout, fname); 
+      free((void*)lock);
+      return NULL;
+    }
+
+    usleep(LOCK_WAIT);
+    waited += LOCK_WAIT/1e6;
 
-  if ((lock = (char*)CPLLockFile(fname, timeout)) == NULL){
-    printf("Unable to lock file (timeout: %ds): %s\n", timeout, fname); 
   }
 
+  close(fd);
+
   return lock;
 }
 
@@ -53,7 +80,12 @@ char *lock = NULL;
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void unlock_file(char *lock){
 
-  CPLUnlockFile(lock);
+
+  if (lock == NULL) return;
+
+  unlink(lock);
+  free((void*)lock);
+
   return;
 }
 
@@ -30,6 +30,9 @@ Lockfiles header
 
 #include <stdio.h>   // core input and output functions
 #include <stdlib.h>  // standard general utilities library
+#include <string.h>  // string handling functions
+
+#include "../cross-level/alloc-cl.h"
 
 
 #ifdef __cplusplus
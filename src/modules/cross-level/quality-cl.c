@@ -27,6 +27,12 @@ This file contains functions for quality assurance
 
 #include "quality-cl.h"
 
+// evaluate rule sets with the best vector instruction set available
+#define QAI_TARGETS __attribute__((target_clones("avx512f","avx2","sse4.2","default")))
+
+// number of pixels that are screened at once
+#define QAI_BLOCK 4096
+
 
 /** This function sets any quality bit in the QAI layer
 +++ Attention: this function implements no safety measures! 
@@ -57,10 +63,7 @@ void set_qai(brick_t *qai, int index, int p, short val){
 +++ Return:    void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 short get_qai(brick_t *qai, int index, int p, int bitfields){
-int i;
-short val = 0;
-
-  for (i=0; i<bitfields; i++) val |= (short)(1 << i);
+short val = (short)((1 << bitfields) - 1);
 
   return (short)(qai->vshort[0][p] >> index) & val;
 }
@@ -233,3 +236,122 @@ void set_vaporfill(brick_t *qai, int p, short val){
   set_qai(qai, _QAI_BIT_WVP_, p, val);
 }
 
+
+/** This function initializes an empty QAI rule set, i.e. no pixel is
++++ rejected.
+--- rules:  QAI rule set
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_qai_rules(qai_rules_t *rules){
+
+  rules->n = 0;
+
+  return;
+}
+
+
+/** This function adds a rule to a QAI rule set. A pixel is rejected if 
++++ the bits given by mask equal value. Use the _QAI_MASK_ and _QAI_VALUE_
++++ macros, e.g. _QAI_MASK_CLD_ and _QAI_VALUE_(_QAI_BIT_CLD_, 2) to re-
++++ ject confident, opaque clouds. Duplicate rules are ignored.
+--- rules:  QAI rule set
+--- mask:   tested bits
+--- value:  rejected value of tested bits
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int add_qai_rule(qai_rules_t *rules, ushort mask, ushort value){
+int r;
+
+
+  for (r=0; r<rules->n; r++){
+    if (rules->mask[r] == mask && rules->value[r] == value) return SUCCESS;
+  }
+
+  if (rules->n >= QAI_MAX_RULES){
+    printf("too many QAI rules (max. %d). ", QAI_MAX_RULES); return FAILURE;}
+
+  rules->mask[rules->n]  = mask;
+  rules->value[rules->n] = (ushort)(value & mask);
+  rules->n++;
+
+  return SUCCESS;
+}
+
+
+/** This function evaluates a QAI rule set for an array of QAI words. The
++++ array is processed in blocks, and each rule is applied to the complete
++++ block with vector instructions.
+--- qai:    QAI words
+--- n:      number of QAI words
+--- rules:  QAI rule set
+--- msk:    1 if the pixel passes all rules, 0 if not (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+QAI_TARGETS
+void evaluate_qai_rules(const short *qai, int n, const qai_rules_t *rules, small *msk){
+int p, p0, p1, r;
+ushort mask, value;
+
+
+  for (p0=0; p0<n; p0+=QAI_BLOCK){
+
+    p1 = (p0+QAI_BLOCK < n) ? p0+QAI_BLOCK : n;
+
+    #pragma omp simd
+    for (p=p0; p<p1; p++) msk[p] = 1;
+
+    for (r=0; r<rules->n; r++){
+
+      mask  = rules->mask[r];
+      value = rules->value[r];
+
+      #pragma omp simd
+      for (p=p0; p<p1; p++) msk[p] &= (small)((((ushort)qai[p]) & mask) != value);
+
+    }
+
+  }
+
+  return;
+}
+
+
+
+/** This function compiles a QAI rule set into a lookup table, which holds
++++ the result of the rule set for every possible QAI word. The table is
++++ indexed with the QAI word, interpreted as unsigned short.
+--- rules:  QAI rule set
+--- lut:    lookup table with QAI_LUT_SIZE elements (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void compile_qai_lut(const qai_rules_t *rules, small *lut){
+short word[QAI_BLOCK];
+int v, v0;
+
+
+  for (v0=0; v0<QAI_LUT_SIZE; v0+=QAI_BLOCK){
+    for (v=0; v<QAI_BLOCK; v++) word[v] = (short)(ushort)(v0+v);
+    evaluate_qai_rules(word, QAI_BLOCK, rules, lut+v0);
+  }
+
+  return;
+}
+
+
+/** This function screens an array of QAI words with a lookup table, that
++++ was compiled with compile_qai_lut.
+--- qai:    QAI words
+--- n:      number of QAI words
+--- lut:    lookup table
+--- msk:    1 if the pixel passes all rules, 0 if not (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void lookup_qai(const short *qai, int n, const small *lut, small *msk){
+int p;
+
+
+  for (p=0; p<n; p++) msk[p] = lut[(ushort)qai[p]];
+
+  return;
+}
+
@@ -33,6 +33,35 @@ Quality assurance header
 extern "C" {
 #endif
 
+// constant QAI bit masks
+#define _QAI_MASK_OFF_ ((ushort)(1 << _QAI_BIT_OFF_))
+#define _QAI_MASK_CLD_ ((ushort)(3 << _QAI_BIT_CLD_))
+#define _QAI_MASK_SHD_ ((ushort)(1 << _QAI_BIT_SHD_))
+#define _QAI_MASK_SNW_ ((ushort)(1 << _QAI_BIT_SNW_))
+#define _QAI_MASK_WTR_ ((ushort)(1 << _QAI_BIT_WTR_))
+#define _QAI_MASK_AOD_ ((ushort)(3 << _QAI_BIT_AOD_))
+#define _QAI_MASK_SUB_ ((ushort)(1 << _QAI_BIT_SUB_))
+#define _QAI_MASK_SAT_ ((ushort)(1 << _QAI_BIT_SAT_))
+#define _QAI_MASK_SUN_ ((ushort)(1 << _QAI_BIT_SUN_))
+#define _QAI_MASK_ILL_ ((ushort)(3 << _QAI_BIT_ILL_))
+#define _QAI_MASK_SLP_ ((ushort)(1 << _QAI_BIT_SLP_))
+#define _QAI_MASK_WVP_ ((ushort)(1 << _QAI_BIT_WVP_))
+
+// value of a (multi-bit) QAI flag, shifted into place
+#define _QAI_VALUE_(bit, val) ((ushort)((val) << (bit)))
+
+#define QAI_MAX_RULES 32
+
+// number of entries of a QAI lookup table, i.e. all 16bit QAI words
+#define QAI_LUT_SIZE 65536
+
+// QAI rule set, a pixel is rejected if (qai & mask) == value for any rule
+typedef struct {
+  int n;                        // number of rules
+  ushort mask[QAI_MAX_RULES];   // tested bits
+  ushort value[QAI_MAX_RULES];  // rejected value of tested bits
+} qai_rules_t;
+
 void set_qai(brick_t *qai, int index, int p, short val);
 short get_qai(brick_t *qai, int index, int p, int bitfields);
 bool get_off(brick_t *qai, int p);
@@ -59,6 +88,11 @@ void set_lowsun(brick_t *qai, int p, short val);
 void set_illumination(brick_t *qai, int p, short val);
 void set_slope(brick_t *qai, int p, short val);
 void set_vaporfill(brick_t *qai, int p, short val);
+void init_qai_rules(qai_rules_t *rules);
+int add_qai_rule(qai_rules_t *rules, ushort mask, ushort value);
+void evaluate_qai_rules(const short *qai, int n, const qai_rules_t *rules, small *msk);
+void compile_qai_lut(const qai_rules_t *rules, small *lut);
+void lookup_qai(const short *qai, int n, const small *lut, small *msk);
 
 #ifdef __cplusplus
 }
@@ -38,6 +38,9 @@ This file contains functions for statistics
 
 void quantile_swap(float *x, int from, int to);
 int comp(const void *a, const void *b);
+void multiselect(double *x, int lo, int hi, int *rank, int a, int b, int depth);
+int quantile_ranks(int n, float *p, int np, int *rank);
+double quantile_from_ranks(double *x, int n, float p);
 
 
 /** One-pass variance and covariance estimation
@@ -658,8 +661,9 @@ float abst, tsq, p, z;
 
 
 /** Quantile
-+++ This function computes a quantile of an array. The quick select algo-
-+++ rithm is used for to sort the array. Caution: the array will be screwed up.
++++ This function computes a quantile of an array. The array is completely
++++ sorted, use quantiles() for computing several quantiles of the same 
++++ array. Caution: the array will be screwed up.
 +++ Copy the array before calling the quantile function.
 --- x:      array
 --- n:      length of array
@@ -677,6 +681,302 @@ double q;
 }
 
 
+/** Multiple order statistics
++++ This function moves the elements with the given ranks to their sorted
++++ position, i.e. x[rank] is the same as in a completely sorted array. 
++++ Smaller elements end up left, larger elements right of each rank. The
++++ array is partitioned around a median-of-three pivot (3-way, which is 
++++ fast for the many duplicates in integer data), and only the partitions
++++ that contain ranks are processed further. Small partitions are sorted, 
++++ and so are partitions that exceed the recursion depth (introselect).
+--- x:      array
+--- lo:     first element of partition
+--- hi:     last element of partition
+--- rank:   sorted ranks
+--- a:      first rank in partition
+--- b:      end of ranks in partition (exclusive)
+--- depth:  remaining recursion depth
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void multiselect(double *x, int lo, int hi, int *rank, int a, int b, int depth){
+int i, lt, gt, mid, a1, b1;
+double pivot, tmp;
+
+
+  while (a < b && lo < hi){
+
+    if (hi-lo < 16 || depth-- <= 0){
+      gsl_sort(x+lo, 1, hi-lo+1);
+      return;
+    }
+
+    // median of three
+    mid = lo + (hi-lo)/2;
+    if (x[mid] < x[lo]){ tmp = x[mid]; x[mid] = x[lo];  x[lo]  = tmp;}
+    if (x[hi]  < x[lo]){ tmp = x[hi];  x[hi]  = x[lo];  x[lo]  = tmp;}
+    if (x[hi]  < x[mid]){tmp = x[hi];  x[hi]  = x[mid]; x[mid] = tmp;}
+    pivot = x[mid];
+
+    // 3-way partition: [lo,lt) < pivot, [lt,gt] == pivot, (gt,hi] > pivot
+    lt = lo; gt = hi; i = lo;
+    while (i <= gt){
+      if (x[i] < pivot){
+        tmp = x[i]; x[i++] = x[lt]; x[lt++] = tmp;
+      } else if (x[i] > pivot){
+        tmp = x[i]; x[i] = x[gt]; x[gt--] = tmp;
+      } else {
+        i++;
+      }
+    }
+
+    for (a1=a;  a1<b && rank[a1] < lt;  a1++);
+    for (b1=a1; b1<b && rank[b1] <= gt; b1++);
+
+    // left partition, then continue with right partition
+    multiselect(x, lo, lt-1, rank, a, a1, depth);
+    lo = gt+1; a = b1;
+
+  }
+
+  return;
+}
+
+
+/** This function collects the ranks that are needed to compute quantiles
++++ (lower and upper neighbour of each quantile position), sorted and 
++++ without duplicates.
+--- n:      length of array
+--- p:      probabilities [0,1]
+--- np:     number of probabilities (max. QUANTILE_MAX)
+--- rank:   ranks (returned)
++++ Return: number of ranks
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int quantile_ranks(int n, float *p, int np, int *rank){
+int i, j, k, r, nr = 0;
+int lhs;
+
+
+  for (i=0; i<np; i++){
+
+    lhs = (int)(p[i]*(double)(n-1));
+
+    for (k=0; k<2; k++){
+
+      if ((r = lhs+k) > n-1) break;
+
+      // insert into sorted ranks, skip duplicates
+      for (j=nr; j>0 && rank[j-1] > r; j--);
+      if (j > 0 && rank[j-1] == r) continue;
+      memmove(rank+j+1, rank+j, sizeof(int)*(nr-j));
+      rank[j] = r;
+      nr++;
+
+    }
+
+  }
+
+  return nr;
+}
+
+
+/** This function computes a quantile from an array, in which the ranks
++++ of the quantile position are at their sorted position. The definition
++++ is the same as gsl_stats_quantile_from_sorted_data.
+--- x:      array
+--- n:      length of array
+--- p:      probability [0,1]
++++ Return: quantile
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double quantile_from_ranks(double *x, int n, float p){
+double index = p*(double)(n-1);
+int lhs = (int)index;
+double delta = index-lhs;
+
+
+  if (n == 0) return 0.0;
+
+  if (lhs == n-1) return x[lhs];
+
+  return (1-delta)*x[lhs] + delta*x[lhs+1];
+}
+
+
+/** Multiple quantiles
++++ This function computes several quantiles of an array at once. The 
++++ array is not sorted. Instead, only the elements that are needed for the
++++ quantiles are selected (multiselect). The results are identical to 
++++ quantile(). Caution: the array will be screwed up.
++++ Copy the array before calling the quantiles function.
+--- x:      array
+--- n:      length of array
+--- p:      probabilities [0,1]
+--- np:     number of probabilities
+--- q:      quantiles (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void quantiles(double *x, int n, float *p, int np, float *q){
+int rank[2*QUANTILE_MAX];
+int i, j, k, nr, depth;
+
+
+  for (depth=0, i=n; i>1; i>>=1) depth += 2;
+
+  for (j=0; j<np; j+=QUANTILE_MAX){
+
+    k = (np-j < QUANTILE_MAX) ? np-j : QUANTILE_MAX;
+
+    if (n > 0){
+      nr = quantile_ranks(n, p+j, k, rank);
+      multiselect(x, 0, n-1, rank, 0, nr, depth);
+    }
+
+    for (i=j; i<j+k; i++) q[i] = (float)quantile_from_ranks(x, n, p[i]);
+
+  }
+
+  return;
+}
+
+
+/** Quantile sketch
++++ This function initializes a histogram-based quantile sketch for 16bit
++++ integer data. The memory is bounded by the bin width, and does not 
++++ depend on the number of values. Quantiles are approximate, the error 
++++ is at most half of the bin width.
+--- sketch: quantile sketch
+--- width:  bin width (1 = exact)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_quantile_sketch(qsketch_t *sketch, int width){
+
+
+  sketch->width = (width < 1) ? 1 : width;
+  sketch->nbin  = (USHRT_MAX / sketch->width) + 1;
+  sketch->n     = 0;
+  sketch->lo    = sketch->nbin;
+  sketch->hi    = -1;
+
+  alloc((void**)&sketch->count, sketch->nbin, sizeof(int));
+
+  return;
+}
+
+
+/** This function frees a quantile sketch
+--- sketch: quantile sketch
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_quantile_sketch(qsketch_t *sketch){
+
+
+  if (sketch->count != NULL) free((void*)sketch->count);
+  sketch->count = NULL;
+
+  return;
+}
+
+
+/** This function empties a quantile sketch. Only the bins in the used 
++++ range are cleared.
+--- sketch: quantile sketch
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void reset_quantile_sketch(qsketch_t *sketch){
+
+
+  if (sketch->hi >= sketch->lo){
+    memset(sketch->count+sketch->lo, 0, sizeof(int)*(sketch->hi-sketch->lo+1));
+  }
+
+  sketch->n  = 0;
+  sketch->lo = sketch->nbin;
+  sketch->hi = -1;
+
+  return;
+}
+
+
+/** This function adds a value to a quantile sketch
+--- sketch: quantile sketch
+--- x:      value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_quantile_sketch(qsketch_t *sketch, short x){
+int b = ((int)x-SHRT_MIN) / sketch->width;
+
+
+  sketch->count[b]++;
+  sketch->n++;
+  if (b < sketch->lo) sketch->lo = b;
+  if (b > sketch->hi) sketch->hi = b;
+
+  return;
+}
+
+
+/** This function computes several quantiles from a quantile sketch. The
++++ sorted values are approximated by the centers of their bins, and the
++++ same quantile definition as in quantile() is used. The last bin may be
++++ partial, its center is computed from the values up to SHRT_MAX.
+--- sketch: quantile sketch
+--- p:      probabilities [0,1]
+--- np:     number of probabilities
+--- q:      quantiles (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void quantiles_sketch(qsketch_t *sketch, float *p, int np, float *q){
+int rank[2*QUANTILE_MAX];
+double value[2*QUANTILE_MAX];
+int i, j, k, r, b, nr, cum;
+int n = sketch->n;
+double index, delta, start, end;
+int lhs;
+
+
+  for (j=0; j<np; j+=QUANTILE_MAX){
+
+    k = (np-j < QUANTILE_MAX) ? np-j : QUANTILE_MAX;
+
+    if (n == 0){
+      for (i=j; i<j+k; i++) q[i] = 0;
+      continue;
+    }
+
+    // walk the histogram once, and pick the values of all ranks
+    nr = quantile_ranks(n, p+j, k, rank);
+
+    for (b=sketch->lo, r=0, cum=0; b<=sketch->hi && r<nr; b++){
+      cum += sketch->count[b];
+      start = (double)SHRT_MIN + (double)b*sketch->width;
+      end   = start + sketch->width-1;
+      if (end > SHRT_MAX) end = SHRT_MAX;
+      while (r < nr && rank[r] < cum){
+        value[r++] = 0.5*(start+end);
+      }
+    }
+
+    for (i=j; i<j+k; i++){
+
+      index = p[i]*(double)(n-1);
+      lhs   = (int)index;
+      delta = index-lhs;
+
+      for (r=0; rank[r] != lhs; r++);
+
+      if (lhs == n-1){
+        q[i] = (float)value[r];
+      } else {
+        q[i] = (float)((1-delta)*value[r] + delta*value[r+1]);
+      }
+
+    }
+
+  }
+
+  return;
+}
+
+
 /** Mode
 +++ This function computes the mode of an array. The array is completely
 +++ sorted. Caution: the array will be screwed up.
@@ -798,3 +1098,76 @@ int comp(const void *a, const void *b){
   return ( *(int*)a - *(int*)b );
 }
 
+
+/** This function seeds a random number generator. The generator is a
++++ SplitMix64, i.e. the sequence only depends on the seed, and multiple 
++++ generators can be used independently, e.g. in different threads.
++++-----------------------------------------------------------------------
++++ Steele, G.L., Lea, D., Flood, C.H. (2014). Fast splittable pseudoran-
++++ dom number generators. ACM SIGPLAN Notices, 49, 453-472.
++++-----------------------------------------------------------------------
+--- rng:    random number generator
+--- seed:   seed
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_rng(rng_t *rng, unsigned long long seed){
+
+  rng->state = seed;
+
+  return;
+}
+
+
+/** This function draws the next 64bit random number
+--- rng:    random number generator
++++ Return: random number
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+unsigned long long rng_next(rng_t *rng){
+unsigned long long z;
+
+  z = (rng->state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+
+/** This function draws an unbiased random integer in [0,n)
+--- rng:    random number generator
+--- n:      upper bound (exclusive)
++++ Return: random integer
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int rng_int(rng_t *rng, int n){
+unsigned long long limit, z;
+
+  if (n <= 1) return 0;
+
+  // reject the incomplete range at the top
+  limit = ULLONG_MAX - ULLONG_MAX % (unsigned long long)n;
+
+  do {
+    z = rng_next(rng);
+  } while (z >= limit);
+
+  return (int)(z % (unsigned long long)n);
+}
+
+
+/** This function shuffles an array (Fisher-Yates)
+--- rng:    random number generator
+--- x:      array (modified)
+--- n:      length of array
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void shuffle(rng_t *rng, int *x, int n){
+int i, j, tmp;
+
+  for (i=n-1; i>0; i--){
+    j = rng_int(rng, i+1);
+    tmp = x[i]; x[i] = x[j]; x[j] = tmp;
+  }
+
+  return;
+}
+
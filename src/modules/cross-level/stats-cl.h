@@ -32,6 +32,8 @@ Statistics header
 #include <stdlib.h>  // standard general utilities library
 #include <stdbool.h> // boolean data type
 #include <math.h>    // common mathematical functions
+#include <limits.h>  // macro constants of the integer types
+#include <string.h>  // string handling functions
 
 #include "../cross-level/const-cl.h"
 #include "../cross-level/alloc-cl.h"
@@ -41,6 +43,22 @@ Statistics header
 extern "C" {
 #endif
 
+#define QUANTILE_MAX 100 // number of quantiles that are selected at once
+
+// histogram-based quantile sketch for 16bit integer data
+typedef struct {
+  int width;   // bin width
+  int nbin;    // number of bins
+  int n;       // number of values
+  int lo, hi;  // range of used bins
+  int *count;  // histogram
+} qsketch_t;
+
+// seeded random number generator
+typedef struct {
+  unsigned long long state;
+} rng_t;
+
 void covar_recurrence(double   x, double   y, double *mx, double *my, double *vx, double *vy, double *cv, double n);
 void cov_recurrence(double   x, double   y, double *mx, double *my, double *cv, double n);
 void kurt_recurrence(double   x,    double *mx, double *vx,    double *sx,double *kx, double n);
@@ -68,9 +86,19 @@ float tscore_Hills_inv_t(float p, int idf);
 float tscore_T_z(float t, int df);
 float tscore_T_p(float t, int df);
 float quantile(double *x, int n, float p);
+void quantiles(double *x, int n, float *p, int np, float *q);
+void init_quantile_sketch(qsketch_t *sketch, int width);
+void free_quantile_sketch(qsketch_t *sketch);
+void reset_quantile_sketch(qsketch_t *sketch);
+void add_quantile_sketch(qsketch_t *sketch, short x);
+void quantiles_sketch(qsketch_t *sketch, float *p, int np, float *q);
 int mode(int *x, int n);
 int n_uniq(int *x, int n);
 int **histogram(int *x, int n, int *n_uniq);
+void init_rng(rng_t *rng, unsigned long long seed);
+unsigned long long rng_next(rng_t *rng);
+int rng_int(rng_t *rng, int n);
+void shuffle(rng_t *rng, int *x, int n);
 
 #ifdef __cplusplus
 }
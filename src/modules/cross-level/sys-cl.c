@@ -149,3 +149,19 @@ char path[NPOW_10];
   return;
 }
 
+
+/** This function returns the physical memory that is currently available
++++ Return: available memory in bytes (0 if unknown)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t available_memory(){
+long pages, size;
+
+
+  pages = sysconf(_SC_AVPHYS_PAGES);
+  size  = sysconf(_SC_PAGESIZE);
+
+  if (pages <= 0 || size <= 0) return 0;
+
+  return (size_t)pages * (size_t)size;
+}
+
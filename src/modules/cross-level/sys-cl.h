@@ -45,6 +45,7 @@ extern "C" {
 char **system_info(int *n);
 void get_install_path(char *buf, size_t size);
 void get_install_directory(char *buf, size_t size);
+size_t available_memory();
 
 #ifdef __cplusplus
 }
@@ -338,6 +338,10 @@ bool is_empty;
     #pragma omp parallel private(p,f) shared(ard_,ard_tex_,cf_,cf_tex_,pred_,cfi,ncf,ny,nx,npc,ard_nodata,cf_nodata,KDIST,nk,mink,phl,y) default(none)
     {
 
+      // scratch memory of this thread, grows to the size needed for one pixel
+      arena_t arena;
+      init_arena(&arena, 0);
+
       #pragma omp for collapse(2) schedule(guided)
       for (i=0; i<ny; i++){
       for (j=0; j<nx; j++){
@@ -347,13 +351,15 @@ bool is_empty;
         if (cf_[0][p] == cf_nodata) continue;
 
         improphe(ard_, ard_tex_, cf_, cf_tex_, pred_, KDIST, ard_nodata, cf_nodata, i, j, p, 
-          nx, ny, phl->imp.ksize, npc, ncf, nk, mink);
+          nx, ny, phl->imp.ksize, npc, ncf, nk, mink, &arena);
 
         for (f=0; f<ncf; f++) cfi.imp_[f][y][p] = pred_[f][p];
 
       }
       }
 
+      free_arena(&arena);
+
     }
     
 
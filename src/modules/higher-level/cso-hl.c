@@ -217,7 +217,8 @@ int nc;
 int nw;
 short nodata = SHRT_MIN;
 short minimum, maximum;
-short q25_, q75_;
+float q_prob[102], q_value[102];
+int nq = 0;
 double mean, var;
 double skew, kurt;
 double skewscaled, kurtscaled;
@@ -294,9 +295,13 @@ bool alloc_q_array = false;
 
   
   if (phl->cso.sta.quantiles || phl->cso.sta.iqr > -1) alloc_q_array = true;
+
+  // all quantiles are computed at once, IQR quartiles at the end
+  for (q=0; q<phl->cso.sta.nquantiles; q++) q_prob[nq++] = phl->cso.sta.q[q];
+  if (phl->cso.sta.iqr > -1){ q_prob[nq++] = 0.25; q_prob[nq++] = 0.75;}
   
 
-  #pragma omp parallel private(o,t,w,minimum,maximum,q,q_array,mean,var,skew,kurt,n,k,skewscaled,kurtscaled,q25_,q75_,d_ce,ce,ce_left) shared(mask_,cs,nc,nw,nt,nodata,alloc_q_array,phl,t0,t1,nprod,ard) default(none)
+  #pragma omp parallel private(o,t,w,minimum,maximum,q,q_array,mean,var,skew,kurt,n,k,skewscaled,kurtscaled,q_value,d_ce,ce,ce_left) shared(mask_,cs,nc,nw,nt,nodata,alloc_q_array,q_prob,nq,phl,t0,t1,nprod,ard) default(none)
   {
 
     if (alloc_q_array) alloc((void**)&q_array, nt+1, sizeof(double));
@@ -317,7 +322,6 @@ bool alloc_q_array = false;
         mean = var = skew = kurt = n = k = 0;
         skewscaled = kurtscaled = 0;
         minimum = SHRT_MAX; maximum = SHRT_MIN;
-        q25_ = q75_ = SHRT_MIN;
 
         if (t0[w] > -1){
 
@@ -378,18 +382,14 @@ bool alloc_q_array = false;
         if (phl->cso.sta.skw > -1) cs.cso_[phl->cso.sta.skw][w][p] = (short)skewscaled;
         if (phl->cso.sta.krt > -1) cs.cso_[phl->cso.sta.krt][w][p] = (short)kurtscaled;
 
-        if (phl->cso.sta.quantiles){
-          for (q=0; q<phl->cso.sta.nquantiles; q++){
-            cs.cso_[phl->cso.sta.qxx[q]][w][p] = (short)quantile(q_array, n, phl->cso.sta.q[q]);
-            if (phl->cso.sta.q[q] == 0.25) q25_ = cs.cso_[phl->cso.sta.qxx[q]][w][p];
-            if (phl->cso.sta.q[q] == 0.75) q75_ = cs.cso_[phl->cso.sta.qxx[q]][w][p];
-          }
+        if (alloc_q_array) quantiles(q_array, n, q_prob, nq, q_value);
+
+        for (q=0; q<phl->cso.sta.nquantiles; q++){
+          cs.cso_[phl->cso.sta.qxx[q]][w][p] = (short)q_value[q];
         }
 
         if (phl->cso.sta.iqr > -1){
-          if (q25_ == SHRT_MIN) q25_ = (short)quantile(q_array, n, 0.25);
-          if (q75_ == SHRT_MIN) q75_ = (short)quantile(q_array, n, 0.75);
-          cs.cso_[phl->cso.sta.iqr][w][p] = q75_-q25_;
+          cs.cso_[phl->cso.sta.iqr][w][p] = (short)q_value[nq-1] - (short)q_value[nq-2];
         }
 
       
@@ -28,164 +28,277 @@ This file contains functions for folding time series
 #include "fold-hl.h"
 
 
-enum { _YEAR_, _QUARTER_, _MONTH_, _WEEK_, _DOY_ };
+enum { _YEAR_, _QUARTER_, _MONTH_, _WEEK_, _DOY_, _FOLD_LENGTH_ };
 
-int fold(short **tsi_, date_t *d_tsi, small *mask_, int nc, int ni, short **fld_, date_t *d_fld, int nf, short nodata, int by, par_hl_t *phl);
+typedef struct {
+  short **fld_;   // folded image array
+  date_t *d_fld;  // dates of folded time series
+  int nf;         // number of folds
+  int by;         // aggregation period
+} fold_t;
 
+int fold_key(date_t *date, int by);
+int fold(short **tsi_, date_t *d_tsi, small *mask_, int nc, int ni, fold_t *folds, int nk, short nodata, par_hl_t *phl);
 
-/** This function folds the time series in a given aggregation period
+
+/** This function returns the date component that is used for folding
+--- date:   date
+--- by:     aggregation period
++++ Return: year, quarter, month, week or DOY
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int fold_key(date_t *date, int by){
+
+
+  switch (by){
+    case _YEAR_:
+      return date->year;
+    case _QUARTER_:
+      return date->quarter;
+    case _MONTH_:
+      return date->month;
+    case _WEEK_:
+      return date->week;
+    case _DOY_:
+      return date->doy;
+  }
+
+  return -1;
+}
+
+
+/** This function folds the time series in several aggregation periods at
++++ once. The folds of all periods are numbered consecutively, and each
++++ interpolation step is mapped to the fold it contributes to (for each
++++ period) before the pixels are processed. Thus, each time series is 
++++ only scanned once, and all folds are accumulated in this single pass.
 --- tsi_:   interpolated image array
 --- d_tsi_: interpolation dates
 --- mask:   mask image
 --- nc:     number of cells
 --- ni:     number of interpolation steps
---- fld_:   folded image array (returned)
---- d_fld:  dates of folded time series
---- nf:     number of folds
+--- folds:  folded image arrays with dates and aggregation period
+--- nk:     number of aggregation periods
 --- nodata: nodata value
---- by:     aggregation period
 --- phl:    HL parameters
 +++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-int fold(short **tsi_, date_t *d_tsi, small *mask_, int nc, int ni, short **fld_, date_t *d_fld, int nf, short nodata, int by, par_hl_t *phl){
-int f, t, n, p;
-short minimum, maximum;
-double mean, var;
-double skew, kurt;
+int fold(short **tsi_, date_t *d_tsi, small *mask_, int nc, int ni, fold_t *folds, int nk, short nodata, par_hl_t *phl){
+int f, g, k, t, p, ng = 0;
+int base[_FOLD_LENGTH_];
+int *owner = NULL, *map = NULL, *offset = NULL;
+int *n = NULL;
+short *minimum = NULL, *maximum = NULL;
+double *mean = NULL, *var = NULL;
+double *skew = NULL, *kurt = NULL;
 double skewscaled, kurtscaled;
 double *q_array = NULL; // need to be double for GSL quantile function
 bool alloc_q_array = false;
+float q_prob[2], q_value[2];
+int p0, np;
+short *tsi_block = NULL, *tsi_p = NULL;
+int *map_t = NULL;
+short value;
 
 
-  if (fld_ == NULL) return CANCEL;
+  if (nk < 1) return CANCEL;
 
   if ((phl->tsa.fld.type >= _STA_Q01_ && phl->tsa.fld.type <= _STA_Q99_) ||
        phl->tsa.fld.type == _STA_IQR_) alloc_q_array = true;
-  
 
-  #pragma omp parallel private(f,t,minimum,maximum,q_array,mean,var,skew,kurt,n,skewscaled,kurtscaled) shared(mask_,tsi_,fld_,d_fld,d_tsi,nc,ni,nf,by,nodata,phl,alloc_q_array) default(none)
+  if (phl->tsa.fld.type == _STA_IQR_){
+    q_prob[0] = 0.25; q_prob[1] = 0.75;
+  } else if (alloc_q_array){
+    q_prob[0] = q_prob[1] = (phl->tsa.fld.type-_STA_Q01_+1)/100.0;
+  }
+
+
+  // number the folds of all periods consecutively
+  for (k=0; k<nk; k++){ base[k] = ng; ng += folds[k].nf;}
+
+  if (ng < 1) return CANCEL;
+
+  alloc((void**)&owner,  ng, sizeof(int));
+  alloc((void**)&offset, ng, sizeof(int));
+  alloc((void**)&map, (size_t)ni*nk, sizeof(int));
+
+  // folds with the same date component share their statistics,
+  // the first of them owns the accumulators
+  for (k=0; k<nk; k++){
+    for (f=0; f<folds[k].nf; f++){
+      owner[base[k]+f] = base[k]+f;
+      for (g=0; g<f; g++){
+        if (fold_key(&folds[k].d_fld[g], folds[k].by) == 
+            fold_key(&folds[k].d_fld[f], folds[k].by)){
+          owner[base[k]+f] = base[k]+g; break;
+        }
+      }
+    }
+  }
+
+  // step-to-fold map, and number of steps per fold
+  for (t=0; t<ni; t++){
+    for (k=0; k<nk; k++){
+      map[t*nk+k] = -1;
+      for (f=0; f<folds[k].nf; f++){
+        if (fold_key(&d_tsi[t], folds[k].by) == fold_key(&folds[k].d_fld[f], folds[k].by)){
+          map[t*nk+k] = owner[base[k]+f]; 
+          offset[owner[base[k]+f]]++;
+          break;
+        }
+      }
+    }
+  }
+
+  // each fold gets its own segment in the quantile array
+  for (g=0, p=0; g<ng; g++){ t = offset[g]; offset[g] = p; p += t;}
+
+
+  #pragma omp parallel private(f,g,k,t,n,minimum,maximum,q_array,mean,var,skew,kurt,skewscaled,kurtscaled,q_value,value,p,np,tsi_block,tsi_p,map_t) shared(mask_,tsi_,folds,nk,base,owner,map,offset,ng,nc,ni,nodata,phl,alloc_q_array,q_prob) default(none)
   {
-    
+
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     // initialize _STAts
-    if (alloc_q_array) alloc((void**)&q_array, ni, sizeof(double));
+    alloc((void**)&n,       ng, sizeof(int));
+    alloc((void**)&minimum, ng, sizeof(short));
+    alloc((void**)&maximum, ng, sizeof(short));
+    alloc((void**)&mean,    ng, sizeof(double));
+    alloc((void**)&var,     ng, sizeof(double));
+    alloc((void**)&skew,    ng, sizeof(double));
+    alloc((void**)&kurt,    ng, sizeof(double));
+    if (alloc_q_array) alloc((void**)&q_array, (size_t)ni*nk, sizeof(double));
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (f=0; f<nf; f++) fld_[f][p] = nodata;
-        continue;
-      }
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(tsi_, ni, p0, np, tsi_block);
+
+      for (p=p0; p<p0+np; p++){
 
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
-      for (f=0; f<nf; f++){
-
-        mean = var = skew = kurt = n = 0;
-        minimum = SHRT_MAX; maximum = SHRT_MIN;
-
-        // compute _STAts
-        for (t=0; t<ni; t++){
-
-          switch (by){
-            case _YEAR_:
-              if (d_tsi[t].year != d_fld[f].year) continue;
-              break;
-            case _QUARTER_:
-              if (d_tsi[t].quarter != d_fld[f].quarter) continue;
-    //printf("%d %d - Q FLD: %d, Q TSI: %d\n", f, t, d_fld[f].quarter, d_tsi[t].quarter);
-    //print_date(&d_fld[f]);
-    //print_date(&d_tsi[t]);
-              break;
-            case _MONTH_:
-              if (d_tsi[t].month != d_fld[f].month) continue;
-              break;
-            case _WEEK_:
-              if (d_tsi[t].week  != d_fld[f].week) continue;
-    //printf("%d %d - W FLD: %d, W TSI: %d\n", f, t, d_fld[f].week, d_tsi[t].week);
-    //print_date(&d_fld[f]);
-    //print_date(&d_tsi[t]);
-              break;
-            case _DOY_:
-              if (d_tsi[t].doy != d_fld[f].doy) continue;
-              break;
+        if (mask_ != NULL && !mask_[p]){
+          for (k=0; k<nk; k++){
+            for (f=0; f<folds[k].nf; f++) folds[k].fld_[f][p] = nodata;
           }
+          continue;
+        }
 
-          if (tsi_[t][p] == nodata) continue;
 
-          
-          // range metrics
-          if (tsi_[t][p] < minimum) minimum = tsi_[t][p];
-          if (tsi_[t][p] > maximum) maximum = tsi_[t][p];
+        for (g=0; g<ng; g++){
+          mean[g] = var[g] = skew[g] = kurt[g] = n[g] = 0;
+          minimum[g] = SHRT_MAX; maximum[g] = SHRT_MIN;
+        }
 
-          // quantile metrics
-          if (alloc_q_array) q_array[n] = tsi_[t][p];
+        // compute _STAts of all folds in one pass
+        for (t=0, map_t=map; t<ni; t++, map_t+=nk){
 
-          n++;
+          if (tsi_p[t] == nodata) continue;
 
-          // moments metrics
-          kurt_recurrence(tsi_[t][p], &mean, &var, 
-                            &skew, &kurt, n);
+          for (k=0; k<nk; k++){
 
-        }
+            if ((g = map_t[k]) < 0) continue;
 
-        
-        // fold by mean (0), min (1), max (2)
-        if (n > 0){
-
-          switch (phl->tsa.fld.type){
-            case _STA_NUM_:
-              fld_[f][p] = n;
-              break;
-            case _STA_AVG_:
-              fld_[f][p] = (short)mean;
-              break;
-            case _STA_MIN_:
-              fld_[f][p] = minimum;
-              break;
-            case _STA_MAX_:
-              fld_[f][p] = maximum;
-              break;
-            case _STA_RNG_:
-              fld_[f][p] = maximum-minimum;
-              break;
-            case _STA_STD_:
-              fld_[f][p] = (short)standdev(var, n);
-              break;
-            case _STA_SKW_:
-              skewscaled = skewness(var, skew, n)*1000;
-              if (skewscaled < -30000) skewscaled = -30000;
-              if (skewscaled >  30000) skewscaled =  30000;
-              fld_[f][p] = (short)skewscaled;
-              break;
-            case _STA_KRT_:
-              kurtscaled = (kurtosis(var, kurt, n)-3)*1000;
-              if (kurtscaled < -30000) kurtscaled = -30000;
-              if (kurtscaled >  30000) kurtscaled =  30000;
-              fld_[f][p] = (short)kurtscaled;
-              break;
-            case _STA_IQR_:
-              fld_[f][p] = (short)(quantile(q_array, n, 0.75)-quantile(q_array, n, 0.25));
-              break;
-          }
+            // range metrics
+            if (tsi_p[t] < minimum[g]) minimum[g] = tsi_p[t];
+            if (tsi_p[t] > maximum[g]) maximum[g] = tsi_p[t];
+
+            // quantile metrics
+            if (alloc_q_array) q_array[offset[g]+n[g]] = tsi_p[t];
+
+            n[g]++;
+
+            // moments metrics
+            kurt_recurrence(tsi_p[t], &mean[g], &var[g], 
+                              &skew[g], &kurt[g], n[g]);
 
-          if (phl->tsa.fld.type >= _STA_Q01_ && phl->tsa.fld.type <= _STA_Q99_){
-            fld_[f][p] = (short)quantile(q_array, n, (phl->tsa.fld.type-_STA_Q01_+1)/100.0);
           }
 
-        } else {
+        }
+
 
-          fld_[f][p] = nodata;
+        // fold by mean (0), min (1), max (2)
+        for (k=0; k<nk; k++){
+          for (f=0; f<folds[k].nf; f++){
+
+            g = owner[base[k]+f];
+
+            if (n[g] > 0){
+
+              value = nodata;
+
+              switch (phl->tsa.fld.type){
+                case _STA_NUM_:
+                  value = n[g];
+                  break;
+                case _STA_AVG_:
+                  value = (short)mean[g];
+                  break;
+                case _STA_MIN_:
+                  value = minimum[g];
+                  break;
+                case _STA_MAX_:
+                  value = maximum[g];
+                  break;
+                case _STA_RNG_:
+                  value = maximum[g]-minimum[g];
+                  break;
+                case _STA_STD_:
+                  value = (short)standdev(var[g], n[g]);
+                  break;
+                case _STA_SKW_:
+                  skewscaled = skewness(var[g], skew[g], n[g])*1000;
+                  if (skewscaled < -30000) skewscaled = -30000;
+                  if (skewscaled >  30000) skewscaled =  30000;
+                  value = (short)skewscaled;
+                  break;
+                case _STA_KRT_:
+                  kurtscaled = (kurtosis(var[g], kurt[g], n[g])-3)*1000;
+                  if (kurtscaled < -30000) kurtscaled = -30000;
+                  if (kurtscaled >  30000) kurtscaled =  30000;
+                  value = (short)kurtscaled;
+                  break;
+                case _STA_IQR_:
+                  quantiles(q_array+offset[g], n[g], q_prob, 2, q_value);
+                  value = (short)(q_value[1]-q_value[0]);
+                  break;
+              }
+
+              if (phl->tsa.fld.type >= _STA_Q01_ && phl->tsa.fld.type <= _STA_Q99_){
+                quantiles(q_array+offset[g], n[g], q_prob, 1, q_value);
+                value = (short)q_value[0];
+              }
+
+              folds[k].fld_[f][p] = value;
+
+            } else {
+
+              folds[k].fld_[f][p] = nodata;
+
+            }
 
+          }
         }
 
       }
-      
+
     }
-   
+
     if (alloc_q_array) free((void*)q_array);
-   
+    free((void*)n);
+    free((void*)minimum); free((void*)maximum);
+    free((void*)mean);    free((void*)var);
+    free((void*)skew);    free((void*)kurt);
+
+    free((void*)tsi_block);
+
   }
-  
+
+  free((void*)owner);
+  free((void*)offset);
+  free((void*)map);
+
 
   return SUCCESS;
 }
@@ -205,13 +318,18 @@ bool alloc_q_array = false;
 +++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int tsa_fold(tsa_t *ts, small *mask_, int nc, int ni, short nodata, par_hl_t *phl){
+fold_t folds[_FOLD_LENGTH_];
+int nk = 0;
+
 
+  if (ts->fby_ != NULL){ folds[nk].fld_ = ts->fby_; folds[nk].d_fld = ts->d_fby; folds[nk].nf = phl->ny; folds[nk++].by = _YEAR_;}
+  if (ts->fbq_ != NULL){ folds[nk].fld_ = ts->fbq_; folds[nk].d_fld = ts->d_fbq; folds[nk].nf = phl->nq; folds[nk++].by = _QUARTER_;}
+  if (ts->fbm_ != NULL){ folds[nk].fld_ = ts->fbm_; folds[nk].d_fld = ts->d_fbm; folds[nk].nf = phl->nm; folds[nk++].by = _MONTH_;}
+  if (ts->fbw_ != NULL){ folds[nk].fld_ = ts->fbw_; folds[nk].d_fld = ts->d_fbw; folds[nk].nf = phl->nw; folds[nk++].by = _WEEK_;}
+  if (ts->fbd_ != NULL){ folds[nk].fld_ = ts->fbd_; folds[nk].d_fld = ts->d_fbd; folds[nk].nf = phl->nd; folds[nk++].by = _DOY_;}
 
-  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, ts->fby_, ts->d_fby, phl->ny, nodata, _YEAR_,    phl);
-  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, ts->fbq_, ts->d_fbq, phl->nq, nodata, _QUARTER_, phl);
-  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, ts->fbm_, ts->d_fbm, phl->nm, nodata, _MONTH_,   phl);
-  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, ts->fbw_, ts->d_fbw, phl->nw, nodata, _WEEK_,    phl);
-  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, ts->fbd_, ts->d_fbd, phl->nd, nodata, _DOY_,     phl);
+  // all aggregation periods are folded in one pass
+  fold(ts->tsi_, ts->d_tsi, mask_, nc, ni, folds, nk, nodata, phl);
 
   return SUCCESS;
 }
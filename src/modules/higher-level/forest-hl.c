@@ -0,0 +1,395 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric 
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2025 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for flattening OpenCV Random Forest models
+into compact node arrays, and for evaluating them. The nodes of each tree
+are renumbered in breadth-first order and stored as structure of arrays.
+A block of samples is walked through each tree at once, which keeps the 
+upper levels of the tree in cache. The votes and predictions are the
+same as those of OpenCV, this is validated when flattening the model.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "forest-hl.h"
+
+/** OpenCV **/
+using namespace cv;
+using namespace cv::ml;
+
+
+#define FOREST_BLOCK 64 // number of samples that are walked through a tree at once
+#define FOREST_PROBE 64 // number of samples to validate a flattened forest
+
+
+void forest_leaves(forest_t *forest, int tree, const float *x, int nx, int *node);
+bool validate_forest(forest_t *forest, Ptr<RTrees> model);
+
+
+/** This function walks a block of samples through one tree. All samples
++++ advance by one level per sweep until they have reached a leaf.
+--- forest: flattened forest
+--- tree:   tree
+--- x:      samples [nx*nfeature]
+--- nx:     number of samples (max. FOREST_BLOCK)
+--- node:   leaf node of each sample (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void forest_leaves(forest_t *forest, int tree, const float *x, int nx, int *node){
+int i, k, active;
+float val;
+const int nf = forest->nfeature;
+
+
+  for (i=0; i<nx; i++) node[i] = forest->root[tree];
+
+  do {
+
+    for (i=0, active=0; i<nx; i++){
+
+      k = node[i];
+      if (forest->var[k] < 0) continue;
+
+      val = x[i*nf + forest->var[k]];
+
+      // missing values are coded as FLT_MAX in OpenCV
+      if (val == FLT_MAX){
+        node[i] = forest->miss[k];
+      } else {
+        node[i] = (val <= forest->thr[k]) ? forest->left[k] : forest->right[k];
+      }
+
+      active++;
+
+    }
+
+  } while (active > 0);
+
+  return;
+}
+
+
+/** This function checks that the flattened forest returns the same votes
++++ and predictions as the OpenCV model. The model is probed with samples,
++++ whose values are on, or next to the split thresholds.
+--- forest: flattened forest
+--- model:  Random Forest model
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool validate_forest(forest_t *forest, Ptr<RTrees> model){
+int i, j, f, k, c;
+unsigned int seed = 1;
+float *x = NULL, *pred = NULL;
+int *votes = NULL;
+bool valid = true;
+Mat probe(FOREST_PROBE, forest->nfeature, CV_32F);
+Mat ref;
+
+
+  for (i=0; i<FOREST_PROBE; i++){
+
+    x = probe.ptr<float>(i);
+    for (f=0; f<forest->nfeature; f++) x[f] = 0;
+
+    for (j=0; j<4*forest->nfeature; j++){
+
+      seed = seed*1103515245 + 12345;
+      k = (seed >> 8) % forest->nnode;
+      if (forest->var[k] < 0) continue;
+
+      switch (j % 3){
+        case 0:
+          x[forest->var[k]] = forest->thr[k];
+          break;
+        case 1:
+          x[forest->var[k]] = nextafterf(forest->thr[k],  FLT_MAX);
+          break;
+        default:
+          x[forest->var[k]] = nextafterf(forest->thr[k], -FLT_MAX);
+          break;
+      }
+
+    }
+
+  }
+
+  alloc((void**)&pred, FOREST_PROBE, sizeof(float));
+
+  model->predict(probe, ref);
+  forest_predict(forest, probe.ptr<float>(0), FOREST_PROBE, pred);
+
+  for (i=0; i<FOREST_PROBE; i++){
+    if (ref.at<float>(i,0) != pred[i]) valid = false;
+  }
+
+  if (forest->classifier){
+
+    alloc((void**)&votes, FOREST_PROBE*forest->nclass, sizeof(int));
+
+    model->getVotes(probe, ref, 0);
+    forest_votes(forest, probe.ptr<float>(0), FOREST_PROBE, votes);
+
+    if (ref.rows != FOREST_PROBE+1 || ref.cols != forest->nclass) valid = false;
+
+    for (i=0; i<FOREST_PROBE && valid; i++){
+      for (c=0; c<forest->nclass; c++){
+        if (ref.at<int>(i+1,c) != votes[i*forest->nclass+c]) valid = false;
+      }
+    }
+
+    free((void*)votes);
+
+  }
+
+  free((void*)pred);
+
+  return valid;
+}
+
+
+/** public functions
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+/** This function converts an OpenCV Random Forest model into a flattened
++++ forest. Models with categorical splits cannot be flattened.
+--- model:  Random Forest model
+--- nf:     number of features
++++ Return: flattened forest, or NULL if not supported
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+forest_t *flatten_forest(Ptr<RTrees> model, int nf){
+forest_t *forest = NULL;
+int t, c, k, n, old, head, tail, nmax;
+int *queue = NULL;
+bool error = false;
+Mat sample, vote;
+
+
+  if (model.empty() || !model->isTrained()) return NULL;
+
+  const std::vector<int> &roots = model->getRoots();
+  const std::vector<DTrees::Node> &nodes = model->getNodes();
+  const std::vector<DTrees::Split> &splits = model->getSplits();
+
+  if (roots.empty() || nodes.empty() || !model->getSubsets().empty()) return NULL;
+
+  nmax = (int)nodes.size();
+
+  alloc((void**)&forest, 1, sizeof(forest_t));
+  forest->classifier = model->isClassifier();
+  forest->ntree = (int)roots.size();
+  forest->nfeature = nf;
+
+  alloc((void**)&forest->root,  forest->ntree, sizeof(int));
+  alloc((void**)&forest->var,   nmax, sizeof(int));
+  alloc((void**)&forest->thr,   nmax, sizeof(float));
+  alloc((void**)&forest->left,  nmax, sizeof(int));
+  alloc((void**)&forest->right, nmax, sizeof(int));
+  alloc((void**)&forest->miss,  nmax, sizeof(int));
+  alloc((void**)&forest->cls,   nmax, sizeof(int));
+  alloc((void**)&forest->value, nmax, sizeof(double));
+  alloc((void**)&queue,         nmax, sizeof(int));
+
+
+  // class labels, these are only accessible through the votes
+  if (forest->classifier){
+
+    sample = Mat::zeros(1, nf, CV_32F);
+    model->getVotes(sample, vote, 0);
+
+    forest->nclass = vote.cols;
+    alloc((void**)&forest->label, forest->nclass, sizeof(int));
+    for (c=0; c<forest->nclass; c++) forest->label[c] = vote.at<int>(0,c);
+
+  }
+
+
+  // renumber the nodes of each tree in breadth-first order
+  for (t=0, n=0; t<forest->ntree && !error; t++){
+
+    forest->root[t] = n;
+    queue[0] = roots[t];
+
+    for (head=0, tail=1; head<tail && !error; head++){
+
+      old = queue[head];
+      k = n+head;
+
+      if (old < 0 || old >= nmax){ error = true; break;}
+
+      const DTrees::Node &node = nodes[old];
+
+      if (node.split < 0){
+
+        forest->var[k] = -1;
+        forest->left[k] = forest->right[k] = forest->miss[k] = -1;
+        forest->cls[k] = node.classIdx;
+        forest->value[k] = node.value;
+
+        if (forest->classifier && (node.classIdx < 0 || node.classIdx >= forest->nclass)) error = true;
+
+      } else {
+
+        const DTrees::Split &split = splits[node.split];
+
+        if (split.inversed || split.varIdx < 0 || split.varIdx >= nf || 
+            n+tail+2 > nmax){ error = true; break;}
+
+        forest->var[k] = split.varIdx;
+        forest->thr[k] = split.c;
+
+        forest->left[k]  = n+tail; queue[tail++] = node.left;
+        forest->right[k] = n+tail; queue[tail++] = node.right;
+        forest->miss[k]  = (node.defaultDir < 0) ? forest->left[k] : forest->right[k];
+
+      }
+
+    }
+
+    n += tail;
+
+  }
+
+  free((void*)queue);
+
+  forest->nnode = n;
+
+  if (error || !validate_forest(forest, model)){
+    free_forest(forest);
+    return NULL;
+  }
+
+  return forest;
+}
+
+
+/** This function frees a flattened forest
+--- forest: flattened forest
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_forest(forest_t *forest){
+
+  if (forest == NULL) return;
+
+  if (forest->label != NULL) free((void*)forest->label);
+  if (forest->root  != NULL) free((void*)forest->root);
+  if (forest->var   != NULL) free((void*)forest->var);
+  if (forest->thr   != NULL) free((void*)forest->thr);
+  if (forest->left  != NULL) free((void*)forest->left);
+  if (forest->right != NULL) free((void*)forest->right);
+  if (forest->miss  != NULL) free((void*)forest->miss);
+  if (forest->cls   != NULL) free((void*)forest->cls);
+  if (forest->value != NULL) free((void*)forest->value);
+  free((void*)forest);
+
+  return;
+}
+
+
+/** This function computes the votes of a classification forest, i.e. the
++++ number of trees that vote for each class. These are the same as the
++++ votes that are returned by OpenCV's getVotes (without the labels).
+--- forest: flattened forest
+--- x:      samples [nx*nfeature]
+--- nx:     number of samples
+--- votes:  votes [nx*nclass] (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void forest_votes(forest_t *forest, const float *x, int nx, int *votes){
+int i, i0, n, t;
+int node[FOREST_BLOCK];
+int *votes_ = NULL;
+
+
+  memset(votes, 0, nx*forest->nclass*sizeof(int));
+
+  for (i0=0; i0<nx; i0+=FOREST_BLOCK){
+
+    n = (i0+FOREST_BLOCK < nx) ? FOREST_BLOCK : nx-i0;
+    votes_ = votes + i0*forest->nclass;
+
+    for (t=0; t<forest->ntree; t++){
+      forest_leaves(forest, t, x+i0*forest->nfeature, n, node);
+      for (i=0; i<n; i++) votes_[i*forest->nclass + forest->cls[node[i]]]++;
+    }
+
+  }
+
+  return;
+}
+
+
+/** This function predicts samples with a flattened forest. For
++++ classification, the label of the class with most votes is returned,
++++ for regression the average of all trees.
+--- forest: flattened forest
+--- x:      samples [nx*nfeature]
+--- nx:     number of samples
+--- pred:   predictions [nx] (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void forest_predict(forest_t *forest, const float *x, int nx, float *pred){
+int i, i0, n, t, c, best;
+int node[FOREST_BLOCK];
+double sum[FOREST_BLOCK];
+int *votes = NULL, *votes_ = NULL;
+float scale = 1.0f/forest->ntree;
+
+
+  if (forest->classifier) alloc((void**)&votes, FOREST_BLOCK*forest->nclass, sizeof(int));
+
+  for (i0=0; i0<nx; i0+=FOREST_BLOCK){
+
+    n = (i0+FOREST_BLOCK < nx) ? FOREST_BLOCK : nx-i0;
+
+    if (forest->classifier){
+
+      forest_votes(forest, x+i0*forest->nfeature, n, votes);
+
+      for (i=0; i<n; i++){
+        votes_ = votes + i*forest->nclass;
+        for (c=1, best=0; c<forest->nclass; c++){
+          if (votes_[best] < votes_[c]) best = c;
+        }
+        pred[i0+i] = (float)forest->label[best];
+      }
+
+    } else {
+
+      for (i=0; i<n; i++) sum[i] = 0;
+
+      for (t=0; t<forest->ntree; t++){
+        forest_leaves(forest, t, x+i0*forest->nfeature, n, node);
+        for (i=0; i<n; i++) sum[i] += forest->value[node[i]];
+      }
+
+      for (i=0; i<n; i++) pred[i0+i] = (float)sum[i]*scale;
+
+    }
+
+  }
+
+  if (forest->classifier) free((void*)votes);
+
+  return;
+}
+
@@ -0,0 +1,73 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric 
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2025 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Flattened decision forest header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef FOREST_HL_H
+#define FOREST_HL_H
+
+#include <stdio.h>   // core input and output functions
+#include <stdlib.h>  // standard general utilities library
+#include <string.h>  // string handling functions
+#include <math.h>    // common mathematical functions
+#include <float.h>   // macro constants of the floating-point library
+
+#include <opencv2/ml.hpp>
+
+#include "../cross-level/const-cl.h"
+#include "../cross-level/alloc-cl.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  bool classifier; // classification or regression forest?
+  int ntree;       // number of trees
+  int nnode;       // number of nodes
+  int nclass;      // number of classes
+  int nfeature;    // number of features
+  int *label;      // class labels [nclass]
+  int *root;       // root node of each tree [ntree]
+  int *var;        // split feature [nnode], -1 for leaves
+  float *thr;      // split threshold [nnode]
+  int *left;       // left child [nnode]
+  int *right;      // right child [nnode]
+  int *miss;       // child for missing values [nnode]
+  int *cls;        // class index of leaves [nnode]
+  double *value;   // value of leaves [nnode]
+} forest_t;
+
+forest_t *flatten_forest(cv::Ptr<cv::ml::RTrees> model, int nf);
+void free_forest(forest_t *forest);
+void forest_votes(forest_t *forest, const float *x, int nx, int *votes);
+void forest_predict(forest_t *forest, const float *x, int nx, float *pred);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -54,9 +54,10 @@ This file contains functions for ImproPhing
 --- nb_mr:     number of bands in mr_
 --- nk:        number of kernel pixels
 --- mink:      minimum number of pixels for good prediction
+--- arena:     scratch memory of calling thread (reset for each pixel)
 +++ Return:    SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-int improphe(float **hr_, float *hr_tex_, float **mr_, float **mr_tex_, short **pred_, float **KDIST, float nodata_hr, short nodata_mr, int i, int j, int p, int nx, int ny, int h, int nb_hr, int nb_mr, int nk, int mink){
+int improphe(float **hr_, float *hr_tex_, float **mr_, float **mr_tex_, short **pred_, float **KDIST, float nodata_hr, short nodata_mr, int i, int j, int p, int nx, int ny, int h, int nb_hr, int nb_mr, int nk, int mink, arena_t *arena){
 int ki, kj; // iterator for KDIST
 int ii, jj; // iterator for kernel relative to center
 int ni, nj, np; // pixel positions
@@ -93,15 +94,16 @@ bool skip;
   if (skip) return SUCCESS;
 
 
-  // allocate
-  alloc((void**)&Sclass, nk, sizeof(int));
-  alloc((void**)&Srecord, nk, sizeof(double));
-  alloc((void**)&Trecord, nk, sizeof(double));
-  alloc_2D((void***)&Mrecord, nb_mr, nk, sizeof(double));
-  alloc_2D((void***)&Urecord, nb_mr, nk, sizeof(double));
-  alloc_3D((void****)&Urange, 2, nb_mr, ns, sizeof(double));
-  alloc((void**)&weightxdata, nb_mr, sizeof(double));
-  alloc((void**)&weight, nb_mr, sizeof(double));
+  // allocate (released with the next pixel)
+  reset_arena(arena);
+  arena_alloc(arena, (void**)&Sclass, nk, sizeof(int));
+  arena_alloc(arena, (void**)&Srecord, nk, sizeof(double));
+  arena_alloc(arena, (void**)&Trecord, nk, sizeof(double));
+  arena_alloc_2D(arena, (void***)&Mrecord, nb_mr, nk, sizeof(double));
+  arena_alloc_2D(arena, (void***)&Urecord, nb_mr, nk, sizeof(double));
+  arena_alloc_3D(arena, (void****)&Urange, 2, nb_mr, ns, sizeof(double));
+  arena_alloc(arena, (void**)&weightxdata, nb_mr, sizeof(double));
+  arena_alloc(arena, (void**)&weight, nb_mr, sizeof(double));
 
 
   // initialize
@@ -192,14 +194,6 @@ bool skip;
   // if no valid neighbour... damn.. use MR
   if (wn == 0){
     for (b_mr=0; b_mr<nb_mr; b_mr++) pred_[b_mr][p] = mr_[b_mr][p];
-    free((void*)Sclass);
-    free((void*)Srecord);
-    free((void*)Trecord);
-    free_2D((void**)Urecord, nb_mr);
-    free_2D((void**)Mrecord, nb_mr);
-    free((void*)weightxdata);
-    free((void*)weight);
-    free_3D((void***)Urange, 2, nb_mr);
     return SUCCESS;
   }
 
@@ -234,17 +228,6 @@ bool skip;
   // prediction -> weighted mean
   for (b_mr=0; b_mr<nb_mr; b_mr++) pred_[b_mr][p] = (float)(weightxdata[b_mr]/weight[b_mr]);
 
-
-  // tidy up things
-  free((void*)Sclass);
-  free((void*)Srecord);
-  free((void*)Trecord);
-  free_2D((void**)Urecord, nb_mr);
-  free_2D((void**)Mrecord, nb_mr);
-  free((void*)weightxdata);
-  free((void*)weight);
-  free_3D((void***)Urange, 2, nb_mr);
-
   return SUCCESS;
 }
 
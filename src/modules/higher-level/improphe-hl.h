@@ -32,6 +32,7 @@ ImproPhe header
 #include <stdlib.h>  // standard general utilities library
 
 #include "../cross-level/const-cl.h"
+#include "../cross-level/alloc-cl.h"
 #include "../cross-level/stats-cl.h"
 #include "../higher-level/read-ard-hl.h"
 
@@ -40,7 +41,7 @@ ImproPhe header
 extern "C" {
 #endif
 
-int improphe(float **hr_, float *hr_tex_, float **mr_, float **mr_tex_, short **pred_, float **KDIST, float nodata_hr, short nodata_mr, int i, int j, int p, int nx, int ny, int h, int nb_hr, int nb_mr, int nk, int mink);
+int improphe(float **hr_, float *hr_tex_, float **mr_, float **mr_tex_, short **pred_, float **KDIST, float nodata_hr, short nodata_mr, int i, int j, int p, int nx, int ny, int h, int nb_hr, int nb_mr, int nk, int mink, arena_t *arena);
 double rescale_weight(double weight, double minweight, double maxweight);
 short **average_season(ard_t *ard, small *mask_, int nb, int nc, int nt, short nodata, int nwin, int *dwin, int ywin, bool *is_empty);
 int standardize_float(float *data, float nodata, int nc);
@@ -34,6 +34,23 @@ This file contains functions for computing spectral indices
 
 enum { TCB, TCG, TCW, TCD};
 
+#define INDEX_BLOCK 4096 // number of pixels processed at once
+
+// compile kernels for several instruction sets, select at runtime; 
+// multiply-adds must not be fused (avx512f implies FMA) to stay bit-exact
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define INDEX_TARGETS __attribute__((target_clones("avx512f","avx2","sse4.2","default"), optimize("fp-contract=off")))
+#else
+#define INDEX_TARGETS
+#endif
+
+
+void band_row(const short *b_, const small *msk_, const small *mask_, short *tss_, int n, short nodata);
+void differenced_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata);
+void ratio_minus1_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata);
+void kernelized_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata);
+void resistance_row(const short *n_, const short *r_, const short *b_, const small *msk_, const small *mask_, float f1, float f2, float f3, float f4, float x, short *tss_, int n, short nodata);
+void tasseled_row(const short **band_, const small *msk_, const small *mask_, const float tc[3][6], const float *x, int comp0, int comp1, short *tss_, int n, short nodata);
 void index_band(ard_t *ard, small *mask_, tsa_t *ts, int b, int nc, int nt, short nodata);
 void index_differenced(ard_t *ard, small *mask_, tsa_t *ts, int b1, int b2, int nc, int nt, short nodata);
 void index_kernelized(ard_t *ard, small *mask_, tsa_t *ts, int b1, int b2, int nc, int nt, short nodata);
@@ -43,6 +60,244 @@ void index_unmixed(ard_t *ard, small *mask_, tsa_t *ts, int nc, int nt, short no
 void index_cont_remove(ard_t *ard, small *mask_, tsa_t *ts, int b_, int b1, int b2, float w_, float w1, float w2, int nc, int nt, short nodata);
 
 
+/** The index kernels below work on contiguous rows of pixels of one date,
++++ i.e. without branches in the pixel loop, such that the compiler can
++++ vectorize them. The kernels are compiled for several instruction sets,
++++ and the best version is selected at runtime. The arithmetic is exactly
++++ the same as in scalar code (no fused multiply-adds), i.e. results are 
++++ bit-identical.
++++ Pixels are valid if both the ARD mask (msk_) and the processing mask
++++ (mask_) are set. If there is no processing mask, msk_ is passed twice.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+/** This function copies a band row, and sets invalid pixels to nodata
+--- b_:     band
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void band_row(const short *b_, const small *msk_, const small *mask_, short *tss_, int n, short nodata){
+int p;
+short v;
+bool valid;
+
+
+  #pragma omp simd private(v,valid)
+  for (p=0; p<n; p++){
+    valid = (msk_[p] != 0) & (mask_[p] != 0);
+    v = b_[p];
+    tss_[p] = valid ? v : nodata;
+  }
+
+  return;
+}
+
+
+/** This function computes a row of a Normalized differenced index
+--- b1_:    band 1
+--- b2_:    band 2
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void differenced_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata){
+int p;
+float tmp, ind, scale = 10000.0, ind_[INDEX_BLOCK];
+small ok_[INDEX_BLOCK];
+bool valid;
+
+
+  // compute unconditionally first, the division would otherwise
+  // be sunk into a branch, which prevents vectorization
+  #pragma omp simd private(tmp,ind)
+  for (p=0; p<n; p++){
+    tmp = (b1_[p]+b2_[p]);
+    ind = (b1_[p]-b2_[p])/tmp;
+    ind_[p] = ind*scale;
+    ok_[p]  = (tmp != 0) & (ind >= -1) & (ind <= 1);
+  }
+
+  #pragma omp simd private(valid)
+  for (p=0; p<n; p++){
+    valid = (msk_[p] != 0) & (mask_[p] != 0) & (ok_[p] != 0);
+    tss_[p] = valid ? (short)ind_[p] : nodata;
+  }
+
+  return;
+}
+
+
+/** This function computes a row of a Ratio - 1 index
+--- b1_:    band 1
+--- b2_:    band 2
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void ratio_minus1_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata){
+int p;
+float ind, scale = 1000.0;
+short v;
+bool valid;
+
+
+  #pragma omp simd private(ind,v,valid)
+  for (p=0; p<n; p++){
+    ind = (b1_[p] / (float)b2_[p]) - 1.0;
+    valid = (msk_[p] != 0) & (mask_[p] != 0) & (b2_[p] != 0) & (ind*scale <= SHRT_MAX) & (ind*scale >= SHRT_MIN);
+    ind   = valid ? ind : 0;
+    v = (short)(ind*scale);
+    tss_[p] = valid ? v : nodata;
+  }
+
+  return;
+}
+
+
+/** This function computes a row of a kernelized Normalized differenced 
++++ index. The loop is vectorized like the other kernels, but exp() is 
++++ still evaluated per pixel with the scalar math library.
+--- b1_:    band 1
+--- b2_:    band 2
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void kernelized_row(const short *b1_, const short *b2_, const small *msk_, const small *mask_, short *tss_, int n, short nodata){
+int p;
+float sigma, diff, tmp, ind, scale = 10000.0;
+short v;
+bool valid;
+
+
+  #pragma omp simd private(sigma,diff,tmp,ind,v,valid)
+  for (p=0; p<n; p++){
+    valid = (msk_[p] != 0) & (mask_[p] != 0) & (b1_[p] > 0) & (b2_[p] > 0);
+    sigma = 0.5 * (b1_[p] + b2_[p]);
+    diff  = b1_[p] - b2_[p];
+    tmp   = exp(-(diff*diff) / (2*sigma*sigma));
+    ind   = (1-tmp) / (1+tmp);
+    ind   = valid ? ind : 0;
+    v = (short)(ind*scale);
+    tss_[p] = valid ? v : nodata;
+  }
+
+  return;
+}
+
+
+/** This function computes a row of a Normalized differenced index with 
++++ resistance terms
+--- n_:     band 1 (nir)
+--- r_:     band 2 (red)
+--- b_:     band 3 (blue)
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- f1:     correction factor 1
+--- f2:     correction factor 2
+--- f3:     correction factor 3
+--- f4:     correction factor 4
+--- x:      red-blue correction factor
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void resistance_row(const short *n_, const short *r_, const short *b_, const small *msk_, const small *mask_, float f1, float f2, float f3, float f4, float x, short *tss_, int n, short nodata){
+int p;
+float tmp, nir, red, blue, ind, scale = 10000.0, ind_[INDEX_BLOCK];
+small ok_[INDEX_BLOCK];
+bool valid;
+
+
+  // compute unconditionally first, see differenced_row
+  #pragma omp simd private(tmp,nir,red,blue,ind)
+  for (p=0; p<n; p++){
+    nir  = n_[p];
+    red  = r_[p];
+    blue = b_[p];
+    red -= x*(blue-red);
+    tmp = nir+f2*red-f3*blue+f4*scale;
+    ind = f1*(nir-red)/tmp;
+    ind_[p] = ind*scale;
+    ok_[p]  = (tmp != 0);
+  }
+
+  #pragma omp simd private(valid)
+  for (p=0; p<n; p++){
+    valid = (msk_[p] != 0) & (mask_[p] != 0) & (ok_[p] != 0);
+    tss_[p] = valid ? (short)ind_[p] : nodata;
+  }
+
+  return;
+}
+
+
+/** This function computes a row of a Tasseled Cap component
+--- band_:  bands (blue, green, red, nir, sw1, sw2)
+--- msk_:   ARD mask
+--- mask_:  processing mask
+--- tc:     Tasseled Cap coefficients
+--- x:      weights of components
+--- comp0:  first component
+--- comp1:  last component + 1
+--- tss_:   index row (returned)
+--- n:      number of pixels
+--- nodata: nodata value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+INDEX_TARGETS
+void tasseled_row(const short **band_, const small *msk_, const small *mask_, const float tc[3][6], const float *x, int comp0, int comp1, short *tss_, int n, short nodata){
+int p, i;
+float tmp, ind_[INDEX_BLOCK];
+short v;
+bool valid;
+const short *b_ = band_[0], *g_ = band_[1], *r_ = band_[2];
+const short *n_ = band_[3], *s1_ = band_[4], *s2_ = band_[5];
+
+
+  #pragma omp simd
+  for (p=0; p<n; p++) ind_[p] = 0;
+
+  for (i=comp0; i<comp1; i++){
+    #pragma omp simd private(tmp)
+    for (p=0; p<n; p++){
+      tmp = tc[i][0]*b_[p]  + tc[i][1]*g_[p] + 
+            tc[i][2]*r_[p]  + tc[i][3]*n_[p] + 
+            tc[i][4]*s1_[p] + tc[i][5]*s2_[p];
+      ind_[p] += x[i]*tmp;
+    }
+  }
+
+  #pragma omp simd private(v,valid)
+  for (p=0; p<n; p++){
+    valid = (msk_[p] != 0) & (mask_[p] != 0);
+    v = (short)ind_[p];
+    tss_[p] = valid ? v : nodata;
+  }
+
+  return;
+}
+
+
 /** This function computes a spectral index time series, with band method,
 +++ i.e. it essentially copies a band from ARD to the TSA image array
 --- ard:    ARD
@@ -55,28 +310,21 @@ void index_cont_remove(ard_t *ard, small *mask_, tsa_t *ts, int b_, int b1, int
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_band(ard_t *ard, small *mask_, tsa_t *ts, int b, int nc, int nt, short nodata){
-int p, t;
+int p0, np, t;
 
 
-  #pragma omp parallel private(t) shared(ard,mask_,ts,b,nc,nt,nodata) default(none)
+  #pragma omp parallel private(t,np) shared(ard,mask_,ts,b,nc,nt,nodata) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
-      
-      for (t=0; t<nt; t++){
-
-        if (!ard[t].msk[p]){
-          ts->tss_[t][p] = nodata;
-        } else {
-          ts->tss_[t][p] = ard[t].dat[b][p];
-        }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
+      for (t=0; t<nt; t++){
+        band_row(ard[t].dat[b]+p0, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          ts->tss_[t]+p0, np, nodata);
       }
 
     }
@@ -99,35 +347,21 @@ int p, t;
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_differenced(ard_t *ard, small *mask_, tsa_t *ts, int b1, int b2, int nc, int nt, short nodata){
-int p, t;
-float tmp, ind, scale = 10000.0;
+int p0, np, t;
 
 
-  #pragma omp parallel private(t,tmp,ind) shared(ard,mask_,ts,b1,b2,nc,nt,nodata,scale) default(none)
+  #pragma omp parallel private(t,np) shared(ard,mask_,ts,b1,b2,nc,nt,nodata) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
-      
-      for (t=0; t<nt; t++){
-
-        if (!ard[t].msk[p]){
-          ts->tss_[t][p] = nodata;
-        } else {
-          tmp = (ard[t].dat[b1][p]+ard[t].dat[b2][p]);
-          ind = (ard[t].dat[b1][p]-ard[t].dat[b2][p])/tmp;
-          if (tmp == 0 || ind < -1 || ind > 1){
-            ts->tss_[t][p] = nodata;
-          } else {
-            ts->tss_[t][p] = (short)(ind*scale);
-          }
-        }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
+      for (t=0; t<nt; t++){
+        differenced_row(ard[t].dat[b1]+p0, ard[t].dat[b2]+p0, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          ts->tss_[t]+p0, np, nodata);
       }
 
     }
@@ -206,34 +440,21 @@ float tmp;
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_ratio_minus1(ard_t *ard, small *mask_, tsa_t *ts, int b1, int b2, int nc, int nt, short nodata){
-int p, t;
-float ind, scale = 1000.0;
+int p0, np, t;
 
 
-  #pragma omp parallel private(t,ind) shared(ard,mask_,ts,b1,b2,nc,nt,nodata,scale) default(none)
+  #pragma omp parallel private(t,np) shared(ard,mask_,ts,b1,b2,nc,nt,nodata) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
       for (t=0; t<nt; t++){
-
-        if (!ard[t].msk[p]){
-          ts->tss_[t][p] = nodata;
-        } else {
-          ind = (ard[t].dat[b1][p] / (float)ard[t].dat[b2][p]) - 1.0;
-          if (ard[t].dat[b2][p] == 0 || ind*scale > SHRT_MAX || ind*scale < SHRT_MIN){
-            ts->tss_[t][p] = nodata;
-          } else {
-            ts->tss_[t][p] = (short)(ind*scale);
-          }
-        }
-
+        ratio_minus1_row(ard[t].dat[b1]+p0, ard[t].dat[b2]+p0, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          ts->tss_[t]+p0, np, nodata);
       }
 
     }
@@ -311,35 +532,21 @@ float upper, lower, ind, scale = 10000.0;
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_kernelized(ard_t *ard, small *mask_, tsa_t *ts, int b1, int b2, int nc, int nt, short nodata){
-int p, t;
-float sigma, diff, tmp, ind, scale = 10000.0;
+int p0, np, t;
 
 
-  #pragma omp parallel private(t,sigma,diff,tmp,ind) shared(ard,mask_,ts,b1,b2,nc,nt,nodata,scale) default(none)
+  #pragma omp parallel private(t,np) shared(ard,mask_,ts,b1,b2,nc,nt,nodata) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
-
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
-      
-      for (t=0; t<nt; t++){
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-        if (!ard[t].msk[p] || 
-             ard[t].dat[b1][p] <= 0 || 
-             ard[t].dat[b2][p] <= 0){
-          ts->tss_[t][p] = nodata;
-        } else {
-          sigma = 0.5 * (ard[t].dat[b1][p] + ard[t].dat[b2][p]);
-          diff  = ard[t].dat[b1][p] - ard[t].dat[b2][p];
-          tmp   = exp(-(diff*diff) / (2*sigma*sigma));
-          ind   = (1-tmp) / (1+tmp);
-          ts->tss_[t][p] = (short)(ind*scale);
-        }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
+      for (t=0; t<nt; t++){
+        kernelized_row(ard[t].dat[b1]+p0, ard[t].dat[b2]+p0, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          ts->tss_[t]+p0, np, nodata);
       }
 
     }
@@ -370,41 +577,24 @@ float sigma, diff, tmp, ind, scale = 10000.0;
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_resistance(ard_t *ard, small *mask_, tsa_t *ts, int n, int r, int b, float f1, float f2, float f3, float f4, bool rbc, int nc, int nt, short nodata){
-int p, t;
-float tmp, x = 0, nir, red, blue, ind, scale = 10000.0;
+int p0, np, t;
+float x = 0;
 
 
   if (rbc) x = 1.0;
 
-  #pragma omp parallel private(t,tmp,nir,red,blue,ind) shared(ard,mask_,ts,n,r,b,nc,nt,nodata,scale,f1,f2,f3,f4,x) default(none)
+  #pragma omp parallel private(t,np) shared(ard,mask_,ts,n,r,b,nc,nt,nodata,f1,f2,f3,f4,x) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
-      
-      for (t=0; t<nt; t++){
-
-        if (!ard[t].msk[p]){
-          ts->tss_[t][p] = nodata;
-        } else {
-          nir  = ard[t].dat[n][p];
-          red  = ard[t].dat[r][p];
-          blue = ard[t].dat[b][p];
-          red -= x*(blue-red);
-          tmp = nir+f2*red-f3*blue+f4*scale;
-          ind = f1*(nir-red)/tmp;
-          if (tmp == 0){// || ind < -1 || ind > 1){
-            ts->tss_[t][p] = nodata;
-          } else {
-            ts->tss_[t][p] = (short)(ind*scale);
-          }
-        }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
+      for (t=0; t<nt; t++){
+        resistance_row(ard[t].dat[n]+p0, ard[t].dat[r]+p0, ard[t].dat[b]+p0, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          f1, f2, f3, f4, x, ts->tss_[t]+p0, np, nodata);
       }
 
     }
@@ -432,42 +622,35 @@ float tmp, x = 0, nir, red, blue, ind, scale = 10000.0;
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void index_tasseled(ard_t *ard, small *mask_, tsa_t *ts, int type, int b, int g, int r, int n, int s1, int s2, int nc, int nt, short nodata){
-int p, t, i, comp0 = type, comp1 = type+1;
-float tmp, x[3] = { 1, 1, 1 }, ind;
+int p0, np, t, comp0 = type, comp1 = type+1;
+float x[3] = { 1, 1, 1 };
 float tc[3][6] = {
 { 0.2043,  0.4158,  0.5524, 0.5741,  0.3124,  0.2303 },
 {-0.1603, -0.2819, -0.4934, 0.7940, -0.0002, -0.1446 },
 { 0.0315,  0.2021,  0.3102, 0.1594, -0.6806, -0.6109 }};
+const short *band_[6];
 
 
   if (type == TCD){ comp0 = 0; comp1 = 3; x[1] = -1; x[2] = -1;}
 
-  #pragma omp parallel private(t,i,tmp,ind) shared(ard,mask_,ts,b,g,r,n,s1,s2,nc,nt,nodata,x,tc,comp0,comp1) default(none)
+  #pragma omp parallel private(t,np,band_) shared(ard,mask_,ts,b,g,r,n,s1,s2,nc,nt,nodata,x,tc,comp0,comp1) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
-
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ts->tss_[t][p] = nodata;
-        continue;
-      }
-      
-      for (t=0; t<nt; t++){
-
-        if (!ard[t].msk[p]){
-          ts->tss_[t][p] = nodata;
-        } else {
-          for (i=comp0, ind=0; i<comp1; i++){
-            tmp = tc[i][0]*ard[t].dat[b][p]  + tc[i][1]*ard[t].dat[g][p] + 
-                  tc[i][2]*ard[t].dat[r][p]  + tc[i][3]*ard[t].dat[n][p] + 
-                  tc[i][4]*ard[t].dat[s1][p] + tc[i][5]*ard[t].dat[s2][p];
-            ind += x[i]*tmp;
-          }
-          ts->tss_[t][p] = (short)ind;
+    for (p0=0; p0<nc; p0+=INDEX_BLOCK){
 
-        }
+      np = (p0+INDEX_BLOCK < nc) ? INDEX_BLOCK : nc-p0;
 
+      for (t=0; t<nt; t++){
+        band_[0] = ard[t].dat[b]+p0;
+        band_[1] = ard[t].dat[g]+p0;
+        band_[2] = ard[t].dat[r]+p0;
+        band_[3] = ard[t].dat[n]+p0;
+        band_[4] = ard[t].dat[s1]+p0;
+        band_[5] = ard[t].dat[s2]+p0;
+        tasseled_row(band_, ard[t].msk+p0, 
+          (mask_ != NULL) ? mask_+p0 : ard[t].msk+p0, 
+          tc, x, comp0, comp1, ts->tss_[t]+p0, np, nodata);
       }
 
     }
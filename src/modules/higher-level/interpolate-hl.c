@@ -87,70 +87,91 @@ int interpolate_linear(tsa_t *ts, small *mask_, int nc, int nt, int ni, short no
 int t, t_left, i, p;
 float x_left, x_right, x;
 float y_left, y_right, y;
+int p0, np;
+short *tss_block = NULL, *tss_p = NULL;
+short *tsi_block = NULL, *tsi_p = NULL;
 
 
-  #pragma omp parallel private(t,t_left,i,x_left,x_right,x,y_left,y_right,y) shared(mask_,ts,nc,nt,ni,nodata) default(none)
+  #pragma omp parallel private(t,t_left,i,x_left,x_right,x,y_left,y_right,y,p,np,tss_block,tss_p,tsi_block,tsi_p) shared(mask_,ts,nc,nt,ni,nodata) default(none)
   {
 
+    alloc((void**)&tss_block, (size_t)TSA_BLOCK*nt, sizeof(short));
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (i=0; i<ni; i++) ts->tsi_[i][p] = nodata;
-        continue;
-      }
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(ts->tss_, nt, p0, np, tss_block);
 
+      for (p=p0; p<p0+np; p++){
 
-      // interpolate for each equidistant timestep
-      for (i=0, t_left=0; i<ni; i++){
-
-        // current time
-        x = ts->d_tsi[i].ce;
-
-        x_left = x_right = INT_MIN;
-        y_left = y_right = nodata;
-
-        // find previous and next point
-        for (t=t_left; t<nt; t++){
-
-          if (ts->tss_[t][p] == nodata) continue;
-
-          if (ts->d_tss[t].ce < x){
-            x_left = ts->d_tss[t].ce;
-            y_left = ts->tss_[t][p];
-            t_left = t;
-          } else if (ts->d_tss[t].ce == x){
-            x_left = x_right = x;
-            y_left = y_right = ts->tss_[t][p];
-            t_left = t;
-            break;
-          } else if (ts->d_tss[t].ce > x){
-            x_right = ts->d_tss[t].ce;
-            y_right = ts->tss_[t][p];
-            break;
-          }
+        tss_p = tss_block + (size_t)(p-p0)*nt;
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
+        if (mask_ != NULL && !mask_[p]){
+          for (i=0; i<ni; i++) tsi_p[i] = nodata;
+          continue;
         }
 
-        // set nodata, copy value or interpolate
-        if (x_left < 0 && x_right < 0){
-          y = nodata;
-        } else if (x_left < 0){
-          y = y_right;
-        } else if (x_right < 0){
-          y = y_left;
-        } else if (x_left == x_right){
-          y = (y_left+y_right)/2.0;
-        } else {
-          y = (y_left*(x_right-x) + y_right*(x-x_left))/(x_right-x_left);
-        }
 
-        ts->tsi_[i][p] = (short)y;
+        // interpolate for each equidistant timestep
+        for (i=0, t_left=0; i<ni; i++){
+
+          // current time
+          x = ts->d_tsi[i].ce;
+
+          x_left = x_right = INT_MIN;
+          y_left = y_right = nodata;
+
+          // find previous and next point
+          for (t=t_left; t<nt; t++){
+
+            if (tss_p[t] == nodata) continue;
+
+            if (ts->d_tss[t].ce < x){
+              x_left = ts->d_tss[t].ce;
+              y_left = tss_p[t];
+              t_left = t;
+            } else if (ts->d_tss[t].ce == x){
+              x_left = x_right = x;
+              y_left = y_right = tss_p[t];
+              t_left = t;
+              break;
+            } else if (ts->d_tss[t].ce > x){
+              x_right = ts->d_tss[t].ce;
+              y_right = tss_p[t];
+              break;
+            }
+
+          }
+
+          // set nodata, copy value or interpolate
+          if (x_left < 0 && x_right < 0){
+            y = nodata;
+          } else if (x_left < 0){
+            y = y_right;
+          } else if (x_right < 0){
+            y = y_left;
+          } else if (x_left == x_right){
+            y = (y_left+y_right)/2.0;
+          } else {
+            y = (y_left*(x_right-x) + y_right*(x-x_left))/(x_right-x_left);
+          }
+
+          tsi_p[i] = (short)y;
+
+        }
 
       }
-      
+
+      scatter_time_block(tsi_block, ni, p0, np, ts->tsi_);
+
     }
     
+    free((void*)tss_block);
+    free((void*)tsi_block);
+
   }
 
 
@@ -172,58 +193,79 @@ int interpolate_moving(tsa_t *ts, small *mask_, int nc, int nt, int ni, short no
 int t, t_left, i, p;
 float x, x_;
 double sum, num;
+int p0, np;
+short *tss_block = NULL, *tss_p = NULL;
+short *tsi_block = NULL, *tsi_p = NULL;
 
 
-  #pragma omp parallel private(t,t_left,i,x, x_,sum,num) shared(mask_,ts,nc,nt,ni,tsi,nodata) default(none)
+  #pragma omp parallel private(t,t_left,i,x, x_,sum,num,p,np,tss_block,tss_p,tsi_block,tsi_p) shared(mask_,ts,nc,nt,ni,tsi,nodata) default(none)
   {
 
+    alloc((void**)&tss_block, (size_t)TSA_BLOCK*nt, sizeof(short));
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (i=0; i<ni; i++) ts->tsi_[i][p] = nodata;
-        continue;
-      }
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(ts->tss_, nt, p0, np, tss_block);
 
+      for (p=p0; p<p0+np; p++){
 
-      // interpolate for each equidistant timestep
-      for (i=0, t_left=0; i<ni; i++){
+        tss_p = tss_block + (size_t)(p-p0)*nt;
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
-        // current time
-        x = ts->d_tsi[i].ce;
+        if (mask_ != NULL && !mask_[p]){
+          for (i=0; i<ni; i++) tsi_p[i] = nodata;
+          continue;
+        }
 
-        sum = num = 0.0;
 
-        // use all points within temporal window
-        for (t=t_left; t<nt; t++){
+        // interpolate for each equidistant timestep
+        for (i=0, t_left=0; i<ni; i++){
 
-          if (ts->tss_[t][p] == nodata) continue;
+          // current time
+          x = ts->d_tsi[i].ce;
 
-          x_ = ts->d_tss[t].ce;
+          sum = num = 0.0;
+
+          // use all points within temporal window
+          for (t=t_left; t<nt; t++){
+
+            if (tss_p[t] == nodata) continue;
+
+            x_ = ts->d_tss[t].ce;
+
+            if (x-x_ > tsi->mov_max){ // earlier than window
+              t_left = t;
+              continue;
+            } else if (x_-x > tsi->mov_max){ // later than window
+              break;
+            } else { // in window
+              sum += tss_p[t]; 
+              num++;
+            }
 
-          if (x-x_ > tsi->mov_max){ // earlier than window
-            t_left = t;
-            continue;
-          } else if (x_-x > tsi->mov_max){ // later than window
-            break;
-          } else { // in window
-            sum += ts->tss_[t][p]; 
-            num++;
           }
 
-        }
+          // interpolate with moving mean, or use nodata
+          if (num > 0){
+             tsi_p[i] = (short)(sum/num);
+          } else {
+             tsi_p[i] = nodata;
+          }
 
-        // interpolate with moving mean, or use nodata
-        if (num > 0){
-           ts->tsi_[i][p] = (short)(sum/num);
-        } else {
-           ts->tsi_[i][p] = nodata;
         }
 
       }
-      
+
+      scatter_time_block(tsi_block, ni, p0, np, ts->tsi_);
+
     }
     
+    free((void*)tss_block);
+    free((void*)tsi_block);
+
   }
 
 
@@ -262,83 +304,101 @@ float y;
 double *sum_yw = NULL, *sum_w = NULL;
 double sum_kd, sum_d;
 rbf_t *rbf = NULL;
+int p0, np;
+short *tss_block = NULL, *tss_p = NULL;
+short *tsi_block = NULL, *tsi_p = NULL;
 
 
   rbf = rbf_kernel(tsi);
 
-  #pragma omp parallel private(k,i,t,t_left,x, x_,sum_yw,sum_w,sum_kd,sum_d,y) shared(mask_,ts,nc,nt,ni,rbf,tsi,nodata) default(none)
+  #pragma omp parallel private(k,i,t,t_left,x, x_,sum_yw,sum_w,sum_kd,sum_d,y,p,np,tss_block,tss_p,tsi_block,tsi_p) shared(mask_,ts,nc,nt,ni,rbf,tsi,nodata) default(none)
   {
 
+    alloc((void**)&tss_block, (size_t)TSA_BLOCK*nt, sizeof(short));
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     alloc((void**)&t_left, rbf->nk, sizeof(int));
     alloc((void**)&sum_yw, rbf->nk, sizeof(double));
     alloc((void**)&sum_w,  rbf->nk, sizeof(double));
 
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (i=0; i<ni; i++) ts->tsi_[i][p] = nodata;
-        continue;
-      }
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(ts->tss_, nt, p0, np, tss_block);
 
-      for (k=0; k<rbf->nk; k++) t_left[k] = 0;
+      for (p=p0; p<p0+np; p++){
 
+        tss_p = tss_block + (size_t)(p-p0)*nt;
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
-      // interpolate for each equidistant timestep
-      for (i=0; i<ni; i++){
+        if (mask_ != NULL && !mask_[p]){
+          for (i=0; i<ni; i++) tsi_p[i] = nodata;
+          continue;
+        }
 
-        // current time
-        x = ts->d_tsi[i].ce;
+        for (k=0; k<rbf->nk; k++) t_left[k] = 0;
 
-        for (k=0; k<rbf->nk; k++){
 
-          sum_yw[k] = sum_w[k] = 0.0;
+        // interpolate for each equidistant timestep
+        for (i=0; i<ni; i++){
 
-          // use all points within temporal window
-          for (t=t_left[k]; t<nt; t++){
+          // current time
+          x = ts->d_tsi[i].ce;
 
-            x_ = ts->d_tss[t].ce;
+          for (k=0; k<rbf->nk; k++){
+
+            sum_yw[k] = sum_w[k] = 0.0;
+
+            // use all points within temporal window
+            for (t=t_left[k]; t<nt; t++){
+
+              x_ = ts->d_tss[t].ce;
+
+              if (x-x_ > rbf->max_ce[k]){ // earlier than window
+                t_left[k] = t;
+                continue;
+              } else if (x_-x > rbf->max_ce[k]){ // later than window
+                break;
+              } else { // in window
+                if (tss_p[t] == nodata) continue;
+                sum_yw[k] += tss_p[t]*rbf->kernel[k][x_-x+rbf->hbin];
+                sum_w[k]  += rbf->kernel[k][x_-x+rbf->hbin];
+              }
 
-            if (x-x_ > rbf->max_ce[k]){ // earlier than window
-              t_left[k] = t;
-              continue;
-            } else if (x_-x > rbf->max_ce[k]){ // later than window
-              break;
-            } else { // in window
-              if (ts->tss_[t][p] == nodata) continue;
-              sum_yw[k] += ts->tss_[t][p]*rbf->kernel[k][x_-x+rbf->hbin];
-              sum_w[k]  += rbf->kernel[k][x_-x+rbf->hbin];
             }
 
           }
 
-        }
+          // compute weighted average + 
+          // weight the kernels with their data availability (weighted with 
+          //        the same kernel as the time series)
+          for (k=0, sum_kd=0, sum_d=0; k<rbf->nk; k++){
+            if (sum_w[k] > 0){
+              // weighted average * weighted data availability (weighted fractions of days)
+              // sum_kd += sum_yw[k]/sum_w[k] * sum_w[k]/max_w[k];
+              // this reduces to:
+              sum_kd += sum_yw[k]/rbf->max_w[k];
+              sum_d  += sum_w[k]/rbf->max_w[k];
+            }
+          }
 
-        // compute weighted average + 
-        // weight the kernels with their data availability (weighted with 
-        //        the same kernel as the time series)
-        for (k=0, sum_kd=0, sum_d=0; k<rbf->nk; k++){
-          if (sum_w[k] > 0){
-            // weighted average * weighted data availability (weighted fractions of days)
-            // sum_kd += sum_yw[k]/sum_w[k] * sum_w[k]/max_w[k];
-            // this reduces to:
-            sum_kd += sum_yw[k]/rbf->max_w[k];
-            sum_d  += sum_w[k]/rbf->max_w[k];
+          // ensemble fit
+          if (sum_d > 0){
+            y = sum_kd/sum_d;
+          } else {
+            y = nodata;
           }
-        }
 
-        // ensemble fit
-        if (sum_d > 0){
-          y = sum_kd/sum_d;
-        } else {
-          y = nodata;
-        }
+          tsi_p[i] = (short)y;
 
-        ts->tsi_[i][p] = (short)y;
+        }
 
       }
-      
+
+      scatter_time_block(tsi_block, ni, p0, np, ts->tsi_);
+
     }
 
     // clean
@@ -346,6 +406,9 @@ rbf_t *rbf = NULL;
     free((void*)sum_yw);
     free((void*)sum_w);
     
+    free((void*)tss_block);
+    free((void*)tsi_block);
+
   }
 
   
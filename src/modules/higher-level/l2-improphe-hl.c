@@ -307,6 +307,10 @@ bool is_empty;
     #pragma omp parallel private(p) shared(hr_,hr_tex_,mr_,mr_tex_,l2i,t,ny,nx,npc,nb_mr,nodata,KDIST,nk,mink,phl) default(none)
     {
 
+      // scratch memory of this thread, grows to the size needed for one pixel
+      arena_t arena;
+      init_arena(&arena, 0);
+
       #pragma omp for collapse(2) schedule(guided)
       for (i=0; i<ny; i++){
       for (j=0; j<nx; j++){
@@ -316,11 +320,13 @@ bool is_empty;
         if (mr_[0][p] == nodata) continue;
 
         improphe(hr_, hr_tex_, mr_, mr_tex_, l2i.imp_[t], KDIST, nodata, nodata, i, j, p, 
-          nx, ny, phl->imp.ksize, npc, nb_mr, nk, mink);
+          nx, ny, phl->imp.ksize, npc, nb_mr, nk, mink, &arena);
 
       }
       }
 
+      free_arena(&arena);
+
     }
     
     free_2D((void**)mr_,     nb_mr);
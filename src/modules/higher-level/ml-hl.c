@@ -34,6 +34,10 @@ using namespace cv::ml;
 
 brick_t **compile_ml(ard_t *features, ml_t *ml, par_hl_t *phl, cube_t *cube, int *nproduct);
 brick_t *compile_ml_brick(brick_t *ard, int nb, bool write, char *prodname, par_hl_t *phl);
+void ml_nodata(ml_t *ml, par_hl_t *phl, int p, short nodata);
+
+// number of pixels that are predicted at once
+#define ML_BLOCK 256
 
 
 /** This function compiles the bricks, in which ML results are stored. 
@@ -188,6 +192,31 @@ int nchar;
 }
 
 
+/** This function sets all ML products of one pixel to nodata
+--- ml:       pointer to instantly useable ML image arrays
+--- phl:      HL parameters
+--- p:        pixel
+--- nodata:   nodata value
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void ml_nodata(ml_t *ml, par_hl_t *phl, int p, short nodata){
+int s, c, sc;
+
+
+  for (s=0, sc=0; s<phl->mcl.nmodelset; s++){
+    if (ml->mlp_ != NULL) ml->mlp_[s][p] = nodata;
+    if (ml->mli_ != NULL) ml->mli_[s][p] = nodata;
+    if (ml->mlu_ != NULL) ml->mlu_[s][p] = nodata;
+    if (ml->rfm_ != NULL) ml->rfm_[s][p] = nodata;
+    for (c=0; c<phl->mcl.nclass[s]; c++, sc++){
+      if (ml->rfp_ != NULL) ml->rfp_[sc][p] = nodata;
+    }
+  }
+
+  return;
+}
+
+
 /** public functions
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
@@ -209,14 +238,19 @@ brick_t **ML;
 small *mask_ = NULL;
 bool regression;
 bool rf, rfprob;
-float **fpred = NULL;
+float *fpred = NULL;
+int   *fvote = NULL;
 int   **ipred = NULL;
+forest_t *forest = NULL;
+double **mean_prob = NULL;
+double *mean = NULL, *mean_old = NULL, *var = NULL;
+int *ntree = NULL, *nm = NULL, *idx = NULL, *act = NULL;
+bool *done = NULL;
 int nprod = 0;
-int mmax = -1;
-int f, s, m, k, c, sc, p, nc;
-double mean, mean_old, var, std, mn;
-double *mean_prob;
-int max_prob, max2_prob, win_class, ntree;
+int mmax = -1, cmax = 1;
+int f, s, m, k, c, sc, i, j, p, p0, nv, na, nc;
+double mn, std;
+int max_prob, max2_prob, win_class, vote;
 short nodata;
 bool valid;
 
@@ -247,9 +281,17 @@ bool valid;
   if (phl->mcl.orfp || phl->mcl.orfm) rfprob = true; else rfprob = false;
 
 
-  // maximum number of models
+  // maximum number of models and classes
   for (s=0; s<phl->mcl.nmodelset; s++){
     if (phl->mcl.nmodel[s] > mmax) mmax = phl->mcl.nmodel[s];
+    if (phl->mcl.nclass[s] > cmax) cmax = phl->mcl.nclass[s];
+  }
+
+  // the flattened forests write their votes with their own number of classes
+  if (rf){
+    for (k=0; k<(int)mod->rf_forest.size(); k++){
+      if (mod->rf_forest[k] != NULL && mod->rf_forest[k]->nclass > cmax) cmax = mod->rf_forest[k]->nclass;
+    }
   }
 
   if (mmax < 0){
@@ -259,148 +301,217 @@ bool valid;
   }
 
 
+  /** The pixels are predicted in blocks of ML_BLOCK pixels, i.e. each
+  +++ model is called once per block instead of once per pixel. For
+  +++ regression, pixels that have converged are dropped from the block
+  +++ before the next model is called.
+  +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
-  #pragma omp parallel private(f,s,m,k,c,sc,mean,mn,mean_old,var,std,fpred,ipred,mean_prob,max_prob,max2_prob,win_class,ntree,valid) shared(features,mod,regression,rf,rfprob,ml,nf,nc,mask_,phl,ML,nodata,mmax) default(none)
+  #pragma omp parallel private(f,s,m,k,c,sc,i,j,p,nv,na,mn,std,fpred,fvote,forest,ipred,mean,mean_old,var,mean_prob,ntree,nm,idx,act,done,max_prob,max2_prob,win_class,vote,valid) shared(features,mod,regression,rf,rfprob,ml,nf,nc,mask_,phl,ML,nodata,mmax,cmax) default(none)
   {
 
-    alloc_2D((void***)&fpred, phl->mcl.nmodelset, mmax, sizeof(float));
-    alloc_2D((void***)&ipred, phl->mcl.nmodelset, mmax, sizeof(int));
-    if (rfprob) alloc((void**)&mean_prob, phl->mcl.nclass_all_sets, sizeof(double));
+    Mat sample(ML_BLOCK, nf, CV_32F);
+    Mat active(ML_BLOCK, nf, CV_32F);
+    Mat input, pred, votes;
+
+    alloc((void**)&idx,      ML_BLOCK, sizeof(int));
+    alloc((void**)&act,      ML_BLOCK, sizeof(int));
+    alloc((void**)&nm,       ML_BLOCK, sizeof(int));
+    alloc((void**)&ntree,    ML_BLOCK, sizeof(int));
+    alloc((void**)&done,     ML_BLOCK, sizeof(bool));
+    alloc((void**)&mean,     ML_BLOCK, sizeof(double));
+    alloc((void**)&mean_old, ML_BLOCK, sizeof(double));
+    alloc((void**)&var,      ML_BLOCK, sizeof(double));
+    alloc((void**)&fpred,    ML_BLOCK, sizeof(float));
+    alloc((void**)&fvote,    ML_BLOCK*cmax, sizeof(int));
+    alloc_2D((void***)&ipred, ML_BLOCK, mmax, sizeof(int));
+    if (rfprob) alloc_2D((void***)&mean_prob, ML_BLOCK, cmax, sizeof(double));
 
     #pragma omp for schedule(dynamic,1)
-    for (p=0; p<nc; p++){
-
-      // skip pixels that are masked
-      if (mask_ != NULL && !mask_[p]){
-        for (s=0, sc=0; s<phl->mcl.nmodelset; s++){
-          if (ml.mlp_ != NULL) ml.mlp_[s][p] = nodata;
-          if (ml.mli_ != NULL) ml.mli_[s][p] = nodata;
-          if (ml.mlu_ != NULL) ml.mlu_[s][p] = nodata;
-          if (ml.rfm_ != NULL) ml.rfm_[s][p] = nodata;
-          for (c=0; c<phl->mcl.nclass[s]; c++, sc++){
-            if (ml.rfp_ != NULL) ml.rfp_[sc][p] = nodata;
-          }
+    for (p0=0; p0<nc; p0+=ML_BLOCK){
+
+      // assemble the features of the valid pixels
+      for (p=p0, nv=0; p<nc && p<p0+ML_BLOCK; p++){
+
+        // skip pixels that are masked
+        if (mask_ != NULL && !mask_[p]){
+          ml_nodata(&ml, phl, p, nodata);
+          continue;
         }
-        continue;
-      }
 
-      Mat sample(1, nf, CV_32F);
-      for (f=0, valid=true; f<nf; f++){
-        sample.at<float>(0,f) = features[f].dat[0][p]/10000.0;
-        if (!features[f].msk[p] && phl->ftr.exclude) valid=false;
-      }
+        for (f=0, valid=true; f<nf; f++){
+          sample.at<float>(nv,f) = features[f].dat[0][p]/10000.0;
+          if (!features[f].msk[p] && phl->ftr.exclude) valid=false;
+        }
 
-      if (!valid){
-        for (s=0, sc=0; s<phl->mcl.nmodelset; s++){
-          if (ml.mlp_ != NULL) ml.mlp_[s][p] = nodata;
-          if (ml.mli_ != NULL) ml.mli_[s][p] = nodata;
-          if (ml.mlu_ != NULL) ml.mlu_[s][p] = nodata;
-          if (ml.rfm_ != NULL) ml.rfm_[s][p] = nodata;
-          for (c=0; c<phl->mcl.nclass[s]; c++, sc++){
-            if (ml.rfp_ != NULL) ml.rfp_[sc][p] = nodata;
-          }
+        if (!valid){
+          ml_nodata(&ml, phl, p, nodata);
+          continue;
         }
-        continue;
+
+        idx[nv++] = p;
+
       }
 
+      if (nv == 0) continue;
+
+
       for (s=0, k=0, sc=0; s<phl->mcl.nmodelset; s++){
-        
-        mean = mean_old = var = 0;
-        ntree = 0;
-        if (rfprob) memset(mean_prob, 0, phl->mcl.nclass_all_sets*sizeof(double));
+
+        for (j=0; j<nv; j++){
+          mean[j] = mean_old[j] = var[j] = 0;
+          ntree[j] = 0;
+          nm[j] = phl->mcl.nmodel[s];
+          done[j] = false;
+          if (rfprob) memset(mean_prob[j], 0, cmax*sizeof(double));
+        }
 
         for (m=0; m<phl->mcl.nmodel[s]; m++, k++){
 
+          // pixels that did not converge yet
+          for (j=0, na=0; j<nv; j++){
+            if (!done[j]) act[na++] = j;
+          }
+
+          if (na == 0) continue;
+
+          if (na == nv){
+            input = sample.rowRange(0, nv);
+          } else {
+            for (i=0; i<na; i++) memcpy(active.ptr<float>(i), sample.ptr<float>(act[i]), nf*sizeof(float));
+            input = active.rowRange(0, na);
+          }
+
+          // use the flattened forest if available
+          forest = (rf) ? mod->rf_forest[k] : NULL;
+
           if (rfprob){
 
-            Mat vote;
-            mod->rf_model[k]->getVotes(sample, vote, 0);
+            if (forest != NULL){
+              forest_votes(forest, input.ptr<float>(0), na, fvote);
+            } else {
+              mod->rf_model[k]->getVotes(input, votes, 0);
+            }
 
-            win_class = 0;
-            max_prob  = 0;
+            for (i=0; i<na; i++){
 
-            for (c=0; c<phl->mcl.nclass[s]; c++){
-              mean_prob[c] += vote.at<int>(1,c);
-              ntree += vote.at<int>(1,c);
-              if (vote.at<int>(1,c) > max_prob){
-                win_class = vote.at<int>(0,c);
-                max_prob  = vote.at<int>(1,c);
+              j = act[i];
+              win_class = 0;
+              max_prob  = 0;
+
+              for (c=0; c<phl->mcl.nclass[s]; c++){
+                vote = (forest != NULL) ? fvote[i*forest->nclass+c] : votes.at<int>(i+1,c);
+                mean_prob[j][c] += vote;
+                ntree[j] += vote;
+                if (vote > max_prob){
+                  win_class = (forest != NULL) ? forest->label[c] : votes.at<int>(0,c);
+                  max_prob  = vote;
+                }
               }
-            }
 
+              ipred[j][m] = win_class;
 
-            ipred[s][m] = win_class;
+            }
 
           } else {
 
-            if (rf){
-              fpred[s][m] = mod->rf_model[k]->predict(sample);
+            if (forest != NULL){
+              forest_predict(forest, input.ptr<float>(0), na, fpred);
             } else {
-              fpred[s][m] = mod->sv_model[k]->predict(sample);
+              if (rf){
+                mod->rf_model[k]->predict(input, pred);
+              } else {
+                mod->sv_model[k]->predict(input, pred);
+              }
+              for (i=0; i<na; i++) fpred[i] = pred.at<float>(i,0);
             }
-            ipred[s][m] = (int)fpred[s][m];
 
-          }
+            for (i=0; i<na; i++){
 
-          if (regression){
+              j = act[i];
+              ipred[j][m] = (int)fpred[i];
 
-            if (m == 0){
-              mean = fpred[s][m];
-            } else {
-              var_recurrence(fpred[s][m], &mean, &var, m+1);
-            }
+              if (regression){
 
-            if (m > 1 && fabs(mean-mean_old) < phl->mcl.converge){ k += phl->mcl.nmodel[s]-m; m++; break;}
-            mean_old = mean;
+                if (m == 0){
+                  mean[j] = fpred[i];
+                } else {
+                  var_recurrence(fpred[i], &mean[j], &var[j], m+1);
+                }
 
-          }
+                if (m > 1 && fabs(mean[j]-mean_old[j]) < phl->mcl.converge){ nm[j] = m+1; done[j] = true;}
+                mean_old[j] = mean[j];
 
-        }
+              }
+
+            }
+
+          }
 
-        if (regression){
-          mn  = mean*phl->mcl.scale;
-          if (mn > SHRT_MAX) mn = SHRT_MAX;
-          if (mn < SHRT_MIN) mn = SHRT_MIN;
-          if (ml.mlp_ != NULL) ml.mlp_[s][p] = (short)mn;  
-          std = standdev(var, m)*10000.0;
-          if (std > SHRT_MAX) std = SHRT_MAX;
-          if (ml.mlu_ != NULL) ml.mlu_[s][p] = (short)(std);
-        } else {
-          if (ml.mlp_ != NULL) ml.mlp_[s][p] = (short)mode(ipred[s], phl->mcl.nmodel[s]);
         }
 
-        if (ml.mli_ != NULL) ml.mli_[s][p] = m;
 
-        if (rfprob){
+        for (j=0; j<nv; j++){
 
-          for (c=0; c<phl->mcl.nclass[s]; c++) mean_prob[c] /= (ntree*0.0001);
+          p = idx[j];
+          m = nm[j];
 
-          if (ml.rfp_ != NULL){
-            for (c=0; c<phl->mcl.nclass[s]; c++) ml.rfp_[sc++][p] = (short)mean_prob[c];
+          if (regression){
+            mn  = mean[j]*phl->mcl.scale;
+            if (mn > SHRT_MAX) mn = SHRT_MAX;
+            if (mn < SHRT_MIN) mn = SHRT_MIN;
+            if (ml.mlp_ != NULL) ml.mlp_[s][p] = (short)mn;  
+            std = standdev(var[j], m)*10000.0;
+            if (std > SHRT_MAX) std = SHRT_MAX;
+            if (ml.mlu_ != NULL) ml.mlu_[s][p] = (short)(std);
+          } else {
+            if (ml.mlp_ != NULL) ml.mlp_[s][p] = (short)mode(ipred[j], phl->mcl.nmodel[s]);
           }
-          
-          if (ml.rfm_ != NULL){
-            max_prob = max2_prob  = 0;
-            for (c=0; c<phl->mcl.nclass[s]; c++){
-              if (mean_prob[c] > max_prob) max_prob = mean_prob[c];
+
+          if (ml.mli_ != NULL) ml.mli_[s][p] = m;
+
+          if (rfprob){
+
+            for (c=0; c<phl->mcl.nclass[s]; c++) mean_prob[j][c] /= (ntree[j]*0.0001);
+
+            if (ml.rfp_ != NULL){
+              for (c=0; c<phl->mcl.nclass[s]; c++) ml.rfp_[sc+c][p] = (short)mean_prob[j][c];
             }
-            for (c=0; c<phl->mcl.nclass[s]; c++){
-              if (mean_prob[c] > max2_prob && mean_prob[c] < max_prob) max2_prob = mean_prob[c];
+
+            if (ml.rfm_ != NULL){
+              max_prob = max2_prob  = 0;
+              for (c=0; c<phl->mcl.nclass[s]; c++){
+                if (mean_prob[j][c] > max_prob) max_prob = mean_prob[j][c];
+              }
+              for (c=0; c<phl->mcl.nclass[s]; c++){
+                if (mean_prob[j][c] > max2_prob && mean_prob[j][c] < max_prob) max2_prob = mean_prob[j][c];
+              }
+              ml.rfm_[s][p] = max_prob-max2_prob;
             }
-            ml.rfm_[s][p] = max_prob-max2_prob;
+
           }
 
         }
 
-      }
+        sc += phl->mcl.nclass[s];
 
+      }
 
     }
-    
-    
-    free_2D((void**)fpred, phl->mcl.nmodelset);
-    free_2D((void**)ipred, phl->mcl.nmodelset);
-    if (rfprob) free((void*)mean_prob);
+
+
+    free((void*)idx);
+    free((void*)act);
+    free((void*)nm);
+    free((void*)ntree);
+    free((void*)done);
+    free((void*)mean);
+    free((void*)mean_old);
+    free((void*)var);
+    free((void*)fpred);
+    free((void*)fvote);
+    free_2D((void**)ipred, ML_BLOCK);
+    if (rfprob) free_2D((void**)mean_prob, ML_BLOCK);
 
   }
 
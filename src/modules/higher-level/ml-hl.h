@@ -39,6 +39,7 @@ Machine learning header
 #include "../cross-level/stats-cl.h"
 #include "../higher-level/param-hl.h"
 #include "../higher-level/read-ard-hl.h"
+#include "../higher-level/forest-hl.h"
 
 
 #ifdef __cplusplus
@@ -49,6 +50,7 @@ typedef struct {
   //std::vector<cv::Ptr<cv::ml::StatModel>> model;
   std::vector<cv::Ptr<cv::ml::RTrees>> rf_model;
   std::vector<cv::Ptr<cv::ml::SVM>> sv_model;
+  std::vector<forest_t*> rf_forest; // flattened rf_model, NULL if not supported
 } aux_ml_t;
 
 typedef struct {
@@ -85,6 +85,10 @@ void register_higher(params_t *params, par_hl_t *phl){
   register_int_par(params,     "NTHREAD_WRITE",   1, INT_MAX, &phl->othread);
   register_int_par(params,     "NTHREAD_COMPUTE", 1, INT_MAX, &phl->cthread);
   register_bool_par(params,    "STREAMING", &phl->stream);
+  register_int_par(params,     "STREAMING_READERS", 1, INT_MAX, &phl->sreader);
+  register_int_par(params,     "STREAMING_WRITERS", 1, INT_MAX, &phl->swriter);
+  register_int_par(params,     "STREAMING_CHUNKS",  1, INT_MAX, &phl->sflight);
+  register_float_par(params,   "STREAMING_MEMORY",  0, FLT_MAX, &phl->smemory);
   register_bool_par(params,    "PRETTY_PROGRESS", &phl->pretty_progress);
 
   return;
@@ -212,6 +216,7 @@ void register_tsa(params_t *params, par_hl_t *phl){
 
   // STM parameters
   register_enumvec_par(params, "STM", _TAGGED_ENUM_STA_, _STA_LENGTH_, &phl->tsa.stm.sta.metrics, &phl->tsa.stm.sta.nmetrics);
+  register_int_par(params,     "STM_QUANTILE_TOLERANCE", 0, SHRT_MAX, &phl->tsa.stm.qtol);
   register_bool_par(params,    "OUTPUT_STM", &phl->tsa.stm.ostm);
 
   // folding parameters
@@ -253,6 +258,7 @@ void register_tsa(params_t *params, par_hl_t *phl){
   // python UDF plug-in parameters
   register_char_par(params,    "FILE_PYTHON",  _CHAR_TEST_NULL_OR_EXIST_, &phl->tsa.pyp.f_code);
   register_enum_par(params,    "PYTHON_TYPE",  _TAGGED_ENUM_UDF_, _UDF_LENGTH_, &phl->tsa.pyp.type);
+  register_bool_par(params,    "PYTHON_ZERO_COPY", &phl->tsa.pyp.zerocopy);
   register_bool_par(params,    "OUTPUT_PYP",    &phl->tsa.pyp.out);
 
   // R UDF plug-in parameters
@@ -388,6 +394,7 @@ void register_smp(params_t *params, par_hl_t *phl){
   register_char_par(params, "FILE_RESPONSE",    _CHAR_TEST_NOT_EXIST_, &phl->smp.f_response);
   register_char_par(params, "FILE_COORDINATES", _CHAR_TEST_NOT_EXIST_, &phl->smp.f_coords);
   register_bool_par(params, "PROJECTED",        &phl->smp.projected);
+  register_bool_par(params, "BINARY_SAMPLE",    &phl->smp.binary);
 
   return;
 }
@@ -458,6 +465,7 @@ void register_udf(params_t *params, par_hl_t *phl){
   // python UDF plug-in parameters
   register_char_par(params,    "FILE_PYTHON",  _CHAR_TEST_NULL_OR_EXIST_, &phl->udf.pyp.f_code);
   register_enum_par(params,    "PYTHON_TYPE",  _TAGGED_ENUM_UDF_, _UDF_LENGTH_, &phl->udf.pyp.type);
+  register_bool_par(params,    "PYTHON_ZERO_COPY", &phl->udf.pyp.zerocopy);
   register_bool_par(params,    "OUTPUT_PYP",    &phl->udf.pyp.out);
 
   // R UDF plug-in parameters
@@ -1650,11 +1658,6 @@ double tol = 5e-3;
       copy_string(phl->tsa.rsp.f_code, NPOW_10, "NULL");
       printf("Warning: R code provided, but OUTPUT_RSP = FALSE. Ignore R UDF plug-in. Proceed.\n");}
 
-    if (phl->tsa.rsp.out && phl->stream){
-      phl->stream = false;
-      printf("Warning: R code provided. STREAMING is forced to FALSE. Proceed.\n");
-    }
-
   }
 
   if (phl->type == _HL_UDF_){
@@ -1675,11 +1678,6 @@ double tol = 5e-3;
       copy_string(phl->udf.rsp.f_code, NPOW_10, "NULL");
       printf("Warning: R code provided, but OUTPUT_RSP = FALSE. Ignore R UDF plug-in. Proceed.\n");}
 
-    if (phl->udf.rsp.out && phl->stream){
-      phl->stream = false;
-      printf("Warning: R code provided. STREAMING is forced to FALSE. Proceed.\n");
-    }
-
   }
 
   if (phl->type == _HL_CFI_){
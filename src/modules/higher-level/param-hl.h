@@ -245,6 +245,7 @@ typedef struct {
   char  **bandname;
   date_t *date;
   int     type;
+  int     zerocopy;
 } par_udf_t;
 
 // aggregation statistics
@@ -274,6 +275,7 @@ typedef struct {
 // STM
 typedef struct {
   int ostm;  // flag: output spectral temporal metrics
+  int qtol;  // tolerance of approximate quantiles (0: exact)
   par_sta_t sta;
 } par_stm_t;
 
@@ -341,6 +343,7 @@ typedef struct {
   char *f_response;
   char *f_coords;
   int  projected;
+  int  binary;
 } par_smp_t;
 
 // texture
@@ -488,6 +491,10 @@ typedef struct {
   int othread;
   int cthread;
   int stream;
+  int sreader;         // number of streaming readers
+  int swriter;         // number of streaming writers
+  int sflight;         // max. number of chunks in flight
+  float smemory;       // max. memory of chunks in flight (GB)
   int pretty_progress;
 
   // products
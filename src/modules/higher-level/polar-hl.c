@@ -329,6 +329,8 @@ double integral[_INTEGRAL_LEN_];
 polar_t *polar = NULL;
 polar_t *theta0 = NULL;
 float green_val, base_val;
+int p0, np;
+short *tsi_block = NULL, *tsi_p = NULL;
 
 
   valid = false;
@@ -341,326 +343,339 @@ float green_val, base_val;
 
 
 
-  #pragma omp parallel private(l,i,i0,i_,ce_left,ce_right,v_left,v_right,valid,ce,v,s,y,r,timing,vector,mean_window,n_window,max_rate,mean_rate,rate,recurrence,integral,polar,theta0,green_val,base_val) shared(mask_,ts,nc,ni,year_min,nodata,pol,tsi) default(none)
+  #pragma omp parallel private(l,i,i0,i_,ce_left,ce_right,v_left,v_right,valid,ce,v,s,y,r,timing,vector,mean_window,n_window,max_rate,mean_rate,rate,recurrence,integral,polar,theta0,green_val,base_val,p,np,tsi_block,tsi_p) shared(mask_,ts,nc,ni,year_min,nodata,pol,tsi) default(none)
   {
 
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     // allocate
     alloc((void**)&polar, ni, sizeof(polar_t));
 
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
+
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(ts->tsi_, ni, p0, np, tsi_block);
+
+      for (p=p0; p<p0+np; p++){
+
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
-      /** nodata if deriving POL failed **/
-      for (l=0; l<_POL_LENGTH_; l++){
-        if (ts->pol_[l] != NULL){
-          for (y=0; y<pol->ny; y++) ts->pol_[l][y][p] = nodata;
+        /** nodata if deriving POL failed **/
+        for (l=0; l<_POL_LENGTH_; l++){
+          if (ts->pol_[l] != NULL){
+            for (y=0; y<pol->ny; y++) ts->pol_[l][y][p] = nodata;
+          }
         }
-      }
-      
-      if (mask_ != NULL && !mask_[p]) continue;
+
+        if (mask_ != NULL && !mask_[p]) continue;
 
 
 
-      valid = true;
-      memset(mean_window[_ALPHA_], 0, 2*sizeof(float));
+        valid = true;
+        memset(mean_window[_ALPHA_], 0, 2*sizeof(float));
 
 
-      /** copy doy/v to working variables 
-      +++ and interpolate linearly to make sure **/
-      for (i=0; i<ni; i++){
+        /** copy doy/v to working variables 
+        +++ and interpolate linearly to make sure **/
+        for (i=0; i<ni; i++){
 
-        // linearly interpolate v-value
-        if (ts->tsi_[i][p] == nodata){
-          
-          ce_left = ce_right = INT_MIN;
-          v_left = v_right = nodata;
-          ce = ts->d_tsi[i].ce;
-          
-          for (i_=i-1; i_>=0; i_--){
-            if (ts->tsi_[i_][p] != nodata){
-              ce_left = ts->d_tsi[i_].ce;
-              v_left = ts->tsi_[i_][p];
-              break;
+          // linearly interpolate v-value
+          if (tsi_p[i] == nodata){
+
+            ce_left = ce_right = INT_MIN;
+            v_left = v_right = nodata;
+            ce = ts->d_tsi[i].ce;
+
+            for (i_=i-1; i_>=0; i_--){
+              if (tsi_p[i_] != nodata){
+                ce_left = ts->d_tsi[i_].ce;
+                v_left = tsi_p[i_];
+                break;
+              }
             }
-          }
-          for (i_=i+1; i_<ni; i_++){
-            if (ts->tsi_[i_][p] != nodata){
-              ce_right = ts->d_tsi[i_].ce;
-              v_right = ts->tsi_[i_][p];
-              break;
+            for (i_=i+1; i_<ni; i_++){
+              if (tsi_p[i_] != nodata){
+                ce_right = ts->d_tsi[i_].ce;
+                v_right = tsi_p[i_];
+                break;
+              }
             }
-          }
-          
-          if (ce_left > 0 && ce_right > 0){
-            v = (v_left*(ce_right-ce) + v_right*(ce-ce_left))/(ce_right-ce_left);
-          } else if (ce_left > 0){
-            v = v_left;
-          } else if (ce_right > 0){
-            v = v_right;
+
+            if (ce_left > 0 && ce_right > 0){
+              v = (v_left*(ce_right-ce) + v_right*(ce-ce_left))/(ce_right-ce_left);
+            } else if (ce_left > 0){
+              v = v_left;
+            } else if (ce_right > 0){
+              v = v_right;
+            } else {
+              v = nodata;
+              valid = false;
+            }
+
+          // copy v-value
           } else {
-            v = nodata;
-            valid = false;
-          }
 
-        // copy v-value
-        } else {
+            v = tsi_p[i];
 
-          v = ts->tsi_[i][p];
+          }
 
-        }
+          r = ts->d_tsi[i].doy/365.0*2.0*M_PI;
+          if (v < 0) v = 0;
 
-        r = ts->d_tsi[i].doy/365.0*2.0*M_PI;
-        if (v < 0) v = 0;
+          polar_coords(r, v, ts->d_tsi[i].year-year_min, &polar[i]);
 
-        polar_coords(r, v, ts->d_tsi[i].year-year_min, &polar[i]);
 
-        
-        if (pol->opct) ts->pcx_[i][p] = (short)polar[i].pcx;
-        if (pol->opct) ts->pcy_[i][p] = (short)polar[i].pcy;
+          if (pol->opct) ts->pcx_[i][p] = (short)polar[i].pcx;
+          if (pol->opct) ts->pcy_[i][p] = (short)polar[i].pcy;
 
-        mean_window[_ALPHA_][_X_] += polar[i].pcx;
-        mean_window[_ALPHA_][_Y_] += polar[i].pcy;
+          mean_window[_ALPHA_][_X_] += polar[i].pcx;
+          mean_window[_ALPHA_][_Y_] += polar[i].pcy;
 
-      }
+        }
 
-      if (!valid) continue;
+        if (!valid) continue;
 
 
-      // mean of polar coordinates
-      mean_window[_ALPHA_][_X_] /= ni;
-      mean_window[_ALPHA_][_Y_] /= ni;
+        // mean of polar coordinates
+        mean_window[_ALPHA_][_X_] /= ni;
+        mean_window[_ALPHA_][_Y_] /= ni;
 
-      // multi-annual average vector
-      polar_vector(mean_window[_ALPHA_][_X_], mean_window[_ALPHA_][_Y_], &vector[_ALPHA_]);
+        // multi-annual average vector
+        polar_vector(mean_window[_ALPHA_][_X_], mean_window[_ALPHA_][_Y_], &vector[_ALPHA_]);
 
-      // diametric opposite of average vector = start of phenological year
-      if (vector[_ALPHA_].rad < M_PI){
-        vector[_THETA_].rad = vector[_ALPHA_].rad + M_PI;
-      } else {
-        vector[_THETA_].rad = vector[_ALPHA_].rad - M_PI;
-      }
-      vector[_THETA_].doy = (vector[_THETA_].rad*365.0/(2.0*M_PI));
+        // diametric opposite of average vector = start of phenological year
+        if (vector[_ALPHA_].rad < M_PI){
+          vector[_THETA_].rad = vector[_ALPHA_].rad + M_PI;
+        } else {
+          vector[_THETA_].rad = vector[_ALPHA_].rad - M_PI;
+        }
+        vector[_THETA_].doy = (vector[_THETA_].rad*365.0/(2.0*M_PI));
 
 
-      identify_regular_seasons(polar, ni, tsi->step, &vector[_THETA_]);
+        identify_regular_seasons(polar, ni, tsi->step, &vector[_THETA_]);
 
-      theta0 = identify_variable_seasons(polar, ni, tsi->step, pol, &vector[_THETA_]);
+        theta0 = identify_variable_seasons(polar, ni, tsi->step, pol, &vector[_THETA_]);
 
-      accumulate_seasons(polar, ni);
+        accumulate_seasons(polar, ni);
 
 
-      for (s=0, i0=0; s<pol->ns; s++){
+        for (s=0, i0=0; s<pol->ns; s++){
 
-        memset(&timing,     0, sizeof(polar_t)*_EVENT_LEN_);
-        memset(mean_window, 0, sizeof(float)*_WINDOW_LEN_*2);
-        memset(n_window,    0, sizeof(float)*_WINDOW_LEN_);
-        memset(max_rate,    0, sizeof(float)*_WINDOW_LEN_);
-        memset(mean_rate,   0, sizeof(float)*_WINDOW_LEN_);
-        memset(recurrence,  0, sizeof(double)*2);
+          memset(&timing,     0, sizeof(polar_t)*_EVENT_LEN_);
+          memset(mean_window, 0, sizeof(float)*_WINDOW_LEN_*2);
+          memset(n_window,    0, sizeof(float)*_WINDOW_LEN_);
+          memset(max_rate,    0, sizeof(float)*_WINDOW_LEN_);
+          memset(mean_rate,   0, sizeof(float)*_WINDOW_LEN_);
+          memset(recurrence,  0, sizeof(double)*2);
 
-        if (vector[_THETA_].doy < 182) y = s; else y = s+1;
-        vector[_THETA_].ce = doy2ce(vector[_THETA_].doy, s);
+          if (vector[_THETA_].doy < 182) y = s; else y = s+1;
+          vector[_THETA_].ce = doy2ce(vector[_THETA_].doy, s);
 
 
-        for (i=i0; i<ni; i++){
-          
-          if (polar[i].season < s) continue;
-          if (polar[i].season > s) break;
+          for (i=i0; i<ni; i++){
 
-          // start of phenological year
-          if (polar[i].cum > 0 && timing[_LEFT_].cum == 0){
-            memcpy(&timing[_LEFT_], &polar[i], sizeof(polar_t));}
+            if (polar[i].season < s) continue;
+            if (polar[i].season > s) break;
 
-          // end of phenological year
-          if (polar[i].cum == 1){
-            if (i+1 < ni){
-              memcpy(&timing[_RIGHT_], &polar[i+1], sizeof(polar_t));
-            } else {
-              memcpy(&timing[_RIGHT_], &polar[i],   sizeof(polar_t));
+            // start of phenological year
+            if (polar[i].cum > 0 && timing[_LEFT_].cum == 0){
+              memcpy(&timing[_LEFT_], &polar[i], sizeof(polar_t));}
+
+            // end of phenological year
+            if (polar[i].cum == 1){
+              if (i+1 < ni){
+                memcpy(&timing[_RIGHT_], &polar[i+1], sizeof(polar_t));
+              } else {
+                memcpy(&timing[_RIGHT_], &polar[i],   sizeof(polar_t));
+              }
             }
-          }
 
-          // start of growing season
-          if (polar[i].cum >= pol->start && timing[_START_].cum == 0){
-            memcpy(&timing[_START_], &polar[i], sizeof(polar_t));}
+            // start of growing season
+            if (polar[i].cum >= pol->start && timing[_START_].cum == 0){
+              memcpy(&timing[_START_], &polar[i], sizeof(polar_t));}
 
-          // mid of growing season
-          if (polar[i].cum >= pol->mid   && timing[_MID_].cum   == 0){
-            memcpy(&timing[_MID_],   &polar[i], sizeof(polar_t));}
+            // mid of growing season
+            if (polar[i].cum >= pol->mid   && timing[_MID_].cum   == 0){
+              memcpy(&timing[_MID_],   &polar[i], sizeof(polar_t));}
 
-          // end of growing season
-          if (polar[i].cum >= pol->end   && timing[_END_].cum   == 0){
-            memcpy(&timing[_END_],   &polar[i], sizeof(polar_t));}
+            // end of growing season
+            if (polar[i].cum >= pol->end   && timing[_END_].cum   == 0){
+              memcpy(&timing[_END_],   &polar[i], sizeof(polar_t));}
 
-          // mean, sd of val + average vector of growing season
-          if (polar[i].cum >= pol->start && 
-              polar[i].cum <  pol->end){
-            var_recurrence(polar[i].val, &recurrence[0], &recurrence[1], ++n_window[_GROW_]);
-            mean_window[_GROW_][_X_] += polar[i].pcx;
-            mean_window[_GROW_][_Y_] += polar[i].pcy;
-          }
+            // mean, sd of val + average vector of growing season
+            if (polar[i].cum >= pol->start && 
+                polar[i].cum <  pol->end){
+              var_recurrence(polar[i].val, &recurrence[0], &recurrence[1], ++n_window[_GROW_]);
+              mean_window[_GROW_][_X_] += polar[i].pcx;
+              mean_window[_GROW_][_Y_] += polar[i].pcy;
+            }
 
-          // max of season
-          if (polar[i].cum >= pol->start && 
-              polar[i].cum <  pol->end   && 
-              polar[i].val > timing[_PEAK_].val){
-            memcpy(&timing[_PEAK_],   &polar[i], sizeof(polar_t));}
-
-          // average vector of early growing season part
-          // + average and maximum rising rate
-          if (polar[i].cum >= pol->start && 
-              polar[i].cum <  pol->mid){
-            mean_window[_EARLY_][_X_] += polar[i].pcx;
-            mean_window[_EARLY_][_Y_] += polar[i].pcy;
-            if (i > 0 && polar[i].val - polar[i-1].val > 0){
-              rate = (polar[i].val - polar[i-1].val)/tsi->step;
-              mean_rate[_EARLY_] += rate;
-              if (rate > max_rate[_EARLY_]) max_rate[_EARLY_] = rate;
+            // max of season
+            if (polar[i].cum >= pol->start && 
+                polar[i].cum <  pol->end   && 
+                polar[i].val > timing[_PEAK_].val){
+              memcpy(&timing[_PEAK_],   &polar[i], sizeof(polar_t));}
+
+            // average vector of early growing season part
+            // + average and maximum rising rate
+            if (polar[i].cum >= pol->start && 
+                polar[i].cum <  pol->mid){
+              mean_window[_EARLY_][_X_] += polar[i].pcx;
+              mean_window[_EARLY_][_Y_] += polar[i].pcy;
+              if (i > 0 && polar[i].val - polar[i-1].val > 0){
+                rate = (polar[i].val - polar[i-1].val)/tsi->step;
+                mean_rate[_EARLY_] += rate;
+                if (rate > max_rate[_EARLY_]) max_rate[_EARLY_] = rate;
+              }
+              n_window[_EARLY_]++;
             }
-            n_window[_EARLY_]++;
-          }
-          
-          // average vector of late growing season part
-          // + average and maximum falling rate
-          if (polar[i].cum >= pol->mid && 
-              polar[i].cum <  pol->end){
-            mean_window[_LATE_][_X_] += polar[i].pcx;
-            mean_window[_LATE_][_Y_] += polar[i].pcy;
-            if (i > 0 && polar[i].val - polar[i-1].val < 0){
-              rate = (polar[i-1].val - polar[i].val)/tsi->step;
-              mean_rate[_LATE_] += rate;
-              if (rate > max_rate[_LATE_]) max_rate[_LATE_] = rate;
+
+            // average vector of late growing season part
+            // + average and maximum falling rate
+            if (polar[i].cum >= pol->mid && 
+                polar[i].cum <  pol->end){
+              mean_window[_LATE_][_X_] += polar[i].pcx;
+              mean_window[_LATE_][_Y_] += polar[i].pcy;
+              if (i > 0 && polar[i].val - polar[i-1].val < 0){
+                rate = (polar[i-1].val - polar[i].val)/tsi->step;
+                mean_rate[_LATE_] += rate;
+                if (rate > max_rate[_LATE_]) max_rate[_LATE_] = rate;
+              }
+              n_window[_LATE_]++;
             }
-            n_window[_LATE_]++;
+
           }
 
-        }
 
+          mean_window[_GROW_][_X_]  /= n_window[_GROW_];
+          mean_window[_GROW_][_Y_]  /= n_window[_GROW_];
+          mean_window[_EARLY_][_X_] /= n_window[_EARLY_];
+          mean_window[_EARLY_][_Y_] /= n_window[_EARLY_];
+          mean_window[_LATE_][_X_]  /= n_window[_LATE_];
+          mean_window[_LATE_][_Y_]  /= n_window[_LATE_];
 
-        mean_window[_GROW_][_X_]  /= n_window[_GROW_];
-        mean_window[_GROW_][_Y_]  /= n_window[_GROW_];
-        mean_window[_EARLY_][_X_] /= n_window[_EARLY_];
-        mean_window[_EARLY_][_Y_] /= n_window[_EARLY_];
-        mean_window[_LATE_][_X_]  /= n_window[_LATE_];
-        mean_window[_LATE_][_Y_]  /= n_window[_LATE_];
+          polar_vector(mean_window[_GROW_][_X_],  mean_window[_GROW_][_Y_], &vector[_GROW_]);
+          polar_vector(mean_window[_EARLY_][_X_], mean_window[_EARLY_][_Y_],&vector[_EARLY_]);
+          polar_vector(mean_window[_LATE_][_X_],  mean_window[_LATE_][_Y_], &vector[_LATE_]);
 
-        polar_vector(mean_window[_GROW_][_X_],  mean_window[_GROW_][_Y_], &vector[_GROW_]);
-        polar_vector(mean_window[_EARLY_][_X_], mean_window[_EARLY_][_Y_],&vector[_EARLY_]);
-        polar_vector(mean_window[_LATE_][_X_],  mean_window[_LATE_][_Y_], &vector[_LATE_]);
+          ce_from_polar_vector(s, &vector[_THETA_], &vector[_GROW_]);
+          ce_from_polar_vector(s, &vector[_THETA_], &vector[_EARLY_]);
+          ce_from_polar_vector(s, &vector[_THETA_], &vector[_LATE_]);
 
-        ce_from_polar_vector(s, &vector[_THETA_], &vector[_GROW_]);
-        ce_from_polar_vector(s, &vector[_THETA_], &vector[_EARLY_]);
-        ce_from_polar_vector(s, &vector[_THETA_], &vector[_LATE_]);
+          mean_rate[_EARLY_] /= n_window[_EARLY_];
+          mean_rate[_LATE_]  /= n_window[_LATE_];
 
-        mean_rate[_EARLY_] /= n_window[_EARLY_];
-        mean_rate[_LATE_]  /= n_window[_LATE_];
+          green_val = (timing[_START_].val + timing[_END_].val)   / 2.0;
+          base_val  = (timing[_LEFT_].val  + timing[_RIGHT_].val) / 2.0;
 
-        green_val = (timing[_START_].val + timing[_END_].val)   / 2.0;
-        base_val  = (timing[_LEFT_].val  + timing[_RIGHT_].val) / 2.0;
+          memset(integral, 0, sizeof(double)*_INTEGRAL_LEN_);
 
-        memset(integral, 0, sizeof(double)*_INTEGRAL_LEN_);
+          for (i=i0; i<ni; i++){
 
-        for (i=i0; i<ni; i++){
+            if (polar[i].season < s) continue;
+            if (polar[i].season > s){ i0 = i; break; }
 
-          if (polar[i].season < s) continue;
-          if (polar[i].season > s){ i0 = i; break; }
+            // green integral
+            if (polar[i].cum >= pol->start && 
+                polar[i].cum <  pol->end &&
+                polar[i].val > green_val){
+              integral[_GREEN_INT_] += (polar[i].val-green_val)*tsi->step;
+            }
 
-          // green integral
-          if (polar[i].cum >= pol->start && 
-              polar[i].cum <  pol->end &&
-              polar[i].val > green_val){
-            integral[_GREEN_INT_] += (polar[i].val-green_val)*tsi->step;
-          }
+            // min-min integral
+            if (polar[i].val > base_val){
+              integral[_SEASONAL_INT_] += (polar[i].val-base_val)*tsi->step;
+            }
 
-          // min-min integral
-          if (polar[i].val > base_val){
-            integral[_SEASONAL_INT_] += (polar[i].val-base_val)*tsi->step;
-          }
+            // latent integral
+            if (polar[i].val > base_val){
+              integral[_LATENT_INT_] += base_val*tsi->step;
+            } else {
+              integral[_LATENT_INT_] += polar[i].val*tsi->step;
+            }
 
-          // latent integral
-          if (polar[i].val > base_val){
-            integral[_LATENT_INT_] += base_val*tsi->step;
-          } else {
-            integral[_LATENT_INT_] += polar[i].val*tsi->step;
-          }
+            // total integral
+            integral[_TOTAL_INT_] += polar[i].val*tsi->step;
 
-          // total integral
-          integral[_TOTAL_INT_] += polar[i].val*tsi->step;
+            // rising integral
+            if (i > 0 && polar[i].val - polar[i-1].val > 0){
+              integral[_RISING_INT_]  += (polar[i].val - polar[i-1].val)*tsi->step;
+            }
 
-          // rising integral
-          if (i > 0 && polar[i].val - polar[i-1].val > 0){
-            integral[_RISING_INT_]  += (polar[i].val - polar[i-1].val)*tsi->step;
-          }
+            // falling integral
+            if (i > 0 && polar[i].val - polar[i-1].val < 0){
+              integral[_FALLING_INT_] += (polar[i-1].val - polar[i].val)*tsi->step;
+            }
 
-          // falling integral
-          if (i > 0 && polar[i].val - polar[i-1].val < 0){
-            integral[_FALLING_INT_] += (polar[i-1].val - polar[i].val)*tsi->step;
           }
 
-        }
 
+          // date parameters
+          if (pol->use[_POL_DEM_]) ts->pol_[_POL_DEM_][y][p] = (short)timing[_LEFT_].ce;
+          if (pol->use[_POL_DSS_]) ts->pol_[_POL_DSS_][y][p] = (short)timing[_START_].ce;
+          if (pol->use[_POL_DMS_]) ts->pol_[_POL_DMS_][y][p] = (short)timing[_MID_].ce;
+          if (pol->use[_POL_DPS_]) ts->pol_[_POL_DPS_][y][p] = (short)timing[_PEAK_].ce;
+          if (pol->use[_POL_DES_]) ts->pol_[_POL_DES_][y][p] = (short)timing[_END_].ce;
+          if (pol->use[_POL_DLM_]) ts->pol_[_POL_DLM_][y][p] = (short)timing[_RIGHT_].ce;
+          if (pol->use[_POL_DEV_]) ts->pol_[_POL_DEV_][y][p] = (short)vector[_EARLY_].ce;
+          if (pol->use[_POL_DAV_]) ts->pol_[_POL_DAV_][y][p] = (short)vector[_GROW_].ce;
+          if (pol->use[_POL_DLV_]) ts->pol_[_POL_DLV_][y][p] = (short)vector[_LATE_].ce;
+          if (pol->use[_POL_DPY_]) ts->pol_[_POL_DPY_][y][p] = (short)(vector[_THETA_].ce);
+          if (pol->use[_POL_DPV_]) ts->pol_[_POL_DPV_][y][p] = (short)(theta0[s].ce - vector[_THETA_].ce);
+
+          // length parameters
+          if (pol->use[_POL_LGS_]) ts->pol_[_POL_LGS_][y][p] = (short)(timing[_END_].ce   - timing[_START_].ce);
+          if (pol->use[_POL_LGV_]) ts->pol_[_POL_LGV_][y][p] = (short)(vector[_LATE_].ce  - vector[_EARLY_].ce);
+          if (pol->use[_POL_LTS_]) ts->pol_[_POL_LTS_][y][p] = (short)(timing[_RIGHT_].ce - timing[_LEFT_].ce);
+
+          // value parameters
+          if (pol->use[_POL_VEM_]) ts->pol_[_POL_VEM_][y][p] = (short)timing[_LEFT_].val;
+          if (pol->use[_POL_VSS_]) ts->pol_[_POL_VSS_][y][p] = (short)timing[_START_].val;
+          if (pol->use[_POL_VMS_]) ts->pol_[_POL_VMS_][y][p] = (short)timing[_MID_].val;
+          if (pol->use[_POL_VPS_]) ts->pol_[_POL_VPS_][y][p] = (short)timing[_PEAK_].val;
+          if (pol->use[_POL_VLM_]) ts->pol_[_POL_VLM_][y][p] = (short)timing[_RIGHT_].val;
+          if (pol->use[_POL_VES_]) ts->pol_[_POL_VES_][y][p] = (short)timing[_END_].val;
+          if (pol->use[_POL_VEV_]) ts->pol_[_POL_VEV_][y][p] = (short)vector[_EARLY_].val;
+          if (pol->use[_POL_VAV_]) ts->pol_[_POL_VAV_][y][p] = (short)vector[_GROW_].val;
+          if (pol->use[_POL_VLV_]) ts->pol_[_POL_VLV_][y][p] = (short)vector[_LATE_].val;
+          if (pol->use[_POL_VBL_]) ts->pol_[_POL_VBL_][y][p] = (short)base_val;
+          if (pol->use[_POL_VGM_]) ts->pol_[_POL_VGM_][y][p] = (short)recurrence[0];
+          if (pol->use[_POL_VGV_]) ts->pol_[_POL_VGV_][y][p] = (short)standdev(recurrence[1], n_window[_GROW_]);
+
+          // amplitude parameters
+          if (pol->use[_POL_VGA_]) ts->pol_[_POL_VGA_][y][p] = (short)(timing[_PEAK_].val - green_val);
+          if (pol->use[_POL_VPA_]) ts->pol_[_POL_VPA_][y][p] = (short)(timing[_PEAK_].val - timing[_MID_].val);
+          if (pol->use[_POL_VSA_]) ts->pol_[_POL_VSA_][y][p] = (short)(timing[_PEAK_].val - base_val);
+
+          // integral parameters
+          if (pol->use[_POL_IST_]) ts->pol_[_POL_IST_][y][p] = (short)(integral[_SEASONAL_INT_] / 365.0); // integral, unit of time: year
+          if (pol->use[_POL_IBL_]) ts->pol_[_POL_IBL_][y][p] = (short)(integral[_LATENT_INT_]   / 365.0); // integral, unit of time: year
+          if (pol->use[_POL_IBT_]) ts->pol_[_POL_IBT_][y][p] = (short)(integral[_TOTAL_INT_]    / 365.0); // integral, unit of time: year
+          if (pol->use[_POL_IGS_]) ts->pol_[_POL_IGS_][y][p] = (short)(integral[_GREEN_INT_]    / 365.0); // integral, unit of time: year
+          if (pol->use[_POL_IRR_]) ts->pol_[_POL_IRR_][y][p] = (short)(integral[_RISING_INT_]   / 30.0); // integral, unit of time: month
+          if (pol->use[_POL_IFR_]) ts->pol_[_POL_IFR_][y][p] = (short)(integral[_FALLING_INT_]  / 30.0); // integral, unit of time: month
+
+          // rate parameters
+          if (pol->use[_POL_RAR_]) ts->pol_[_POL_RAR_][y][p] = (short)(mean_rate[_EARLY_] * 30); // increase per month
+          if (pol->use[_POL_RAF_]) ts->pol_[_POL_RAF_][y][p] = (short)(mean_rate[_LATE_]  * 30); // decrease per month
+          if (pol->use[_POL_RMR_]) ts->pol_[_POL_RMR_][y][p] = (short)(max_rate[_EARLY_]  * 30); // increase per month
+          if (pol->use[_POL_RMF_]) ts->pol_[_POL_RMF_][y][p] = (short)(max_rate[_LATE_]   * 30); // decrease per month
+
+        }
 
-        // date parameters
-        if (pol->use[_POL_DEM_]) ts->pol_[_POL_DEM_][y][p] = (short)timing[_LEFT_].ce;
-        if (pol->use[_POL_DSS_]) ts->pol_[_POL_DSS_][y][p] = (short)timing[_START_].ce;
-        if (pol->use[_POL_DMS_]) ts->pol_[_POL_DMS_][y][p] = (short)timing[_MID_].ce;
-        if (pol->use[_POL_DPS_]) ts->pol_[_POL_DPS_][y][p] = (short)timing[_PEAK_].ce;
-        if (pol->use[_POL_DES_]) ts->pol_[_POL_DES_][y][p] = (short)timing[_END_].ce;
-        if (pol->use[_POL_DLM_]) ts->pol_[_POL_DLM_][y][p] = (short)timing[_RIGHT_].ce;
-        if (pol->use[_POL_DEV_]) ts->pol_[_POL_DEV_][y][p] = (short)vector[_EARLY_].ce;
-        if (pol->use[_POL_DAV_]) ts->pol_[_POL_DAV_][y][p] = (short)vector[_GROW_].ce;
-        if (pol->use[_POL_DLV_]) ts->pol_[_POL_DLV_][y][p] = (short)vector[_LATE_].ce;
-        if (pol->use[_POL_DPY_]) ts->pol_[_POL_DPY_][y][p] = (short)(vector[_THETA_].ce);
-        if (pol->use[_POL_DPV_]) ts->pol_[_POL_DPV_][y][p] = (short)(theta0[s].ce - vector[_THETA_].ce);
-
-        // length parameters
-        if (pol->use[_POL_LGS_]) ts->pol_[_POL_LGS_][y][p] = (short)(timing[_END_].ce   - timing[_START_].ce);
-        if (pol->use[_POL_LGV_]) ts->pol_[_POL_LGV_][y][p] = (short)(vector[_LATE_].ce  - vector[_EARLY_].ce);
-        if (pol->use[_POL_LTS_]) ts->pol_[_POL_LTS_][y][p] = (short)(timing[_RIGHT_].ce - timing[_LEFT_].ce);
-
-        // value parameters
-        if (pol->use[_POL_VEM_]) ts->pol_[_POL_VEM_][y][p] = (short)timing[_LEFT_].val;
-        if (pol->use[_POL_VSS_]) ts->pol_[_POL_VSS_][y][p] = (short)timing[_START_].val;
-        if (pol->use[_POL_VMS_]) ts->pol_[_POL_VMS_][y][p] = (short)timing[_MID_].val;
-        if (pol->use[_POL_VPS_]) ts->pol_[_POL_VPS_][y][p] = (short)timing[_PEAK_].val;
-        if (pol->use[_POL_VLM_]) ts->pol_[_POL_VLM_][y][p] = (short)timing[_RIGHT_].val;
-        if (pol->use[_POL_VES_]) ts->pol_[_POL_VES_][y][p] = (short)timing[_END_].val;
-        if (pol->use[_POL_VEV_]) ts->pol_[_POL_VEV_][y][p] = (short)vector[_EARLY_].val;
-        if (pol->use[_POL_VAV_]) ts->pol_[_POL_VAV_][y][p] = (short)vector[_GROW_].val;
-        if (pol->use[_POL_VLV_]) ts->pol_[_POL_VLV_][y][p] = (short)vector[_LATE_].val;
-        if (pol->use[_POL_VBL_]) ts->pol_[_POL_VBL_][y][p] = (short)base_val;
-        if (pol->use[_POL_VGM_]) ts->pol_[_POL_VGM_][y][p] = (short)recurrence[0];
-        if (pol->use[_POL_VGV_]) ts->pol_[_POL_VGV_][y][p] = (short)standdev(recurrence[1], n_window[_GROW_]);
-
-        // amplitude parameters
-        if (pol->use[_POL_VGA_]) ts->pol_[_POL_VGA_][y][p] = (short)(timing[_PEAK_].val - green_val);
-        if (pol->use[_POL_VPA_]) ts->pol_[_POL_VPA_][y][p] = (short)(timing[_PEAK_].val - timing[_MID_].val);
-        if (pol->use[_POL_VSA_]) ts->pol_[_POL_VSA_][y][p] = (short)(timing[_PEAK_].val - base_val);
-
-        // integral parameters
-        if (pol->use[_POL_IST_]) ts->pol_[_POL_IST_][y][p] = (short)(integral[_SEASONAL_INT_] / 365.0); // integral, unit of time: year
-        if (pol->use[_POL_IBL_]) ts->pol_[_POL_IBL_][y][p] = (short)(integral[_LATENT_INT_]   / 365.0); // integral, unit of time: year
-        if (pol->use[_POL_IBT_]) ts->pol_[_POL_IBT_][y][p] = (short)(integral[_TOTAL_INT_]    / 365.0); // integral, unit of time: year
-        if (pol->use[_POL_IGS_]) ts->pol_[_POL_IGS_][y][p] = (short)(integral[_GREEN_INT_]    / 365.0); // integral, unit of time: year
-        if (pol->use[_POL_IRR_]) ts->pol_[_POL_IRR_][y][p] = (short)(integral[_RISING_INT_]   / 30.0); // integral, unit of time: month
-        if (pol->use[_POL_IFR_]) ts->pol_[_POL_IFR_][y][p] = (short)(integral[_FALLING_INT_]  / 30.0); // integral, unit of time: month
-
-        // rate parameters
-        if (pol->use[_POL_RAR_]) ts->pol_[_POL_RAR_][y][p] = (short)(mean_rate[_EARLY_] * 30); // increase per month
-        if (pol->use[_POL_RAF_]) ts->pol_[_POL_RAF_][y][p] = (short)(mean_rate[_LATE_]  * 30); // decrease per month
-        if (pol->use[_POL_RMR_]) ts->pol_[_POL_RMR_][y][p] = (short)(max_rate[_EARLY_]  * 30); // increase per month
-        if (pol->use[_POL_RMF_]) ts->pol_[_POL_RMF_][y][p] = (short)(max_rate[_LATE_]   * 30); // decrease per month
+        if (theta0 != NULL) free((void*)theta0); 
+        theta0 = NULL;
 
       }
 
-      if (theta0 != NULL) free((void*)theta0); 
-      theta0 = NULL;
-
     }
 
     free((void*)polar);
 
+    free((void*)tsi_block);
+
   }
 
 
@@ -40,6 +40,7 @@ void percent_done(progress_t *pro);
 void print_progress_summary(progress_t *pro);
 void print_progress_details(progress_t *pro);
 void print_progress_runtime(progress_t *pro);
+void finish_progress(progress_t *pro);
 
 
 /** This function measures the progress
@@ -72,11 +73,18 @@ void init_progess(progress_t *pro, cube_t *cube, par_hl_t *phl){
 
   measure_progress(pro, _TASK_RUNTIME_, _CLOCK_TICK_);
   
-  pro->thread[_TASK_INPUT_]   = phl->ithread;
+  if (phl->stream){
+    pro->thread[_TASK_INPUT_]  = phl->sreader*phl->ithread;
+    pro->thread[_TASK_OUTPUT_] = phl->swriter*phl->othread;
+  } else {
+    pro->thread[_TASK_INPUT_]  = phl->ithread;
+    pro->thread[_TASK_OUTPUT_] = phl->othread;
+  }
   pro->thread[_TASK_COMPUTE_] = phl->cthread;
-  pro->thread[_TASK_OUTPUT_]  = phl->othread;
-  pro->thread[_TASK_ALL_]     = phl->ithread+phl->cthread+phl->othread;
-  pro->thread[_TASK_RUNTIME_] = phl->ithread+phl->cthread+phl->othread;
+  pro->thread[_TASK_ALL_]     = pro->thread[_TASK_INPUT_] + 
+                                pro->thread[_TASK_COMPUTE_] + 
+                                pro->thread[_TASK_OUTPUT_];
+  pro->thread[_TASK_RUNTIME_] = pro->thread[_TASK_ALL_];
 
   pro->npu = cube->tn*cube->cn;
 
@@ -90,6 +98,7 @@ void init_progess(progress_t *pro, cube_t *cube, par_hl_t *phl){
   pro->pu_prev  =  0;
   pro->pu_next  =  0;
   pro->done     =  0;
+  pro->nprint   =  0;
 
   pro->tile      = 0;
   pro->tile_prev = 0;
@@ -163,7 +172,7 @@ void rewind_stdout(progress_t *pro){
 
 int line, nline = 12;
 
-  if (pro->pu >=0){
+  if (pro->nprint > 0){
     for (line=0; line<=nline; line++) printf("\033[A\r");
     printf("\n");
   }
@@ -174,68 +183,66 @@ int line, nline = 12;
 }
 
 
-/** This function sets the current processing units
+/** This function sets the processing unit that is handled by a task
 --- pro:      progress handle
---- cube:     datacube definition
---- phl:      HL parameters
+--- task:     input, compute or output task
+--- pu:       processing unit
 +++ Return:   void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void processing_unit(progress_t *pro){
-  
-  pro->pu++;
-  pro->pu_prev  = pro->pu-1;
-  pro->pu_next  = pro->pu+1;
-
-  if (pro->pu >= 0 && pro->pu < pro->npu){
-    pro->tile = floor(pro->pu      / (float)pro->nchunk);
-  } else pro->tile = -1;
+void progress_unit(progress_t *pro, int task, int pu){
+int tile = -1, chunk = -1, tx = -1, ty = -1;
 
-  if (pro->pu_next >= 0 && pro->pu_next < pro->npu){
-    pro->tile_next = floor(pro->pu_next / (float)pro->nchunk);
-  } else pro->tile_next = -1;
-  
-  if (pro->pu_prev >= 0 && pro->pu_prev < pro->npu){
-    pro->tile_prev = floor(pro->pu_prev / (float)pro->nchunk);
-  } else pro->tile_prev = -1;
 
+  if (pu >= 0 && pu < pro->npu){
+    tile  = floor(pu / (float)pro->nchunk);
+    chunk = pu - (tile * pro->nchunk);
+    tx    = pro->tiles_x[tile];
+    ty    = pro->tiles_y[tile];
+  }
 
-  if (pro->tile > -1){
-    pro->chunk = pro->pu - (pro->tile * pro->nchunk);
-  } else pro->chunk  = -1;
-  
-  if (pro->tile_next > -1){
-    pro->chunk_next = pro->pu_next - (pro->tile_next * pro->nchunk);
-  } else pro->chunk_next = -1;
-  
-  if (pro->tile_prev > -1){
-    pro->chunk_prev = pro->pu_prev - (pro->tile_prev * pro->nchunk);
-  } else pro->chunk_prev = -1;
-
+  switch (task){
+    case _TASK_INPUT_:
+      pro->pu_next    = pu;
+      pro->tile_next  = tile;
+      pro->chunk_next = chunk;
+      pro->tx_next    = tx;
+      pro->ty_next    = ty;
+      break;
+    case _TASK_COMPUTE_:
+      pro->pu    = pu;
+      pro->tile  = tile;
+      pro->chunk = chunk;
+      pro->tx    = tx;
+      pro->ty    = ty;
+      break;
+    case _TASK_OUTPUT_:
+      pro->pu_prev    = pu;
+      pro->tile_prev  = tile;
+      pro->chunk_prev = chunk;
+      pro->tx_prev    = tx;
+      pro->ty_prev    = ty;
+      break;
+    default:
+      printf("unknown task\n");
+      break;
+  }
 
-  if (pro->tile > -1){
-    pro->tx = pro->tiles_x[pro->tile]; 
-  } else pro->tx = -1;
+  return;
+}
 
-  if (pro->tile > -1){
-    pro->ty = pro->tiles_y[pro->tile];
-  } else pro->ty = -1;
 
-  if (pro->tile_next > -1){
-    pro->tx_next = pro->tiles_x[pro->tile_next]; 
-  } else pro->tx_next = -1;
+/** This function sets the current processing units
+--- pro:      progress handle
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void processing_unit(progress_t *pro){
+int pu = pro->pu+1;
 
-  if (pro->tile_next > -1){
-    pro->ty_next = pro->tiles_y[pro->tile_next];
-  } else pro->ty_next = -1;
 
-  if (pro->tile_prev > -1){
-    pro->tx_prev = pro->tiles_x[pro->tile_prev]; 
-  } else pro->tx_prev = -1;
+  progress_unit(pro, _TASK_INPUT_,   pu+1);
+  progress_unit(pro, _TASK_COMPUTE_, pu);
+  progress_unit(pro, _TASK_OUTPUT_,  pu-1);
 
-  if (pro->tile_prev > -1){
-    pro->ty_prev = pro->tiles_y[pro->tile_prev];
-  } else pro->ty_prev = -1;
-  
   return;
 }
 
@@ -395,6 +402,8 @@ void print_progress_details(progress_t *pro){
   printf("Time (sec):      %7.0f %7.0f %7.0f\n", 
     pro->secs[_TASK_INPUT_], pro->secs[_TASK_COMPUTE_], pro->secs[_TASK_OUTPUT_]);
 
+  pro->nprint++;
+
   return;
 }
 
@@ -507,6 +516,25 @@ bool write_this_chunk(progress_t *pro, int *nprod){
 }
 
 
+/** This function prints the final progress information and cleans up
+--- pro:      progress handle
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void finish_progress(progress_t *pro){
+
+
+  measure_progress(pro, _TASK_RUNTIME_, _CLOCK_TOCK_);
+
+  print_progress_summary(pro);
+  print_progress_runtime(pro);
+
+  free((void*)pro->tiles_x);
+  free((void*)pro->tiles_y);
+
+  return;
+}
+
+
 /** This function handles and prints progress
 --- pro:      progress handle
 +++ Return:   true/false
@@ -524,13 +552,7 @@ bool progress(progress_t *pro){
 
   if (pro->pu > pro->npu){
 
-    measure_progress(pro, _TASK_RUNTIME_, _CLOCK_TOCK_);
-
-    print_progress_summary(pro);
-    print_progress_runtime(pro);
-
-    free((void*)pro->tiles_x);
-    free((void*)pro->tiles_y);
+    finish_progress(pro);
     
     return false;
   
@@ -551,3 +573,81 @@ bool progress(progress_t *pro){
 }
 
 
+/** This function adds the time that a task spent on one processing unit
++++ when streaming with the work queue
+--- pro:      progress handle
+--- task:     input, compute or output task
+--- secs:     processing time
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void progress_queue_time(progress_t *pro, int task, double secs){
+
+
+  pro->secs[task] = secs;
+  pro->secs_total[task] += secs;
+
+  pro->secs_total[_TASK_ALL_] = pro->secs_total[_TASK_INPUT_]   + 
+                                pro->secs_total[_TASK_COMPUTE_] + 
+                                pro->secs_total[_TASK_OUTPUT_];
+
+  return;
+}
+
+
+/** This function adds the time that the work queue was bound by a task
+--- pro:      progress handle
+--- task:     input, compute or output task
+--- secs:     bound time
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void progress_queue_bound(progress_t *pro, int task, double secs){
+
+
+  pro->secs_bound[task] += secs;
+
+  return;
+}
+
+
+/** This function handles and prints progress when streaming with the 
++++ work queue. In contrast to progress(), the processing units of the
++++ input, compute and output tasks are not in lock-step.
+--- pro:      progress handle
+--- ndone:    number of finished processing units
++++ Return:   true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool progress_queue(progress_t *pro, int ndone){
+double secs;
+
+
+  rewind_stdout(pro);
+
+  if (ndone >= pro->npu){
+
+    pro->done = 100.0;
+
+    finish_progress(pro);
+
+    return false;
+
+  } else {
+
+    secs = proctime(pro->TIME[_TASK_RUNTIME_]);
+
+    if (ndone > 0 && secs > 0){
+      set_secs(&pro->eta, (pro->npu-ndone) * (secs/ndone));
+    } else {
+      set_secs(&pro->eta, 0);
+    }
+
+    pro->done = (float)ndone/pro->npu*100.0;
+
+    print_progress_summary(pro);
+    print_progress_details(pro);
+
+    return true;
+
+  }
+
+}
+
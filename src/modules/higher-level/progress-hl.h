@@ -61,6 +61,7 @@ typedef struct {
   date_t bound[_TASK_LENGTH_];
   date_t sequential[_TASK_LENGTH_];
   int pretty_progress;
+  int nprint;
 } progress_t;
 
 void measure_progress(progress_t *pro, int task, int clock);
@@ -69,6 +70,10 @@ bool read_this_chunk(progress_t *pro);
 bool compute_this_chunk(progress_t *pro);
 bool write_this_chunk(progress_t *pro, int *nprod);
 bool progress(progress_t *pro);
+void progress_unit(progress_t *pro, int task, int pu);
+void progress_queue_time(progress_t *pro, int task, double secs);
+void progress_queue_bound(progress_t *pro, int task, double secs);
+bool progress_queue(progress_t *pro, int ndone);
 
 #ifdef __cplusplus
 }
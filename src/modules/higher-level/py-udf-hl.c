@@ -51,6 +51,97 @@ typedef struct {
 
 py_dimlab_t python_label_dimensions(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf);
 int date_from_bandname(date_t *date, char *bandname);
+int compile_python(const char *fname, PyObject *main_dict);
+short *contiguous_images(short **img_, int n, int nc);
+
+// callables of the compiled UDF, these are cached for all chunks
+PyObject *py_forcepy_init_ = NULL;
+PyObject *py_forcepy_      = NULL;
+
+
+/** This function compiles the UDF code, and executes it in the main 
++++ module. This is only done once, i.e. module-level code (e.g. imports
++++ of heavy libraries) is not re-executed for every chunk.
+--- fname:     UDF file
+--- main_dict: dictionary of main module
++++ Return:    SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int compile_python(const char *fname, PyObject *main_dict){
+FILE *fpy = NULL;
+char *source = NULL;
+long size;
+PyObject *py_file   = NULL;
+PyObject *py_code   = NULL;
+PyObject *py_result = NULL;
+
+
+  if ((fpy = fopen(fname, "rb")) == NULL){
+    printf("Unable to open %s. ", fname); return FAILURE;}
+
+  fseek(fpy, 0, SEEK_END);
+  size = ftell(fpy);
+  fseek(fpy, 0, SEEK_SET);
+
+  if (size < 0){
+    printf("Unable to read %s. ", fname); fclose(fpy); return FAILURE;}
+
+  alloc((void**)&source, size+1, sizeof(char));
+
+  if (fread(source, 1, size, fpy) != (size_t)size){
+    printf("Unable to read %s. ", fname); 
+    free((void*)source); fclose(fpy); return FAILURE;}
+
+  fclose(fpy);
+
+
+  if ((py_code = Py_CompileString(source, fname, Py_file_input)) == NULL){
+    PyErr_Print();
+    printf("Unable to compile %s. ", fname); 
+    free((void*)source); return FAILURE;}
+
+  free((void*)source);
+
+  // __file__ is defined while the code runs, same as PyRun_SimpleFile
+  py_file = PyUnicode_DecodeFSDefault(fname);
+  PyDict_SetItemString(main_dict, "__file__", py_file);
+  Py_DECREF(py_file);
+
+  py_result = PyEval_EvalCode(py_code, main_dict, main_dict);
+  Py_DECREF(py_code);
+
+  PyDict_DelItemString(main_dict, "__file__");
+
+  if (py_result == NULL){
+    PyErr_Print();
+    printf("Unable to run %s. ", fname); return FAILURE;}
+
+  Py_DECREF(py_result);
+
+  return SUCCESS;
+}
+
+
+/** This function checks whether a stack of images is stored back-to-back
++++ in one contiguous block of memory, i.e. whether the stack can be 
++++ handed to python without copying.
+--- img_:   images [n][nc]
+--- n:      number of images
+--- nc:     number of cells
++++ Return: start of contiguous memory, or NULL if not contiguous
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+short *contiguous_images(short **img_, int n, int nc){
+int i;
+
+
+  if (img_ == NULL || n < 1) return NULL;
+
+  for (i=1; i<n; i++){
+    if (img_[i] != img_[0] + (size_t)i*nc) return NULL;
+  }
+
+  return img_[0];
+}
+
 
 /** public functions
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
@@ -63,6 +154,8 @@ int date_from_bandname(date_t *date, char *bandname);
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int register_python(par_hl_t *phl){
 par_udf_t *udf;
+PyObject *main_module = NULL;
+PyObject *main_dict   = NULL;
 
 
   #ifdef FORCE_DEBUG
@@ -94,11 +187,11 @@ par_udf_t *udf;
   PyRun_SimpleString("init()");
 
   PyRun_SimpleString(
-    "def forcepy_wrapper(args):                                                    \n"
-    "    forcepy_udf, inarray, nband, date, sensor, bandname, nodata, nproc = args \n"
-    "    outarray = np.full(shape=(nband,), fill_value=nodata, dtype=np.int16)     \n"
-    "    forcepy_udf(inarray, outarray, date, sensor, bandname, nodata, nproc)     \n"
-    "    return outarray                                                           \n");
+    "def forcepy_wrapper(args):                                                            \n"
+    "    forcepy_udf, inarray, nband, date, sensor, bandname, nodata, nproc = args[:8]     \n"
+    "    outarray = np.full(shape=(nband,), fill_value=nodata, dtype=np.int16)             \n"
+    "    forcepy_udf(inarray, outarray, date, sensor, bandname, nodata, nproc, *args[8:])  \n"
+    "    return outarray                                                                   \n");
 
   PyRun_SimpleString(
     "def forcepy_date2epoch(year, month, day):                                                  \n"
@@ -128,7 +221,7 @@ par_udf_t *udf;
 
   if (udf->type == _UDF_PIXEL_){
     PyRun_SimpleString(
-      "def forcepy_(iblock, year, month, day, sensor, bandname, nodata, nband, nproc):           \n"
+      "def forcepy_(iblock, year, month, day, sensor, bandname, nodata, nband, nproc, oblock=None, mask=None, zerocopy=False): \n"
       "    try:                                                                                  \n"
       "        if 'forcepy_pixel' not in globals():                                              \n"
       "            print('forcepy_pixel not found.')                                             \n"
@@ -141,12 +234,15 @@ par_udf_t *udf;
       "            for xi in range(nX):                                                          \n"
       "                inarray = iblock[:, :, yi:yi+1, xi:xi+1]                                  \n"
       "                args = (forcepy_pixel, inarray, nband, date, sensor, bandname, nodata, 1) \n"
+      "                if zerocopy:                                                              \n"
+      "                    args += (None if mask is None else mask[:, yi:yi+1, xi:xi+1],)        \n"
       "                argss.append(args)                                                        \n"
       "        res = pool.map(func=forcepy_wrapper, iterable=argss)                              \n"
       "        pool.close()                                                                      \n"
       "        del pool                                                                          \n"
       "        # reshape space dimensions                                                        \n"
-      "        oblock = np.full(shape=(nband, nY, nX), fill_value=nodata, dtype=np.int16)        \n"
+      "        if oblock is None:                                                                \n"
+      "            oblock = np.full(shape=(nband, nY, nX), fill_value=nodata, dtype=np.int16)    \n"
       "        i = 0                                                                             \n"
       "        for yi in range(nY):                                                              \n"
       "            for xi in range(nX):                                                          \n"
@@ -158,15 +254,21 @@ par_udf_t *udf;
       "        return None                                                                       \n");
   } else if (udf->type == _UDF_BLOCK_){
     PyRun_SimpleString(
-      "def forcepy_(iblock, year, month, day, sensor, bandname, nodata, nband, nproc):        \n"
+      "def forcepy_(iblock, year, month, day, sensor, bandname, nodata, nband, nproc, oblock=None, mask=None, zerocopy=False): \n"
       "    try:                                                                               \n"
       "        if 'forcepy_block' not in globals():                                           \n"
       "            print('forcepy_block not found.')                                          \n"
       "            return None                                                                \n"
       "        nDates, nBands, nY, nX = iblock.shape                                          \n"
       "        date = forcepy_date2epoch(year, month, day)                                    \n"
-      "        oblock = np.full(shape=(nband, nY, nX), fill_value=nodata, dtype=np.int16)     \n"
-      "        forcepy_block(iblock, oblock, date, sensor, bandname, nodata, nproc)           \n"
+      "        if oblock is None:                                                             \n"
+      "            oblock = np.full(shape=(nband, nY, nX), fill_value=nodata, dtype=np.int16) \n"
+      "        else:                                                                          \n"
+      "            oblock.fill(nodata)                                                        \n"
+      "        if zerocopy:                                                                   \n"
+      "            forcepy_block(iblock, oblock, date, sensor, bandname, nodata, nproc, mask) \n"
+      "        else:                                                                          \n"
+      "            forcepy_block(iblock, oblock, date, sensor, bandname, nodata, nproc)       \n"
       "        return oblock                                                                  \n"
       "    except:                                                                            \n"
       "        print(traceback.format_exc())                                                  \n"
@@ -176,6 +278,24 @@ par_udf_t *udf;
     exit(FAILURE);
   }
 
+
+  // compile the provided python function, and keep the callables
+  main_module = PyImport_AddModule("__main__");
+  main_dict   = PyModule_GetDict(main_module);
+
+  if (compile_python(udf->f_code, main_dict) == FAILURE){
+    printf("Check the python UDF code!\n");
+    exit(FAILURE);}
+
+  py_forcepy_init_ = PyDict_GetItemString(main_dict, "forcepy_init_");
+  py_forcepy_      = PyDict_GetItemString(main_dict, "forcepy_");
+  if (py_forcepy_init_ == NULL || py_forcepy_ == NULL){
+    printf("Python error!\n");
+    exit(FAILURE);}
+
+  Py_INCREF(py_forcepy_init_);
+  Py_INCREF(py_forcepy_);
+
   #ifdef FORCE_DEBUG
   printf("finished to register python interface\n");
   #endif
@@ -203,7 +323,13 @@ par_udf_t *udf;
     return;
   }
 
-  if (udf->out) Py_Finalize();
+  if (udf->out){
+    Py_XDECREF(py_forcepy_init_);
+    Py_XDECREF(py_forcepy_);
+    py_forcepy_init_ = NULL;
+    py_forcepy_      = NULL;
+    Py_Finalize();
+  }
 
   #ifdef FORCE_DEBUG
   printf("finished to deregister python interface\n");
@@ -224,11 +350,7 @@ par_udf_t *udf;
 +++ Return:    void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void init_pyp(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf){
-FILE *fpy             = NULL;
 py_dimlab_t pylab;
-PyObject *main_module = NULL;
-PyObject *main_dict   = NULL;
-PyObject *py_fun      = NULL;
 PyObject *py_return   = NULL;
 PyObject *py_bandname = NULL;
 PyObject *py_encoded  = NULL;
@@ -251,22 +373,14 @@ int b;
   }
 
 
-  main_module = PyImport_AddModule("__main__");
-  main_dict   = PyModule_GetDict(main_module);
+  if (py_forcepy_init_ == NULL){
+    printf("Python interface is not registered!\n");
+    exit(FAILURE);}
 
   pylab = python_label_dimensions(ard, ts, submodule, idx_name, nb, nt, udf);
 
-  // parse the provided python function
-  fpy = fopen(udf->f_code, "r");
-  PyRun_SimpleFile(fpy, udf->f_code);
-
-  py_fun = PyDict_GetItemString(main_dict, "forcepy_init_");
-  if (py_fun == NULL){
-    printf("Python error!\n");
-    exit(FAILURE);}
-
   py_return = PyObject_CallFunctionObjArgs(
-    py_fun, 
+    py_forcepy_init_, 
     pylab.year, pylab.month, pylab.day, 
     pylab.sensor, 
     pylab.bandname, 
@@ -314,8 +428,6 @@ int b;
   Py_DECREF(pylab.bandname);
   Py_DECREF(pylab.sensor);
   Py_DECREF(py_return);
-  
-  fclose(fpy);
 
   #ifdef FORCE_DEBUG
   printf("finished to initialize python interface\n");
@@ -464,17 +576,20 @@ int b, t, p;
 size_t k;
 py_dimlab_t pylab;
 npy_intp dim_data[4] = { nt, nb, ny, nx };
-FILE     *fpy         = NULL;
-PyObject *main_module = NULL;
-PyObject *main_dict   = NULL;
-PyObject *py_fun      = NULL;
+npy_intp dim_mask[3] = { nt, ny, nx };
+npy_intp dim_out[3]  = { udf->nb, ny, nx };
 PyObject *py_nodata   = NULL;
 PyObject *py_nproc    = NULL;
 PyObject *py_nband    = NULL;
+PyObject *py_out      = Py_None;
+PyObject *py_mask     = Py_None;
 PyArrayObject* py_data     = NULL;
 PyArrayObject *py_return   = NULL;
 short* data_    = NULL;
 short* return_  = NULL;
+short* out_     = NULL;
+short** pyp_    = NULL;
+small* msk_     = NULL;
 
 
   if (submodule == _HL_UDF_ && udf_->pyp_ == NULL) return CANCEL;
@@ -485,30 +600,86 @@ short* return_  = NULL;
   printf("starting to run python interface\n");
   #endif
 
-  main_module = PyImport_AddModule("__main__");
-  main_dict   = PyModule_GetDict(main_module);
+  if (py_forcepy_ == NULL){
+    printf("Python interface is not registered!\n");
+    exit(FAILURE);}
 
   pylab = python_label_dimensions(ard, ts, submodule, idx_name, nb, nt, udf);
 
-  fpy = fopen(udf->f_code, "r");
-  PyRun_SimpleFile(fpy, udf->f_code);
-
-  py_fun = PyDict_GetItemString(main_dict, "forcepy_");
-  if (py_fun == NULL){
-    printf("Python error!\n");
-    exit(FAILURE);}
-
   py_nodata = PyLong_FromLong(nodata);
   py_nproc = PyLong_FromLong(cthread);
   py_nband = PyLong_FromLong(udf->nb);
 
-  py_data     = (PyArrayObject *) PyArray_SimpleNew(4, dim_data, NPY_INT16);
-  data_     = (short*)PyArray_DATA(py_data);
+  if (submodule == _HL_UDF_){
+    pyp_ = udf_->pyp_;
+  } else if (submodule == _HL_TSA_){
+    pyp_ = ts->pyp_;
+  } else {
+    printf("unknown submodule. ");
+    exit(FAILURE);
+  }
 
 
   // copy C data to python objects
-  
-  if (submodule == _HL_UDF_){
+
+  if (udf->zerocopy){
+
+    // input: a read-only view on the image memory if it is contiguous,
+    // else copy once without substituting nodata values.
+    // dates are separate bricks in the UDF submodule, 
+    // i.e. this is only contiguous for a single date
+    if (submodule == _HL_UDF_){
+      data_ = (nt == 1) ? contiguous_images(ard[0].dat, nb, nc) : NULL;
+    } else {
+      data_ = contiguous_images(ts->tsi_, nt, nc);
+    }
+
+    if (data_ != NULL){
+
+      py_data = (PyArrayObject *) PyArray_New(&PyArray_Type, 4, dim_data, NPY_INT16, 
+        NULL, data_, 0, NPY_ARRAY_CARRAY_RO, NULL);
+
+    } else {
+
+      py_data = (PyArrayObject *) PyArray_SimpleNew(4, dim_data, NPY_INT16);
+      data_   = (short*)PyArray_DATA(py_data);
+
+      if (submodule == _HL_UDF_){
+        for (t=0; t<nt; t++){
+          for (b=0; b<nb; b++){
+            memcpy(data_, ard[t].dat[b], sizeof(short)*nc);
+            data_ += nc;
+          }
+        }
+      } else {
+        for (t=0; t<nt; t++){
+          memcpy(data_, ts->tsi_[t], sizeof(short)*nc);
+          data_ += nc;
+        }
+      }
+
+      PyArray_CLEARFLAGS(py_data, NPY_ARRAY_WRITEABLE);
+
+    }
+
+    // mask: passed separately
+    if (submodule == _HL_UDF_){
+      py_mask = PyArray_SimpleNew(3, dim_mask, NPY_BOOL);
+      msk_    = (small*)PyArray_DATA((PyArrayObject*)py_mask);
+      for (t=0, k=0; t<nt; t++){
+        for (p=0; p<nc; p++) msk_[k++] = (ard[t].msk[p] != 0);
+      }
+    }
+
+    // output: a writeable view on the output brick
+    if ((out_ = contiguous_images(pyp_, udf->nb, nc)) != NULL){
+      py_out = PyArray_SimpleNewFromData(3, dim_out, NPY_INT16, out_);
+    }
+
+  } else if (submodule == _HL_UDF_){
+
+    py_data = (PyArrayObject *) PyArray_SimpleNew(4, dim_data, NPY_INT16);
+    data_   = (short*)PyArray_DATA(py_data);
 
     for (t=0, k=0; t<nt; t++){
       for (b=0; b<nb; b++){
@@ -522,22 +693,22 @@ short* return_  = NULL;
       }
     }
 
-  } else if (submodule == _HL_TSA_){
+  } else {
+
+    py_data = (PyArrayObject *) PyArray_SimpleNew(4, dim_data, NPY_INT16);
+    data_   = (short*)PyArray_DATA(py_data);
 
     for (t=0; t<nt; t++){
       memcpy(data_, ts->tsi_[t], sizeof(short)*nc);
       data_ += nc;
     }
 
-  } else {
-    printf("unknown submodule. ");
-    exit(FAILURE);
   }
 
 
   // fire up python
   py_return = (PyArrayObject *) PyObject_CallFunctionObjArgs(
-    py_fun, 
+    py_forcepy_, 
     py_data, 
     pylab.year, pylab.month, pylab.day, 
     pylab.sensor, 
@@ -545,33 +716,26 @@ short* return_  = NULL;
     py_nodata, 
     py_nband, 
     py_nproc, 
+    py_out,
+    py_mask,
+    udf->zerocopy ? Py_True : Py_False,
     NULL);
 
-  if ((PyObject*)py_return == Py_None){
+  if (py_return == NULL || (PyObject*)py_return == Py_None){
     printf("None returned from python. Check the python UDF code!\n");
     exit(FAILURE);}
 
 
-  // copy to output brick
-  return_ = (short*)PyArray_DATA(py_return);
-
-  if (submodule == _HL_UDF_){
-
-    for (b=0; b<udf->nb; b++){
-      memcpy(udf_->pyp_[b], return_, sizeof(short)*nc);
-      return_ += nc;
-    }
+  // copy to output brick, unless python wrote into it directly
+  if ((PyObject*)py_return != py_out){
 
-  } else if (submodule == _HL_TSA_){
+    return_ = (short*)PyArray_DATA(py_return);
 
     for (b=0; b<udf->nb; b++){
-      memcpy(ts->pyp_[b], return_, sizeof(short)*nc);
+      memcpy(pyp_[b], return_, sizeof(short)*nc);
       return_ += nc;
     }
 
-  } else {
-    printf("unknown submodule.\n");
-    exit(FAILURE);
   }
 
 
@@ -579,6 +743,8 @@ short* return_  = NULL;
   // clean
   Py_DECREF(py_return);
   Py_DECREF(py_data);
+  if (py_out  != Py_None) Py_DECREF(py_out);
+  if (py_mask != Py_None) Py_DECREF(py_mask);
   Py_DECREF(py_nodata);
   Py_DECREF(py_nband);
   Py_DECREF(py_nproc);
@@ -589,8 +755,6 @@ short* return_  = NULL;
   Py_DECREF(pylab.sensor);
 
 
-  fclose(fpy);
-
   #ifdef FORCE_DEBUG
   printf("finished to run python interface\n");
   #endif
@@ -28,41 +28,47 @@ This file contains functions for screening quality bit files
 #include "quality-hl.h"
 
 
-bool use_this_pixel(brick_t *qai, int p, par_qai_t *qai_rule, bool is_ard);
+int compile_qai_rules(par_qai_t *qai_rule, bool is_ard, qai_rules_t *rules);
 
 
-/** Decide whether to use this pixel
-+++ This function checks the QAI layer against the user-defined QAI crite-
-+++ ria.
---- qai:      Quality Assurance Information
---- p:        pixel
+/** Compile the QAI rule set
++++ This function translates the user-defined QAI criteria into a rule set
++++ that can be evaluated for whole arrays of QAI words.
 --- qai_rule: ruleset for QAI filtering
-+++ Return:   true/false
+--- is_ard:   is the input ARD (or Level 1)?
+--- rules:    QAI rule set (returned)
++++ Return:   SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-bool use_this_pixel(brick_t *qai, int p, par_qai_t *qai_rule, bool is_ard){
-  
-  if (!is_ard            && get_off(qai, p))               return false;
-
-  if (qai_rule->off      && get_off(qai, p))               return false;
-  if (qai_rule->cld_unc  && get_cloud(qai, p) == 1)        return false;
-  if (qai_rule->cld_opq  && get_cloud(qai, p) == 2)        return false;
-  if (qai_rule->cld_cir  && get_cloud(qai, p) == 3)        return false;
-  if (qai_rule->shd      && get_shadow(qai, p))            return false;
-  if (qai_rule->snw      && get_snow(qai, p))              return false;
-  if (qai_rule->wtr      && get_water(qai, p))             return false;
-  if (qai_rule->aod_int  && get_aerosol(qai, p) == 1)      return false;
-  if (qai_rule->aod_high && get_aerosol(qai, p) == 2)      return false;
-  if (qai_rule->aod_fill && get_aerosol(qai, p) == 3)      return false;
-  if (qai_rule->sub      && get_subzero(qai, p))           return false;
-  if (qai_rule->sat      && get_saturation(qai, p))        return false;
-  if (qai_rule->sun      && get_lowsun(qai, p))            return false;
-  if (qai_rule->ill_low  && get_illumination(qai, p) == 1) return false;
-  if (qai_rule->ill_poor && get_illumination(qai, p) == 2) return false;
-  if (qai_rule->ill_shd  && get_illumination(qai, p) == 3) return false;
-  if (qai_rule->slp      && get_slope(qai, p))             return false;
-  if (qai_rule->wvp      && get_vaporfill(qai, p))         return false;
-
-  return true;
+int compile_qai_rules(par_qai_t *qai_rule, bool is_ard, qai_rules_t *rules){
+int error = 0;
+
+
+  init_qai_rules(rules);
+
+  if (!is_ard            && add_qai_rule(rules, _QAI_MASK_OFF_, _QAI_MASK_OFF_)                 == FAILURE) error++;
+
+  if (qai_rule->off      && add_qai_rule(rules, _QAI_MASK_OFF_, _QAI_MASK_OFF_)                 == FAILURE) error++;
+  if (qai_rule->cld_unc  && add_qai_rule(rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 1))  == FAILURE) error++;
+  if (qai_rule->cld_opq  && add_qai_rule(rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 2))  == FAILURE) error++;
+  if (qai_rule->cld_cir  && add_qai_rule(rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 3))  == FAILURE) error++;
+  if (qai_rule->shd      && add_qai_rule(rules, _QAI_MASK_SHD_, _QAI_MASK_SHD_)                 == FAILURE) error++;
+  if (qai_rule->snw      && add_qai_rule(rules, _QAI_MASK_SNW_, _QAI_MASK_SNW_)                 == FAILURE) error++;
+  if (qai_rule->wtr      && add_qai_rule(rules, _QAI_MASK_WTR_, _QAI_MASK_WTR_)                 == FAILURE) error++;
+  if (qai_rule->aod_int  && add_qai_rule(rules, _QAI_MASK_AOD_, _QAI_VALUE_(_QAI_BIT_AOD_, 1))  == FAILURE) error++;
+  if (qai_rule->aod_high && add_qai_rule(rules, _QAI_MASK_AOD_, _QAI_VALUE_(_QAI_BIT_AOD_, 2))  == FAILURE) error++;
+  if (qai_rule->aod_fill && add_qai_rule(rules, _QAI_MASK_AOD_, _QAI_VALUE_(_QAI_BIT_AOD_, 3))  == FAILURE) error++;
+  if (qai_rule->sub      && add_qai_rule(rules, _QAI_MASK_SUB_, _QAI_MASK_SUB_)                 == FAILURE) error++;
+  if (qai_rule->sat      && add_qai_rule(rules, _QAI_MASK_SAT_, _QAI_MASK_SAT_)                 == FAILURE) error++;
+  if (qai_rule->sun      && add_qai_rule(rules, _QAI_MASK_SUN_, _QAI_MASK_SUN_)                 == FAILURE) error++;
+  if (qai_rule->ill_low  && add_qai_rule(rules, _QAI_MASK_ILL_, _QAI_VALUE_(_QAI_BIT_ILL_, 1))  == FAILURE) error++;
+  if (qai_rule->ill_poor && add_qai_rule(rules, _QAI_MASK_ILL_, _QAI_VALUE_(_QAI_BIT_ILL_, 2))  == FAILURE) error++;
+  if (qai_rule->ill_shd  && add_qai_rule(rules, _QAI_MASK_ILL_, _QAI_VALUE_(_QAI_BIT_ILL_, 3))  == FAILURE) error++;
+  if (qai_rule->slp      && add_qai_rule(rules, _QAI_MASK_SLP_, _QAI_MASK_SLP_)                 == FAILURE) error++;
+  if (qai_rule->wvp      && add_qai_rule(rules, _QAI_MASK_WVP_, _QAI_MASK_WVP_)                 == FAILURE) error++;
+
+  if (error > 0) return FAILURE;
+
+  return SUCCESS;
 }
 
 
@@ -83,6 +89,9 @@ int t, p, nc;
 int error = 0;
 bool is_ard = false;
 small *mask_ = NULL;
+short *qai_  = NULL;
+small *lut   = NULL;
+qai_rules_t rules;
 
 
 
@@ -99,6 +108,13 @@ small *mask_ = NULL;
   
   if (input_level == _INP_ARD_ || input_level == _INP_QAI_) is_ard = true;
 
+  if (compile_qai_rules(qai_rule, is_ard, &rules) == FAILURE){
+    printf("Error compiling QAI rules."); return FAILURE;}
+
+  // evaluate rule set for every possible QAI word
+  alloc((void**)&lut, QAI_LUT_SIZE, sizeof(small));
+  compile_qai_lut(&rules, lut);
+
 
   #pragma omp parallel shared(ard,nt) reduction(+: error) default(none)
   {
@@ -114,27 +130,39 @@ small *mask_ = NULL;
 
   if (error > 0){
     printf("%d screening QAI errors. ", error); 
+    free((void*)lut);
     return FAILURE;
   }
 
 
   nc = get_brick_chunkncells(ard[0].MSK);
 
-  #pragma omp parallel private(t) shared(ard,mask_,nt,nc,qai_rule,is_ard) default(none)
+  #pragma omp parallel private(p,qai_) shared(ard,mask_,nt,nc,lut) reduction(+: error) default(none)
   {
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (t=0; t<nt; t++){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (t=0; t<nt; t++) ard[t].msk[p] = false;
-      } else {
-        for (t=0; t<nt; t++) ard[t].msk[p] = use_this_pixel(ard[t].QAI, p, qai_rule, is_ard);
+      if ((qai_ = get_band_short(ard[t].QAI, 0)) == NULL){
+        printf("Error getting QAI."); error++; continue;}
+
+      lookup_qai(qai_, nc, lut, ard[t].msk);
+
+      if (mask_ != NULL){
+        #pragma omp simd
+        for (p=0; p<nc; p++) ard[t].msk[p] &= (small)(mask_[p] != 0);
       }
 
     }
 
   }
+
+  free((void*)lut);
+
+  if (error > 0){
+    printf("%d screening QAI errors. ", error); 
+    return FAILURE;
+  }
   
 
   #ifdef FORCE_CLOCK
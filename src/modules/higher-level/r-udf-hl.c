@@ -21,25 +21,73 @@ along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
 /**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-This file contains functions for plugging-in R UDFs into FORCE
+This file contains functions for plugging-in R UDFs into FORCE.
+R is not thread-safe, and needs to be called from the thread that 
+initialized it. Therefore, R runs in a long-lived worker process, which 
+is forked when the R interface is registered. FORCE hands the data over
+through shared memory, and a pair of pipes is used to signal requests 
+and replies. Thus, the UDF can be called from any thread (e.g. the 
+compute team when streaming).
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
 
 #include "r-udf-hl.h"
 
+#include <unistd.h>     // standard symbolic constants and types 
+#include <sys/mman.h>   // memory management declarations
+#include <sys/wait.h>   // declarations for waiting
+#include <omp.h>        // multi-platform shared memory multiprocessing
+
 #include <Rinternals.h>
 #include <Rembedded.h>
 #include <R_ext/Parse.h>
 
 
-void init_snowfall(int n);
-void parse_rstats(const char *string);
-void rstats_label_dimensions(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf);
+enum { _RSTATS_READY_, _RSTATS_INIT_, _RSTATS_RUN_, _RSTATS_STOP_ };
 
+// header of the shared memory, data follow after RSTATS_HEADER bytes
+typedef struct {
+  size_t size;     // size of shared memory
+  int command;     // request
+  int status;      // reply: SUCCESS/FAILURE
+  int nt, nb;      // number of time steps and bands (labels)
+  int ncpu;        // number of CPUs for the UDF
+  int nodata;      // nodata value
+  int ndim;        // number of array dimensions
+  int dim[4];      // array dimensions
+  size_t n;        // number of values in data array
+  int nb_out;      // number of output bands (reply to init)
+} rstats_msg_t;
+
+#define RSTATS_HEADER 256
+
+// R worker process
+typedef struct {
+  pid_t pid;          // process ID of worker
+  int request;        // pipe for requests
+  int reply;          // pipe for replies
+  int fd;             // shared memory file
+  size_t size;        // mapped size
+  rstats_msg_t *msg;  // shared memory
+  omp_lock_t lock;    // only one request at a time
+} rstats_worker_t;
+
+rstats_worker_t rstats_worker = { -1, -1, -1, -1, 0, NULL };
 
-/** public functions
-+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
+void init_snowfall(int n);
+void source_rstats(const char *fname);
+void parse_rstats(const char *string);
+void map_rstats_memory(size_t size);
+void reserve_rstats_memory(size_t size);
+size_t rstats_offset_data(int nt, int nb);
+void rstats_label_dimensions(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf);
+void rstats_request(int command);
+void rstats_define_labels();
+void rstats_worker_setup(par_udf_t *udf, int cthread);
+void rstats_worker_init();
+void rstats_worker_run();
+void rstats_worker_loop(par_udf_t *udf, int cthread);
 
 
 /** This function initializes a snowfall cluster in R
@@ -106,34 +154,178 @@ int i;
 }
 
 
-/** This function initializes the R interpreter, and defines a 
-+++ function for wrapping the UDF code
---- phl:    HL parameters
+/** This function maps the shared memory. If the shared memory was grown
++++ by the other process, it is re-mapped with the new size.
+--- size:   size of shared memory
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void register_rstats(par_hl_t *phl){
-par_udf_t *udf;
-int r_argc = 2;
-char *r_argv[] = { "R", "--silent" };
+void map_rstats_memory(size_t size){
+void *ptr = NULL;
 
 
-  #ifdef FORCE_DEBUG
-  printf("starting to register R interface\n");
-  #endif
+  if (rstats_worker.msg != NULL && rstats_worker.size == size) return;
 
-  // choose module
-  if (phl->tsa.rsp.out){
-    udf = &phl->tsa.rsp;
-  } else if (phl->udf.rsp.out){
-    udf = &phl->udf.rsp;
-  } else {
-    return;
+  if (rstats_worker.msg != NULL) munmap((void*)rstats_worker.msg, rstats_worker.size);
+
+  ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rstats_worker.fd, 0);
+  if (ptr == MAP_FAILED){
+    printf("unable to map shared memory for R worker.\n"); exit(FAILURE);}
+
+  rstats_worker.msg  = (rstats_msg_t*)ptr;
+  rstats_worker.size = size;
+
+  return;
+}
+
+
+/** This function makes sure that the shared memory is large enough. Only
++++ the process, whose turn it is, may call this function.
+--- size:   required size of shared memory
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void reserve_rstats_memory(size_t size){
+
+
+  map_rstats_memory(rstats_worker.msg->size);
+
+  if (size <= rstats_worker.size) return;
+
+  // grow by at least 50%, such that this does not happen too often
+  if (size < rstats_worker.size*3/2) size = rstats_worker.size*3/2;
+
+  if (ftruncate(rstats_worker.fd, size) != 0){
+    printf("unable to grow shared memory for R worker.\n"); exit(FAILURE);}
+
+  map_rstats_memory(size);
+  rstats_worker.msg->size = size;
+
+  return;
+}
+
+
+/** This function computes where the data array starts in the shared
++++ memory. Labels are stored first: years, months, days, sensors and 
++++ bandnames.
+--- nt:     number of time steps
+--- nb:     number of bands
++++ Return: offset of data array (bytes)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t rstats_offset_data(int nt, int nb){
+size_t offset;
+
+
+  offset = RSTATS_HEADER + 
+           (size_t)nt*3*sizeof(int) + 
+           (size_t)nt*NPOW_04 + 
+           (size_t)nb*NPOW_10;
+
+  // align to 8 bytes
+  return (offset+7)/8*8;
+}
+
+
+/** This function sends a request to the R worker, and waits for the 
++++ reply. Terminates FORCE if the worker is gone, or if the UDF failed.
+--- command: request
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void rstats_request(int command){
+char c = 0;
+
+
+  rstats_worker.msg->command = command;
+  rstats_worker.msg->status  = FAILURE;
+
+  if (write(rstats_worker.request, &c, 1) != 1 ||
+      read(rstats_worker.reply, &c, 1) != 1){
+    printf("R worker terminated unexpectedly. Check the R UDF code!\n");
+    exit(FAILURE);
   }
 
+  // the worker might have grown the shared memory
+  map_rstats_memory(rstats_worker.msg->size);
+
+  if (rstats_worker.msg->status != SUCCESS){
+    printf("R UDF failed. Check the R UDF code!\n");
+    exit(FAILURE);
+  }
+
+  return;
+}
+
+
+/** This function defines the labels (time, band, sensor) in R, which 
++++ were handed over through shared memory (R worker)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void rstats_define_labels(){
+int b, t;
+int nt = rstats_worker.msg->nt;
+int nb = rstats_worker.msg->nb;
+int *years_  = (int*)((char*)rstats_worker.msg + RSTATS_HEADER);
+int *months_ = years_  + nt;
+int *days_   = months_ + nt;
+char *sensor_   = (char*)(days_ + nt);
+char *bandname_ = sensor_ + (size_t)nt*NPOW_04;
+
+SEXP dim_nt, dim_nb;
+SEXP years, months, days;
+SEXP sensors, bandnames;
+
+
+  PROTECT(dim_nt = allocVector(INTSXP, 1));
+  INTEGER(dim_nt)[0] = nt;
+  defineVar(install("nt"), dim_nt, R_GlobalEnv);
+  UNPROTECT(1);
+
+  PROTECT(dim_nb = allocVector(INTSXP, 1));
+  INTEGER(dim_nb)[0] = nb;
+  defineVar(install("nb"), dim_nb, R_GlobalEnv);
+  UNPROTECT(1);
+
+  PROTECT(years     = allocVector(INTSXP, nt));
+  PROTECT(months    = allocVector(INTSXP, nt));
+  PROTECT(days      = allocVector(INTSXP, nt));
+  PROTECT(sensors   = allocVector(STRSXP, nt));
+  PROTECT(bandnames = allocVector(STRSXP, nb));
+
+  for (t=0; t<nt; t++){
+    INTEGER(years)[t]  = years_[t];
+    INTEGER(months)[t] = months_[t];
+    INTEGER(days)[t]   = days_[t];
+    SET_STRING_ELT(sensors, t, mkChar(sensor_ + (size_t)t*NPOW_04));
+  }
+
+  for (b=0; b<nb; b++){
+    SET_STRING_ELT(bandnames, b, mkChar(bandname_ + (size_t)b*NPOW_10));
+  }
+
+  defineVar(install("years"),     years,     R_GlobalEnv);
+  defineVar(install("months"),    months,    R_GlobalEnv);
+  defineVar(install("days"),      days,      R_GlobalEnv);
+  defineVar(install("sensors"),   sensors,   R_GlobalEnv);
+  defineVar(install("bandnames"), bandnames, R_GlobalEnv);
+  UNPROTECT(5);
+
+  return;
+}
+
+
+/** This function initializes the R interpreter, and defines a 
++++ function for wrapping the UDF code (R worker)
+--- udf:     user-defined code parameters
+--- cthread: number of computing threads
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void rstats_worker_setup(par_udf_t *udf, int cthread){
+int r_argc = 2;
+char *r_argv[] = { (char*)"R", (char*)"--silent" };
+
+
   Rf_initEmbeddedR(r_argc, r_argv);
 
   // create snowfall cluster
-  if (udf->type == _UDF_PIXEL_) init_snowfall(phl->cthread);
+  if (udf->type == _UDF_PIXEL_) init_snowfall(cthread);
 
   // parse once to make sure that functions are available
   source_rstats(udf->f_code);
@@ -194,25 +386,170 @@ char *r_argv[] = { "R", "--silent" };
     exit(FAILURE);
   }
 
-  #ifdef FORCE_DEBUG
-  printf("finished to register R interface\n");
-  #endif
+  return;
+}
+
+
+/** This function calls the UDF initialization, and hands the output band
++++ names back through shared memory (R worker)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void rstats_worker_init(){
+SEXP bandnames;
+size_t offset;
+char *bandname_ = NULL;
+int b, error = 0;
+
+
+  rstats_define_labels();
+
+  PROTECT(bandnames = R_tryEval(lang1(install("force_rstats_init_")), R_GlobalEnv, &error));
+
+  if (error || isNull(bandnames) || length(bandnames) < 1){
+    printf("no bandnames returnded (NULL). Check R UDF code!\n");
+    UNPROTECT(1);
+    return;
+  } 
+
+  offset = rstats_offset_data(rstats_worker.msg->nt, rstats_worker.msg->nb);
+  reserve_rstats_memory(offset + (size_t)length(bandnames)*NPOW_10);
+
+  rstats_worker.msg->nb_out = length(bandnames);
+  bandname_ = (char*)rstats_worker.msg + offset;
+
+  for (b=0; b<rstats_worker.msg->nb_out; b++){
+    copy_string(bandname_ + (size_t)b*NPOW_10, NPOW_10, CHAR(STRING_ELT(bandnames, b)));
+  }
+
+  UNPROTECT(1);
+
+  rstats_worker.msg->status = SUCCESS;
 
   return;
 }
 
 
-/** This function cleans up the R interpreter
+/** This function runs the UDF on the data in shared memory, and hands 
++++ the results back through shared memory (R worker)
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void deregister_rstats(par_hl_t *phl){
+void rstats_worker_run(){
+SEXP na_value, ncpu;
+SEXP dim, array;
+SEXP rstats_return;
+size_t offset, n;
+int d, error = 0;
+
+
+  rstats_define_labels();
+
+  PROTECT(na_value = allocVector(INTSXP, 1));
+  INTEGER(na_value)[0] = rstats_worker.msg->nodata;
+  defineVar(install("na_value"), na_value, R_GlobalEnv);
+  UNPROTECT(1); // na_value
+
+  PROTECT(ncpu = allocVector(INTSXP, 1));
+  INTEGER(ncpu)[0] = rstats_worker.msg->ncpu;
+  defineVar(install("ncpu"), ncpu, R_GlobalEnv);
+  UNPROTECT(1); // ncpu
+
+  PROTECT(dim = allocVector(INTSXP, rstats_worker.msg->ndim));
+  for (d=0; d<rstats_worker.msg->ndim; d++) INTEGER(dim)[d] = rstats_worker.msg->dim[d];
+
+  PROTECT(array = allocArray(INTSXP, dim));
+
+  offset = rstats_offset_data(rstats_worker.msg->nt, rstats_worker.msg->nb);
+  memcpy(INTEGER(array), (char*)rstats_worker.msg + offset, sizeof(int)*rstats_worker.msg->n);
+
+  // fire up R
+  PROTECT(rstats_return = R_tryEval(lang2(install("force_rstats_"), array), R_GlobalEnv, &error));
+
+  if (error || TYPEOF(rstats_return) != INTSXP){
+    UNPROTECT(3); // dim, array, rstats_return
+    return;
+  }
+
+  n = XLENGTH(rstats_return);
+  reserve_rstats_memory(offset + sizeof(int)*n);
+
+  memcpy((char*)rstats_worker.msg + offset, INTEGER(rstats_return), sizeof(int)*n);
+  rstats_worker.msg->n = n;
+
+  UNPROTECT(3); // dim, array, rstats_return
+
+  rstats_worker.msg->status = SUCCESS;
+
+  return;
+}
+
+
+/** This function is the main loop of the R worker process. R is set up, 
++++ and requests are processed until the worker is stopped.
+--- udf:     user-defined code parameters
+--- cthread: number of computing threads
++++ Return:  does not return
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void rstats_worker_loop(par_udf_t *udf, int cthread){
+char c = 0;
+
+
+  rstats_worker_setup(udf, cthread);
+
+  rstats_worker.msg->status = SUCCESS;
+  if (write(rstats_worker.reply, &c, 1) != 1) _exit(FAILURE);
+
+  while (read(rstats_worker.request, &c, 1) == 1){
+
+    map_rstats_memory(rstats_worker.msg->size);
+
+    switch (rstats_worker.msg->command){
+      case _RSTATS_INIT_:
+        rstats_worker_init();
+        break;
+      case _RSTATS_RUN_:
+        rstats_worker_run();
+        break;
+      case _RSTATS_STOP_:
+        if (udf->type == _UDF_PIXEL_) R_tryEval(lang1(install("sfStop")), R_GlobalEnv, NULL);
+        Rf_endEmbeddedR(0);
+        rstats_worker.msg->status = SUCCESS;
+        fflush(stdout);
+        if (write(rstats_worker.reply, &c, 1) != 1) _exit(FAILURE);
+        _exit(SUCCESS);
+      default:
+        printf("unknown request for R worker.\n");
+        break;
+    }
+
+    fflush(stdout);
+    if (write(rstats_worker.reply, &c, 1) != 1) break;
+
+  }
+
+  _exit(FAILURE);
+}
+
+
+/** public functions
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+/** This function starts the R worker process, which initializes the R 
++++ interpreter, and defines a function for wrapping the UDF code
+--- phl:    HL parameters
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void register_rstats(par_hl_t *phl){
 par_udf_t *udf;
+int request[2], reply[2];
+char c;
 
 
   #ifdef FORCE_DEBUG
-  printf("starting to deregister R interface\n");
+  printf("starting to register R interface\n");
   #endif
 
+  // choose module
   if (phl->tsa.rsp.out){
     udf = &phl->tsa.rsp;
   } else if (phl->udf.rsp.out){
@@ -222,11 +559,79 @@ par_udf_t *udf;
   }
 
 
-  if (udf->type == _UDF_PIXEL_){
-     R_tryEval(lang1(install("sfStop")), R_GlobalEnv, NULL);
+  // shared memory, and pipes for signaling
+  if ((rstats_worker.fd = memfd_create("force-rstats", 0)) < 0 ||
+      ftruncate(rstats_worker.fd, NPOW_16) != 0){
+    printf("unable to create shared memory for R worker.\n"); exit(FAILURE);}
+
+  map_rstats_memory(NPOW_16);
+  rstats_worker.msg->size = NPOW_16;
+
+  if (pipe(request) != 0 || pipe(reply) != 0){
+    printf("unable to create pipes for R worker.\n"); exit(FAILURE);}
+
+  fflush(stdout);
+
+  if ((rstats_worker.pid = fork()) < 0){
+    printf("unable to start R worker.\n"); exit(FAILURE);}
+
+
+  if (rstats_worker.pid == 0){
+
+    // worker: does not return
+    close(request[1]); close(reply[0]);
+    rstats_worker.request = request[0];
+    rstats_worker.reply   = reply[1];
+    rstats_worker_loop(udf, phl->cthread);
+
   }
 
-  if (udf->out) Rf_endEmbeddedR(0);
+  close(request[0]); close(reply[1]);
+  rstats_worker.request = request[1];
+  rstats_worker.reply   = reply[0];
+
+  omp_init_lock(&rstats_worker.lock);
+
+  // wait until R is ready
+  if (read(rstats_worker.reply, &c, 1) != 1){
+    printf("R worker terminated unexpectedly. Check the R UDF code!\n");
+    exit(FAILURE);
+  }
+
+  #ifdef FORCE_DEBUG
+  printf("finished to register R interface\n");
+  #endif
+
+  return;
+}
+
+
+/** This function stops the R worker, which cleans up the R interpreter
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void deregister_rstats(par_hl_t *phl){
+
+
+  #ifdef FORCE_DEBUG
+  printf("starting to deregister R interface\n");
+  #endif
+
+  if (!phl->tsa.rsp.out && !phl->udf.rsp.out) return;
+  if (rstats_worker.pid <= 0) return;
+
+
+  rstats_request(_RSTATS_STOP_);
+  waitpid(rstats_worker.pid, NULL, 0);
+
+  close(rstats_worker.request);
+  close(rstats_worker.reply);
+  munmap((void*)rstats_worker.msg, rstats_worker.size);
+  close(rstats_worker.fd);
+  omp_destroy_lock(&rstats_worker.lock);
+
+  rstats_worker.pid  = -1;
+  rstats_worker.msg  = NULL;
+  rstats_worker.size = 0;
 
 
   #ifdef FORCE_DEBUG
@@ -247,8 +652,8 @@ par_udf_t *udf;
 +++ Return:    void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 void init_rsp(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf){
-SEXP bandnames;
 date_t date;
+char *bandname_ = NULL;
 int b;
 
 
@@ -266,25 +671,21 @@ int b;
   }
 
 
-  rstats_label_dimensions(ard, ts, submodule, idx_name, nb, nt, udf);
-
-
-  PROTECT(bandnames = R_tryEval(lang1(install("force_rstats_init_")), R_GlobalEnv, NULL));
+  omp_set_lock(&rstats_worker.lock);
 
-  if (isNull(bandnames) || length(bandnames) < 1){
-    printf("no bandnames returnded (NULL). Check R UDF code!\n");
-    exit(FAILURE);
-  } 
+  rstats_label_dimensions(ard, ts, submodule, idx_name, nb, nt, udf);
 
-  //R_tryEval(lang2(install("print"), bandnames), R_GlobalEnv, NULL);
+  rstats_request(_RSTATS_INIT_);
 
-  udf->nb = length(bandnames);
+  udf->nb = rstats_worker.msg->nb_out;
   alloc_2D((void***)&udf->bandname, udf->nb, NPOW_10, sizeof(char));
   alloc((void**)&udf->date, udf->nb, sizeof(date_t));
 
+  bandname_ = (char*)rstats_worker.msg + rstats_offset_data(nt, nb);
+
   for (b=0; b<udf->nb; b++){
 
-    copy_string(udf->bandname[b], NPOW_10, CHAR(STRING_ELT(bandnames, b)));
+    copy_string(udf->bandname[b], NPOW_10, bandname_ + (size_t)b*NPOW_10);
 
     date_from_string(&date, udf->bandname[b]);
     copy_date(&date, &udf->date[b]);
@@ -296,7 +697,7 @@ int b;
 
   }
 
-  UNPROTECT(1);
+  omp_unset_lock(&rstats_worker.lock);
 
 
   #ifdef FORCE_DEBUG
@@ -336,7 +737,8 @@ void term_rsp(par_udf_t *udf){
 }
 
 
-/** This function labels the dimension of the UDF input data (time, band, sensor)
+/** This function labels the dimension of the UDF input data (time, band,
++++ sensor), and copies the labels to the shared memory
 --- ard:       ARD
 --- ts:        pointer to instantly useable TSA image arrays
 --- submodule: HLPS submodule
@@ -349,72 +751,56 @@ void term_rsp(par_udf_t *udf){
 void rstats_label_dimensions(ard_t *ard, tsa_t *ts, int submodule, char *idx_name, int nb, int nt, par_udf_t *udf){
 int b, t;
 date_t date;
-char sensor[NPOW_04];
-char bandname[NPOW_10];
+int *years_  = NULL;
+int *months_ = NULL;
+int *days_   = NULL;
+char *sensor_   = NULL;
+char *bandname_ = NULL;
 
-SEXP dim_nt, dim_nb;
-SEXP years, months, days;
-SEXP sensors, bandnames;
 
+  reserve_rstats_memory(rstats_offset_data(nt, nb));
 
-  PROTECT(dim_nt = allocVector(INTSXP, 1));
-  INTEGER(dim_nt)[0] = nt;
-  defineVar(install("nt"), dim_nt, R_GlobalEnv);
-  UNPROTECT(1);
+  rstats_worker.msg->nt = nt;
+  rstats_worker.msg->nb = nb;
 
-  PROTECT(dim_nb = allocVector(INTSXP, 1));
-  INTEGER(dim_nb)[0] = nb;
-  defineVar(install("nb"), dim_nb, R_GlobalEnv);
-  UNPROTECT(1);
-
-  PROTECT(years     = allocVector(INTSXP, nt));
-  PROTECT(months    = allocVector(INTSXP, nt));
-  PROTECT(days      = allocVector(INTSXP, nt));
-  PROTECT(sensors   = allocVector(STRSXP, nt));
-  PROTECT(bandnames = allocVector(STRSXP, nb));
+  years_    = (int*)((char*)rstats_worker.msg + RSTATS_HEADER);
+  months_   = years_  + nt;
+  days_     = months_ + nt;
+  sensor_   = (char*)(days_ + nt);
+  bandname_ = sensor_ + (size_t)nt*NPOW_04;
 
 
-  // copy C data to R objects
+  // copy C data to shared memory
   if (submodule == _HL_UDF_){
 
     for (t=0; t<nt; t++){
       date = get_brick_date(ard[t].DAT, 0);
-      INTEGER(years)[t]  = date.year;
-      INTEGER(months)[t] = date.month;
-      INTEGER(days)[t]   = date.day;
-      get_brick_sensor(ard[t].DAT, 0, sensor, NPOW_04);
-      SET_STRING_ELT(sensors, t, mkChar(sensor));
-
+      years_[t]  = date.year;
+      months_[t] = date.month;
+      days_[t]   = date.day;
+      get_brick_sensor(ard[t].DAT, 0, sensor_ + (size_t)t*NPOW_04, NPOW_04);
     }
 
     for (b=0; b<nb; b++){
-      get_brick_bandname(ard[0].DAT, b, bandname, NPOW_10);
-      SET_STRING_ELT(bandnames, b, mkChar(bandname));
+      get_brick_bandname(ard[0].DAT, b, bandname_ + (size_t)b*NPOW_10, NPOW_10);
     }
 
   } else if (submodule == _HL_TSA_){
 
     for (t=0; t<nt; t++){
-      INTEGER(years)[t]  = ts->d_tsi[t].year;
-      INTEGER(months)[t] = ts->d_tsi[t].month;
-      INTEGER(days)[t]   = ts->d_tsi[t].day; 
-      SET_STRING_ELT(sensors, t, mkChar(ts->bandnames_tsi[t]));
+      years_[t]  = ts->d_tsi[t].year;
+      months_[t] = ts->d_tsi[t].month;
+      days_[t]   = ts->d_tsi[t].day; 
+      copy_string(sensor_ + (size_t)t*NPOW_04, NPOW_04, ts->bandnames_tsi[t]);
     }
 
-    SET_STRING_ELT(bandnames, 0, mkChar(idx_name));
+    copy_string(bandname_, NPOW_10, idx_name);
 
   } else {
     printf("unknown submodule. ");
     exit(FAILURE);
   }
 
-  defineVar(install("years"),     years,     R_GlobalEnv);
-  defineVar(install("months"),    months,    R_GlobalEnv);
-  defineVar(install("days"),      days,      R_GlobalEnv);
-  defineVar(install("sensors"),   sensors,   R_GlobalEnv);
-  defineVar(install("bandnames"), bandnames, R_GlobalEnv);
-  UNPROTECT(5);
-
 
   return;
 }
@@ -438,12 +824,9 @@ SEXP sensors, bandnames;
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int rstats_udf(ard_t *ard, udf_t *udf_, tsa_t *ts, small *mask_, int submodule, char *idx_name, int nx, int ny, int nc, int nb, int nt, short nodata, par_udf_t *udf, int cthread){
 int b, t, p;
-size_t k;
+size_t k, n, offset;
 int *array_ = NULL, value;
 int nvalid = 0;
-SEXP na_value, ncpu;
-SEXP dim, array;
-SEXP rstats_return;
 int *rstats_return_ = NULL;
 
 
@@ -455,18 +838,12 @@ int *rstats_return_ = NULL;
   printf("starting to run R interface\n");
   #endif
 
+  omp_set_lock(&rstats_worker.lock);
+
   rstats_label_dimensions(ard, ts, submodule, idx_name, nb, nt, udf);
 
-
-  PROTECT(na_value = allocVector(INTSXP, 1));
-  INTEGER(na_value)[0] = nodata;
-  defineVar(install("na_value"), na_value, R_GlobalEnv);
-  UNPROTECT(1); // na_value
-
-  PROTECT(ncpu = allocVector(INTSXP, 1));
-  INTEGER(ncpu)[0] = cthread;
-  defineVar(install("ncpu"), ncpu, R_GlobalEnv);
-  UNPROTECT(1); // ncpu
+  rstats_worker.msg->nodata = nodata;
+  rstats_worker.msg->ncpu   = cthread;
 
   // how many valid pixels?
   if (udf->type == _UDF_PIXEL_){
@@ -477,26 +854,31 @@ int *rstats_return_ = NULL;
   }
 
   if (udf->type == _UDF_PIXEL_){
-    PROTECT(dim = allocVector(INTSXP, 3));
-    INTEGER(dim)[0] = nt;
-    INTEGER(dim)[1] = nb;
-    INTEGER(dim)[2] = nvalid;
+    rstats_worker.msg->ndim = 3;
+    rstats_worker.msg->dim[0] = nt;
+    rstats_worker.msg->dim[1] = nb;
+    rstats_worker.msg->dim[2] = nvalid;
+    n = (size_t)nvalid;
   } else if (udf->type == _UDF_BLOCK_){
-    PROTECT(dim = allocVector(INTSXP, 4));
-    INTEGER(dim)[0] = nt;
-    INTEGER(dim)[1] = nb;
-    INTEGER(dim)[2] = ny;
-    INTEGER(dim)[3] = nx;
+    rstats_worker.msg->ndim = 4;
+    rstats_worker.msg->dim[0] = nt;
+    rstats_worker.msg->dim[1] = nb;
+    rstats_worker.msg->dim[2] = ny;
+    rstats_worker.msg->dim[3] = nx;
+    n = (size_t)nc;
   } else {
     printf("unknown UDF type.\n"); 
     exit(FAILURE);
   }
 
-  PROTECT(array = allocArray(INTSXP, dim));
-  UNPROTECT(1); // dim
-  array_ = INTEGER(array);
+  // make room for input and expected output
+  offset = rstats_offset_data(nt, nb);
+  reserve_rstats_memory(offset + sizeof(int)*n*((nb*nt > udf->nb) ? nb*nt : udf->nb));
+  rstats_worker.msg->n = n*nb*nt;
 
-  // copy C data to R objects
+  array_ = (int*)((char*)rstats_worker.msg + offset);
+
+  // copy C data to shared memory
 
   k = 0;
 
@@ -522,10 +904,16 @@ int *rstats_return_ = NULL;
 
 
   // fire up R
-  PROTECT(rstats_return = R_tryEval(lang2(install("force_rstats_"), array), R_GlobalEnv, NULL));
+  rstats_request(_RSTATS_RUN_);
+
+  if (rstats_worker.msg->n != n*udf->nb){
+    printf("R UDF returned %lu values, but %lu were expected. Check the R UDF code!\n",
+      (unsigned long)rstats_worker.msg->n, (unsigned long)(n*udf->nb));
+    exit(FAILURE);
+  }
 
   // copy to output brick
-  rstats_return_ = INTEGER(rstats_return);
+  rstats_return_ = (int*)((char*)rstats_worker.msg + offset);
 
   k =  0;
 
@@ -549,7 +937,7 @@ int *rstats_return_ = NULL;
   }
   }
 
-  UNPROTECT(2); // array, rstats_return
+  omp_unset_lock(&rstats_worker.lock);
 
 
   #ifdef FORCE_DEBUG
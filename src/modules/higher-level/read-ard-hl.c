@@ -36,11 +36,25 @@ int reduce_psf(short *hr, int nx, int ny, int nc, short *lr, int NX, int NY, int
 int date_ard(date_t *date, char *bname);
 int product_ard(char product[], int size, char *bname);
 int sensor_ard(int *sid, par_sen_t *sen, char *bname);
+void free_ard_index_entry(ard_index_t *index);
+ard_index_t *build_ard_index(char *dname, struct timespec mtime);
+ard_index_t *read_ard_index(char *fname, char *dname, struct timespec mtime);
+int write_ard_index(char *fname, ard_index_t *index);
+ard_index_t *get_ard_index(char *d_lower, int tx, int ty);
 int list_mask(int tx, int ty, par_hl_t *phl, dir_t *dir);
 int list_ard(int tx, int ty, par_sen_t *sen, par_hl_t *phl, dir_t *dir);
 int list_ard_filter_ce(int cemin, int cemax, dir_t dir);
 
 
+#define ARD_INDEX_MAGIC "FORCE ARD INDEX 1" // header of ARD index files
+#define ARD_INDEX_DIR   ".force-index"      // index directory in datacube
+#define ARD_INDEX_CACHE 8                   // number of indices held in memory
+
+ard_index_t *ard_index_cache[ARD_INDEX_CACHE] = { NULL };
+int ard_index_used[ARD_INDEX_CACHE] = { 0 };
+int ard_index_clock = 0;
+
+
 /** Reduce spatial resolution using an approximate Point Spread Function
 +++ This function will convolve the full-res image with a Gaussian Lowpass
 +++ with filter size based upon the two resolutions. Afterward, the image
@@ -258,9 +272,273 @@ char cs[6];
 }
 
 
-/** This function lists all files in the mask directory, and matches the
-+++ entries against the requested mask basename. The dir_t struct must be
-+++ freed on success.
+/** This function frees an ARD file index
+--- index:  ARD file index
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_ard_index_entry(ard_index_t *index){
+
+
+  if (index == NULL) return;
+
+  if (index->name != NULL) free_2D((void**)index->name, index->n);
+  if (index->ce   != NULL) free((void*)index->ce);
+  if (index->doy  != NULL) free((void*)index->doy);
+  free((void*)index);
+
+  return;
+}
+
+
+/** This function builds an ARD file index by listing the tile directory.
++++ Only files with expected extensions are retained, and the date is
++++ parsed from the basename.
+--- dname:  tile directory
+--- mtime:  modification time of the tile directory
++++ Return: ARD file index (NULL if directory cannot be listed)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+ard_index_t *build_ard_index(char *dname, struct timespec mtime){
+ard_index_t *index = NULL;
+struct dirent **LIST = NULL;
+int N, i;
+char ext[NPOW_10];
+date_t date;
+
+
+  #ifdef FORCE_DEBUG
+  printf("scanning %s for files\n", dname);
+  #endif
+
+  if ((N = scandir(dname, &LIST, 0, alphasort)) < 0) return NULL;
+
+  alloc((void**)&index, 1, sizeof(ard_index_t));
+  copy_string(index->dname, NPOW_10, dname);
+  index->mtime = mtime;
+
+  alloc((void**)&index->name, (N > 0) ? N : 1, sizeof(char*));
+  alloc((void**)&index->ce,   (N > 0) ? N : 1, sizeof(int));
+  alloc((void**)&index->doy,  (N > 0) ? N : 1, sizeof(int));
+
+  for (i=0, index->n=0; i<N; i++){
+
+    // filter expected extensions    
+    extension(LIST[i]->d_name, ext, NPOW_10);
+    if (strcmp(ext, ".dat") != 0 &&
+        strcmp(ext, ".bsq") != 0 &&
+        strcmp(ext, ".bil") != 0 &&
+        strcmp(ext, ".tif") != 0 &&
+        strcmp(ext, ".vrt") != 0) continue;
+
+    alloc((void**)&index->name[index->n], strlen(LIST[i]->d_name)+1, sizeof(char));
+    strcpy(index->name[index->n], LIST[i]->d_name);
+
+    if (date_ard(&date, LIST[i]->d_name) == SUCCESS){
+      index->ce[index->n]  = date.ce;
+      index->doy[index->n] = date.doy;
+    } else {
+      index->ce[index->n]  = -1;
+      index->doy[index->n] = -1;
+    }
+
+    index->n++;
+
+  }
+
+  free_2D((void**)LIST, N);
+
+  #ifdef FORCE_DEBUG
+  printf("found %d files, %d in index\n", N, index->n);
+  #endif
+
+  return index;
+}
+
+
+/** This function reads an ARD file index from disc. The index is only
++++ used if it was built for the current state of the tile directory.
++++ The index is a text file. The header holds the modification time of
++++ the tile directory and the number of entries, followed by one line
++++ per file with date (days since CE), DOY and basename.
+--- fname:  index file
+--- dname:  tile directory
+--- mtime:  modification time of the tile directory
++++ Return: ARD file index (NULL if not available or outdated)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+ard_index_t *read_ard_index(char *fname, char *dname, struct timespec mtime){
+ard_index_t *index = NULL;
+FILE *fp = NULL;
+char buffer[NPOW_10];
+char *ptr = NULL;
+long long sec;
+long nsec;
+int n, i;
+
+
+  if ((fp = fopen(fname, "r")) == NULL) return NULL;
+
+  if (fgets(buffer, NPOW_10, fp) == NULL || 
+      strcmp(buffer, ARD_INDEX_MAGIC "\n") != 0 ||
+      fscanf(fp, "%lld %ld %d\n", &sec, &nsec, &n) != 3 ||
+      sec != (long long)mtime.tv_sec || nsec != (long)mtime.tv_nsec || n < 0){
+    fclose(fp);
+    return NULL;
+  }
+
+  alloc((void**)&index, 1, sizeof(ard_index_t));
+  copy_string(index->dname, NPOW_10, dname);
+  index->mtime = mtime;
+
+  alloc((void**)&index->name, (n > 0) ? n : 1, sizeof(char*));
+  alloc((void**)&index->ce,   (n > 0) ? n : 1, sizeof(int));
+  alloc((void**)&index->doy,  (n > 0) ? n : 1, sizeof(int));
+
+  for (i=0, index->n=0; i<n; i++){
+
+    if (fscanf(fp, "%d %d ", &index->ce[i], &index->doy[i]) != 2 ||
+        fgets(buffer, NPOW_10, fp) == NULL){
+      free_ard_index_entry(index);
+      fclose(fp);
+      return NULL;
+    }
+
+    if ((ptr = strchr(buffer, '\n')) != NULL) *ptr = '\0';
+
+    alloc((void**)&index->name[i], strlen(buffer)+1, sizeof(char));
+    strcpy(index->name[i], buffer);
+    index->n++;
+
+  }
+
+  fclose(fp);
+
+  #ifdef FORCE_DEBUG
+  printf("read %d files from index %s\n", n, fname);
+  #endif
+
+  return index;
+}
+
+
+/** This function writes an ARD file index to disc. The index is written
++++ to a temporary file, which is then renamed. Thus, concurrent processes
++++ never see a partial index. If the index cannot be written, e.g. be-
++++ cause the datacube is read-only, the index is silently only kept in
++++ memory.
+--- fname:  index file
+--- index:  ARD file index
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int write_ard_index(char *fname, ard_index_t *index){
+FILE *fp = NULL;
+char dname[NPOW_10];
+char temp[NPOW_10];
+int nchar, i;
+
+
+  directoryname(fname, dname, NPOW_10);
+  if (mkdir(dname, 0777) != 0 && errno != EEXIST) return FAILURE;
+
+  nchar = snprintf(temp, NPOW_10, "%s.%d", fname, (int)getpid());
+  if (nchar < 0 || nchar >= NPOW_10) return FAILURE;
+
+  if ((fp = fopen(temp, "w")) == NULL) return FAILURE;
+
+  fprintf(fp, "%s\n", ARD_INDEX_MAGIC);
+  fprintf(fp, "%lld %ld %d\n", (long long)index->mtime.tv_sec, (long)index->mtime.tv_nsec, index->n);
+  for (i=0; i<index->n; i++) fprintf(fp, "%d %d %s\n", index->ce[i], index->doy[i], index->name[i]);
+
+  if (fclose(fp) != 0 || rename(temp, fname) != 0){
+    remove(temp);
+    return FAILURE;
+  }
+
+  return SUCCESS;
+}
+
+
+/** This function returns the ARD file index of a tile directory. The 
++++ index is looked up in memory first, then on disc. If it does not 
++++ exist, or if the tile directory was modified since the index was 
++++ built, the directory is listed, and the index is stored in memory
++++ and on disc. The index must only be used in the critical section
++++ 'ard_index'.
+--- d_lower: datacube directory
+--- tx:      tile X-ID
+--- ty:      tile Y-ID
++++ Return:  ARD file index (NULL if tile directory does not exist)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+ard_index_t *get_ard_index(char *d_lower, int tx, int ty){
+ard_index_t *index = NULL;
+struct stat st;
+char dname[NPOW_10];
+char fname[NPOW_10];
+int nchar, i, k, old;
+
+
+  nchar = snprintf(dname, NPOW_10, "%s/X%04d_Y%04d", d_lower, tx, ty);
+  if (nchar < 0 || nchar >= NPOW_10){ 
+    printf("Buffer Overflow in assembling dirname\n"); return NULL;}
+
+  if (stat(dname, &st) != 0) return NULL;
+
+  ard_index_clock++;
+
+  // look up in memory
+  for (i=0; i<ARD_INDEX_CACHE; i++){
+    if ((index = ard_index_cache[i]) == NULL) continue;
+    if (strcmp(index->dname, dname) != 0) continue;
+    if (index->mtime.tv_sec  == st.st_mtim.tv_sec && 
+        index->mtime.tv_nsec == st.st_mtim.tv_nsec){
+      ard_index_used[i] = ard_index_clock;
+      return index;
+    }
+    free_ard_index_entry(index);
+    ard_index_cache[i] = NULL;
+  }
+
+  // look up on disc, or build from scratch
+  nchar = snprintf(fname, NPOW_10, "%s/%s/X%04d_Y%04d", d_lower, ARD_INDEX_DIR, tx, ty);
+  if (nchar < 0 || nchar >= NPOW_10){ 
+    printf("Buffer Overflow in assembling filename\n"); return NULL;}
+
+  if ((index = read_ard_index(fname, dname, st.st_mtim)) == NULL){
+    if ((index = build_ard_index(dname, st.st_mtim)) == NULL) return NULL;
+    write_ard_index(fname, index);
+  }
+
+  // replace least recently used index in memory
+  for (i=0, k=0, old=INT_MAX; i<ARD_INDEX_CACHE; i++){
+    if (ard_index_cache[i] == NULL){ k = i; break; }
+    if (ard_index_used[i] < old){ old = ard_index_used[i]; k = i; }
+  }
+
+  free_ard_index_entry(ard_index_cache[k]);
+  ard_index_cache[k] = index;
+  ard_index_used[k]  = ard_index_clock;
+
+  return index;
+}
+
+
+/** This function frees all ARD file indices that are held in memory
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_ard_index(){
+int i;
+
+
+  for (i=0; i<ARD_INDEX_CACHE; i++){
+    free_ard_index_entry(ard_index_cache[i]);
+    ard_index_cache[i] = NULL;
+  }
+
+  return;
+}
+
+
+/** This function checks whether the requested mask exists in the mask
++++ directory, and returns it as listing. The dir_t struct must be freed 
++++ on success.
 --- tx:     tile X-ID
 --- ty:     tile Y-ID
 --- phl:    HL parameters
@@ -268,7 +546,7 @@ char cs[6];
 +++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int list_mask(int tx, int ty, par_hl_t *phl, dir_t *dir){
-int m;
+char fname[NPOW_10];
 int nchar;
 dir_t d;
 
@@ -278,29 +556,15 @@ dir_t d;
   if (nchar < 0 || nchar >= NPOW_10){ 
     printf("Buffer Overflow in assembling dirname\n"); return FAILURE;}
 
-  // directory listing
-  if ((d.N = scandir(d.name, &d.LIST, 0, alphasort)) < 0){
-    return FAILURE;}
+  // no need to list the directory, the basename is known
+  concat_string_2(fname, NPOW_10, d.name, phl->b_mask, "/");
+  if (!fileexist(fname)) return FAILURE;
 
   // masks
+  d.LIST = NULL;
+  d.N = d.n = 1;
   alloc_2D((void***)&d.list, d.N, NPOW_10, sizeof(char));
-
-  for (m=0, d.n=0; m<d.N; m++){
-
-    if (strcmp(d.LIST[m]->d_name, phl->b_mask) == 0){
-      copy_string(d.list[d.n++], NPOW_10, d.LIST[m]->d_name);
-      break;
-    }
-
-  }
-
-  if (d.n<1){
-    free_2D((void**)d.list, d.N);
-    free_2D((void**)d.LIST, d.N);
-    d.list = NULL;
-    d.LIST = NULL;
-    return FAILURE;
-  }
+  copy_string(d.list[0], NPOW_10, phl->b_mask);
 
   *dir = d;
   return SUCCESS;
@@ -309,8 +573,9 @@ dir_t d;
 
 /** This function lists all ARD main products (BAP, BOA, TOA, SIG) files 
 +++ in the lower level directory. Only requested sensors are listed. Only 
-+++ the requested time frame is listed. The dir_t struct must be freed on 
-+++ success.
++++ the requested time frame is listed. The files are queried from the
++++ ARD file index, i.e. the directory is not listed for every chunk. The
++++ dir_t struct must be freed on success.
 --- tx:     tile X-ID
 --- ty:     tile Y-ID
 --- sen:    sensor parameters
@@ -321,9 +586,8 @@ dir_t d;
 int list_ard(int tx, int ty, par_sen_t *sen, par_hl_t *phl, dir_t *dir){
 int i, s;
 bool vs;
-date_t date;
 dir_t d;
-char ext[NPOW_10];
+ard_index_t *index = NULL;
 int nchar;
 
 
@@ -332,63 +596,55 @@ int nchar;
   if (nchar < 0 || nchar >= NPOW_10){ 
     printf("Buffer Overflow in assembling dirname\n"); return FAILURE;}
 
-  #ifdef FORCE_DEBUG
-  printf("scanning %s for files\n", d.name);
-  #endif
+  d.LIST = NULL;
+  d.list = NULL;
+  d.N = d.n = 0;
 
-  // directory listing
-  if ((d.N = scandir(d.name, &d.LIST, 0, alphasort)) < 0){
-    return FAILURE;}
+  #pragma omp critical (ard_index)
+  {
 
-  #ifdef FORCE_DEBUG
-  printf("found %d files, filtering now\n", d.N);
-  #endif
+    // directory listing, extensions and dates are already filtered/parsed
+    if ((index = get_ard_index(phl->d_lower, tx, ty)) != NULL && index->n > 0){
 
-  // reflectance products
-  alloc_2D((void***)&d.list, d.N, NPOW_10, sizeof(char));
+      // reflectance products
+      d.N = index->n;
+      alloc_2D((void***)&d.list, d.N, NPOW_10, sizeof(char));
 
-  for (i=0, d.n=0; i<d.N; i++){
+      for (i=0; i<index->n; i++){
 
-    // filter expected extensions    
-    extension(d.LIST[i]->d_name, ext, NPOW_10);
-    if (strcmp(ext, ".dat") != 0 &&
-        strcmp(ext, ".bsq") != 0 &&
-        strcmp(ext, ".bil") != 0 &&
-        strcmp(ext, ".tif") != 0 &&
-        strcmp(ext, ".vrt") != 0) continue;
+        // filter product type
+        if (strstr(index->name[i], sen->main_product) == NULL) continue;
 
-    // filter product type
-    if (strstr(d.LIST[i]->d_name, sen->main_product) == NULL) continue;
+        // filter sensor list
+        for (s=0, vs=false; s<sen->n; s++){
+          if (strstr(index->name[i], sen->sensor[s]) != NULL){
+            #ifdef FORCE_DEBUG
+            printf("sensor is: %s\n", sen->sensor[s]);
+            #endif
+            vs = true; 
+            break;
+          }
+        }
+        if (!vs) continue;
 
-    // filter sensor list
-    for (s=0, vs=false; s<sen->n; s++){
-      if (strstr(d.LIST[i]->d_name, sen->sensor[s]) != NULL){
-        #ifdef FORCE_DEBUG
-        printf("sensor is: %s\n", sen->sensor[s]);
-        #endif
-        vs = true; 
-        break;
-      }
-    }
-    if (!vs) continue;
+        // filter dates
+        if (index->ce[i] < 0) continue;
+        if (index->ce[i] < phl->date_range[_MIN_].ce) continue;
+        if (index->ce[i] > phl->date_range[_MAX_].ce) continue;
+        if (!phl->date_doys[index->doy[i]]) continue;
 
+        // if we are still here, copy
+        copy_string(d.list[d.n++], NPOW_10, index->name[i]);
 
-    // filter dates
-    date_ard(&date, d.LIST[i]->d_name);
-    if (date.ce < phl->date_range[_MIN_].ce) continue;
-    if (date.ce > phl->date_range[_MAX_].ce) continue;
-    if (!phl->date_doys[date.doy]) continue;
+      }
 
-    // if we are still here, copy
-    copy_string(d.list[d.n++], NPOW_10, d.LIST[i]->d_name);
+    }
 
   }
 
   if (d.n<1){
-    free_2D((void**)d.list, d.N);
-    free_2D((void**)d.LIST, d.N);
+    if (d.list != NULL) free_2D((void**)d.list, d.N);
     d.list = NULL;
-    d.LIST = NULL;
     return FAILURE;
   }
 
@@ -437,7 +693,6 @@ int n;
 
   if ((dir.n = n)<1){
     free_2D((void**)dir.list, dir.N);
-    free_2D((void**)dir.LIST, dir.N);
     return FAILURE;
   }
 
@@ -507,7 +762,6 @@ int n = 0;
   //    printf("Error reading mask %s. ", fname); *success = FAILURE; return NULL;}
 
   free_2D((void**)dir.list, dir.N); dir.list = NULL;
-  free_2D((void**)dir.LIST, dir.N); dir.LIST = NULL;
 
   nc = get_brick_chunkncells(MASK);
   if ((mask_ = get_band_small(MASK, 0)) == NULL){
@@ -976,7 +1230,6 @@ off_t bytes = 0;
   }
 
   free_2D((void**)dir.list, dir.N); dir.list = NULL;
-  free_2D((void**)dir.LIST, dir.N); dir.LIST = NULL;
   
 
   #ifdef FORCE_CLOCK
@@ -1017,12 +1270,17 @@ GDALDatasetH dataset;
 GDALRasterBandH band;
 gdalopt_t format;
 
+short **brick_short = NULL;
 short *read_buf  = NULL;
 short *psf_buf   = NULL;
+int   *disc_map  = NULL;
+int   *brick_map = NULL;
+GSpacing band_space;
+bool equal_space;
 
 int sid = 0;
 
-int b, nbands, nb = 0, offb = read_b, p;
+int b, nbands, nb = 0, nb_read, offb = read_b, p;
 int nx, ny, nc;
 int xoff_disc, yoff_disc;
 int nx_read, ny_read, nc_read;
@@ -1122,7 +1380,7 @@ double tol = 5e-3;
   +++         read @ target res using NN
   +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
   
-  dataset = GDALOpenEx(file, GDAL_OF_READONLY, NULL, NULL, NULL);
+  dataset = open_gdalcache(file);
   //CPLPopErrorHandler();
   
   if (dataset == NULL){
@@ -1144,19 +1402,19 @@ double tol = 5e-3;
   
   if (fmod(width, res_disc) > tol){
     printf("requested image width %f must be a multiple of image resolution %f (%f > %f). ", width, res_disc, fmod(width, res_disc), tol);
-    return NULL;
+    close_gdalcache(dataset); return NULL;
   }
   if (fmod(height, res_disc) > tol){
     printf("requested image height %f must be a multiple of image resolution %f (%f > %f). ", height, res_disc, fmod(height, res_disc), tol);
-    return NULL;
+    close_gdalcache(dataset); return NULL;
   }
   if (fmod(y_offset, res_disc) > tol){
     printf("requested image offset %f must be a multiple of image resolution %f (%f > %f). ", y_offset, res_disc, fmod(y_offset, res_disc), tol);
-    return NULL;
+    close_gdalcache(dataset); return NULL;
   }
   if (fmod(x_offset, res_disc) > tol){
     printf("requested image offset %f must be a multiple of image resolution %f (%f > %f). ", x_offset, res_disc, fmod(x_offset, res_disc), tol);
-    return NULL;
+    close_gdalcache(dataset); return NULL;
   }
 
   nx_disc = (int)(width/res_disc);
@@ -1190,18 +1448,23 @@ double tol = 5e-3;
   printf("reading %d pixels, converting them into %d RAM pixels\n", nc_read, nc);
   #endif
 
-  alloc((void**)&read_buf, nc_read, sizeof(short));
   brick = allocate_brick(nb, nc, datatype);
 
-  for (b=0, b_brick=0; b<nbands; b++){
+
+  // map bands on disc to bands in brick
+  alloc((void**)&disc_map,  (nb > 0) ? nb : 1, sizeof(int));
+  alloc((void**)&brick_map, (nb > 0) ? nb : 1, sizeof(int));
+
+  for (b=0, b_brick=0, nb_read=0; b<nbands; b++){
 
     if (ard_type == _ARD_REF_){
       if ((b_disc = sen->band[sid][b])  < 0) continue;
-      if ((b_disc = sen->band[sid][b]) == 0){
-        set_brick_domain(brick, b_brick, sen->domain[b]);
+      set_brick_domain(brick, b_brick, sen->domain[b]);
+      if (b_disc == 0){
         b_brick++;
         continue;
       }
+      set_brick_bandname(brick, b_brick, sen->domain[b]);
     } else {
       b_disc = offb+b;
     }
@@ -1210,52 +1473,102 @@ double tol = 5e-3;
     printf("read band %d to %d, %d bands in total\n", b_disc, b_brick, nb);
     #endif
 
-    if (datatype == _DT_SMALL_){
-      if ((brick_small_ = get_band_small(brick, b_brick)) == NULL) return NULL;
-    } else if (datatype == _DT_SHORT_){
-      if ((brick_short_ = get_band_short(brick, b_brick)) == NULL) return NULL;
+    disc_map[nb_read]  = b_disc;
+    brick_map[nb_read] = b_brick;
+    nb_read++;
+    b_brick++;
+
+  }
+
+
+  if (datatype == _DT_SHORT_ && nc_read == nc){
+
+    /** fast path: decode directly into brick memory
+    +++ if the bands are equally spaced in memory, all bands are read 
+    +++ with one single call, otherwise band by band
+    +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+    if ((brick_short = get_bands_short(brick)) == NULL){
+      close_gdalcache(dataset); free((void*)disc_map); free((void*)brick_map); return NULL;}
+
+    band_space = (nb_read > 1) ? (char*)brick_short[brick_map[1]] - (char*)brick_short[brick_map[0]] : 0;
+    equal_space = (nb_read == 1 || band_space >= (GSpacing)(nc*sizeof(short)));
+    for (b=2; b<nb_read && equal_space; b++){
+      if ((char*)brick_short[brick_map[b]] - (char*)brick_short[brick_map[b-1]] != band_space) equal_space = false;
+    }
+
+    if (nb_read > 0 && equal_space){
+      if (GDALDatasetRasterIOEx(dataset, GF_Read, 
+        xoff_disc, yoff_disc, nx_disc, ny_disc, 
+        brick_short[brick_map[0]], nx, ny, GDT_Int16, nb_read, disc_map, 
+        0, 0, band_space, NULL) == CE_Failure){
+        printf("could not read image.\n"); close_gdalcache(dataset); 
+        free((void*)disc_map); free((void*)brick_map); return NULL;}
     } else {
-      printf("unsupported datatype. "); return NULL;
+      for (b=0; b<nb_read; b++){
+        band = GDALGetRasterBand(dataset, disc_map[b]);
+        if (GDALRasterIO(band, GF_Read, 
+          xoff_disc, yoff_disc, nx_disc, ny_disc, 
+          brick_short[brick_map[b]], nx, ny, GDT_Int16, 0, 0) == CE_Failure){
+          printf("could not read image.\n"); close_gdalcache(dataset); 
+          free((void*)disc_map); free((void*)brick_map); return NULL;}
+      }
     }
 
-    for (p=0; p<nc_read; p++) read_buf[p] = nodata;
+  } else {
+
+    /** read band by band into buffer, then reduce with PSF and/or
+    +++ convert to brick datatype
+    +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
-    band = GDALGetRasterBand(dataset, b_disc);
-    if (GDALRasterIO(band, GF_Read, 
-      xoff_disc, yoff_disc, nx_disc, ny_disc, 
-      read_buf, nx_read, ny_read, GDT_Int16, 0, 0) == CE_Failure){
-      printf("could not read image.\n"); return NULL;}
+    alloc((void**)&read_buf, nc_read, sizeof(short));
+
+    for (b=0; b<nb_read; b++){
 
-    if (psf && nc_disc > nc){
-      for (p=0; p<nc; p++) psf_buf[p] = nodata;
-      reduce_psf(read_buf, nx_disc, ny_disc, nc_disc, psf_buf, nx, ny, nc, nodata);
       if (datatype == _DT_SMALL_){
-        for (p=0; p<nc; p++) brick_small_[p] = psf_buf[p];
+        if ((brick_small_ = get_band_small(brick, brick_map[b])) == NULL){
+          close_gdalcache(dataset); 
+          free((void*)disc_map); free((void*)brick_map); return NULL;}
       } else if (datatype == _DT_SHORT_){
-        for (p=0; p<nc; p++) brick_short_[p] = psf_buf[p];
+        if ((brick_short_ = get_band_short(brick, brick_map[b])) == NULL){
+          close_gdalcache(dataset); 
+          free((void*)disc_map); free((void*)brick_map); return NULL;}
       } else {
-        printf("unsupported datatype. "); return NULL;
+        printf("unsupported datatype. "); close_gdalcache(dataset); 
+        free((void*)disc_map); free((void*)brick_map); return NULL;
       }
-    } else {
-      if (datatype == _DT_SMALL_){
-        for (p=0; p<nc; p++) brick_small_[p] = read_buf[p];
-      } else if (datatype == _DT_SHORT_){
-        for (p=0; p<nc; p++) brick_short_[p] = read_buf[p];
+
+      band = GDALGetRasterBand(dataset, disc_map[b]);
+      if (GDALRasterIO(band, GF_Read, 
+        xoff_disc, yoff_disc, nx_disc, ny_disc, 
+        read_buf, nx_read, ny_read, GDT_Int16, 0, 0) == CE_Failure){
+        printf("could not read image.\n"); close_gdalcache(dataset); 
+        free((void*)disc_map); free((void*)brick_map); return NULL;}
+
+      if (psf && nc_disc > nc){
+        for (p=0; p<nc; p++) psf_buf[p] = nodata;
+        reduce_psf(read_buf, nx_disc, ny_disc, nc_disc, psf_buf, nx, ny, nc, nodata);
+        if (datatype == _DT_SMALL_){
+          for (p=0; p<nc; p++) brick_small_[p] = psf_buf[p];
+        } else {
+          for (p=0; p<nc; p++) brick_short_[p] = psf_buf[p];
+        }
       } else {
-        printf("unsupported datatype. "); return NULL;
+        if (datatype == _DT_SMALL_){
+          for (p=0; p<nc; p++) brick_small_[p] = read_buf[p];
+        } else {
+          for (p=0; p<nc; p++) brick_short_[p] = read_buf[p];
+        }
       }
-    }
-    
-    if (ard_type == _ARD_REF_){
-      set_brick_domain(brick, b_brick, sen->domain[b]);
-      set_brick_bandname(brick, b_brick, sen->domain[b]);
-    }
 
-    b_brick++;
+    }
 
   }
 
-  GDALClose(dataset);
+  free((void*)disc_map);
+  free((void*)brick_map);
+
+  close_gdalcache(dataset);
   if (read_buf != NULL){ free((void*)read_buf); read_buf = NULL;}
   if (psf_buf  != NULL){ free((void*)psf_buf);  psf_buf  = NULL;}
 
@@ -30,12 +30,15 @@ Reading ARD header
 
 #include <stdio.h>   // core input and output functions
 #include <stdlib.h>  // standard general utilities library
+#include <limits.h>  // macro constants of the integer types
+#include <sys/stat.h> // file information
 
 #include "../cross-level/const-cl.h"
 #include "../cross-level/string-cl.h"
 #include "../cross-level/brick-cl.h"
 #include "../cross-level/imagefuns-cl.h"
 #include "../cross-level/quality-cl.h"
+#include "../cross-level/gdalcache-cl.h"
 #include "../higher-level/param-hl.h"
 
 
@@ -64,6 +67,15 @@ typedef struct {
   //date_t  date; // acquisition date
 } ard_t;
 
+typedef struct {
+  char dname[NPOW_10];    // tile directory
+  struct timespec mtime;  // modification time of tile directory
+  char **name;            // basenames of files
+  int   *ce;              // acquisition date, days since CE (-1: unknown)
+  int   *doy;             // acquisition date, day of year
+  int    n;               // number of files
+} ard_index_t;
+
 brick_t *read_mask(int *success, off_t *ibytes, int tx, int ty, int chunk, cube_t *cube, par_hl_t *phl);
 ard_t *read_features(off_t *ibytes, int *nt, int tx, int ty, int chunk, cube_t *cube, par_hl_t *phl);
 ard_t *read_confield(off_t *ibytes, int *nt, int tx, int ty, int chunk, cube_t *cube, par_hl_t *phl);
@@ -71,6 +83,7 @@ ard_t *read_ard(off_t *ibytes, int *nt, int tx, int ty, int chunk, cube_t *cube,
 brick_t *read_block(char *file, int ard_type, par_sen_t *sen, int read_b, int read_nb, short nodata, int datatype, int chunk, int tx, int ty, cube_t *cube, bool psf, double partial_x, double partial_y);
 brick_t *add_blocks(char *file, int ard_type, par_sen_t *sen, int read_b, int read_nb, short nodata, int datatype, int chunk, int tx, int ty, cube_t *cube, bool psf, double radius, brick_t *ARD);
 int free_ard(ard_t *ard, int nt);
+void free_ard_index();
 
 #ifdef __cplusplus
 }
@@ -108,6 +108,7 @@ int nchar;
         cv::Ptr<cv::ml::RTrees> newmodel = cv::ml::RTrees::create();
         newmodel = cv::ml::RTrees::load(fname);
         aux->ml.rf_model.push_back(newmodel);
+        aux->ml.rf_forest.push_back(flatten_forest(newmodel, phl->ftr.nfeature));
 
         if (phl->mcl.method == _ML_RFC_){
 
@@ -118,6 +119,12 @@ int nchar;
           cv::Mat vote;
           newmodel->getVotes(sample, vote, 0);
 
+          if (m > 0 && vote.cols != phl->mcl.nclass[s]){
+            printf("Models of set %d have different numbers of classes (%d vs. %d).\n", 
+              s+1, phl->mcl.nclass[s], vote.cols);
+            return FAILURE;
+          }
+
           phl->mcl.nclass[s] = vote.cols;
           
           sample.release();
@@ -331,6 +338,11 @@ int i;
       free((void*)aux->sample.visited);
     }
 
+    if (phl->type == _HL_ML_){
+      for (i=0; i<(int)aux->ml.rf_forest.size(); i++) free_forest(aux->ml.rf_forest[i]);
+      aux->ml.rf_forest.clear();
+    }
+
     free((void*)aux); aux = NULL;
 
   }
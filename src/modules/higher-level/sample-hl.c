@@ -36,6 +36,7 @@ This file contains functions for sampling of features
 
 
 void append_table(char *fname, bool *allow, double **tab, int nrow, int ncol, int decimals);
+void append_binary(par_hl_t *phl, aux_smp_t *smp, bool *allow, double **features, double **response, int nf, int nr);
 
 void append_table(char *fname, bool *allow, double **tab, int nrow, int ncol, int decimals){
 int row, col;
@@ -62,6 +63,75 @@ FILE *fp = NULL;
 }
 
 
+/** This function appends the allowed samples to the binary sample tables
++++ of features and responses. Both tables also hold the coordinates. Both
++++ files are locked while appending, such that the blocks of features and 
++++ responses are in the same order if multiple processes are sampling.
+--- phl:      HL parameters
+--- smp:      sample
+--- allow:    samples to append
+--- features: sampled features
+--- response: sampled responses
+--- nf:       number of features
+--- nr:       number of response variables
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void append_binary(par_hl_t *phl, aux_smp_t *smp, bool *allow, double **features, double **response, int nf, int nr){
+char **names = NULL;
+char bname[NPOW_10];
+char *lock_f = NULL, *lock_r = NULL;
+double timeout;
+int f, r, nchar, err;
+
+
+  alloc_2D((void***)&names, MAX(nf, nr), BINTABLE_NAME_LEN, sizeof(char));
+
+  for (f=0; f<nf; f++){
+    basename_without_ext(phl->ftr.bname[f], bname, NPOW_10);
+    nchar = snprintf(names[f], BINTABLE_NAME_LEN, "%s_B%04d", bname, phl->ftr.band[f]);
+    if (nchar < 0 || nchar >= BINTABLE_NAME_LEN){ 
+      printf("Buffer Overflow in assembling feature name\n"); exit(FAILURE);}
+  }
+
+  timeout = lock_timeout((size_t)smp->ns*(nf+nr+4)*sizeof(float));
+
+  if ((lock_f = lock_file(phl->smp.f_sample, timeout)) == NULL){
+    printf("unable to lock %s. ", phl->smp.f_sample); exit(FAILURE);}
+
+  if ((lock_r = lock_file(phl->smp.f_response, timeout)) == NULL){
+    unlock_file(lock_f);
+    printf("unable to lock %s. ", phl->smp.f_response); exit(FAILURE);}
+
+  err = write_bintable(phl->smp.f_sample, features, smp->tab, allow, 
+          smp->ns, nf, names, phl->ftr.nodata);
+
+  if (err == SUCCESS){
+
+    for (r=0; r<nr; r++){
+      nchar = snprintf(names[r], BINTABLE_NAME_LEN, "RESPONSE_%d", r+1);
+      if (nchar < 0 || nchar >= BINTABLE_NAME_LEN){ 
+        printf("Buffer Overflow in assembling response name\n"); err = FAILURE;}
+    }
+
+  }
+
+  if (err == SUCCESS){
+    err = write_bintable(phl->smp.f_response, response, smp->tab, allow, 
+            smp->ns, nr, names, phl->ftr.nodata);
+  }
+
+  unlock_file(lock_r);
+  unlock_file(lock_f);
+
+  if (err != SUCCESS){
+    printf("unable to append to %s and %s. ", phl->smp.f_sample, phl->smp.f_response); exit(FAILURE);}
+
+  free_2D((void**)names, MAX(nf, nr));
+
+  return;
+}
+
+
 
 
 
@@ -247,8 +317,12 @@ double minx, maxx, miny, maxy;
 
 
   if (added > 0){
-    append_table(phl->smp.f_sample,   copied, smp_features, smp->ns, nf, 0);
-    append_table(phl->smp.f_response, copied, smp_response, smp->ns, nr, 6);
+    if (phl->smp.binary){
+      append_binary(phl, smp, copied, smp_features, smp_response, nf, nr);
+    } else {
+      append_table(phl->smp.f_sample,   copied, smp_features, smp->ns, nf, 0);
+      append_table(phl->smp.f_response, copied, smp_response, smp->ns, nr, 6);
+    }
     append_table(phl->smp.f_coords,   copied, smp->tab,     smp->ns, 2,  6);
   }
 
@@ -32,6 +32,8 @@ Sampling header
 #include <stdlib.h>  // standard general utilities library
 
 #include "../cross-level/const-cl.h"
+#include "../cross-level/bintable-cl.h"
+#include "../cross-level/dir-cl.h"
 #include "../higher-level/read-ard-hl.h"
 
 
@@ -44,12 +44,17 @@ This file contains functions for spectral temporal metrics
 int tsa_stm(tsa_t *ts, small *mask_, int nc, int ni, short nodata, par_stm_t *stm){
 int t, b, n, p, q;
 short minimum, maximum;
-short q25_, q75_;
 double mean, var;
 double skew, kurt;
 double skewscaled, kurtscaled;
 double *q_array = NULL; // need to be double for GSL quantile function
 bool alloc_q_array = false;
+qsketch_t sketch;
+float q_prob[102];
+float *q_value = NULL;
+int nq = 0;
+int p0, np;
+short *tsi_block = NULL, *tsi_p = NULL;
 
 
   if (ts->stm_ == NULL) return CANCEL;
@@ -57,83 +62,122 @@ bool alloc_q_array = false;
   cite_me(_CITE_STM_);
   
   if (stm->sta.quantiles || stm->sta.iqr > -1) alloc_q_array = true;
+
+  // all quantiles are computed at once, IQR quartiles at the end
+  for (q=0; q<stm->sta.nquantiles; q++) q_prob[nq++] = stm->sta.q[q];
+  if (stm->sta.iqr > -1){ q_prob[nq++] = 0.25; q_prob[nq++] = 0.75;}
   
 
-  #pragma omp parallel private(t,b,minimum,maximum,q,q_array,mean,var,skew,kurt,n,skewscaled,kurtscaled,q25_,q75_) shared(mask_,ts,nc,ni,nodata,stm,alloc_q_array) default(none)
+  #pragma omp parallel private(t,b,minimum,maximum,q,q_array,q_value,sketch,mean,var,skew,kurt,n,skewscaled,kurtscaled,p,np,tsi_block,tsi_p) shared(mask_,ts,nc,ni,nodata,stm,alloc_q_array,q_prob,nq) default(none)
   {
 
+    alloc((void**)&tsi_block, (size_t)TSA_BLOCK*ni, sizeof(short));
+
     // initialize stats
-    if (alloc_q_array) alloc((void**)&q_array, ni, sizeof(double));
+    if (alloc_q_array){
+      alloc((void**)&q_value, nq, sizeof(float));
+      if (stm->qtol > 0){
+        init_quantile_sketch(&sketch, 2*stm->qtol+1);
+      } else {
+        alloc((void**)&q_array, ni, sizeof(double));
+      }
+    }
 
     #pragma omp for
-    for (p=0; p<nc; p++){
+    for (p0=0; p0<nc; p0+=TSA_BLOCK){
 
-      if (mask_ != NULL && !mask_[p]){
-        for (b=0; b<stm->sta.nmetrics; b++) ts->stm_[b][p] = nodata;
-        continue;
-      }
+      np = (p0+TSA_BLOCK < nc) ? TSA_BLOCK : nc-p0;
+      gather_time_block(ts->tsi_, ni, p0, np, tsi_block);
 
-      mean = var = skew = kurt = n = 0;
-      minimum = SHRT_MAX; maximum = SHRT_MIN;
-      q25_ = q75_ = SHRT_MIN;
+      for (p=p0; p<p0+np; p++){
 
-      for (t=0; t<ni; t++){
+        tsi_p = tsi_block + (size_t)(p-p0)*ni;
 
-        if (ts->tsi_[t][p] == nodata) continue;
+        if (mask_ != NULL && !mask_[p]){
+          for (b=0; b<stm->sta.nmetrics; b++) ts->stm_[b][p] = nodata;
+          continue;
+        }
 
-        // range metrics
-        if (ts->tsi_[t][p] < minimum) minimum = ts->tsi_[t][p];
-        if (ts->tsi_[t][p] > maximum) maximum = ts->tsi_[t][p];
+        mean = var = skew = kurt = n = 0;
+        minimum = SHRT_MAX; maximum = SHRT_MIN;
 
-        // quantile metrics
-        if (alloc_q_array) q_array[n] = ts->tsi_[t][p];
+        for (t=0; t<ni; t++){
 
-        n++;
+          if (tsi_p[t] == nodata) continue;
 
-        // moments metrics
-        kurt_recurrence(ts->tsi_[t][p], &mean, &var, 
-                          &skew, &kurt, n);
+          // range metrics
+          if (tsi_p[t] < minimum) minimum = tsi_p[t];
+          if (tsi_p[t] > maximum) maximum = tsi_p[t];
 
-      }
+          // quantile metrics
+          if (alloc_q_array){
+            if (stm->qtol > 0){
+              add_quantile_sketch(&sketch, tsi_p[t]);
+            } else {
+              q_array[n] = tsi_p[t];
+            }
+          }
+
+          n++;
+
+          // moments metrics
+          kurt_recurrence(tsi_p[t], &mean, &var, 
+                            &skew, &kurt, n);
+
+        }
+
+
+        if (n > 0){
+          skewscaled = skewness(var, skew, n)*1000;
+          kurtscaled = (kurtosis(var, kurt, n)-3)*1000;
+          if (skewscaled < -30000) skewscaled = -30000;
+          if (skewscaled >  30000) skewscaled =  30000;
+          if (kurtscaled < -30000) kurtscaled = -30000;
+          if (kurtscaled >  30000) kurtscaled =  30000;
+          if (stm->sta.num > -1) ts->stm_[stm->sta.num][p] = n;
+          if (stm->sta.min > -1) ts->stm_[stm->sta.min][p] = minimum;
+          if (stm->sta.max > -1) ts->stm_[stm->sta.max][p] = maximum;
+          if (stm->sta.rng > -1) ts->stm_[stm->sta.rng][p] = maximum-minimum;
+          if (stm->sta.avg > -1) ts->stm_[stm->sta.avg][p] = (short)mean;
+          if (stm->sta.std > -1) ts->stm_[stm->sta.std][p] = (short)standdev(var, n);
+          if (stm->sta.skw > -1) ts->stm_[stm->sta.skw][p] = (short)skewscaled;
+          if (stm->sta.krt > -1) ts->stm_[stm->sta.krt][p] = (short)kurtscaled;
+
+          if (alloc_q_array){
+            if (stm->qtol > 0){
+              quantiles_sketch(&sketch, q_prob, nq, q_value);
+              reset_quantile_sketch(&sketch);
+            } else {
+              quantiles(q_array, n, q_prob, nq, q_value);
+            }
+          }
 
-  
-      if (n > 0){
-        skewscaled = skewness(var, skew, n)*1000;
-        kurtscaled = (kurtosis(var, kurt, n)-3)*1000;
-        if (skewscaled < -30000) skewscaled = -30000;
-        if (skewscaled >  30000) skewscaled =  30000;
-        if (kurtscaled < -30000) kurtscaled = -30000;
-        if (kurtscaled >  30000) kurtscaled =  30000;
-        if (stm->sta.num > -1) ts->stm_[stm->sta.num][p] = n;
-        if (stm->sta.min > -1) ts->stm_[stm->sta.min][p] = minimum;
-        if (stm->sta.max > -1) ts->stm_[stm->sta.max][p] = maximum;
-        if (stm->sta.rng > -1) ts->stm_[stm->sta.rng][p] = maximum-minimum;
-        if (stm->sta.avg > -1) ts->stm_[stm->sta.avg][p] = (short)mean;
-        if (stm->sta.std > -1) ts->stm_[stm->sta.std][p] = (short)standdev(var, n);
-        if (stm->sta.skw > -1) ts->stm_[stm->sta.skw][p] = (short)skewscaled;
-        if (stm->sta.krt > -1) ts->stm_[stm->sta.krt][p] = (short)kurtscaled;
-
-        if (stm->sta.quantiles){
           for (q=0; q<stm->sta.nquantiles; q++){
-            ts->stm_[stm->sta.qxx[q]][p] = (short)quantile(q_array, n, stm->sta.q[q]);
-            if (stm->sta.q[q] == 0.25) q25_ = ts->stm_[stm->sta.qxx[q]][p];
-            if (stm->sta.q[q] == 0.75) q75_ = ts->stm_[stm->sta.qxx[q]][p];
+            ts->stm_[stm->sta.qxx[q]][p] = (short)q_value[q];
           }
-        }
 
-        if (stm->sta.iqr > -1){
-          if (q25_ == SHRT_MIN) q25_ = (short)quantile(q_array, n, 0.25);
-          if (q75_ == SHRT_MIN) q75_ = (short)quantile(q_array, n, 0.75);
-          ts->stm_[stm->sta.iqr][p] = q75_-q25_;
+          if (stm->sta.iqr > -1){
+            ts->stm_[stm->sta.iqr][p] = (short)q_value[nq-1] - (short)q_value[nq-2];
+          }
+        } else {
+          for (b=0; b<stm->sta.nmetrics; b++) ts->stm_[b][p] = nodata;
         }
-      } else {
-        for (b=0; b<stm->sta.nmetrics; b++) ts->stm_[b][p] = nodata;
+
       }
-      
+
     }
 
-    if (alloc_q_array) free((void*)q_array);
+    if (alloc_q_array){
+      free((void*)q_value);
+      if (stm->qtol > 0){
+        free_quantile_sketch(&sketch);
+      } else {
+        free((void*)q_array);
+      }
+    }
     
+    free((void*)tsi_block);
+
   }
 
   return SUCCESS;
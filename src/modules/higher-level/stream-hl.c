@@ -0,0 +1,514 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric 
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2025 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for streaming processing units through a
+bounded work queue. Readers, the compute team and writers work on 
+different processing units at the same time, and are only synchronized
+through the queue, i.e. a slow chunk does not stall the other tasks.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "stream-hl.h"
+#include "tasks-hl.h"
+
+#include <unistd.h>  // standard symbolic constants and types 
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+
+#define STREAM_WAIT 10000 // microseconds to sleep when no work is available
+
+enum { _UNIT_WAIT_,    _UNIT_READ_,  _UNIT_INPUT_, _UNIT_COMPUTE_, 
+       _UNIT_OUTPUT_,  _UNIT_WRITE_, _UNIT_DONE_ };
+
+typedef struct {
+  omp_lock_t lock;
+  int   *status;    // processing state of each unit
+  off_t *bytes;     // memory that is held by each unit
+  int npu;          // number of processing units
+  int nchunk;       // number of chunks per tile
+  int next;         // next unit to be read
+  int nread;        // number of units that are currently read
+  int nflight;      // number of units in flight (reading until written)
+  int ncomputed;    // number of computed units
+  int ndone;        // number of finished units
+  int max_flight;   // maximum number of units in flight
+  off_t mem;        // memory that is held by the units in flight
+  off_t max_mem;    // maximum memory of the units in flight (0: no limit)
+  off_t max_read;   // largest input so far, used to estimate the next read
+} stream_t;
+
+void init_stream(stream_t *stream, progress_t *pro, par_hl_t *phl);
+void free_stream(stream_t *stream);
+bool read_this_unit(stream_t *stream);
+int next_unit(stream_t *stream, int status);
+int next_output_unit(stream_t *stream);
+off_t output_size(brick_t **OUTPUT, int nprod);
+void print_stream(stream_t *stream, progress_t *pro);
+void stream_reader(stream_t *stream, progress_t *pro, bool account, off_t *ibytes, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl);
+void stream_computer(stream_t *stream, progress_t *pro, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod);
+void stream_writer(stream_t *stream, progress_t *pro, off_t *obytes, brick_t ***OUTPUT, int *nprod, par_hl_t *phl);
+
+
+/** This function initializes the work queue
+--- stream:   work queue
+--- pro:      progress handle
+--- phl:      HL parameters
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_stream(stream_t *stream, progress_t *pro, par_hl_t *phl){
+
+
+  stream->npu    = pro->npu;
+  stream->nchunk = pro->nchunk;
+
+  alloc((void**)&stream->status, stream->npu, sizeof(int));
+  alloc((void**)&stream->bytes,  stream->npu, sizeof(off_t));
+
+  stream->next      = 0;
+  stream->nread     = 0;
+  stream->nflight   = 0;
+  stream->ncomputed = 0;
+  stream->ndone     = 0;
+  stream->mem       = 0;
+  stream->max_read  = 0;
+
+  stream->max_flight = phl->sflight;
+  stream->max_mem    = (off_t)(phl->smemory*1024.0*1024.0*1024.0);
+
+  omp_init_lock(&stream->lock);
+
+  return;
+}
+
+
+/** This function frees the work queue
+--- stream:   work queue
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_stream(stream_t *stream){
+
+
+  omp_destroy_lock(&stream->lock);
+
+  free((void*)stream->status); stream->status = NULL;
+  free((void*)stream->bytes);  stream->bytes  = NULL;
+
+  return;
+}
+
+
+/** This function tells whether there is room in the queue to read the 
++++ next unit. The memory of units that are currently read is estimated
++++ with the largest input seen so far. At least one unit is always
++++ allowed in flight.
+--- stream:   work queue
++++ Return:   true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool read_this_unit(stream_t *stream){
+
+
+  if (stream->next >= stream->npu) return false;
+  if (stream->nflight == 0) return true;
+  if (stream->nflight >= stream->max_flight) return false;
+
+  if (stream->max_mem > 0 && 
+      stream->mem + (stream->nread+1)*stream->max_read > stream->max_mem){
+    return false;
+  }
+
+  return true;
+}
+
+
+/** This function returns the oldest unit with a given processing state
+--- stream:   work queue
+--- status:   processing state
++++ Return:   processing unit (or -1 if there is none)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int next_unit(stream_t *stream, int status){
+int pu;
+
+
+  for (pu=0; pu<stream->next; pu++){
+    if (stream->status[pu] == status) return pu;
+  }
+
+  return -1;
+}
+
+
+/** This function returns the oldest unit that is ready to be written. 
++++ The chunks of one tile are written into the same files, and the first
++++ chunk creates them. Thus, a unit is only handed out when all earlier
++++ chunks of the same tile are done.
+--- stream:   work queue
++++ Return:   processing unit (or -1 if there is none)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int next_output_unit(stream_t *stream){
+int pu, first, p;
+bool ready;
+
+
+  for (pu=0; pu<stream->next; pu++){
+
+    if (stream->status[pu] != _UNIT_OUTPUT_) continue;
+
+    first = pu - (pu % stream->nchunk);
+
+    for (p=first, ready=true; p<pu; p++){
+      if (stream->status[p] != _UNIT_DONE_){ ready = false; break;}
+    }
+
+    if (ready) return pu;
+
+  }
+
+  return -1;
+}
+
+
+/** This function returns the memory held by the output bricks of a unit
+--- OUTPUT:   OUTPUT bricks of one processing unit
+--- nprod:    number of output bricks
++++ Return:   bytes
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+off_t output_size(brick_t **OUTPUT, int nprod){
+off_t bytes = 0;
+int o;
+
+
+  if (OUTPUT == NULL) return 0;
+
+  for (o=0; o<nprod; o++){
+    if (OUTPUT[o] != NULL) bytes += get_brick_size(OUTPUT[o]);
+  }
+
+  return bytes;
+}
+
+
+/** This function prints progress while the queue is running. Must be 
++++ called when holding the lock.
+--- stream:   work queue
+--- pro:      progress handle
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void print_stream(stream_t *stream, progress_t *pro){
+
+
+  if (stream->ndone < stream->npu) progress_queue(pro, stream->ndone);
+
+  return;
+}
+
+
+/** This function is the work loop of one reader. Readers take the units
++++ in ascending order, as long as the queue is not exceeded
+--- stream:   work queue
+--- pro:      progress handle
+--- account:  account the waiting time of this reader?
+--- ibytes:   number of bytes read
+--- MASK:     mask image
+--- ARD1:     primary   ARD
+--- ARD2:     secondary ARD
+--- nt1:      number of primary   ARD products
+--- nt2:      number of secondary ARD products
+--- cube:     datacube definition
+--- phl:      HL parameters
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void stream_reader(stream_t *stream, progress_t *pro, bool account, off_t *ibytes, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl){
+int pu, tx, ty, chunk;
+off_t bytes;
+double secs, wait;
+bool output;
+
+
+  while (true){
+
+    omp_set_lock(&stream->lock);
+
+    if (stream->next >= stream->npu){
+      omp_unset_lock(&stream->lock);
+      break;
+    }
+
+    if (!read_this_unit(stream)){
+      output = (next_unit(stream, _UNIT_OUTPUT_) >= 0 || 
+                next_unit(stream, _UNIT_WRITE_)  >= 0);
+      omp_unset_lock(&stream->lock);
+      wait = omp_get_wtime();
+      usleep(STREAM_WAIT);
+      if (account){
+        omp_set_lock(&stream->lock);
+        progress_queue_bound(pro, (output) ? _TASK_OUTPUT_ : _TASK_COMPUTE_, 
+          omp_get_wtime()-wait);
+        omp_unset_lock(&stream->lock);
+      }
+      continue;
+    }
+
+    pu = stream->next++;
+    stream->status[pu] = _UNIT_READ_;
+    stream->nread++;
+    stream->nflight++;
+
+    progress_unit(pro, _TASK_INPUT_, pu);
+    tx = pro->tx_next; ty = pro->ty_next; chunk = pro->chunk_next;
+
+    omp_unset_lock(&stream->lock);
+
+
+    secs  = omp_get_wtime();
+    bytes = read_higher_level_unit(pu, tx, ty, chunk, 
+              MASK, ARD1, ARD2, nt1, nt2, cube, phl);
+    secs  = omp_get_wtime()-secs;
+
+
+    omp_set_lock(&stream->lock);
+
+    *ibytes += bytes;
+
+    stream->status[pu] = _UNIT_INPUT_;
+    stream->bytes[pu]  = bytes;
+    stream->mem += bytes;
+    stream->nread--;
+    if (bytes > stream->max_read) stream->max_read = bytes;
+
+    progress_queue_time(pro, _TASK_INPUT_, secs);
+    print_stream(stream, pro);
+
+    omp_unset_lock(&stream->lock);
+
+  }
+
+  return;
+}
+
+
+/** This function is the work loop of the compute team. The oldest unit 
++++ that was read is computed next.
+--- stream:   work queue
+--- pro:      progress handle
+--- MASK:     mask image
+--- ARD1:     primary   ARD
+--- ARD2:     secondary ARD
+--- nt1:      number of primary   ARD products
+--- nt2:      number of secondary ARD products
+--- cube:     datacube definition
+--- phl:      HL parameters
+--- aux:      auxilliary data
+--- OUTPUT:   OUTPUT bricks
+--- nproduct: number of output bricks
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void stream_computer(stream_t *stream, progress_t *pro, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod){
+int pu;
+double secs, wait;
+
+
+  while (true){
+
+    omp_set_lock(&stream->lock);
+
+    if (stream->ncomputed >= stream->npu){
+      omp_unset_lock(&stream->lock);
+      break;
+    }
+
+    if ((pu = next_unit(stream, _UNIT_INPUT_)) < 0){
+      omp_unset_lock(&stream->lock);
+      wait = omp_get_wtime();
+      usleep(STREAM_WAIT);
+      omp_set_lock(&stream->lock);
+      progress_queue_bound(pro, _TASK_INPUT_, omp_get_wtime()-wait);
+      omp_unset_lock(&stream->lock);
+      continue;
+    }
+
+    stream->status[pu] = _UNIT_COMPUTE_;
+    progress_unit(pro, _TASK_COMPUTE_, pu);
+
+    omp_unset_lock(&stream->lock);
+
+
+    secs = omp_get_wtime();
+    compute_higher_level_unit(pu, MASK, ARD1, ARD2, nt1, nt2, 
+      cube, phl, aux, OUTPUT, nprod);
+    secs = omp_get_wtime()-secs;
+
+
+    omp_set_lock(&stream->lock);
+
+    stream->mem -= stream->bytes[pu];
+    stream->ncomputed++;
+
+    if (nprod[pu] > 0 && OUTPUT[pu] != NULL){
+      stream->bytes[pu]  = output_size(OUTPUT[pu], nprod[pu]);
+      stream->mem       += stream->bytes[pu];
+      stream->status[pu] = _UNIT_OUTPUT_;
+    } else {
+      free((void*)OUTPUT[pu]);
+      OUTPUT[pu] = NULL;
+      stream->bytes[pu]  = 0;
+      stream->status[pu] = _UNIT_DONE_;
+      stream->nflight--;
+      stream->ndone++;
+    }
+
+    progress_queue_time(pro, _TASK_COMPUTE_, secs);
+    print_stream(stream, pro);
+
+    omp_unset_lock(&stream->lock);
+
+  }
+
+  return;
+}
+
+
+/** This function is the work loop of one writer. The oldest unit that 
++++ was computed is written next, as long as the earlier chunks of its
++++ tile were already written.
+--- stream:   work queue
+--- pro:      progress handle
+--- obytes:   number of bytes written
+--- OUTPUT:   OUTPUT bricks
+--- nproduct: number of output bricks
+--- phl:      HL parameters
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void stream_writer(stream_t *stream, progress_t *pro, off_t *obytes, brick_t ***OUTPUT, int *nprod, par_hl_t *phl){
+int pu, tx, ty;
+off_t bytes;
+double secs;
+
+
+  while (true){
+
+    omp_set_lock(&stream->lock);
+
+    if (stream->ndone >= stream->npu){
+      omp_unset_lock(&stream->lock);
+      break;
+    }
+
+    if ((pu = next_output_unit(stream)) < 0){
+      omp_unset_lock(&stream->lock);
+      usleep(STREAM_WAIT);
+      continue;
+    }
+
+    stream->status[pu] = _UNIT_WRITE_;
+    progress_unit(pro, _TASK_OUTPUT_, pu);
+    tx = pro->tx_prev; ty = pro->ty_prev;
+
+    omp_unset_lock(&stream->lock);
+
+
+    secs = omp_get_wtime();
+    bytes = output_higher_level_unit(pu, tx, ty, OUTPUT, nprod, phl);
+    secs = omp_get_wtime()-secs;
+
+
+    omp_set_lock(&stream->lock);
+
+    *obytes += bytes;
+
+    stream->mem -= stream->bytes[pu];
+    stream->bytes[pu]  = 0;
+    stream->status[pu] = _UNIT_DONE_;
+    stream->nflight--;
+    stream->ndone++;
+
+    progress_queue_time(pro, _TASK_OUTPUT_, secs);
+    print_stream(stream, pro);
+
+    omp_unset_lock(&stream->lock);
+
+  }
+
+  return;
+}
+
+
+/** This function streams all processing units through a bounded work 
++++ queue. There are STREAMING_READERS readers, one compute team and 
++++ STREAMING_WRITERS writers, which each have their own sub-threads. Up
++++ to STREAMING_CHUNKS units are in flight at the same time, and new 
++++ units are only read if the units in flight do not hold more than 
++++ STREAMING_MEMORY.
+--- pro:      progress handle
+--- ibytes:   number of bytes read
+--- obytes:   number of bytes written
+--- MASK:     mask image
+--- ARD1:     primary   ARD
+--- ARD2:     secondary ARD
+--- nt1:      number of primary   ARD products
+--- nt2:      number of secondary ARD products
+--- cube:     datacube definition
+--- phl:      HL parameters
+--- aux:      auxilliary data
+--- OUTPUT:   OUTPUT bricks
+--- nproduct: number of output bricks
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void stream_higher_level(progress_t *pro, off_t *ibytes, off_t *obytes, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod){
+stream_t stream;
+off_t ib = 0, ob = 0;
+
+
+  init_stream(&stream, pro, phl);
+
+  progress_unit(pro, _TASK_INPUT_,   -1);
+  progress_unit(pro, _TASK_COMPUTE_, -1);
+  progress_unit(pro, _TASK_OUTPUT_,  -1);
+  progress_queue(pro, 0);
+
+  #pragma omp parallel num_threads(phl->sreader+1+phl->swriter) shared(stream,pro,MASK,ARD1,ARD2,nt1,nt2,cube,phl,aux,OUTPUT,nprod) reduction(+: ib, ob) default(none)
+  {
+
+    if (omp_get_thread_num() < phl->sreader){
+      stream_reader(&stream, pro, omp_get_thread_num() == 0, &ib, 
+        MASK, ARD1, ARD2, nt1, nt2, cube, phl);
+    } else if (omp_get_thread_num() == phl->sreader){
+      stream_computer(&stream, pro, MASK, ARD1, ARD2, nt1, nt2, 
+        cube, phl, aux, OUTPUT, nprod);
+    } else {
+      stream_writer(&stream, pro, &ob, OUTPUT, nprod, phl);
+    }
+
+  }
+
+  *ibytes += ib;
+  *obytes += ob;
+
+  progress_queue(pro, stream.ndone);
+
+  free_stream(&stream);
+
+  return;
+}
+
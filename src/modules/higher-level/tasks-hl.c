@@ -34,9 +34,11 @@ This file contains functions for higher level tasks
 /** OpenMP **/
 #include <omp.h> // multi-platform shared memory multiprocessing
 
-/** This function handles the reading tasks
---- pro:      progress handle
---- ibytes:   number of bytes read
+/** This function reads one processing unit
+--- pu:       processing unit
+--- tx:       tile X-ID
+--- ty:       tile Y-ID
+--- chunk:    chunk ID
 --- MASK:     mask image
 --- ARD1:     primary   ARD
 --- ARD2:     secondary ARD
@@ -44,84 +46,93 @@ This file contains functions for higher level tasks
 --- nt2:      number of secondary ARD products
 --- cube:     datacube definition
 --- phl:      HL parameters
-+++ Return:   void
++++ Return:   number of bytes read
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void read_higher_level (progress_t *pro, off_t *ibytes, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl){
+off_t read_higher_level_unit(int pu, int tx, int ty, int chunk, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl){
 int mask_status;
 off_t bytes = 0;
 
 
-  if (!read_this_chunk(pro)) return;
-
-
-  MASK[pro->pu_next] = NULL;
-  ARD1[pro->pu_next] = NULL;
-  ARD2[pro->pu_next] = NULL;
-  nt1[pro->pu_next]  = 0;
-  nt2[pro->pu_next]  = 0;
-
-  measure_progress(pro, _TASK_INPUT_, _CLOCK_TICK_);
+  MASK[pu] = NULL;
+  ARD1[pu] = NULL;
+  ARD2[pu] = NULL;
+  nt1[pu]  = 0;
+  nt2[pu]  = 0;
 
   omp_set_num_threads(phl->ithread);
 
-  MASK[pro->pu_next] = read_mask(&mask_status, &bytes,
-    pro->tx_next, pro->ty_next, pro->chunk_next, cube, phl);
+  MASK[pu] = read_mask(&mask_status, &bytes, tx, ty, chunk, cube, phl);
 
-  if (MASK[pro->pu_next] == NULL && mask_status != SUCCESS){
+  if (MASK[pu] == NULL && mask_status != SUCCESS){
     if (mask_status == FAILURE){
-      printf("error reading mask tile X%04d_Y%04d chunk %d.\n", 
-        pro->tx_next, pro->ty_next, pro->chunk_next);
+      printf("error reading mask tile X%04d_Y%04d chunk %d.\n", tx, ty, chunk);
     } else if (mask_status == CANCEL){
       //printf("no mask data. skip block.\n");
     }
-    measure_progress(pro, _TASK_INPUT_, _CLOCK_TOCK_);
-    return;
+    return 0;
   }
 
 
   if (phl->input_level1 == _INP_FTR_){
-    ARD1[pro->pu_next] = read_features(&bytes, &nt1[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, phl);
+    ARD1[pu] = read_features(&bytes, &nt1[pu], tx, ty, chunk, cube, phl);
   } else if (phl->input_level1 == _INP_CON_){
-    ARD1[pro->pu_next] = read_confield(&bytes, &nt1[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, phl);
+    ARD1[pu] = read_confield(&bytes, &nt1[pu], tx, ty, chunk, cube, phl);
   } else if (phl->input_level1 == _INP_ARD_ || phl->input_level1 == _INP_QAI_){
-    ARD1[pro->pu_next] = read_ard(&bytes, &nt1[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, &phl->sen, phl);
+    ARD1[pu] = read_ard(&bytes, &nt1[pu], tx, ty, chunk, cube, &phl->sen, phl);
   } else if (phl->input_level1 != _INP_NONE_) {
     printf("unknown input level\n");
   }
 
-  if (ARD1[pro->pu_next] == NULL && nt1[pro->pu_next] < 0){
-    printf("error reading data from tile X%04d_Y%04d chunk %d.\n", 
-      pro->tx_next, pro->ty_next, pro->chunk_next);
-    measure_progress(pro, _TASK_INPUT_, _CLOCK_TOCK_);
-    return;
+  if (ARD1[pu] == NULL && nt1[pu] < 0){
+    printf("error reading data from tile X%04d_Y%04d chunk %d.\n", tx, ty, chunk);
+    return 0;
   }
 
 
   if (phl->input_level2 == _INP_FTR_){
-    ARD2[pro->pu_next] = read_features(&bytes, &nt2[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, phl);
+    ARD2[pu] = read_features(&bytes, &nt2[pu], tx, ty, chunk, cube, phl);
   } else if (phl->input_level2 == _INP_CON_){
-    ARD2[pro->pu_next] = read_confield(&bytes, &nt2[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, phl);
+    ARD2[pu] = read_confield(&bytes, &nt2[pu], tx, ty, chunk, cube, phl);
   } else if (phl->input_level2 == _INP_ARD_ || phl->input_level2 == _INP_QAI_){
-    ARD2[pro->pu_next] = read_ard(&bytes, &nt2[pro->pu_next], 
-      pro->tx_next, pro->ty_next, pro->chunk_next, cube, &phl->sen2, phl);
+    ARD2[pu] = read_ard(&bytes, &nt2[pu], tx, ty, chunk, cube, &phl->sen2, phl);
   } else if (phl->input_level2 != _INP_NONE_){
     printf("unknown input level\n");
   }
 
-  if (ARD2[pro->pu_next] == NULL && nt2[pro->pu_next] < 0){
-    printf("error reading secondary data from tile X%04d_Y%04d chunk %d.\n", 
-      pro->tx_next, pro->ty_next, pro->chunk_next);
-    measure_progress(pro, _TASK_INPUT_, _CLOCK_TOCK_);
-    return;
+  if (ARD2[pu] == NULL && nt2[pu] < 0){
+    printf("error reading secondary data from tile X%04d_Y%04d chunk %d.\n", tx, ty, chunk);
+    return 0;
   }
 
 
-  *ibytes = bytes;
+  return bytes;
+}
+
+
+/** This function handles the reading tasks
+--- pro:      progress handle
+--- ibytes:   number of bytes read
+--- MASK:     mask image
+--- ARD1:     primary   ARD
+--- ARD2:     secondary ARD
+--- nt1:      number of primary   ARD products
+--- nt2:      number of secondary ARD products
+--- cube:     datacube definition
+--- phl:      HL parameters
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_higher_level (progress_t *pro, off_t *ibytes, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl){
+off_t bytes = 0;
+
+
+  if (!read_this_chunk(pro)) return;
+
+  measure_progress(pro, _TASK_INPUT_, _CLOCK_TICK_);
+
+  bytes = read_higher_level_unit(pro->pu_next, pro->tx_next, pro->ty_next, 
+    pro->chunk_next, MASK, ARD1, ARD2, nt1, nt2, cube, phl);
+
+  *ibytes += bytes;
 
   measure_progress(pro, _TASK_INPUT_, _CLOCK_TOCK_);
 
@@ -129,8 +140,8 @@ off_t bytes = 0;
 }
 
 
-/** This function handles the computing tasks
---- pro:      progress handle
+/** This function computes one processing unit
+--- pu:       processing unit
 --- MASK:     mask image
 --- ARD1:     primary   ARD
 --- ARD2:     secondary ARD
@@ -143,40 +154,35 @@ off_t bytes = 0;
 --- nproduct: number of output bricks
 +++ Return:   void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void compute_higher_level (progress_t *pro, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod){
+void compute_higher_level_unit(int pu, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod){
 bool error = false;
 
 
-  if (!compute_this_chunk(pro)) return;
-
-  OUTPUT[pro->pu] = NULL;
-  nprod[pro->pu]  = 0;
-
-
-  measure_progress(pro, _TASK_COMPUTE_, _CLOCK_TICK_);
+  OUTPUT[pu] = NULL;
+  nprod[pu]  = 0;
 
   omp_set_num_threads(phl->cthread);
 
 
-  if (nt1[pro->pu] > 0){
-    if (screen_qai(ARD1[pro->pu], nt1[pro->pu], MASK[pro->pu], &phl->qai, phl->input_level1) != SUCCESS) error = true;
+  if (nt1[pu] > 0){
+    if (screen_qai(ARD1[pu], nt1[pu], MASK[pu], &phl->qai, phl->input_level1) != SUCCESS) error = true;
     if (phl->input_level1 == _INP_ARD_ || phl->input_level1 == _INP_QAI_){
-      if (screen_noise(ARD1[pro->pu], nt1[pro->pu], MASK[pro->pu], &phl->qai) == FAILURE) error = true;
+      if (screen_noise(ARD1[pu], nt1[pu], MASK[pu], &phl->qai) == FAILURE) error = true;
     }
   } else {
     error = true;
   }
 
-  if (nt2[pro->pu] > 0){
-    if (screen_qai(ARD2[pro->pu], nt2[pro->pu], MASK[pro->pu], &phl->qai, phl->input_level2) != SUCCESS) error = true;
+  if (nt2[pu] > 0){
+    if (screen_qai(ARD2[pu], nt2[pu], MASK[pu], &phl->qai, phl->input_level2) != SUCCESS) error = true;
     if (phl->input_level2 == _INP_ARD_ || phl->input_level2 == _INP_QAI_){
-      if (screen_noise(ARD2[pro->pu], nt2[pro->pu], MASK[pro->pu], &phl->qai) == FAILURE) error = true;
+      if (screen_noise(ARD2[pu], nt2[pu], MASK[pu], &phl->qai) == FAILURE) error = true;
     }
   }
 
 
   if (!error && phl->input_level1 == _INP_ARD_){
-    if (spectral_adjust(ARD1[pro->pu], MASK[pro->pu], nt1[pro->pu], phl) == FAILURE) error = true;
+    if (spectral_adjust(ARD1[pu], MASK[pu], nt1[pu], phl) == FAILURE) error = true;
   }
 
 
@@ -184,48 +190,48 @@ bool error = false;
 
     switch (phl->type){
       case _HL_BAP_:
-        OUTPUT[pro->pu] = level3(ARD1[pro->pu], ARD2[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], nt2[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = level3(ARD1[pu], ARD2[pu], MASK[pu], 
+          nt1[pu], nt2[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_TSA_:
-        OUTPUT[pro->pu] = time_series_analysis(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, &aux->endmember, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = time_series_analysis(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, &aux->endmember, cube, &nprod[pu]);
         break;
       case _HL_CSO_:
-        OUTPUT[pro->pu] = clear_sky_observations(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = clear_sky_observations(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_ML_:
-        OUTPUT[pro->pu] = machine_learning(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, &aux->ml, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = machine_learning(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, &aux->ml, cube, &nprod[pu]);
         break;
       case _HL_SMP_:
-        OUTPUT[pro->pu] = sample_points(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, &aux->sample, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = sample_points(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, &aux->sample, cube, &nprod[pu]);
         break;
       case _HL_TXT_:
-        OUTPUT[pro->pu] = texture(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = texture(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_LSM_:
-        OUTPUT[pro->pu] = landscape_metrics(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = landscape_metrics(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_L2I_:
-        OUTPUT[pro->pu] = level2_improphe(ARD1[pro->pu], ARD2[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], nt2[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = level2_improphe(ARD1[pu], ARD2[pu], MASK[pu], 
+          nt1[pu], nt2[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_CFI_:
-        OUTPUT[pro->pu] = confield_improphe(ARD1[pro->pu], ARD2[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], nt2[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = confield_improphe(ARD1[pu], ARD2[pu], MASK[pu], 
+          nt1[pu], nt2[pu], phl, cube, &nprod[pu]);
         break;
       case _HL_LIB_:
-        OUTPUT[pro->pu] = library_completeness(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, &aux->library, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = library_completeness(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, &aux->library, cube, &nprod[pu]);
         break;
       case _HL_UDF_:
-        OUTPUT[pro->pu] = udf_plugin(ARD1[pro->pu], MASK[pro->pu], 
-          nt1[pro->pu], phl, cube, &nprod[pro->pu]);
+        OUTPUT[pu] = udf_plugin(ARD1[pu], MASK[pu], 
+          nt1[pu], phl, cube, &nprod[pu]);
         break;
       default:
         printf("unknown processing module\n");
@@ -235,25 +241,58 @@ bool error = false;
   }
 
   
-  free_ard(ARD1[pro->pu], nt1[pro->pu]);
-  free_ard(ARD2[pro->pu], nt2[pro->pu]);
-  free_brick(MASK[pro->pu]);
+  free_ard(ARD1[pu], nt1[pu]);
+  free_ard(ARD2[pu], nt2[pu]);
+  free_brick(MASK[pu]);
 
-  measure_progress(pro, _TASK_COMPUTE_, _CLOCK_TOCK_);
+  ARD1[pu] = NULL;
+  ARD2[pu] = NULL;
+  MASK[pu] = NULL;
 
   return;
 }
 
 
-/** This function handles the output tasks
+/** This function handles the computing tasks
 --- pro:      progress handle
---- obytes:   number of bytes written
+--- MASK:     mask image
+--- ARD1:     primary   ARD
+--- ARD2:     secondary ARD
+--- nt1:      number of primary   ARD products
+--- nt2:      number of secondary ARD products
+--- cube:     datacube definition
+--- phl:      HL parameters
+--- aux:      auxilliary data
 --- OUTPUT:   OUTPUT bricks
 --- nproduct: number of output bricks
---- phl:      HL parameters
 +++ Return:   void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-void output_higher_level (progress_t *pro, off_t *obytes, brick_t ***OUTPUT, int *nprod, par_hl_t *phl){
+void compute_higher_level (progress_t *pro, brick_t **MASK, ard_t **ARD1, ard_t **ARD2, int *nt1, int *nt2, cube_t *cube, par_hl_t *phl, aux_t *aux, brick_t ***OUTPUT, int *nprod){
+
+
+  if (!compute_this_chunk(pro)) return;
+
+  measure_progress(pro, _TASK_COMPUTE_, _CLOCK_TICK_);
+
+  compute_higher_level_unit(pro->pu, MASK, ARD1, ARD2, nt1, nt2, 
+    cube, phl, aux, OUTPUT, nprod);
+
+  measure_progress(pro, _TASK_COMPUTE_, _CLOCK_TOCK_);
+
+  return;
+}
+
+
+/** This function writes one processing unit
+--- pu:       processing unit
+--- tx:       tile X-ID
+--- ty:       tile Y-ID
+--- OUTPUT:   OUTPUT bricks
+--- nproduct: number of output bricks
+--- phl:      HL parameters
++++ Return:   number of bytes written
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+off_t output_higher_level_unit(int pu, int tx, int ty, brick_t ***OUTPUT, int *nprod, par_hl_t *phl){
 char dname[NPOW_10]; 
 int nchar;
 char *lock = NULL;
@@ -262,43 +301,37 @@ off_t bytes = 0;
 int o;
 
 
-  if (!write_this_chunk(pro, nprod)) return;
-  if (OUTPUT[pro->pu_prev] == NULL) return;
-
+  if (nprod[pu] <= 0 || OUTPUT[pu] == NULL) return 0;
 
-  measure_progress(pro, _TASK_OUTPUT_, _CLOCK_TICK_);
 
-  nchar = snprintf(dname, NPOW_10, "%s/X%04d_Y%04d", phl->d_higher, pro->tx_prev, pro->ty_prev);
+  nchar = snprintf(dname, NPOW_10, "%s/X%04d_Y%04d", phl->d_higher, tx, ty);
   if (nchar < 0 || nchar >= NPOW_10){ 
     printf("Buffer Overflow in assembling filename\n"); exit(1);}
 
-  if ((lock = (char*)CPLLockFile(dname, 60)) == NULL){
-    printf("Unable to lock directory %s (timeout: %ds). ", dname, 60);
-    error = true;
-  }
+  if ((lock = lock_file(dname, 60)) == NULL) error = true;
 
   if (!error){
 
     createdir(dname);
-    CPLUnlockFile(lock);
+    unlock_file(lock);
     lock = NULL;
 
     omp_set_num_threads(phl->othread);
   
-    #pragma omp parallel shared(OUTPUT,pro,nprod,phl) reduction(+: bytes) default(none)
+    #pragma omp parallel shared(OUTPUT,pu,nprod,phl) reduction(+: bytes) default(none)
     {
 
       CPLPushErrorHandler(CPLQuietErrorHandler);
       CPLSetConfigOption("GDAL_PAM_ENABLED", "YES");
 
       #pragma omp for schedule(dynamic,1)
-      for (o=0; o<nprod[pro->pu_prev]; o++){
-        if (phl->radius > 0) OUTPUT[pro->pu_prev][o] = crop_brick(
-          OUTPUT[pro->pu_prev][o], phl->radius);
-        write_brick(OUTPUT[pro->pu_prev][o]);
-        if (OUTPUT[pro->pu_prev][o] != NULL && 
-            get_brick_open(OUTPUT[pro->pu_prev][o]) != OPEN_FALSE){
-            bytes += get_brick_size(OUTPUT[pro->pu_prev][o]);
+      for (o=0; o<nprod[pu]; o++){
+        if (phl->radius > 0) OUTPUT[pu][o] = crop_brick(
+          OUTPUT[pu][o], phl->radius);
+        write_brick(OUTPUT[pu][o]);
+        if (OUTPUT[pu][o] != NULL && 
+            get_brick_open(OUTPUT[pu][o]) != OPEN_FALSE){
+            bytes += get_brick_size(OUTPUT[pu][o]);
         }
       }
 
@@ -310,11 +343,32 @@ int o;
 
   }
 
-  for (o=0; o<nprod[pro->pu_prev]; o++) free_brick(OUTPUT[pro->pu_prev][o]);
-  free((void*)OUTPUT[pro->pu_prev]);
-  OUTPUT[pro->pu_prev] = NULL;
+  for (o=0; o<nprod[pu]; o++) free_brick(OUTPUT[pu][o]);
+  free((void*)OUTPUT[pu]);
+  OUTPUT[pu] = NULL;
+
+  return bytes;
+}
+
+
+/** This function handles the output tasks
+--- pro:      progress handle
+--- obytes:   number of bytes written
+--- OUTPUT:   OUTPUT bricks
+--- nproduct: number of output bricks
+--- phl:      HL parameters
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void output_higher_level (progress_t *pro, off_t *obytes, brick_t ***OUTPUT, int *nprod, par_hl_t *phl){
+
+
+  if (!write_this_chunk(pro, nprod)) return;
+  if (OUTPUT[pro->pu_prev] == NULL) return;
+
+  measure_progress(pro, _TASK_OUTPUT_, _CLOCK_TICK_);
 
-  *obytes = bytes;
+  *obytes += output_higher_level_unit(pro->pu_prev, pro->tx_prev, pro->ty_prev, 
+    OUTPUT, nprod, phl);
 
   measure_progress(pro, _TASK_OUTPUT_, _CLOCK_TOCK_);
 
@@ -35,6 +35,7 @@ TSA Processing header
 #include "../cross-level/brick-cl.h"
 #include "../higher-level/param-hl.h"
 #include "../higher-level/read-ard-hl.h"
+#include "../higher-level/tsblock-hl.h"
 
 
 #ifdef __cplusplus
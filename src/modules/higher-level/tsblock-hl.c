@@ -0,0 +1,93 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+This file is part of FORCE - Framework for Operational Radiometric 
+Correction for Environmental monitoring.
+
+Copyright (C) 2013-2025 David Frantz
+
+FORCE is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+FORCE is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with FORCE.  If not, see <http://www.gnu.org/licenses/>.
+
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for transposing time series into pixel-
+major blocks. Time series are stored as one image per time step, i.e.
+a per-pixel kernel that loops over time touches a different cache line 
+for every time step. The kernels process the pixels in blocks instead.
+Each block is transposed into a small buffer, in which the time series
+of each pixel is contiguous.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "tsblock-hl.h"
+
+
+#define TSA_BLOCK_T 32 // number of time steps that are transposed at once
+
+
+/** This function copies a block of pixels from time-major images into a
++++ pixel-major buffer, i.e. block[p*nt+t] = ts_[t][p0+p].
+--- ts_:    time series images [nt][nc]
+--- nt:     number of time steps
+--- p0:     first pixel of block
+--- np:     number of pixels in block
+--- block:  pixel-major buffer [np*nt] (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void gather_time_block(short **ts_, int nt, int p0, int np, short *block){
+int t, t0, t1, p;
+short *block_ = NULL;
+
+
+  for (t0=0; t0<nt; t0+=TSA_BLOCK_T){
+
+    t1 = (t0+TSA_BLOCK_T < nt) ? t0+TSA_BLOCK_T : nt;
+
+    for (p=0, block_=block; p<np; p++, block_+=nt){
+      for (t=t0; t<t1; t++) block_[t] = ts_[t][p0+p];
+    }
+
+  }
+
+  return;
+}
+
+
+/** This function copies a pixel-major buffer back into time-major images,
++++ i.e. ts_[t][p0+p] = block[p*nt+t].
+--- block:  pixel-major buffer [np*nt]
+--- nt:     number of time steps
+--- p0:     first pixel of block
+--- np:     number of pixels in block
+--- ts_:    time series images [nt][nc] (modified)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void scatter_time_block(short *block, int nt, int p0, int np, short **ts_){
+int t, t0, t1, p;
+short *block_ = NULL;
+
+
+  for (t0=0; t0<nt; t0+=TSA_BLOCK_T){
+
+    t1 = (t0+TSA_BLOCK_T < nt) ? t0+TSA_BLOCK_T : nt;
+
+    for (p=0, block_=block; p<np; p++, block_+=nt){
+      for (t=t0; t<t1; t++) ts_[t][p0+p] = block_[t];
+    }
+
+  }
+
+  return;
+}
+
@@ -39,9 +39,33 @@ float wul, wur, wll, wlr;
 float wtop, wdown;
 } iweights_t;
 
+// precomputed interpolation grid
+typedef struct {
+int    nf, ne;                  // number of columns/rows in coarse grid
+int   *gleft, *gright;          // left/right coarse column of each column
+int   *gtop,  *gdown;           // top/bottom coarse row of each row
+float *wleft, *wright;          // column weights if both coarse cells are valid
+float *wtop,  *wdown;           // row weights if both coarse cells are valid
+bool  *valid;                   // validity of coarse cells
+} igrid_t;
+
+// band-specific inputs of surface reflectance
+typedef struct {
+int     b;                      // input band
+float   E0;                     // solar irradiance
+short  *toa, *boa;              // TOA and BOA reflectance
+short  *bck, *tg;               // background reflectance, gaseous transmittance
+float **T, **Ts, **tss, **tsd;  // elevation-dependent atmospheric parameters
+float **tvs, **tvd, **s, **rho_p;
+float  *Tg, *Tso, *Tvo, *brdf;  // coarse grids
+} sr_band_t;
+
 iweights_t interpolation_weights(int j, int i, int nf, int ne, float res, float full_res, float *COARSE, float nodata);
+void init_interpolation_grid(igrid_t *grid, int nx, int ny, float full_res, int nf, int ne, float res, float *COARSE, float nodata);
+void free_interpolation_grid(igrid_t *grid);
+iweights_t grid_weights(igrid_t *grid, int j, int i);
 float interpolate_coarse(iweights_t weight, float *COARSE);
-int surface_reflectance(par_ll_t *pl2, atc_t *atc, int b, short *bck_, short *toa_, short *Tg_, short *boa_, small *dem_, short *ill_, ushort *sky_, ushort *cf_, brick_t *QAI);
+int surface_reflectance(par_ll_t *pl2, atc_t *atc, igrid_t *grid, int *bands, int b0, int b1, short **bck_, short **Tg_, brick_t *WVP, brick_t *BOA, small *dem_, short *ill_, ushort *sky_, ushort *cf_, brick_t *QAI);
 short *background_reflectance(atc_t *atc, int b, short *toa_, short *Tg_, small *dem_, brick_t *QAI);
 int atmo_angledep(par_ll_t *pl2, meta_t *meta, atc_t *atc, top_t *TOP, brick_t *QAI);
 int atmo_elevdep(par_ll_t *pl2, atc_t *atc, brick_t *QAI, top_t *TOP);
@@ -155,6 +179,168 @@ bool vul, vur, vll, vlr;
 }
 
 
+/** This function precomputes the parts of the interpolation weights that
++++ only depend on the column or on the row, as well as the validity of 
++++ the coarse cells. The grid is computed once per image and can be used
++++ for all bands. grid_weights yields the same weights as 
++++ interpolation_weights.
+--- grid:     interpolation grid (returned)
+--- nx:       number or columns in full image
+--- ny:       number or rows    in full image
+--- full_res: resolution of full image
+--- nf:       number or columns in coarse grid
+--- ne:       number or rows    in coarse grid
+--- res:      resolution of coarse grid
+--- COARSE:   one coarse grid
+--- nodata:   nodata of coarse grid
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_interpolation_grid(igrid_t *grid, int nx, int ny, float full_res, int nf, int ne, float res, float *COARSE, float nodata){
+int i, j, g;
+float e_, f_;
+int   e, f;
+float c1, c2;
+
+
+  grid->nf = nf;
+  grid->ne = ne;
+
+  alloc((void**)&grid->gleft,  nx, sizeof(int));
+  alloc((void**)&grid->gright, nx, sizeof(int));
+  alloc((void**)&grid->wleft,  nx, sizeof(float));
+  alloc((void**)&grid->wright, nx, sizeof(float));
+  alloc((void**)&grid->gtop,   ny, sizeof(int));
+  alloc((void**)&grid->gdown,  ny, sizeof(int));
+  alloc((void**)&grid->wtop,   ny, sizeof(float));
+  alloc((void**)&grid->wdown,  ny, sizeof(float));
+  alloc((void**)&grid->valid,  nf*ne, sizeof(bool));
+
+  for (j=0; j<nx; j++){
+
+    f_ = j*full_res/res; f = floor(f_);
+
+    if (f_-f < 0.5){ grid->gleft[j] = f-1; grid->gright[j] = f;} else { grid->gleft[j] = f; grid->gright[j] = f+1;}
+    if (grid->gleft[j] < 0)    grid->gleft[j]  = f;
+    if (grid->gright[j] >= nf) grid->gright[j] = f;
+
+    c1 = grid->gleft[j]  + 0.5;
+    c2 = grid->gright[j] + 0.5;
+    grid->wleft[j]  = (c2-f_)/(c2-c1);
+    grid->wright[j] = (f_-c1)/(c2-c1);
+
+  }
+
+  for (i=0; i<ny; i++){
+
+    e_ = i*full_res/res; e = floor(e_);
+
+    if (e_-e < 0.5){ grid->gtop[i] = e-1; grid->gdown[i] = e;} else { grid->gtop[i] = e; grid->gdown[i] = e+1;}
+    if (grid->gtop[i] < 0)    grid->gtop[i]  = e;
+    if (grid->gdown[i] >= ne) grid->gdown[i] = e;
+
+    c1 = grid->gtop[i]  + 0.5;
+    c2 = grid->gdown[i] + 0.5;
+    grid->wtop[i]  = (c2-e_)/(c2-c1);
+    grid->wdown[i] = (e_-c1)/(c2-c1);
+
+  }
+
+  for (g=0; g<nf*ne; g++) grid->valid[g] = !fequal(COARSE[g], nodata);
+
+  return;
+}
+
+
+/** This function frees the interpolation grid
+--- grid:     interpolation grid
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_interpolation_grid(igrid_t *grid){
+
+  free((void*)grid->gleft);  grid->gleft  = NULL;
+  free((void*)grid->gright); grid->gright = NULL;
+  free((void*)grid->wleft);  grid->wleft  = NULL;
+  free((void*)grid->wright); grid->wright = NULL;
+  free((void*)grid->gtop);   grid->gtop   = NULL;
+  free((void*)grid->gdown);  grid->gdown  = NULL;
+  free((void*)grid->wtop);   grid->wtop   = NULL;
+  free((void*)grid->wdown);  grid->wdown  = NULL;
+  free((void*)grid->valid);  grid->valid  = NULL;
+
+  return;
+}
+
+
+/** This function assembles the weights to interpolate the coarse atmos-
++++ pheric parameters from the precomputed interpolation grid
+--- grid:     interpolation grid
+--- j:        column of full image
+--- i:        row    of full image
++++ Return:   weights
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+iweights_t grid_weights(igrid_t *grid, int j, int i){
+iweights_t weight;
+int   gleft = grid->gleft[j], gright = grid->gright[j];
+int   gtop  = grid->gtop[i],  gdown  = grid->gdown[i];
+bool vtop = true, vdown = true;
+bool vul, vur, vll, vlr;
+
+
+  weight.gul = gtop*grid->nf  + gleft;
+  weight.gur = gtop*grid->nf  + gright;
+  weight.gll = gdown*grid->nf + gleft;
+  weight.glr = gdown*grid->nf + gright;
+
+  vul = grid->valid[weight.gul];
+  vur = grid->valid[weight.gur];
+  vll = grid->valid[weight.gll];
+  vlr = grid->valid[weight.glr];
+
+  if (gleft == gright){
+    weight.wul = 0.5; weight.wur = 0.5;
+  } else if (vul && vur){
+    weight.wul = grid->wleft[j];
+    weight.wur = grid->wright[j];
+  } else if (vul && !vur){
+    weight.wul = 1; weight.wur = 0;
+  } else if (!vul && vur){
+    weight.wul = 0; weight.wur = 1;
+  } else {
+    weight.wul = 0; weight.wur = 0;
+    vtop = false;
+  }
+
+  if (gleft == gright){
+    weight.wll = 0.5; weight.wlr = 0.5;
+  } else if (vll && vlr){
+    weight.wll = grid->wleft[j];
+    weight.wlr = grid->wright[j];
+  } else if (vll && !vlr){
+    weight.wll = 1; weight.wlr = 0;
+  } else if (!vll && vlr){
+    weight.wll = 0; weight.wlr = 1;
+  } else {
+    weight.wll = 0; weight.wlr = 0;
+    vdown = false;
+  }
+
+  if (gtop == gdown){
+    weight.wtop = 0.5; weight.wdown = 0.5;
+  } else if (vtop && vdown){
+    weight.wtop  = grid->wtop[i];
+    weight.wdown = grid->wdown[i];
+  } else if (vtop){
+    weight.wtop = 1; weight.wdown = 0;
+  } else if (vdown){
+    weight.wtop = 0; weight.wdown = 1;
+  } else {
+    weight.wtop = 0; weight.wdown = 0;
+  }
+
+  return weight;  
+}
+
+
 /** This function interpolates the coarse atmospheric parameters
 --- weight:   weight for the interpolation
 --- COARSE:   one coarse grid
@@ -173,14 +359,23 @@ float ul, ur, ll, lr;
 }
 
 
-/** This function computes the surface reflectance
+/** This function computes the surface reflectance. All requested bands
++++ are processed in one pass, i.e. the interpolation weights, topographic
++++ factors and water vapor are only looked up once per pixel. Output band
++++ b_ is written to band b_ of the brick, input band bands[b_] is read 
++++ from the same brick (in-place band reordering, bands[b_] >= b_).
++++ If no gaseous transmittance is given for a band, but a water vapor 
++++ brick is, the transmittance is computed on the fly.
 --- pl2:    L2 parameters
 --- atc:    atmospheric correction factors
---- b:      band
---- bck_:   background reflectance
---- toa_:   TOA reflectance
---- Tg_:    gaseous transmittance
---- boa_:   BOA reflectance
+--- grid:   interpolation grid
+--- bands:  input band of each output band
+--- b0:     first output band to process
+--- b1:     last output band to process (exclusive)
+--- bck_:   background reflectance for each output band (or NULL)
+--- Tg_:    gaseous transmittance for each output band (or NULL)
+--- WVP:    water vapor (or NULL)
+--- BOA:    TOA reflectance (input) / BOA reflectance (output)
 --- dem_:   DEM
 --- ill_:   illumination angle
 --- sky_:   sky view factor
@@ -188,36 +383,28 @@ float ul, ur, ll, lr;
 --- QAI:    Quality Assurance Information
 +++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-int surface_reflectance(par_ll_t *pl2, atc_t *atc, int b, short *bck_, short *toa_, short *Tg_, short *boa_, small *dem_, short *ill_, ushort *sky_, ushort *cf_, brick_t *QAI){
-int i, j, p, nx, ny, ne, nf, z, b_sw2;
-float fres, gres;
+int surface_reflectance(par_ll_t *pl2, atc_t *atc, igrid_t *grid, int *bands, int b0, int b1, short **bck_, short **Tg_, brick_t *WVP, brick_t *BOA, small *dem_, short *ill_, ushort *sky_, ushort *cf_, brick_t *QAI){
+int i, j, p, nx, ny, z, b_, k, nk, b_sw2;
+int g, pw;
 float A = 1.0;
 float brdf = 1.0;
 iweights_t weights;
 float toa, bck, ref, tmp;
 short nodata = -9999;
-short vnodata;
 float E0_, tss_sw2, tsd_sw2;
 float sky, ill, cf, f, f0, h0; 
 float T, Ts, tss, tsd, tvs, tvd;
 float s, rho_p, szen, ms;
 float tg, Tso, Tvo;
-float  *xy_vz       = NULL;
-float  *xy_sz       = NULL;
-float  *xy_Tg       = NULL;
-float  *xy_Tvo      = NULL;
-float  *xy_Tso      = NULL;
-float  *xy_brdf     = NULL;
-float **xyz_T       = NULL;
-float **xyz_Ts      = NULL;
-float **xyz_tss     = NULL;
-float **xyz_tsd     = NULL;
-float **xyz_tvs     = NULL;
-float **xyz_tvd     = NULL;
-float **xyz_s       = NULL;
-float **xyz_rho_p   = NULL;
-float **xyz_tss_sw2 = NULL;
-float **xyz_tsd_sw2 = NULL;
+float wms, wmv, wnodata = 0;
+short wvp;
+bool wvalid = false;
+bool off;
+short  *wvp_   = NULL;
+float  *xy_ms  = NULL;
+float  *xy_mv  = NULL;
+float  *xy_sz  = NULL;
+sr_band_t *band = NULL;
 
 
   #ifdef FORCE_CLOCK
@@ -227,35 +414,52 @@ float **xyz_tsd_sw2 = NULL;
 
   nx  = get_brick_ncols(QAI);
   ny  = get_brick_nrows(QAI);
-  fres  = get_brick_res(QAI);
-  nf  = get_brick_ncols(atc->xy_view);
-  ne  = get_brick_nrows(atc->xy_view);
-  gres  = get_brick_res(atc->xy_view);
-  vnodata = get_brick_nodata(atc->xy_view, ZEN);
+  nk  = b1-b0;
   if ((b_sw2 = find_domain(atc->xy_mod, "SWIR2")) < 0)   return FAILURE;
 
-  if ((xyz_T       = atc_get_band_reshaped(atc->xyz_T,     b))     == NULL) return FAILURE;
-  if ((xyz_Ts      = atc_get_band_reshaped(atc->xyz_Ts,    b))     == NULL) return FAILURE;
-  if ((xyz_tss     = atc_get_band_reshaped(atc->xyz_tss,   b))     == NULL) return FAILURE;
-  if ((xyz_tsd     = atc_get_band_reshaped(atc->xyz_tsd,   b))     == NULL) return FAILURE;
-  if ((xyz_tvs     = atc_get_band_reshaped(atc->xyz_tvs,   b))     == NULL) return FAILURE;
-  if ((xyz_tvd     = atc_get_band_reshaped(atc->xyz_tvd,   b))     == NULL) return FAILURE;
-  if ((xyz_s       = atc_get_band_reshaped(atc->xyz_s,     b))     == NULL) return FAILURE;
-  if ((xyz_rho_p   = atc_get_band_reshaped(atc->xyz_rho_p, b))     == NULL) return FAILURE;
-  if ((xyz_tss_sw2 = atc_get_band_reshaped(atc->xyz_tss,   b_sw2)) == NULL) return FAILURE;
-  if ((xyz_tsd_sw2 = atc_get_band_reshaped(atc->xyz_tsd,   b_sw2)) == NULL) return FAILURE;
-  if ((xy_vz       = get_band_float(atc->xy_view, ZEN)) == NULL) return FAILURE;
-  if ((xy_sz       = get_band_float(atc->xy_sun,  ZEN)) == NULL) return FAILURE;
-  if ((xy_Tg       = get_band_float(atc->xy_Tg,   b))   == NULL) return FAILURE;
-  if ((xy_Tvo      = get_band_float(atc->xy_Tvo,  b))   == NULL) return FAILURE;
-  if ((xy_Tso      = get_band_float(atc->xy_Tso,  b))   == NULL) return FAILURE;
-  if ((xy_brdf     = get_band_float(atc->xy_brdf, b))   == NULL) return FAILURE;
+  if ((xy_sz = get_band_float(atc->xy_sun, ZEN)) == NULL) return FAILURE;
+
+  if (WVP != NULL){
+    if ((wvp_  = get_band_short(WVP, 0))          == NULL) return FAILURE;
+    if ((xy_ms = get_band_float(atc->xy_sun, cZEN))  == NULL) return FAILURE;
+    if ((xy_mv = get_band_float(atc->xy_view, cZEN)) == NULL) return FAILURE;
+    wnodata = get_brick_nodata(atc->xy_view, cZEN);
+  }
+
+
+  alloc((void**)&band, nk, sizeof(sr_band_t));
+
+  for (k=0; k<nk; k++){
+
+    b_ = b0+k;
+    band[k].b  = bands[b_];
+    band[k].E0 = atc->E0[band[k].b];
+
+    if ((band[k].toa = get_band_short(BOA, band[k].b)) == NULL) return FAILURE;
+    if ((band[k].boa = get_band_short(BOA, b_))        == NULL) return FAILURE;
+    band[k].bck = (bck_ != NULL) ? bck_[b_] : NULL;
+    band[k].tg  = (Tg_  != NULL) ? Tg_[b_]  : NULL;
+
+    if ((band[k].T     = atc_get_band_reshaped(atc->xyz_T,     band[k].b)) == NULL) return FAILURE;
+    if ((band[k].Ts    = atc_get_band_reshaped(atc->xyz_Ts,    band[k].b)) == NULL) return FAILURE;
+    if ((band[k].tss   = atc_get_band_reshaped(atc->xyz_tss,   band[k].b)) == NULL) return FAILURE;
+    if ((band[k].tsd   = atc_get_band_reshaped(atc->xyz_tsd,   band[k].b)) == NULL) return FAILURE;
+    if ((band[k].tvs   = atc_get_band_reshaped(atc->xyz_tvs,   band[k].b)) == NULL) return FAILURE;
+    if ((band[k].tvd   = atc_get_band_reshaped(atc->xyz_tvd,   band[k].b)) == NULL) return FAILURE;
+    if ((band[k].s     = atc_get_band_reshaped(atc->xyz_s,     band[k].b)) == NULL) return FAILURE;
+    if ((band[k].rho_p = atc_get_band_reshaped(atc->xyz_rho_p, band[k].b)) == NULL) return FAILURE;
+    if ((band[k].Tg    = get_band_float(atc->xy_Tg,   band[k].b)) == NULL) return FAILURE;
+    if ((band[k].Tvo   = get_band_float(atc->xy_Tvo,  band[k].b)) == NULL) return FAILURE;
+    if ((band[k].Tso   = get_band_float(atc->xy_Tso,  band[k].b)) == NULL) return FAILURE;
+    if ((band[k].brdf  = get_band_float(atc->xy_brdf, band[k].b)) == NULL) return FAILURE;
+
+  }
   
   
   if (pl2->dobrdf) cite_me(_CITE_BRDF_);
 
 
-  #pragma omp parallel private(j, p, z, toa, weights, T, Ts, tss, tsd, tvs, tvd, s, rho_p, tss_sw2, tsd_sw2, tg, sky, ill, cf, szen, ms, Tso, Tvo, E0_, f, f0, h0, bck, tmp, ref) firstprivate(A, brdf) shared(b, b_sw2, nx, ny, nf, ne, gres, fres, vnodata, nodata, toa_, boa_, bck_, QAI, dem_, ill_, sky_, cf_, Tg_, atc, pl2, xyz_T, xyz_Ts, xyz_tss, xyz_tsd, xyz_tvs, xyz_tvd, xyz_s, xyz_rho_p, xyz_tss_sw2, xyz_tsd_sw2, xy_brdf, xy_vz, xy_sz, xy_Tg, xy_Tvo, xy_Tso) default(none) 
+  #pragma omp parallel private(j, p, k, z, g, pw, toa, weights, T, Ts, tss, tsd, tvs, tvd, s, rho_p, tss_sw2, tsd_sw2, tg, sky, ill, cf, szen, ms, Tso, Tvo, E0_, f, f0, h0, bck, tmp, ref, wvp, wms, wmv, wvalid, off) firstprivate(A, brdf) shared(nk, nx, ny, nodata, wnodata, QAI, WVP, dem_, ill_, sky_, cf_, atc, pl2, grid, band, wvp_, xy_ms, xy_mv, xy_sz) default(none) 
   {
 
     #pragma omp for schedule(guided)
@@ -267,100 +471,135 @@ float **xyz_tsd_sw2 = NULL;
       p = i*nx+j;
 
       if (get_off(QAI, p)){ 
-        boa_[p] = nodata; continue;}
-
-      toa = toa_[p]/10000.0;
+        for (k=0; k<nk; k++) band[k].boa[p] = nodata; 
+        continue;
+      }
 
 
+      // band-independent variables
       if (pl2->doatmo){
 
         z = dem_[p];
+        weights = grid_weights(grid, j, i);
 
-        // smooth atc variables
-        weights = interpolation_weights(j, i, nf, ne, gres, fres, xy_vz, vnodata);
-        T       = interpolate_coarse(weights, xyz_T[z]);
-        Ts      = interpolate_coarse(weights, xyz_Ts[z]);    
-        tss     = interpolate_coarse(weights, xyz_tss[z]);
-        tsd     = interpolate_coarse(weights, xyz_tsd[z]);
-        tvs     = interpolate_coarse(weights, xyz_tvs[z]);
-        tvd     = interpolate_coarse(weights, xyz_tvd[z]);
-        s       = interpolate_coarse(weights, xyz_s[z]); 
-        rho_p   = interpolate_coarse(weights, xyz_rho_p[z]); 
-        tss_sw2 = interpolate_coarse(weights, xyz_tss[z]);
-        tsd_sw2 = interpolate_coarse(weights, xyz_tsd[z]);
-        if (pl2->dobrdf) brdf = interpolate_coarse(weights, xy_brdf); 
-
-        if (Tg_ == NULL){
-          tg = interpolate_coarse(weights, xy_Tg);
-        } else {
-          tg = Tg_[p]/10000.0;
-        }
-
-        // topographic correction factor
         if (pl2->dotopo){
-
           sky = sky_[p]/10000.0;
           ill = ill_[p]/10000.0;
           cf  = cf_[p]/10000.0;
-
           if (ill > 0){
-
             szen = interpolate_coarse(weights, xy_sz); 
             ms   = cos(szen);
-            Tso  = interpolate_coarse(weights, xy_Tso); 
-            Tvo  = interpolate_coarse(weights, xy_Tvo); 
-            E0_ = atc->E0[b] * Tvo*Tso;
-            f  = E0_*tss/(E0_*tsd);
-            f0 = E0_*tss_sw2/(E0_*tsd_sw2);
-            h0 = (M_PI+2*szen)/(2.0*M_PI);
+            h0   = (M_PI+2*szen)/(2.0*M_PI);
+          }
+        }
 
-            A = (ms+cf/f0*f/h0)/(ill+sky*cf/f0*f/h0);
-            if (A < 0) A = -10000.0;
+        // water vapor was estimated for blocks of 6x6 pixels
+        if (wvp_ != NULL){
+          pw = (i/6*6)*nx + j/6*6;
+          g  = convert_brick_ji2p(WVP, atc->xy_view, i/6*6, j/6*6);
+          wvalid = !fequal(xy_mv[g], wnodata);
+          wvp = wvp_[pw];
+          wms = xy_ms[g];
+          wmv = xy_mv[g];
+        }
 
-          } else A = 1.0;
+      }
 
-        }
 
-        if (pl2->doenv){
+      for (k=0, off=false; k<nk; k++){
 
-            // target reflectance
-            bck = bck_[p]/10000.0;
-            tmp = (1-bck*s);
+        toa = band[k].toa[p]/10000.0;
 
-            ref = A * brdf * 
-                (toa/tg*tmp - rho_p*tmp - Ts*tvs*bck) / (Ts*tvd);
+        if (pl2->doatmo){
 
-        } else {
+          // smooth atc variables, only the ones that are needed below
+          s       = interpolate_coarse(weights, band[k].s[z]); 
+          rho_p   = interpolate_coarse(weights, band[k].rho_p[z]); 
+          if (pl2->dobrdf) brdf = interpolate_coarse(weights, band[k].brdf); 
 
-          // homogeneous target reflectance
-          tmp = (toa-rho_p)/tg;
-          ref = A * brdf * tmp / (T + s*tmp);
+          if (band[k].tg != NULL){
+            tg = band[k].tg[p]/10000.0;
+          } else if (wvp_ != NULL){
+            if (wvalid){
+              tg = gas_transmittance_pixel(band[k].b, wvp, wms, wmv, 
+                     band[k].Tso[g], band[k].Tvo[g])/10000.0;
+            } else tg = 0;
+          } else {
+            tg = interpolate_coarse(weights, band[k].Tg);
+          }
 
-          //printf("toa: %.2f, rho_p: %.4f, tg: %.4f, A: %.2f, brdf: %.2f, T: %.4f, s: %.4f\n", toa, rho_p, tg, A, brdf, T, s);
+          // topographic correction factor
+          if (pl2->dotopo){
 
-        }
+            if (ill > 0){
 
+              tss     = interpolate_coarse(weights, band[k].tss[z]);
+              tsd     = interpolate_coarse(weights, band[k].tsd[z]);
+              tss_sw2 = interpolate_coarse(weights, band[k].tss[z]);
+              tsd_sw2 = interpolate_coarse(weights, band[k].tsd[z]);
+              Tso  = interpolate_coarse(weights, band[k].Tso); 
+              Tvo  = interpolate_coarse(weights, band[k].Tvo); 
+              E0_ = band[k].E0 * Tvo*Tso;
+              f  = E0_*tss/(E0_*tsd);
+              f0 = E0_*tss_sw2/(E0_*tsd_sw2);
 
-      } else {
+              A = (ms+cf/f0*f/h0)/(ill+sky*cf/f0*f/h0);
+              if (A < 0) A = -10000.0;
 
-        // top-of-atmosphere
-        ref = toa;
+            } else A = 1.0;
 
-      }
+          }
 
+          if (pl2->doenv){
 
-      if (ref < 0.0) set_subzero(QAI,    p, true);
-      if (ref > 1.0) set_saturation(QAI, p, true);
+              // target reflectance
+              Ts  = interpolate_coarse(weights, band[k].Ts[z]);    
+              tvs = interpolate_coarse(weights, band[k].tvs[z]);
+              tvd = interpolate_coarse(weights, band[k].tvd[z]);
+              bck = band[k].bck[p]/10000.0;
+              tmp = (1-bck*s);
+
+              ref = A * brdf * 
+                  (toa/tg*tmp - rho_p*tmp - Ts*tvs*bck) / (Ts*tvd);
+
+          } else {
+
+            // homogeneous target reflectance
+            T   = interpolate_coarse(weights, band[k].T[z]);
+            tmp = (toa-rho_p)/tg;
+            ref = A * brdf * tmp / (T + s*tmp);
+
+          }
+
+
+        } else {
+
+          // top-of-atmosphere
+          ref = toa;
+
+        }
+
+
+        if (ref < 0.0) set_subzero(QAI,    p, true);
+        if (ref > 1.0) set_saturation(QAI, p, true);
+
+        if (pl2->erase_cloud && get_cloud(QAI, p) == 2){
+          band[k].boa[p] = nodata;
+        } else if (ref < -1.0){
+          set_off(QAI, p, true);
+          off = true;
+          break;
+        } else if (ref*10000.0 > SHRT_MAX){
+          band[k].boa[p] = (short)SHRT_MAX;
+        } else {
+          band[k].boa[p] = (short)(ref*10000.0);
+        }
 
-      if (pl2->erase_cloud && get_cloud(QAI, p) == 2){
-        boa_[p] = nodata;
-      } else if (ref < -1.0){
-        boa_[p] = nodata;
-        set_off(QAI, p, true);
-      } else if (ref*10000.0 > SHRT_MAX){
-        boa_[p] = (short)SHRT_MAX;
-      } else {
-        boa_[p] = (short)(ref*10000.0);
+      }
+
+      // pixel was invalidated, nodata in all bands
+      if (off){
+        for (k=0; k<nk; k++) band[k].boa[p] = nodata;
       }
 
     }
@@ -368,16 +607,17 @@ float **xyz_tsd_sw2 = NULL;
     
   }
 
-  free((void*)xyz_T);
-  free((void*)xyz_Ts);
-  free((void*)xyz_tss);
-  free((void*)xyz_tsd);
-  free((void*)xyz_tvs);
-  free((void*)xyz_tvd);
-  free((void*)xyz_s);
-  free((void*)xyz_rho_p);
-  free((void*)xyz_tss_sw2);
-  free((void*)xyz_tsd_sw2);
+  for (k=0; k<nk; k++){
+    free((void*)band[k].T);
+    free((void*)band[k].Ts);
+    free((void*)band[k].tss);
+    free((void*)band[k].tsd);
+    free((void*)band[k].tvs);
+    free((void*)band[k].tvd);
+    free((void*)band[k].s);
+    free((void*)band[k].rho_p);
+  }
+  free((void*)band);
 
   
   #ifdef FORCE_CLOCK
@@ -1007,11 +1247,12 @@ small  *dem_     = NULL;
 short  *ill_     = NULL;
 ushort *sky_     = NULL;
 ushort *cf_      = NULL;
-short  *bck_     = NULL;
-short  *Tg_      = NULL;
+short  **bck_    = NULL;
+short  **Tg_     = NULL;
 short  *toa_     = NULL;
-short  *boa_     = NULL;
 short  **boa__   = NULL;
+float   *xy_vz   = NULL;
+igrid_t grid;
 
 brick_t *BOA = TOA;
 
@@ -1042,50 +1283,78 @@ brick_t *BOA = TOA;
   #endif
 
 
+  // the interpolation weights are the same for all bands
+  if ((xy_vz = get_band_float(atc->xy_view, ZEN)) == NULL) return NULL;
+  init_interpolation_grid(&grid, get_brick_ncols(QAI), get_brick_nrows(QAI), get_brick_res(QAI),
+    get_brick_ncols(atc->xy_view), get_brick_nrows(atc->xy_view), get_brick_res(atc->xy_view),
+    xy_vz, get_brick_nodata(atc->xy_view, ZEN));
+
+
+  // gaseous transmittance is estimated from the water vapor map
+  if (!pl2->doatmo || mission != SENTINEL2) WVP = NULL;
+
+
   // final radiometric processing and band reordering
-  for (b_=0; b_<nb_; b_++){
+  if (pl2->doatmo && pl2->doenv){
 
-    if ((b = bands[b_]) < 0) continue;
+    // the background reflectance needs the complete band, do one band at a time
+    alloc((void**)&bck_, nb_, sizeof(short*));
+    alloc((void**)&Tg_,  nb_, sizeof(short*));
 
-    if ((toa_ = get_band_short(BOA, b))  == NULL) return NULL;
-    if ((boa_ = get_band_short(BOA, b_)) == NULL) return NULL;
+    for (b_=0; b_<nb_; b_++){
 
-    if (pl2->doatmo && mission == SENTINEL2){
-      if ((Tg_ = gas_transmittance(atc, b, WVP, QAI)) == NULL){
-      printf("error in gas transmittance.\n"); return NULL;}
-    } else Tg_ = NULL;
-  
-    if (pl2->doatmo && pl2->doenv){
-      if ((bck_ = background_reflectance(atc, b, toa_, Tg_, dem_, QAI)) == NULL){
+      b = bands[b_];
+
+      if ((toa_ = get_band_short(BOA, b)) == NULL) return NULL;
+
+      if (WVP != NULL){
+        if ((Tg_[b_] = gas_transmittance(atc, b, WVP, QAI)) == NULL){
+        printf("error in gas transmittance.\n"); return NULL;}
+      }
+
+      if ((bck_[b_] = background_reflectance(atc, b, toa_, Tg_[b_], dem_, QAI)) == NULL){
       printf("error in background reflectance.\n"); return NULL;}
-    } else bck_ = NULL;
- 
-    if (surface_reflectance(pl2, atc, b, bck_, toa_, Tg_, boa_, dem_, ill_, sky_, cf_, QAI) == FAILURE){
-    printf("error in surface reflectance.\n"); return NULL;}
 
-    set_brick_wavelength(BOA, b_, get_brick_wavelength(BOA, b));
-    get_brick_domain(BOA,   b, domain,   NPOW_10); set_brick_domain(BOA,   b_, domain);
-    get_brick_bandname(BOA, b, bandname, NPOW_10); set_brick_bandname(BOA, b_, bandname);
+      if (surface_reflectance(pl2, atc, &grid, bands, b_, b_+1, bck_, Tg_, NULL, BOA, dem_, ill_, sky_, cf_, QAI) == FAILURE){
+      printf("error in surface reflectance.\n"); return NULL;}
 
-    if (Tg_ != NULL) free((void*)Tg_);  
-    Tg_ = NULL;
-    if (bck_ != NULL) free((void*)bck_); 
-    bck_ = NULL;
+      if (Tg_[b_] != NULL) free((void*)Tg_[b_]);  
+      free((void*)bck_[b_]);
 
-  }
+    }
 
+    free((void*)bck_);
+    free((void*)Tg_);
 
-  // force nodata in all bands
-  if ((boa__ = get_bands_short(BOA)) == NULL) return NULL;
-  
-  #pragma omp parallel private(b_) shared(nc, nb_, QAI, boa__, nodata) default(none) 
-  {
-    #pragma omp for schedule(guided)
-    for (p=0; p<nc; p++){
-      if (get_off(QAI, p)){
-        for (b_=0; b_<nb_; b_++) boa__[b_][p] = nodata;
+
+    // force nodata in all bands
+    if ((boa__ = get_bands_short(BOA)) == NULL) return NULL;
+    
+    #pragma omp parallel private(b_) shared(nc, nb_, QAI, boa__, nodata) default(none) 
+    {
+      #pragma omp for schedule(guided)
+      for (p=0; p<nc; p++){
+        if (get_off(QAI, p)){
+          for (b_=0; b_<nb_; b_++) boa__[b_][p] = nodata;
+        }
       }
     }
+
+  } else {
+
+    // all bands in one pass, gaseous transmittance is computed on the fly
+    if (surface_reflectance(pl2, atc, &grid, bands, 0, nb_, NULL, NULL, WVP, BOA, dem_, ill_, sky_, cf_, QAI) == FAILURE){
+    printf("error in surface reflectance.\n"); return NULL;}
+
+  }
+
+  free_interpolation_grid(&grid);
+
+  for (b_=0; b_<nb_; b_++){
+    b = bands[b_];
+    set_brick_wavelength(BOA, b_, get_brick_wavelength(BOA, b));
+    get_brick_domain(BOA,   b, domain,   NPOW_10); set_brick_domain(BOA,   b_, domain);
+    get_brick_bandname(BOA, b, bandname, NPOW_10); set_brick_bandname(BOA, b_, bandname);
   }
 
 
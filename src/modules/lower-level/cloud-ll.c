@@ -765,6 +765,7 @@ int nthr;
 int err = 0;
 float res;
 float maxdist;
+int maxdist_pix;
 short bck;
 float lo = 0.175;
 short *spr_  = NULL;
@@ -791,9 +792,10 @@ char domains[2][NPOW_10] = { "NIR", "SWIR1" };
   
   // compute shadow probability only for pixels that 
   // are close enough to clouds
-  if ((dist_ = dist_transform_(cld_, nx, ny)) == NULL){
-    printf("distance transform failed.\n"); return FAILURE;}
   maxdist = 12000 * tan(acos(atc->cosszen[0]))/res;
+  if (maxdist < USHRT_MAX) maxdist_pix = (int)maxdist+1; else maxdist_pix = 0;
+  if ((dist_ = truncated_dist_transform_(cld_, nx, ny, maxdist_pix)) == NULL){
+    printf("distance transform failed.\n"); return FAILURE;}
 
   #ifdef FORCE_DEBUG
   printf("maximum distance for cloud shadows: %.0f", maxdist);
@@ -1887,9 +1889,10 @@ ushort *DIST_PIX = NULL;
     }
   }
 
-  /** compute pixel distance **/
+  /** compute pixel distance, truncated at the distance that 
+  +++ exceeds the maximum distance in meters **/
   if (k > 0){
-    DIST_PIX = dist_transform_(TO_DIST, nx, ny);
+    DIST_PIX = truncated_dist_transform_(TO_DIST, nx, ny, (int)(SHRT_MAX/res)+1);
   } else {
     alloc((void**)&DIST_PIX, nc, sizeof(ushort));
     for (p=0; p<nc; p++) DIST_PIX[p] = ny+nx;
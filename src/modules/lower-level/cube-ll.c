@@ -28,13 +28,87 @@ This file contains functions that define the datacubes
 #include "cube-ll.h"
 
 
+#define CUBE_MEMORY 0.5 // fraction of available memory for the chips of all threads
+
+
+int chip_level2(brick_t *LEVEL2, brick_t *CUBED, int istart, int jstart, int *i0, int *i1, int *j0, int *j1);
 int tile_level2(par_ll_t *pl2, cube_t *cube, brick_t **LEVEL2, int nprod);
 int flush_level2(par_ll_t *pl2, meta_t *meta, brick_t **LEVEL2, int nprod);
 multicube_t *start_datacube(par_ll_t *pl2, brick_t *brick);
 
 
+/** This function copies the part of an image that intersects with a chip
++++ into the chip. The intersection is copied row by row, the remaining 
++++ chip pixels are set to nodata.
+--- LEVEL2: L2 brick
+--- CUBED:  chip brick
+--- istart: image row    of the first chip row
+--- jstart: image column of the first chip column
+--- i0:     first chip row    that intersects with the image (returned)
+--- i1:     last  chip row    that intersects with the image (exclusive, returned)
+--- j0:     first chip column that intersects with the image (returned)
+--- j1:     last  chip column that intersects with the image (exclusive, returned)
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int chip_level2(brick_t *LEVEL2, brick_t *CUBED, int istart, int jstart, int *i0, int *i1, int *j0, int *j1){
+int i, j, b, nb, nx, ny, cube_nx, cube_ny;
+short nodata;
+short **level2_ = NULL;
+short **cubed_  = NULL;
+short *chip_ = NULL;
+
+
+  nb = get_brick_nbands(LEVEL2);
+  nx = get_brick_ncols(LEVEL2);
+  ny = get_brick_nrows(LEVEL2);
+  cube_nx = get_brick_ncols(CUBED);
+  cube_ny = get_brick_nrows(CUBED);
+
+  if ((level2_ = get_bands_short(LEVEL2)) == NULL) return FAILURE;
+  if ((cubed_  = get_bands_short(CUBED))  == NULL) return FAILURE;
+
+  // intersection of chip and image in chip coordinates
+  *i0 = (istart < 0) ? -istart : 0;
+  *j0 = (jstart < 0) ? -jstart : 0;
+  *i1 = (ny-istart < cube_ny) ? ny-istart : cube_ny;
+  *j1 = (nx-jstart < cube_nx) ? nx-jstart : cube_nx;
+  if (*i1 < *i0) *i1 = *i0;
+  if (*j1 < *j0) *j1 = *j0;
+
+  for (b=0; b<nb; b++){
+
+    nodata = get_brick_nodata(LEVEL2, b);
+
+    for (i=0; i<cube_ny; i++){
+
+      chip_ = cubed_[b] + (size_t)i*cube_nx;
+
+      if (i < *i0 || i >= *i1 || *j0 == *j1){
+        for (j=0; j<cube_nx; j++) chip_[j] = nodata;
+        continue;
+      }
+
+      for (j=0; j<*j0; j++) chip_[j] = nodata;
+
+      memcpy(chip_ + *j0, level2_[b] + (size_t)(i+istart)*nx + *j0+jstart, 
+        (*j1-*j0)*sizeof(short));
+
+      for (j=*j1; j<cube_nx; j++) chip_[j] = nodata;
+
+    }
+
+  }
+
+  return SUCCESS;
+}
+
+
 /** This function tiles the image, computes tile cloud coverage and writes
-+++ gridded images to disc.
++++ gridded images to disc. The tiles are processed in parallel, each 
++++ thread cuts and writes its own tile, i.e. writing (and compressing) 
++++ one tile overlaps with cutting and writing the others. Each thread 
++++ holds one chip of every product, thus the number of threads is 
++++ reduced if the chips would not fit into the available memory.
 --- pl2:    L2 parameters
 --- cube:   data cube parameters
 --- LEVEL2: L2 brick
@@ -42,27 +116,30 @@ multicube_t *start_datacube(par_ll_t *pl2, brick_t *brick);
 +++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 int tile_level2(par_ll_t *pl2, cube_t *cube, brick_t **LEVEL2, int nprod){
-int i, j, p, np, nx, ny, b, nb, prod;
+int i, j, p, t, nt, nb, prod;
 char dname[NPOW_10];
 int nchar;
 double geotran[6];
+double tgeotran[6];
 int tx, ty;  // tile id
 double tulx, tuly; // ul of tile
 double ulx, uly; // ul of image
 int istart, jstart; // image-to-chip offset
+int i0, i1, j0, j1; // intersection of image and chip
 int ntile = 0; // number of written tiles
 int *tiles_x = NULL;
 int *tiles_y = NULL;
 int  tiles_k;
+int *tx_ = NULL;
+int *ty_ = NULL;
+int nthread, nthread_mem;
+size_t chip_bytes = 0, mem;
 int err = 0;
 bool empty;
-short nodata;
 brick_t **CUBED   = NULL;
-short   **level2_ = NULL;
-short   **cubed_  = NULL;
 double ncld, ndata; // cloud cover
 double scale, res;
-int cube_nx, cube_ny, cube_nc;
+int cube_nx;
 
 
   #ifdef FORCE_CLOCK
@@ -78,151 +155,167 @@ int cube_nx, cube_ny, cube_nc;
   get_brick_geotran(LEVEL2[0], geotran, 6);
   ulx = get_brick_ulx(LEVEL2[0]);
   uly = get_brick_uly(LEVEL2[0]);
-  
 
 
-  // intersect the image with the tile grid
+  // tiles that intersect with the image (and are allowlisted, if specified)
+  alloc((void**)&tx_, cube->tnx*cube->tny, sizeof(int));
+  alloc((void**)&ty_, cube->tnx*cube->tny, sizeof(int));
 
-  // initialize smaller cubed products
-  alloc((void**)&CUBED, nprod, sizeof(brick_t*));
+  for (ty=cube->tminy, nt=0; ty<=cube->tmaxy; ty++){
+  for (tx=cube->tminx; tx<=cube->tmaxx; tx++){
+    if (tile_allowlisted(tiles_x, tiles_y, tiles_k, tx, ty) == FAILURE) continue;
+    tx_[nt] = tx;
+    ty_[nt] = ty;
+    nt++;
+  }
+  }
 
-  for (prod=0; prod<(nprod); prod++){
-    nb = get_brick_nbands(LEVEL2[prod]);
-    res = get_brick_res(LEVEL2[prod]);
-    scale = cube->res/res;
-    CUBED[prod] = copy_brick(LEVEL2[prod], nb, _DT_NONE_);
-    set_brick_geotran(CUBED[prod], geotran);
-    set_brick_ncols(CUBED[prod], (int)(cube->nx*scale));
-    set_brick_nrows(CUBED[prod], (int)(cube->ny*scale));
-    set_brick_chunkncols(CUBED[prod], (int)(cube->cx*scale));
-    set_brick_chunknrows(CUBED[prod], (int)(cube->cy*scale));
-    allocate_brick_bands(CUBED[prod], nb, (int)(cube->nc*scale), _DT_SHORT_);
+  nthread = (nt < pl2->nthread) ? nt : pl2->nthread;
+
+  // memory of one set of chips
+  for (prod=0; prod<nprod; prod++){
+    scale = cube->res/get_brick_res(LEVEL2[prod]);
+    chip_bytes += (size_t)get_brick_nbands(LEVEL2[prod]) * 
+                  (size_t)(cube->nc*scale) * sizeof(short);
   }
 
+  if ((mem = available_memory()) > 0 && chip_bytes > 0){
+    nthread_mem = (int)(mem*CUBE_MEMORY / chip_bytes);
+    if (nthread_mem < nthread) nthread = nthread_mem;
+  }
 
-//    #pragma omp for collapse(2) schedule(guided)
-  for (ty=cube->tminy; ty<=cube->tmaxy; ty++){
-  for (tx=cube->tminx; tx<=cube->tmaxx; tx++){
+  if (nthread < 1) nthread = 1;
 
-    // if tile is not allowlisted (if specified), skip
-    if (tile_allowlisted(tiles_x, tiles_y, tiles_k, tx, ty) == FAILURE) continue;
 
-    // upper left coordinate of current tile
-    tulx = cube->origin_map.x + tx*cube->tilesize;
-    tuly = cube->origin_map.y - ty*cube->tilesize;
+  #pragma omp parallel num_threads(nthread) private(i, j, p, t, nb, prod, dname, nchar, tgeotran, tx, ty, tulx, tuly, istart, jstart, i0, i1, j0, j1, empty, CUBED, ncld, ndata, scale, res, cube_nx) shared(nt, tx_, ty_, nprod, LEVEL2, cube, geotran, ulx, uly, pl2) reduction(+: err, ntile) default(none)
+  {
 
-    
-    empty = true;
-    ndata = ncld = 0.0;
+    // initialize smaller cubed products, one set per thread
+    alloc((void**)&CUBED, nprod, sizeof(brick_t*));
 
-    // copy to cubed products
     for (prod=0; prod<nprod; prod++){
-      
-      if (prod > 0 && empty) break;
-
       nb = get_brick_nbands(LEVEL2[prod]);
-      nx  = get_brick_ncols(LEVEL2[prod]);
-      ny  = get_brick_nrows(LEVEL2[prod]);
       res = get_brick_res(LEVEL2[prod]);
       scale = cube->res/res;
-      cube_nx = (int)(cube->nx*scale);
-      cube_ny = (int)(cube->ny*scale);
-      cube_nc = (int)(cube->nc*scale);
-
-      // image offset relative to current tile
-      jstart = floor((tulx-ulx)/res); // changed from round to floor
-      istart = floor((uly-tuly)/res); // changed from round to floor
-      
-      #ifdef FORCE_DEBUG
-      printf("ul: %f/%f, offset: %d/%d\n", tulx, tuly, jstart, istart);
-      #endif
-      
-      if ((level2_ = get_bands_short(LEVEL2[prod])) == NULL){ err++; continue;}
-      if ((cubed_  = get_bands_short(CUBED[prod]))  == NULL){ err++; continue;}
+      CUBED[prod] = copy_brick(LEVEL2[prod], nb, _DT_NONE_);
+      set_brick_geotran(CUBED[prod], geotran);
+      set_brick_ncols(CUBED[prod], (int)(cube->nx*scale));
+      set_brick_nrows(CUBED[prod], (int)(cube->ny*scale));
+      set_brick_chunkncols(CUBED[prod], (int)(cube->cx*scale));
+      set_brick_chunknrows(CUBED[prod], (int)(cube->cy*scale));
+      allocate_brick_bands(CUBED[prod], nb, (int)(cube->nc*scale), _DT_SHORT_);
+    }
 
-      // init with nodata
-      for (b=0; b<nb; b++){
-        nodata = get_brick_nodata(LEVEL2[prod], b);
-        for (p=0; p<cube_nc; p++) cubed_[b][p] = nodata;
-      }
+    memcpy(tgeotran, geotran, 6*sizeof(double));
 
-      // copy image to chip + compute tile cloud cover
-      for (i=0, p=0; i<cube_ny; i++){
-      for (j=0; j<cube_nx; j++, p++){
 
-        np  = nx*(i+istart) + j+jstart; // image
-        p = cube_nx*i+j;               // chip
+    #pragma omp for schedule(dynamic)
+    for (t=0; t<nt; t++){
 
-        if (i+istart < 0 || i+istart >= ny || 
-            j+jstart < 0 || j+jstart >= nx) continue;
+      tx = tx_[t];
+      ty = ty_[t];
 
-        for (b=0; b<nb; b++) cubed_[b][p] = level2_[b][np];
+      // upper left coordinate of current tile
+      tulx = cube->origin_map.x + tx*cube->tilesize;
+      tuly = cube->origin_map.y - ty*cube->tilesize;
 
-        // count valid and cloudy pixels
+      
+      empty = true;
+      ndata = ncld = 0.0;
+
+      // copy to cubed products
+      for (prod=0; prod<nprod; prod++){
+        
+        if (prod > 0 && empty) break;
+
+        res = get_brick_res(LEVEL2[prod]);
+        scale = cube->res/res;
+        cube_nx = (int)(cube->nx*scale);
+
+        // image offset relative to current tile
+        jstart = floor((tulx-ulx)/res); // changed from round to floor
+        istart = floor((uly-tuly)/res); // changed from round to floor
+        
+        #ifdef FORCE_DEBUG
+        printf("ul: %f/%f, offset: %d/%d\n", tulx, tuly, jstart, istart);
+        #endif
+
+        // copy image to chip
+        if (chip_level2(LEVEL2[prod], CUBED[prod], istart, jstart, &i0, &i1, &j0, &j1) == FAILURE){
+          err++; continue;}
+
+        // compute tile cloud cover
         if (prod == 0){
 
-          if (get_off(CUBED[prod], p)) continue;
-          
-          if (get_cloud(CUBED[prod], p) > 0 || get_shadow(CUBED[prod], p)) ncld++;
-          ndata++;
-          empty = false;
+          for (i=i0; i<i1; i++){
+          for (j=j0, p=cube_nx*i+j0; j<j1; j++, p++){
 
-        }
+            if (get_off(CUBED[prod], p)) continue;
+            
+            if (get_cloud(CUBED[prod], p) > 0 || get_shadow(CUBED[prod], p)) ncld++;
+            ndata++;
+            empty = false;
 
+          }
+          }
+
+        }
+        
       }
-      }
-      
-    }
 
 
-    // meteor cover of tile
-    if (ndata > 0) ncld = ncld/ndata*100.0;
+      // meteor cover of tile
+      if (ndata > 0) ncld = ncld/ndata*100.0;
 
 
-    #ifdef FORCE_DEBUG
-    printf("tile X%04d_Y%04d: empty: %d, cloud cover: %03.0f%%\n", 
-      tx, ty, empty, ncld);
-    #endif
+      #ifdef FORCE_DEBUG
+      printf("tile X%04d_Y%04d: empty: %d, cloud cover: %03.0f%%\n", 
+        tx, ty, empty, ncld);
+      #endif
 
-    if (ncld > pl2->maxtc) empty = true;
+      if (ncld > pl2->maxtc) empty = true;
 
 
-    // if there are data in tile -> output
-    if (!empty){
+      // if there are data in tile -> output
+      if (!empty){
 
-      geotran[0] = tulx;
-      geotran[3] = tuly;
+        tgeotran[0] = tulx;
+        tgeotran[3] = tuly;
 
-      nchar = snprintf(dname, NPOW_10, "%s/X%04d_Y%04d", cube->dname, tx, ty);
-      if (nchar < 0 || nchar >= NPOW_10){ 
-        printf("Buffer Overflow in assembling dirname\n"); return FAILURE;}
+        nchar = snprintf(dname, NPOW_10, "%s/X%04d_Y%04d", cube->dname, tx, ty);
+        if (nchar < 0 || nchar >= NPOW_10){ 
+          printf("Buffer Overflow in assembling dirname\n"); err++; continue;}
 
-      for (prod=0; prod<(nprod); prod++){
-        set_brick_geotran(CUBED[prod], geotran);
-        set_brick_dirname(CUBED[prod], dname);
-        set_brick_provdir(CUBED[prod], pl2->d_prov);
-        if (write_brick(CUBED[prod]) == FAILURE){ err++; continue;}
-      }
+        for (prod=0; prod<(nprod); prod++){
+          set_brick_geotran(CUBED[prod], tgeotran);
+          set_brick_dirname(CUBED[prod], dname);
+          set_brick_provdir(CUBED[prod], pl2->d_prov);
+          if (write_brick(CUBED[prod]) == FAILURE){ err++; continue;}
+        }
+
+        ntile++;
 
-      ntile++;
+      }
 
     }
 
-  }
+
+    for (prod=0; prod<nprod; prod++) free_brick(CUBED[prod]);
+    free((void*)CUBED);
+
   }
   
 
+  // clean
+  free((void*)tiles_x); free((void*)tiles_y);
+  free((void*)tx_); free((void*)ty_);
+
   if (err > 0){
     printf("error in cubing Level 2 products\n"); return FAILURE;}
   
   // print to stdout for logfile
   printf("%2d product(s) written. ", ntile);
 
-  // clean
-  free((void*)tiles_x); free((void*)tiles_y);
-  for (prod=0; prod<nprod; prod++) free_brick(CUBED[prod]);
-  free((void*)CUBED);
-
 
   #ifdef FORCE_CLOCK
   proctime_print("tiling output brick", TIME);
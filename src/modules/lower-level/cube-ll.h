@@ -30,11 +30,13 @@ Datacube header
 
 #include <stdio.h>   // core input and output functions
 #include <stdlib.h>  // standard general utilities library
+#include <string.h>  // string handling functions
 
 #include "../cross-level/string-cl.h"
 #include "../cross-level/cube-cl.h"
 #include "../cross-level/tile-cl.h"
 #include "../cross-level/brick-cl.h"
+#include "../cross-level/sys-cl.h"
 #include "../cross-level/quality-cl.h"
 #include "../lower-level/param-ll.h"
 #include "../lower-level/meta-ll.h"
@@ -27,12 +27,12 @@ This file contains functions for handling Atmospheric Gas
 
 #include "gas-ll.h"
 
-/** GNU Scientific Library (GSL) **/
-#include <gsl/gsl_multimin.h>          // minimization functions 
-
 
 wvp_lut_t _WVLUT_;
 
+float wvp_difference(int kw, int kms, int kmv, float *p);
+float invert_wvp(float *p);
+
 
 /** This function computes a water vapor transmittace look-up-table, which
 +++ is used for fast estimation of Sentinel-2 water vapor. The function 
@@ -110,80 +110,90 @@ int nw = 701;
 }
 
 
-/** This minimizer function computes BOA reflectance for the reference and
-+++ measurement channels and returns the absolute residual.
---- v:      current water vapor estimate
---- params: parameters used for minimization
-+++ Return: Absolute residual of BOA reflectance (reference - measurement)
+/** This function computes BOA reflectance for the reference and measure-
++++ ment channels for one tabulated water vapor value, and returns their
++++ difference.
+--- kw:     index of tabulated water vapor (0.01 steps)
+--- kms:    index of tabulated sun air mass
+--- kmv:    index of tabulated view air mass
+--- p:      parameters, see water_vapor
++++ Return: Difference of BOA reflectance (reference - measurement)
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-double fun_wvp(const gsl_vector *v, void *params){
-float *p = (float *)params;
-float w;
+float wvp_difference(int kw, int kms, int kmv, float *p){
 float nir, wvp;
-int b_nir, b_wvp, b_nir_rsr, b_wvp_rsr;
-float ms, mv, To_nir, To_wvp, rho_p_nir, rho_p_wvp;
+int b_nir, b_wvp;
+float To_nir, To_wvp, rho_p_nir, rho_p_wvp;
 float T_nir, T_wvp, s_nir, s_wvp;
-float Tsw_nir, Tvw_nir, Tsw_wvp, Tvw_wvp, Tg_nir, Tg_wvp;
+float Tg_nir, Tg_wvp;
 float tmp, sr_reference, sr_measure;
-int kms, kmv, kw;
 
 
-  w = gsl_vector_get(v, 0);
-
   nir       = p[0];
   wvp       = p[1];
   b_nir     = (int)p[2];
   b_wvp     = (int)p[3];
-  b_nir_rsr = (int)p[4];
-  b_wvp_rsr = (int)p[5];
-  ms        = p[6];
-  mv        = p[7];
-  To_nir    = p[8];
-  To_wvp    = p[9];
-  rho_p_nir = p[10];
-  rho_p_wvp = p[11];
-  T_nir     = p[12];
-  T_wvp     = p[13];
-  s_nir     = p[14];
-  s_wvp     = p[15];
-
-
-  // negative water vapor values are not allowed
-  if (w < 0.0) w = 0.0;
-
-  // if water vapor > tabulated values, compute
-  if (w > 7.0){
-
-    Tsw_nir = wvp_transmitt(w, ms, b_nir_rsr);
-    Tvw_nir = wvp_transmitt(w, mv, b_nir_rsr);
-    Tsw_wvp = wvp_transmitt(w, ms, b_wvp_rsr);
-    Tvw_wvp = wvp_transmitt(w, mv, b_wvp_rsr);
-
-  // use tabulated values
-  } else {
+  To_nir    = p[6];
+  To_wvp    = p[7];
+  rho_p_nir = p[8];
+  rho_p_wvp = p[9];
+  T_nir     = p[10];
+  T_wvp     = p[11];
+  s_nir     = p[12];
+  s_wvp     = p[13];
+
+  Tg_nir  = _WVLUT_.val[b_nir][kw][kms]*_WVLUT_.val[b_nir][kw][kmv]*To_nir;
+  Tg_wvp  = _WVLUT_.val[b_wvp][kw][kms]*_WVLUT_.val[b_wvp][kw][kmv]*To_wvp;
 
-    kw =  (int)floor(w/0.01);
-    kms = (int)floor(ms/0.01);
-    kmv = (int)floor(mv/0.01);
+  tmp = (nir-rho_p_nir)/Tg_nir;
+  sr_reference = tmp / (T_nir + s_nir*tmp);
 
-    Tsw_nir = _WVLUT_.val[b_nir][kw][kms];
-    Tvw_nir = _WVLUT_.val[b_nir][kw][kmv];
-    Tsw_wvp = _WVLUT_.val[b_wvp][kw][kms];
-    Tvw_wvp = _WVLUT_.val[b_wvp][kw][kmv];
+  tmp = (wvp-rho_p_wvp)/Tg_wvp;
+  sr_measure = tmp / (T_wvp + s_wvp*tmp);
 
-  }
+  return sr_reference-sr_measure;
+}
 
 
-  Tg_nir  = Tsw_nir*Tvw_nir*To_nir;
-  Tg_wvp  = Tsw_wvp*Tvw_wvp*To_wvp;
+/** This function inverts the radiative transfer for water vapor, i.e. it
++++ finds the water vapor, for which BOA reflectance of the reference and
++++ measurement channels is equal. The difference changes monotonically
++++ with water vapor, thus the sign change is found by bisection of the
++++ tabulated values, and the water vapor is interpolated linearly be-
++++ tween the bracketing values.
+--- p:      parameters, see water_vapor
++++ Return: Water vapor, or -1 if there is no solution within the table
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+float invert_wvp(float *p){
+int kms, kmv, lo, hi, mid;
+float d_lo, d_hi, d_mid;
 
-  tmp = (nir-rho_p_nir)/Tg_nir;
-  sr_reference = tmp / (T_nir + s_nir*tmp);
 
-  tmp = (wvp-rho_p_wvp)/Tg_wvp;
-  sr_measure = tmp / (T_wvp + s_wvp*tmp);
+  kms = (int)floor(p[4]/0.01);
+  kmv = (int)floor(p[5]/0.01);
+
+  lo = 0;
+  hi = _WVLUT_.nw-1;
+
+  d_lo = wvp_difference(lo, kms, kmv, p);
+  d_hi = wvp_difference(hi, kms, kmv, p);
+
+  // no sign change, i.e. solution is outside of tabulated values
+  if ((d_lo > 0) == (d_hi > 0) || d_lo == d_hi) return -1;
 
-  return fabs(sr_reference-sr_measure);
+  while (hi-lo > 1){
+
+    mid = (lo+hi)/2;
+    d_mid = wvp_difference(mid, kms, kmv, p);
+
+    if ((d_mid > 0) == (d_lo > 0)){
+      lo = mid; d_lo = d_mid;
+    } else {
+      hi = mid; d_hi = d_mid;
+    }
+
+  }
+
+  return (lo + d_lo/(d_lo-d_hi))*0.01;
 }
 
 
@@ -192,7 +202,8 @@ int kms, kmv, kw;
 +++ allocated in this case. Water vapor is estimated for each 60m pixel
 +++ using the complete radiative transfer assuming that BOA reflectance
 +++ of the NIR reference channel @ 0.865�m and the NIR water vapor channel
-+++ @ 0.945 should be equal. Nelder-Mead Simplex optimization is used.
++++ @ 0.945 should be equal. The radiative transfer is inverted with the
++++ tabulated water vapor transmittance, see invert_wvp.
 +++ Water and shadow pixels will be set to the scene average, and a QAI
 +++ flag is set in this case.
 --- meta:   metadata
@@ -208,14 +219,7 @@ int b_reference, b_measure;
 float reference, measure, dem;
 float w, w_avg;
 double w_sum = 0, num = 0;
-float param[16];
-const gsl_multimin_fminimizer_type *T = NULL;
-gsl_multimin_fminimizer *s = NULL;
-gsl_vector *ss = NULL, *x = NULL;
-gsl_multimin_function minex_func;
-size_t iter;
-int status;
-double size;
+float param[14];
 brick_t *WVP = NULL;
 short  *wvp_ = NULL;
 small  *dem_ = NULL;
@@ -274,29 +278,9 @@ float **xyz_s_m = NULL;
   if ((xyz_s_m     = atc_get_band_reshaped(atc->xyz_s, b_measure))   == NULL) return NULL;
 
 
-  #pragma omp parallel private(j, ii, jj, p, g, reference, measure, dem, z, k, w, x, T, ss, s, minex_func, param, iter, status, size) shared(nx, ny, b_reference, b_measure, toa_, wvp_, dem_, QAI, xy_ms, xy_mv, xy_Tvo_r, xy_Tvo_m, xy_Tso_r, xy_Tso_m, xyz_rho_p_r, xyz_rho_p_m, xyz_T_r, xyz_T_m, xyz_s_r, xyz_s_m, atc, meta, gsl_multimin_fminimizer_nmsimplex2) reduction(+: w_sum, num) default(none)
+  #pragma omp parallel private(j, ii, jj, p, g, reference, measure, dem, z, k, w, param) shared(nx, ny, b_reference, b_measure, toa_, wvp_, dem_, QAI, xy_ms, xy_mv, xy_Tvo_r, xy_Tvo_m, xy_Tso_r, xy_Tso_m, xyz_rho_p_r, xyz_rho_p_m, xyz_T_r, xyz_T_m, xyz_s_r, xyz_s_m, atc) reduction(+: w_sum, num) default(none)
   {
 
-  
-    /** initialize optimizer
-    +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-    
-    w = 3.0;
-
-    // start value, is set to last value in loop
-    x = gsl_vector_alloc(1);
-
-    // initial step size of simplex
-    ss = gsl_vector_alloc(1);
-    gsl_vector_set(ss, 0, 0.25);
-
-    // initialize method and iterate
-    minex_func.n = 1;
-    minex_func.f = fun_wvp;
-    minex_func.params = param;
-    T = gsl_multimin_fminimizer_nmsimplex2;
-    s = gsl_multimin_fminimizer_alloc(T, 1);
-
 
     /**estimate water vapor for each 60m pixel
     +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
@@ -340,48 +324,29 @@ float **xyz_s_m = NULL;
       if (fequal(xy_mv[g], get_brick_nodata(atc->xy_view, cZEN))) continue;
 
 
-      /** copy variables to param, and initialize minimizer
+      /** copy variables to param
       +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
       param[0]  = reference;
       param[1]  = measure;
       param[2]  = b_reference;
       param[3]  = b_measure;
-      param[4]  = meta->cal[b_reference].rsr_band;
-      param[5]  = meta->cal[b_measure].rsr_band;
-      param[6]  = xy_ms[g];
-      param[7]  = xy_mv[g];
-      param[8]  = xy_Tso_r[g]*xy_Tvo_r[g];
-      param[9]  = xy_Tso_m[g]*xy_Tvo_m[g];
-      param[10] = xyz_rho_p_r[z][g];
-      param[11] = xyz_rho_p_m[z][g];
-      param[12] = xyz_T_r[z][g];
-      param[13] = xyz_T_m[z][g];
-      param[14] = xyz_s_r[z][g];
-      param[15] = xyz_s_m[z][g];
-
-      gsl_vector_set(x, 0, w);
-      gsl_multimin_fminimizer_set(s, &minex_func, x, ss);
-
-
-      /** optimize radiative transfer, estimate water vapor
+      param[4]  = xy_ms[g];
+      param[5]  = xy_mv[g];
+      param[6]  = xy_Tso_r[g]*xy_Tvo_r[g];
+      param[7]  = xy_Tso_m[g]*xy_Tvo_m[g];
+      param[8]  = xyz_rho_p_r[z][g];
+      param[9]  = xyz_rho_p_m[z][g];
+      param[10] = xyz_T_r[z][g];
+      param[11] = xyz_T_m[z][g];
+      param[12] = xyz_s_r[z][g];
+      param[13] = xyz_s_m[z][g];
+
+
+      /** invert radiative transfer, estimate water vapor
       +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
-      iter = 0;
-
-      do {
-        iter++;
-        status = gsl_multimin_fminimizer_iterate(s);
-
-        if (status) break;
-
-        size = gsl_multimin_fminimizer_size(s);
-        status = gsl_multimin_test_size(size, 1e-2);
-
-      } while (status == GSL_CONTINUE && iter < 100);
-
-      if ((w = (float)gsl_vector_get(s->x, 0)) > 7 || w <= 0){
-        w = 3; ;continue;}
+      if ((w = invert_wvp(param)) > 7 || w <= 0) continue;
 
       w_sum += w;
       num++;
@@ -404,10 +369,6 @@ float **xyz_s_m = NULL;
     }
     }
 
-    /** clean
-    +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-    gsl_vector_free(x); gsl_vector_free(ss); gsl_multimin_fminimizer_free(s);
-
   }
 
   free((void*)xyz_rho_p_r); free((void*)xyz_rho_p_m);
@@ -466,8 +427,7 @@ float **xyz_s_m = NULL;
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 short *gas_transmittance(atc_t *atc, int b, brick_t *WVP, brick_t *QAI){
 int i, j, ii, jj, p, nx, ny, g;
-int kw, kms, kmv;
-float w, ms, mv, Tsw, Tvw, Tso, Tvo, tg;
+short tg;
 short *wvp_ = NULL;
 short *Tg_  = NULL;
 float *xy_ms = NULL;
@@ -495,7 +455,7 @@ float *xy_Tvo = NULL;
   /**estimate water vapor for each 60m pixel
   +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
-  #pragma omp parallel private(j, p, ii, jj, g, w, kw, ms, mv, kms, kmv, Tsw, Tvw, Tso, Tvo, tg) shared(b, nx, ny, QAI, wvp_, WVP, _WVLUT_, Tg_, xy_ms, xy_mv, xy_Tso, xy_Tvo, atc) default(none) 
+  #pragma omp parallel private(j, p, ii, jj, g, tg) shared(b, nx, ny, QAI, wvp_, WVP, Tg_, xy_ms, xy_mv, xy_Tso, xy_Tvo, atc) default(none) 
   {
 
     #pragma omp for schedule(guided)
@@ -513,19 +473,7 @@ float *xy_Tvo = NULL;
       /** gaseous transmittance
       +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
 
-      w = wvp_[p]/1000.0;
-      kw = (int)floor(w/0.01);
-
-      ms = xy_ms[g];
-      mv = xy_mv[g];
-      kms = (int)floor(ms/0.01);
-      kmv = (int)floor(mv/0.01);
-
-      Tsw = _WVLUT_.val[b][kw][kms];
-      Tvw = _WVLUT_.val[b][kw][kmv];
-      Tso = xy_Tso[g];
-      Tvo = xy_Tvo[g];
-      tg  = gas_transmitt(Tsw, Tvw, Tso, Tvo);
+      tg = gas_transmittance_pixel(b, wvp_[p], xy_ms[g], xy_mv[g], xy_Tso[g], xy_Tvo[g]);
 
 
       /** replicate values at original resolution
@@ -537,7 +485,7 @@ float *xy_Tvo = NULL;
 
         if (get_off(QAI, p)) continue;
 
-        Tg_[p]  = (short)(tg*10000);
+        Tg_[p]  = tg;
 
       }
       }
@@ -555,6 +503,37 @@ float *xy_Tvo = NULL;
 }
 
 
+/** Water vapor estimation
++++ This function computes the gaseous transmittance of one pixel, based 
++++ on the estimated water vapor content. Gaseous Transmittance is scaled
++++ by 10000.
+--- b:      band for which the transmittance is computed
+--- wvp:    water vapor (scaled by 1000)
+--- ms:     cosine of sun zenith
+--- mv:     cosine of view zenith
+--- Tso:    ozone transmittance (sun path)
+--- Tvo:    ozone transmittance (view path)
++++ Return: Gaseous transmittance
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+short gas_transmittance_pixel(int b, short wvp, float ms, float mv, float Tso, float Tvo){
+int kw, kms, kmv;
+float w, Tsw, Tvw, tg;
+
+
+  w = wvp/1000.0;
+  kw = (int)floor(w/0.01);
+
+  kms = (int)floor(ms/0.01);
+  kmv = (int)floor(mv/0.01);
+
+  Tsw = _WVLUT_.val[b][kw][kms];
+  Tvw = _WVLUT_.val[b][kw][kmv];
+  tg  = gas_transmitt(Tsw, Tvw, Tso, Tvo);
+
+  return (short)(tg*10000);
+}
+
+
 /** This function frees the WV LUT global variable
 +++ Return: void
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
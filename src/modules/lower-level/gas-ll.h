@@ -60,6 +60,7 @@ extern wvp_lut_t _WVLUT_;
 int wvp_transmitt_lut(meta_t *meta, atc_t *atc);
 brick_t *water_vapor(meta_t *meta, atc_t *atc, brick_t *TOA, brick_t *QAI, brick_t *DEM);
 short *gas_transmittance(atc_t *atc, int b, brick_t *WVP, brick_t *QAI);
+short gas_transmittance_pixel(int b, short wvp, float ms, float mv, float Tso, float Tvo);
 void free_wvlut();
 float ozone_amount(float lon, float lat, int doy);
 float water_vapor_from_lut(par_ll_t *pl2, atc_t *atc);
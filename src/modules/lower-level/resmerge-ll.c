@@ -49,25 +49,12 @@ This file contains functions to enhance spatial resolution
 #include <gsl/gsl_multifit.h>          // multi-parameter fitting
 
 
-/** StarFM candidate struct
-+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-
-typedef struct {
-  int dx, dy;     // distance
-  float coarse;   // coarse data
-  float fine;     // fine data
-  float r_coarse; // relative difference between two coarse obs.
-  float r_fine;   // relative difference between coarse and fine obs.
-  float C;        // reversed distance
-} starfm_candidate_t;
-
-
 int resolution_merge_1(brick_t *TOA, brick_t *QAI);
 int resolution_merge_2(brick_t *TOA, brick_t *QAI);
 int resolution_merge_3(brick_t *TOA, brick_t *QAI);
 double rescale_weight(double weight, double minweight, double maxweight);
 short **improphe(int nx, int ny, brick_t *QAI, short **toa_, float **KDIST, int h, int nb_m, int nb_c, int *bands_m, int *bands_c, int nk, int mink);
-float *starfm(int nx, int ny, brick_t *QAI, float **coarse, float **fine, int r);
+short **starfm(int nx, int ny, brick_t *QAI, short **toa_, float **coarse, float **fine, int nb, int *bands, int r);
 
 
 /** Sentinel-2 resolution merge option 1
@@ -343,7 +330,7 @@ int nk = 5;
 double sum[2], num;
 float **coarse = NULL;
 float **fine   = NULL;
-float  *pred   = NULL;
+short **pred_  = NULL;
 float **kernel = NULL;
 short **toa_ = NULL;
 
@@ -370,7 +357,7 @@ short **toa_ = NULL;
   if ((bands[b++] = find_domain(TOA, "SWIR1"))    < 0) return FAILURE;
   if ((bands[b++] = find_domain(TOA, "SWIR2"))    < 0) return FAILURE;
 
-  alloc_2D((void***)&coarse, 3, nc, sizeof(float));
+  alloc_2D((void***)&coarse, 2, nc, sizeof(float));
   alloc_2D((void***)&fine,   2, nc, sizeof(float));
 
   for (p=0; p<nc; p++){
@@ -384,8 +371,11 @@ short **toa_ = NULL;
   if (gauss_kernel(nk, 0.5, &kernel) != SUCCESS){
     printf("Could not generate kernel. "); return FAILURE;}
 
-  for (i=0, p=0; i<ny; i++){
-  for (j=0; j<nx; j++, p++){
+  #pragma omp parallel for private(j, p, ii, jj, ni, nj, np, sum, num) shared(nx, ny, nk, green, red, bnir, toa_, kernel, coarse, QAI) default(none)
+  for (i=0; i<ny; i++){
+  for (j=0; j<nx; j++){
+
+    p = i*nx+j;
     
     if (get_off(QAI, p)) continue;
 
@@ -477,26 +467,21 @@ short **toa_ = NULL;
 
   /** Predict at fine resolution **/
 
+  pred_ = starfm(nx, ny, QAI, toa_, coarse, fine, nb, bands, 1);
+
   for (b_=0; b_<nb; b_++){
-    
     b = bands[b_];
-    
-    for (p=0; p<nc; p++) coarse[2][p] = toa_[b][p]/10000.0;
-
-    pred = starfm(nx, ny, QAI, coarse, fine, 1);
-
-    for (p=0; p<nc; p++) toa_[b][p] = (short)(pred[p]*10000);
-
-    free((void*)pred);
-
+    memcpy(toa_[b], pred_[b_], nc*sizeof(short));
   }
 
+  free_2D((void**)pred_, nb);
+
   #ifdef FORCE_DEBUG
   set_brick_filename(TOA, "TOA-RESMERGED");
   print_brick_info(TOA); set_brick_open(TOA, OPEN_CREATE); write_brick(TOA);
   #endif
 
-  free_2D((void**)coarse, 3);
+  free_2D((void**)coarse, 2);
   free_2D((void**)fine,   2);
 
   #ifdef FORCE_CLOCK
@@ -698,8 +683,11 @@ short **pred_ = NULL;
 
 /** STARFM
 +++ This function is a streamlined version of the STARFM code using two
-+++ image pairs of coarse/fine data and one coarse image that should be
-+++ prediction at the fine scale.
++++ image pairs of coarse/fine data and coarse images that should be
++++ predicted at the fine scale. All bands are predicted in one pass. The
++++ spectrally similar neighbours (slice test) do not depend on the band,
++++ thus they are only selected once per pixel, and only the temporal 
++++ test and weights are evaluated for each band.
 +++-----------------------------------------------------------------------
 +++ Gao, F., Masek, J., Schwaller, M., & Hall, F. (2006). On the Blending 
 +++ of the Landsat and MODIS Surface Reflectance: Predicting Daily Landsat
@@ -708,28 +696,40 @@ short **pred_ = NULL;
 --- nx:      number of X-pixels (3x3 mosaic)
 --- ny:      number of Y-pixels (3x3 mosaic)
 --- QAI:     Quality Assurance Information
---- coarse: coarse resolution data (3 bands, 1-2 base pairs, 3 prediction)
---- fine:   fine data (2 bands, i.e. base pairs)
---- r:      prediction radius in pixels
-+++ Return: SUCCESS / FAILURE
+--- toa_:    TOA reflectance, coarse data that should be predicted
+--- coarse:  coarse resolution data (2 bands, i.e. base pairs)
+--- fine:    fine data (2 bands, i.e. base pairs)
+--- nb:      number of bands to predict
+--- bands:   bands to predict
+--- r:       prediction radius in pixels
++++ Return:  prediction (scaled by 10000)
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-float *starfm(int nx, int ny, brick_t *QAI, float **coarse, float **fine, int r){
-int i, j, p, ii, jj, ni, nj, np, c, ncan;
+short **starfm(int nx, int ny, brick_t *QAI, short **toa_, float **coarse, float **fine, int nb, int *bands, int r){
+int i, j, p, ii, jj, ni, nj, np, b, b_, c, k, nk, ncan, nsim;
 float diff;
-float d, D;     // spatial distance, relative spatial distance
+float d;        // spatial distance
 float T, S, TS; // temporal, spectral, and combined difference
 float C_sum;    // sum of combined inversed weight
 float W;        // normalized weight
+float target;   // coarse data that should be predicted at central pixel
+float r_coarse; // relative difference between two coarse obs. at central pixel
 float min_r_coarse, min_r_fine; // min. of rel. differences of central pix
 float unc_coarse_1, unc_coarse_2, unc_fine; // uncertainty coarse and fine
 float unc_r_coarse, unc_r_fine;             // uncertainty rel. difference
 float unc_all;                              // combined uncertainty
-starfm_candidate_t *can = NULL; // candidate pixel struct
-float *prediction = NULL; // prediction
+float prediction; // prediction
+short **pred_ = NULL;
+
+// relative spatial distance of kernel pixels
+int   *kdx = NULL, *kdy = NULL;
+float *kD = NULL;
 
-#ifdef FORCE_DEBUG
-float *percentsample = NULL; // percentage of valid candidates
-#endif
+// spectrally similar candidates (position, base pair data, distance)
+int   *can_np = NULL;
+float *can_coarse = NULL, *can_fine = NULL, *can_r_fine = NULL, *can_D = NULL;
+// per-band candidate data (temporal difference, weight, passed test)
+float *can_r_coarse = NULL, *can_C = NULL;
+bool  *can_ok = NULL;
 
 int pair, npair = 2;
 
@@ -784,164 +784,188 @@ float slice_value[2], std, nclass = 40;
   }
 
 
-  /** predict fine resolution data **/
+  /** precompute relative spatial distance of kernel pixels **/
 
-  alloc((void**)&can, (r*2+1)*(r*2+1)*npair+1, sizeof(starfm_candidate_t));
-  alloc((void**)&prediction, nx*ny, sizeof(float));
-  #ifdef FORCE_DEBUG
-  alloc((void**)&percentsample, nx*ny, sizeof(float));
-  #endif
+  nk = (r*2+1)*(r*2+1);
+  alloc((void**)&kdx, nk, sizeof(int));
+  alloc((void**)&kdy, nk, sizeof(int));
+  alloc((void**)&kD,  nk, sizeof(float));
 
-  for (i=0, p=0; i<ny; i++){
-  for (j=0; j<nx; j++, p++){
+  for (ii=-r, k=0; ii<=r; ii++){
+  for (jj=-r; jj<=r; jj++, k++){
+    kdx[k] = jj;
+    kdy[k] = ii;
+    d = sqrt(jj*jj + ii*ii);
+    kD[k] = 1.0+d/r;
+  }
+  }
 
-    if (get_off(QAI, p)) continue;
 
+  /** predict fine resolution data **/
 
-    /** add original fine observation to candidate list (Index 0) **/
+  alloc_2D((void***)&pred_, nb, nx*ny, sizeof(short));
 
-    c = 0;
-    can[c].dx = 0;
-    can[c].dy = 0;
-    can[c].coarse = coarse[npair][p];
-    c++;
+  #pragma omp parallel private(j, p, ii, jj, ni, nj, np, b, b_, c, k, ncan, nsim, diff, T, S, TS, C_sum, W, target, r_coarse, min_r_coarse, min_r_fine, prediction, pair, can_np, can_coarse, can_fine, can_r_fine, can_D, can_r_coarse, can_C, can_ok) shared(nx, ny, nk, nb, npair, bands, toa_, coarse, fine, QAI, kdx, kdy, kD, slice_value, unc_r_coarse, unc_r_fine, unc_all, pred_) default(none)
+  {
 
+    alloc((void**)&can_np,       nk*npair, sizeof(int));
+    alloc((void**)&can_coarse,   nk*npair, sizeof(float));
+    alloc((void**)&can_fine,     nk*npair, sizeof(float));
+    alloc((void**)&can_r_fine,   nk*npair, sizeof(float));
+    alloc((void**)&can_D,        nk*npair, sizeof(float));
+    alloc((void**)&can_r_coarse, nk*npair, sizeof(float));
+    alloc((void**)&can_C,        nk*npair, sizeof(float));
+    alloc((void**)&can_ok,       nk*npair, sizeof(bool));
 
-    /** add base pairs of central pixel to candidates and
-    +++ estimate minimum relative differences **/
+    #pragma omp for schedule(guided)
+    for (i=0; i<ny; i++){
+    for (j=0; j<nx; j++){
 
-    min_r_coarse = min_r_fine = SHRT_MAX;
+      p = i*nx+j;
 
-    for (pair=0; pair<npair; pair++){
+      if (get_off(QAI, p)) continue;
 
-      can[c].dx = 0;
-      can[c].dy = 0;
-      can[c].coarse = coarse[pair][p];
-      can[c].fine   = fine[pair][p];
 
-      can[c].r_coarse = coarse[pair][p] - coarse[npair][p];
-      can[c].r_fine   = coarse[pair][p] - fine[pair][p];
+      /** estimate minimum spectral difference of central pixel **/
 
-      if (fabs(can[c].r_coarse) < min_r_coarse) min_r_coarse = fabs(can[c].r_coarse);
-      if (fabs(can[c].r_fine)   < min_r_fine)   min_r_fine   = fabs(can[c].r_fine);
-      c++;
+      min_r_fine = SHRT_MAX;
 
-    }
+      for (pair=0; pair<npair; pair++){
+        if (fabs(coarse[pair][p] - fine[pair][p]) < min_r_fine) min_r_fine = fabs(coarse[pair][p] - fine[pair][p]);
+      }
 
 
-    /** add all base observations within prediction kernel to candidates
-    +++ if they are more similar than the minimum relative difference
-    +++ at the central pixel. This includes the central pixel (reset index
-    +++ to 1). **/
+      /** collect all base observations within prediction kernel that 
+      +++ are spectrally similar to the central pixel (slice test). This
+      +++ includes the central pixel. **/
 
-    c = 1;
+      nsim = 0;
 
-    for (ii=-r; ii<=r; ii++){
-    for (jj=-r; jj<=r; jj++){
+      for (k=0; k<nk; k++){
 
-      ni = i+ii; nj = j+jj;
-      if (ni < 0 || ni >= ny || nj < 0 || nj >= nx) continue;
-      np = ni*nx+nj;
+        ni = i+kdy[k]; nj = j+kdx[k];
+        if (ni < 0 || ni >= ny || nj < 0 || nj >= nx) continue;
+        np = ni*nx+nj;
 
-      if (get_off(QAI, np)) continue;
-      
-      for (pair=0; pair<npair; pair++){
+        if (get_off(QAI, np)) continue;
 
-        diff = fabs(fine[pair][np] - fine[pair][p]);
-        if (diff > slice_value[pair]) continue;
+        for (pair=0; pair<npair; pair++){
 
-        can[c].dx = jj;
-        can[c].dy = ii;
-        can[c].coarse = coarse[pair][np];
-        can[c].fine   = fine[pair][np];
+          diff = fabs(fine[pair][np] - fine[pair][p]);
+          if (diff > slice_value[pair]) continue;
 
-        can[c].r_coarse = coarse[pair][np] - coarse[npair][np];
-        can[c].r_fine   = coarse[pair][np] - fine[pair][np];
+          can_np[nsim]     = np;
+          can_coarse[nsim] = coarse[pair][np];
+          can_fine[nsim]   = fine[pair][np];
+          can_r_fine[nsim] = coarse[pair][np] - fine[pair][np];
+          can_D[nsim]      = kD[k];
+          nsim++;
 
-        if (fabs(can[c].r_coarse) < (min_r_coarse+unc_r_coarse) ||
-            fabs(can[c].r_fine)   < (min_r_fine+unc_r_fine)) c++;
+        }
 
       }
 
-    }
-    }
 
+      for (b_=0; b_<nb; b_++){
 
-    /** predict fine data from candidates based on 
-    +++ spatial distance,
-    +++ spectral distance (coarse-fine difference of input pairs) and 
-    +++ 'temporal distance' (coarse-coarse difference of one base to
-    +++ target image).
-    +++ If there is no candidate, use coarse data. **/
+        b = bands[b_];
 
-    C_sum = 0.0;
-    
-    if ((ncan = c) > 1){
+        target = toa_[b][p]/10000.0;
 
-      for (c=1; c<ncan; c++){
 
-          // location distance to central pixel
-          d = sqrt(can[c].dx*can[c].dx + can[c].dy*can[c].dy);
+        /** estimate minimum temporal difference of central pixel **/
 
-          // temporal, spectral and combined distance
-          // add a small uncertainty to avoid zero in T or S (avoid a 
-          // biased large weight)
+        min_r_coarse = SHRT_MAX;
 
-          T = fabs(can[c].r_coarse) + 0.0001;
-          S = fabs(can[c].r_fine)   + 0.0001;
+        for (pair=0; pair<npair; pair++){
+          r_coarse = coarse[pair][p] - target;
+          if (fabs(r_coarse) < min_r_coarse) min_r_coarse = fabs(r_coarse);
+        }
+
+
+        /** keep similar observations as candidates if they are more 
+        +++ similar than the minimum relative difference at the central 
+        +++ pixel, and compute weights based on
+        +++ spatial distance,
+        +++ spectral distance (coarse-fine difference of input pairs) and 
+        +++ 'temporal distance' (coarse-coarse difference of one base to
+        +++ target image).
+        +++ A small uncertainty is added to avoid zero in T or S (avoid a 
+        +++ biased large weight). Use max weight if very close. **/
+
+        #pragma omp simd private(T, S, TS)
+        for (c=0; c<nsim; c++){
+
+          can_r_coarse[c] = can_coarse[c] - (float)(toa_[b][can_np[c]]/10000.0);
+
+          can_ok[c] = fabs(can_r_coarse[c]) < (min_r_coarse+unc_r_coarse) ||
+                      fabs(can_r_fine[c])   < (min_r_fine+unc_r_fine);
+
+          T = fabs(can_r_coarse[c]) + 0.0001;
+          S = fabs(can_r_fine[c])   + 0.0001;
           TS = T*S;
 
+          can_C[c] = (TS < unc_all) ? 1.0 : 1.0/(TS*can_D[c]);
 
-          // use max weight if very close or compute combined inverted weight
-          if (TS < unc_all){
-            can[c].C = 1.0;
-          } else {
-            D = 1.0+d/r;
-            can[c].C = 1.0/(TS*D);
-          }
+        }
 
-          // sum of all inverted weights
-          C_sum += can[c].C;
 
-      }
+        /** predict fine data from candidates using weighting function.
+        +++ If there is no candidate, use coarse data. **/
 
-      for (c=1; c<ncan; c++){
+        C_sum = 0.0;
+        ncan = 0;
 
-        // normalized weight
-        W = can[c].C/C_sum;
+        for (c=0; c<nsim; c++){
+          if (!can_ok[c]) continue;
+          C_sum += can_C[c];
+          ncan++;
+        }
 
-        // predict fine data using weighting function
-        prediction[p] += W * (can[c].fine - can[c].r_coarse);
+        if (ncan > 0){
 
-        #ifdef FORCE_DEBUG
-        percentsample[p] = (ncan/((r*2+1)*(r*2+1)*npair));
-        #endif
+          prediction = 0.0;
 
-      }
-      
-    } else {
+          for (c=0; c<nsim; c++){
+            if (!can_ok[c]) continue;
+            W = can_C[c]/C_sum;
+            prediction += W * (can_fine[c] - can_r_coarse[c]);
+          }
+
+        } else {
+
+          // retain coarse data if no suitable candidate
+          prediction = target;
+
+        }
 
-      // retain coarse data if no suitable candidate
-      prediction[p] = can[0].coarse;
+        pred_[b_][p] = (short)(prediction*10000);
+
+      }
 
     }
+    }
 
+    free((void*)can_np);
+    free((void*)can_coarse);
+    free((void*)can_fine);
+    free((void*)can_r_fine);
+    free((void*)can_D);
+    free((void*)can_r_coarse);
+    free((void*)can_C);
+    free((void*)can_ok);
 
-  }
   }
 
-  free((void*)can);
-
-  #ifdef FORCE_DEBUG
-  //db_write_image_1D((void**)percentsample,  "PANSHARP-PSAM", nx, ny, sizeof(float), 4);
-  free((void*)percentsample);
-  #endif
+  free((void*)kdx);
+  free((void*)kdy);
+  free((void*)kD);
 
   #ifdef FORCE_CLOCK
   proctime_print("STARFM", TIME);
   #endif
 
-  return prediction;
+  return pred_;
 }
 
 
@@ -64,6 +64,13 @@ int **ptr = NULL;
   free_2DC((void**)ptr); // Free the allocated memory
 }
 
+void test_alloc_2DC_should_AllocateEmptyContiguous2DArray(void) {
+int **ptr = NULL;
+  alloc_2DC((void***)&ptr, 0, 3, sizeof(int));
+  TEST_ASSERT_NOT_NULL(ptr);
+  free_2DC((void**)ptr); // Free the allocated memory
+}
+
 // Test cases for alloc_3D
 void test_alloc_3D_should_Allocate3DArray(void) {
 int ***ptr = NULL;
@@ -175,6 +182,34 @@ int **ptr = NULL;
   free_2DC((void**)ptr); // Free the allocated memory
 }
 
+void test_re_alloc_2DC_should_KeepRowsWhenAddingRows(void) {
+int **ptr = NULL;
+  alloc_2DC((void***)&ptr, 2, 3, sizeof(int));
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      ptr[i][j] = i*3+j+1;
+    }
+  }
+  re_alloc_2DC((void***)&ptr, 2, 3, 4, 3, sizeof(int));
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_PTR(ptr[0] + i*3, ptr[i]);
+    for (int j = 0; j < 3; j++) {
+      TEST_ASSERT_EQUAL((i < 2) ? i*3+j+1 : 0, ptr[i][j]);
+    }
+  }
+  free_2DC((void**)ptr); // Free the allocated memory
+}
+
+void test_re_alloc_2DC_should_ReallocateEmptyContiguous2DArray(void) {
+int **ptr = NULL;
+  alloc_2DC((void***)&ptr, 0, 3, sizeof(int));
+  re_alloc_2DC((void***)&ptr, 0, 3, 2, 3, sizeof(int));
+  TEST_ASSERT_NOT_NULL(ptr[1]);
+  re_alloc_2DC((void***)&ptr, 2, 3, 0, 3, sizeof(int));
+  TEST_ASSERT_NOT_NULL(ptr);
+  free_2DC((void**)ptr); // Free the allocated memory
+}
+
 // Test cases for re_alloc_3D
 void test_re_alloc_3D_should_Reallocate3DArray(void) {
 int ***ptr = NULL;
@@ -204,6 +239,114 @@ int ***ptr = NULL;
   free_3D((void***)ptr, 4, 6); // Free the allocated memory
 }
 
+// Test cases for slabs
+void test_alloc_slab_should_AllocateAlignedZeroMemory(void) {
+char *ptr = NULL;
+  alloc_slab((void**)&ptr, 1000);
+  TEST_ASSERT_NOT_NULL(ptr);
+  TEST_ASSERT_EQUAL(0, (size_t)ptr % SLAB_ALIGN);
+  for (int i = 0; i < 1000; i++) {
+    TEST_ASSERT_EQUAL(0, ptr[i]);
+  }
+  free_slab(ptr, 1000); // Free the allocated memory
+  free_slab_pool();
+}
+
+void test_alloc_slab_should_ReuseReleasedSlab(void) {
+char *ptr = NULL, *ptr2 = NULL;
+  init_slab_pool(SLAB_POOL_BYTES);
+  alloc_slab((void**)&ptr, 1000);
+  memset(ptr, 1, 1000);
+  free_slab(ptr, 1000);
+  alloc_slab((void**)&ptr2, 1000);
+  TEST_ASSERT_EQUAL_PTR(ptr, ptr2);
+  for (int i = 0; i < 1000; i++) {
+    TEST_ASSERT_EQUAL(0, ptr2[i]);
+  }
+  free_slab(ptr2, 1000); // Free the allocated memory
+  init_slab_pool(0);
+}
+
+void test_alloc_slab_should_AlignLargeSlabToHugePage(void) {
+char *ptr = NULL;
+  alloc_slab((void**)&ptr, SLAB_HUGE+1);
+  TEST_ASSERT_EQUAL(0, (size_t)ptr % SLAB_HUGE);
+  ptr[2*SLAB_HUGE-1] = 1;
+  free_slab(ptr, SLAB_HUGE+1); // Free the allocated memory
+  free_slab_pool();
+}
+
+// Test cases for arena
+void test_arena_alloc_should_AllocateAlignedZeroMemory(void) {
+arena_t arena;
+int *ptr = NULL;
+double *dbl = NULL;
+  init_arena(&arena, 1024);
+  arena_alloc(&arena, (void**)&ptr, 3, sizeof(int));
+  arena_alloc(&arena, (void**)&dbl, 5, sizeof(double));
+  TEST_ASSERT_EQUAL(0, (size_t)ptr % ARENA_ALIGN);
+  TEST_ASSERT_EQUAL(0, (size_t)dbl % ARENA_ALIGN);
+  for (int i = 0; i < 5; i++) {
+    TEST_ASSERT_EQUAL(0, dbl[i]);
+  }
+  TEST_ASSERT_EQUAL(0, arena.nspill);
+  free_arena(&arena); // Free the allocated memory
+}
+
+void test_arena_alloc_should_ReuseMemoryAfterReset(void) {
+arena_t arena;
+int *ptr = NULL, *ptr2 = NULL;
+  init_arena(&arena, 1024);
+  arena_alloc(&arena, (void**)&ptr, 4, sizeof(int));
+  for (int i = 0; i < 4; i++) ptr[i] = i+1;
+  reset_arena(&arena);
+  arena_alloc(&arena, (void**)&ptr2, 4, sizeof(int));
+  TEST_ASSERT_EQUAL_PTR(ptr, ptr2);
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(0, ptr2[i]);
+  }
+  free_arena(&arena); // Free the allocated memory
+}
+
+void test_arena_alloc_should_GrowWhenFull(void) {
+arena_t arena;
+int *ptr = NULL;
+  init_arena(&arena, 0);
+  arena_alloc(&arena, (void**)&ptr, 100, sizeof(int));
+  arena_alloc(&arena, (void**)&ptr, 100, sizeof(int));
+  TEST_ASSERT_EQUAL(2, arena.nspill);
+  reset_arena(&arena);
+  TEST_ASSERT_EQUAL(0, arena.nspill);
+  TEST_ASSERT_TRUE(arena.size >= 200*sizeof(int));
+  arena_alloc(&arena, (void**)&ptr, 100, sizeof(int));
+  arena_alloc(&arena, (void**)&ptr, 100, sizeof(int));
+  TEST_ASSERT_EQUAL(0, arena.nspill);
+  free_arena(&arena); // Free the allocated memory
+}
+
+void test_arena_alloc_3D_should_Allocate3DArray(void) {
+arena_t arena;
+int ***ptr = NULL;
+  init_arena(&arena, 0);
+  arena_alloc_3D(&arena, (void****)&ptr, 2, 3, 4, sizeof(int));
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 4; k++) {
+        TEST_ASSERT_EQUAL(0, ptr[i][j][k]);
+        ptr[i][j][k] = i*12+j*4+k;
+      }
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 4; k++) {
+        TEST_ASSERT_EQUAL(i*12+j*4+k, ptr[i][j][k]);
+      }
+    }
+  }
+  free_arena(&arena); // Free the allocated memory
+}
+
 int main(void) {
 
   UNITY_BEGIN();
@@ -216,6 +359,7 @@ int main(void) {
 
   RUN_TEST(test_alloc_2DC_should_AllocateContiguous2DArray);
   RUN_TEST(test_alloc_2DC_should_InitializeContiguous2DArrayToZero);
+  RUN_TEST(test_alloc_2DC_should_AllocateEmptyContiguous2DArray);
 
   RUN_TEST(test_alloc_3D_should_Allocate3DArray);
   RUN_TEST(test_alloc_3D_should_Initialize3DArrayToZero);
@@ -230,10 +374,21 @@ int main(void) {
 
   RUN_TEST(test_re_alloc_2DC_should_ReallocateContiguous2DArray);
   RUN_TEST(test_re_alloc_2DC_should_InitializeNewContiguous2DArrayMemoryToZero);
+  RUN_TEST(test_re_alloc_2DC_should_KeepRowsWhenAddingRows);
+  RUN_TEST(test_re_alloc_2DC_should_ReallocateEmptyContiguous2DArray);
   
   RUN_TEST(test_re_alloc_3D_should_Reallocate3DArray);
   RUN_TEST(test_re_alloc_3D_should_InitializeNew3DArrayMemoryToZero);
 
+  RUN_TEST(test_alloc_slab_should_AllocateAlignedZeroMemory);
+  RUN_TEST(test_alloc_slab_should_ReuseReleasedSlab);
+  RUN_TEST(test_alloc_slab_should_AlignLargeSlabToHugePage);
+
+  RUN_TEST(test_arena_alloc_should_AllocateAlignedZeroMemory);
+  RUN_TEST(test_arena_alloc_should_ReuseMemoryAfterReset);
+  RUN_TEST(test_arena_alloc_should_GrowWhenFull);
+  RUN_TEST(test_arena_alloc_3D_should_Allocate3DArray);
+
   return UNITY_END();
 
 }
@@ -0,0 +1,168 @@
+#include "unity/unity.h"
+#include <unistd.h>
+#include "../modules/cross-level/bintable-cl.h"
+
+#define NROW 37
+#define NCOL 5
+
+char fname[NPOW_10];
+double **tab = NULL;
+double **coords = NULL;
+bool allow[NROW];
+char name_buf[NCOL][BINTABLE_NAME_LEN] = { "BLUE", "GREEN", "RED", "NIR", "SWIR1" };
+char *names[NCOL];
+
+void setUp(void) {
+  int row, col;
+  snprintf(fname, NPOW_10, "/tmp/force-test-bintable-%d.btb", (int)getpid());
+  remove(fname);
+  for (col=0; col<NCOL; col++) names[col] = name_buf[col];
+  alloc_2D((void***)&tab, NROW, NCOL, sizeof(double));
+  alloc_2D((void***)&coords, NROW, 2, sizeof(double));
+  for (row=0; row<NROW; row++){
+    for (col=0; col<NCOL; col++) tab[row][col] = row*100 + col;
+    coords[row][_X_] = 4000000.5 + row;
+    coords[row][_Y_] = 3000000.5 - row;
+    allow[row] = (row % 3 != 0);
+  }
+}
+
+void tearDown(void) {
+  remove(fname);
+  free_2D((void**)tab, NROW);
+  free_2D((void**)coords, NROW);
+}
+
+void test_bintable_should_RoundTripAppendedBlocks(void) {
+  bintable_t table;
+  float **rows = NULL;
+  float *column = NULL;
+  bool all[NROW];
+  int row, col, k, n = 0;
+
+  for (row=0; row<NROW; row++){ all[row] = true; n += allow[row]; }
+
+  TEST_ASSERT_FALSE(is_bintable(fname));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname, tab, coords, allow, NROW, NCOL, names, -9999));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname, tab, coords, all,   NROW, NCOL, names, -9999));
+  TEST_ASSERT_TRUE(is_bintable(fname));
+
+  TEST_ASSERT_EQUAL_INT(SUCCESS, open_bintable(fname, &table));
+  TEST_ASSERT_EQUAL_INT(NCOL, table.ncol);
+  TEST_ASSERT_EQUAL_INT(n+NROW, (int)table.nrow);
+  TEST_ASSERT_EQUAL_INT(2, table.nblock);
+  TEST_ASSERT_EQUAL_FLOAT(-9999, table.nodata);
+  for (col=0; col<NCOL; col++) TEST_ASSERT_EQUAL_STRING(names[col], table.col_names[col]);
+
+  alloc_2DC((void***)&rows, table.nrow, NCOL, sizeof(float));
+  alloc((void**)&column, table.nrow, sizeof(float));
+  gather_bintable(&table, rows);
+  gather_bintable_col(&table, 3, column);
+
+  for (row=0, k=0; row<NROW; row++){
+    if (!allow[row]) continue;
+    for (col=0; col<NCOL; col++) TEST_ASSERT_EQUAL_FLOAT(tab[row][col], rows[k][col]);
+    TEST_ASSERT_EQUAL_FLOAT(tab[row][3], column[k]);
+    TEST_ASSERT_TRUE(coords[row][_X_] == table.block_x[0][k]);
+    TEST_ASSERT_TRUE(coords[row][_Y_] == table.block_y[0][k]);
+    k++;
+  }
+  for (row=0; row<NROW; row++, k++){
+    for (col=0; col<NCOL; col++) TEST_ASSERT_EQUAL_FLOAT(tab[row][col], rows[k][col]);
+    TEST_ASSERT_EQUAL_FLOAT(tab[row][3], column[k]);
+  }
+
+  free_2DC((void**)rows);
+  free((void*)column);
+  close_bintable(&table);
+}
+
+void test_bintable_should_OverwriteLeftoverBytes(void) {
+  bintable_t table;
+  float **rows = NULL;
+  bool all[NROW];
+  char junk[100];
+  FILE *fp = NULL;
+  int row, col, n = 0;
+
+  for (row=0; row<NROW; row++){ all[row] = true; n += allow[row]; }
+  memset(junk, 0x7f, 100);
+
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname, tab, coords, allow, NROW, NCOL, names, -9999));
+
+  // simulate an append that was interrupted before the header was updated
+  fp = fopen(fname, "ab");
+  fwrite(junk, 100, 1, fp);
+  fclose(fp);
+
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname, tab, coords, all, NROW, NCOL, names, -9999));
+
+  TEST_ASSERT_EQUAL_INT(SUCCESS, open_bintable(fname, &table));
+  TEST_ASSERT_EQUAL_INT(2, table.nblock);
+  TEST_ASSERT_EQUAL_INT(n+NROW, (int)table.nrow);
+  TEST_ASSERT_EQUAL_INT(NROW, (int)table.block_nrow[1]);
+
+  alloc_2DC((void***)&rows, table.nrow, NCOL, sizeof(float));
+  gather_bintable(&table, rows);
+  for (row=0; row<NROW; row++){
+    for (col=0; col<NCOL; col++) TEST_ASSERT_EQUAL_FLOAT(tab[row][col], rows[n+row][col]);
+    TEST_ASSERT_TRUE(coords[row][_X_] == table.block_x[1][row]);
+  }
+
+  free_2DC((void**)rows);
+  close_bintable(&table);
+}
+
+void test_bintable_should_MatchRowsOfPairedTables(void) {
+  bintable_t a, b;
+  char fname2[NPOW_10];
+
+  snprintf(fname2, NPOW_10, "/tmp/force-test-bintable-%d-2.btb", (int)getpid());
+  remove(fname2);
+
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname,  tab, coords, allow, NROW, NCOL, names, -9999));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname2, tab, coords, allow, NROW, 1,    names, -9999));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, open_bintable(fname,  &a));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, open_bintable(fname2, &b));
+  TEST_ASSERT_TRUE(same_bintable_rows(&a, &b));
+  close_bintable(&b);
+
+  // same number of rows, but different coordinates
+  coords[1][_X_] += 30;
+  remove(fname2);
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname2, tab, coords, allow, NROW, 1, names, -9999));
+  TEST_ASSERT_EQUAL_INT(SUCCESS, open_bintable(fname2, &b));
+  TEST_ASSERT_FALSE(same_bintable_rows(&a, &b));
+
+  close_bintable(&a);
+  close_bintable(&b);
+  remove(fname2);
+}
+
+void test_bintable_should_RejectColumnMismatch(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, append_bintable(fname, tab, coords, allow, NROW, NCOL, names, -9999));
+  TEST_ASSERT_EQUAL_INT(FAILURE, append_bintable(fname, tab, coords, allow, NROW, NCOL-1, names, -9999));
+}
+
+void test_bintable_should_RejectTextTable(void) {
+  bintable_t table;
+  FILE *fp = fopen(fname, "w");
+  fprintf(fp, "1 2 3\n4 5 6\n");
+  fclose(fp);
+  TEST_ASSERT_FALSE(is_bintable(fname));
+  TEST_ASSERT_EQUAL_INT(FAILURE, open_bintable(fname, &table));
+}
+
+int main(void) {
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_bintable_should_RoundTripAppendedBlocks);
+  RUN_TEST(test_bintable_should_OverwriteLeftoverBytes);
+  RUN_TEST(test_bintable_should_MatchRowsOfPairedTables);
+  RUN_TEST(test_bintable_should_RejectColumnMismatch);
+  RUN_TEST(test_bintable_should_RejectTextTable);
+
+  return UNITY_END();
+
+}
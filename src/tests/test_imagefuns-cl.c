@@ -0,0 +1,88 @@
+#include "unity/unity.h"
+#include <math.h>
+#include "../modules/cross-level/imagefuns-cl.h"
+
+#define NX 301
+#define NY 157
+
+small image[NX*NY];
+ushort truth[NX*NY];
+int cells[NX*NY];
+bool initialized = false;
+
+void setUp(void) {
+  int x, y, xx, yy, p, d, dmin, k, n = 0;
+  // compute the image and the reference only once for all tests
+  if (initialized) return;
+  initialized = true;
+  srand(42);
+  // sparse TRUE cells, and an empty band without TRUE cells
+  for (p=0; p<NX*NY; p++) image[p] = (rand() % 500 == 0);
+  for (y=60; y<100; y++){
+  for (x=0; x<NX; x++) image[y*NX+x] = false;
+  }
+  // brute force distance to all TRUE cells
+  for (p=0; p<NX*NY; p++){
+    if (image[p]) cells[n++] = p;
+  }
+  for (y=0; y<NY; y++){
+  for (x=0; x<NX; x++){
+    dmin = INT_MAX;
+    for (k=0; k<n; k++){
+      yy = cells[k] / NX;
+      xx = cells[k] % NX;
+      d = (xx-x)*(xx-x) + (yy-y)*(yy-y);
+      if (d < dmin) dmin = d;
+    }
+    truth[y*NX+x] = (ushort)sqrt(dmin);
+  }
+  }
+}
+
+void tearDown(void) { }
+
+void test_dist_transform_should_MatchBruteForce(void) {
+  ushort *dist = dist_transform_(image, NX, NY);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(truth, dist, NX*NY);
+  free((void*)dist);
+}
+
+void test_truncated_dist_transform_should_CapDistances(void) {
+  ushort *dist = NULL;
+  int p, max[3] = { 1, 7, 25 }, m;
+
+  for (m=0; m<3; m++){
+    dist = truncated_dist_transform_(image, NX, NY, max[m]);
+    for (p=0; p<NX*NY; p++){
+      if (truth[p] < max[m]){
+        TEST_ASSERT_EQUAL_UINT16(truth[p], dist[p]);
+      } else {
+        TEST_ASSERT_EQUAL_UINT16(max[m], dist[p]);
+      }
+    }
+    free((void*)dist);
+  }
+}
+
+void test_truncated_dist_transform_should_HandleNarrowImage(void) {
+  small column[NY];
+  ushort *dist = NULL;
+  int y;
+
+  for (y=0; y<NY; y++) column[y] = (y == 10);
+  dist = truncated_dist_transform_(column, 1, NY, 50);
+  for (y=0; y<NY; y++) TEST_ASSERT_EQUAL_UINT16((abs(y-10) < 50) ? abs(y-10) : 50, dist[y]);
+  free((void*)dist);
+}
+
+int main(void) {
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_dist_transform_should_MatchBruteForce);
+  RUN_TEST(test_truncated_dist_transform_should_CapDistances);
+  RUN_TEST(test_truncated_dist_transform_should_HandleNarrowImage);
+
+  return UNITY_END();
+
+}
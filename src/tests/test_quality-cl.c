@@ -0,0 +1,120 @@
+#include "unity/unity.h"
+#include "../modules/cross-level/quality-cl.h"
+
+#define N_WORDS 65536
+
+short qai[N_WORDS];
+small msk[N_WORDS];
+brick_t *QAI = NULL;
+
+void setUp(void) {
+  int p;
+  QAI = allocate_brick(1, N_WORDS, _DT_SHORT_);
+  for (p=0; p<N_WORDS; p++) qai[p] = QAI->vshort[0][p] = (short)p;
+}
+
+void tearDown(void) {
+  free_brick(QAI);
+}
+
+void test_evaluate_qai_rules_should_PassAllWithoutRules(void) {
+  qai_rules_t rules;
+  int p;
+
+  init_qai_rules(&rules);
+  evaluate_qai_rules(qai, N_WORDS, &rules, msk);
+  for (p=0; p<N_WORDS; p++) TEST_ASSERT_EQUAL_UINT8(1, msk[p]);
+}
+
+void test_evaluate_qai_rules_should_RejectMultiBitValue(void) {
+  qai_rules_t rules;
+  int p;
+
+  init_qai_rules(&rules);
+  TEST_ASSERT_EQUAL_INT(SUCCESS, add_qai_rule(&rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 2)));
+  evaluate_qai_rules(qai, N_WORDS, &rules, msk);
+  for (p=0; p<N_WORDS; p++) TEST_ASSERT_EQUAL_UINT8(get_cloud(QAI, p) != 2, msk[p]);
+}
+
+void test_evaluate_qai_rules_should_MatchPixelFunctions(void) {
+  qai_rules_t rules;
+  bool use;
+  int p;
+
+  init_qai_rules(&rules);
+  add_qai_rule(&rules, _QAI_MASK_OFF_, _QAI_MASK_OFF_);
+  add_qai_rule(&rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 3));
+  add_qai_rule(&rules, _QAI_MASK_SHD_, _QAI_MASK_SHD_);
+  add_qai_rule(&rules, _QAI_MASK_AOD_, _QAI_VALUE_(_QAI_BIT_AOD_, 1));
+  add_qai_rule(&rules, _QAI_MASK_ILL_, _QAI_VALUE_(_QAI_BIT_ILL_, 3));
+  add_qai_rule(&rules, _QAI_MASK_WVP_, _QAI_MASK_WVP_);
+
+  // odd length to cover the remainder of the vector loops
+  evaluate_qai_rules(qai, N_WORDS-3, &rules, msk);
+
+  for (p=0; p<N_WORDS-3; p++){
+    use = !get_off(QAI, p) && get_cloud(QAI, p) != 3 && !get_shadow(QAI, p) &&
+          get_aerosol(QAI, p) != 1 && get_illumination(QAI, p) != 3 && !get_vaporfill(QAI, p);
+    TEST_ASSERT_EQUAL_UINT8(use, msk[p]);
+  }
+}
+
+void test_lookup_qai_should_MatchRuleEvaluation(void) {
+  qai_rules_t rules;
+  small lut[QAI_LUT_SIZE];
+  small ref[N_WORDS];
+  int p;
+
+  init_qai_rules(&rules);
+  add_qai_rule(&rules, _QAI_MASK_OFF_, _QAI_MASK_OFF_);
+  add_qai_rule(&rules, _QAI_MASK_CLD_, _QAI_VALUE_(_QAI_BIT_CLD_, 1));
+  add_qai_rule(&rules, _QAI_MASK_SNW_, _QAI_MASK_SNW_);
+  add_qai_rule(&rules, _QAI_MASK_ILL_, _QAI_VALUE_(_QAI_BIT_ILL_, 2));
+  add_qai_rule(&rules, _QAI_MASK_WVP_, _QAI_MASK_WVP_);
+
+  compile_qai_lut(&rules, lut);
+
+  // negative QAI words need to be looked up as unsigned
+  for (p=0; p<N_WORDS; p++) qai[p] = (short)(N_WORDS-1-p);
+
+  evaluate_qai_rules(qai, N_WORDS, &rules, ref);
+  lookup_qai(qai, N_WORDS, lut, msk);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ref, msk, N_WORDS);
+}
+
+void test_add_qai_rule_should_IgnoreDuplicates(void) {
+  qai_rules_t rules;
+
+  init_qai_rules(&rules);
+  add_qai_rule(&rules, _QAI_MASK_SNW_, _QAI_MASK_SNW_);
+  add_qai_rule(&rules, _QAI_MASK_SNW_, _QAI_MASK_SNW_);
+  TEST_ASSERT_EQUAL_INT(1, rules.n);
+}
+
+void test_add_qai_rule_should_FailWhenFull(void) {
+  qai_rules_t rules;
+  int r;
+
+  init_qai_rules(&rules);
+  for (r=0; r<QAI_MAX_RULES; r++){
+    TEST_ASSERT_EQUAL_INT(SUCCESS, add_qai_rule(&rules, 0xFFFF, (ushort)r));
+  }
+  TEST_ASSERT_EQUAL_INT(FAILURE, add_qai_rule(&rules, 0xFFFF, QAI_MAX_RULES));
+}
+
+int main(void) {
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_evaluate_qai_rules_should_PassAllWithoutRules);
+  RUN_TEST(test_evaluate_qai_rules_should_RejectMultiBitValue);
+  RUN_TEST(test_evaluate_qai_rules_should_MatchPixelFunctions);
+
+  RUN_TEST(test_lookup_qai_should_MatchRuleEvaluation);
+
+  RUN_TEST(test_add_qai_rule_should_IgnoreDuplicates);
+  RUN_TEST(test_add_qai_rule_should_FailWhenFull);
+
+  return UNITY_END();
+
+}
@@ -0,0 +1,202 @@
+#include "unity/unity.h"
+#include <limits.h>
+#include "../modules/cross-level/stats-cl.h"
+
+#define N_VALUES 1001
+
+double values[N_VALUES];
+double copy[N_VALUES];
+float probs[] = { 0.0f, 0.01f, 0.05f, 0.25f, 0.33f, 0.5f, 0.75f, 0.95f, 0.99f, 1.0f };
+int nprobs = 10;
+
+void setUp(void) {
+  int i;
+  srand(42);
+  // many duplicates, as in 16bit integer data
+  for (i=0; i<N_VALUES; i++) values[i] = (double)(rand() % 200 - 50);
+}
+
+void tearDown(void) { }
+
+void test_quantiles_should_MatchQuantile(void) {
+  float q[10];
+  int i, n;
+  int sizes[] = { 1, 2, 3, 15, 16, 17, 100, N_VALUES };
+
+  for (n=0; n<8; n++){
+    memcpy(copy, values, sizeof(double)*sizes[n]);
+    quantiles(copy, sizes[n], probs, nprobs, q);
+    for (i=0; i<nprobs; i++){
+      memcpy(copy, values, sizeof(double)*sizes[n]);
+      TEST_ASSERT_EQUAL_FLOAT(quantile(copy, sizes[n], probs[i]), q[i]);
+    }
+  }
+}
+
+void test_quantiles_should_HandleUnsortedProbabilities(void) {
+  float p[3] = { 0.75f, 0.25f, 0.75f };
+  float q[3];
+  double x[8] = { 8, 1, 7, 2, 6, 3, 5, 4 };
+
+  quantiles(x, 8, p, 3, q);
+  TEST_ASSERT_EQUAL_FLOAT(6.25f, q[0]);
+  TEST_ASSERT_EQUAL_FLOAT(2.75f, q[1]);
+  TEST_ASSERT_EQUAL_FLOAT(6.25f, q[2]);
+}
+
+void test_quantiles_should_HandleConstantArray(void) {
+  float q[10];
+  int i;
+
+  for (i=0; i<N_VALUES; i++) copy[i] = 7;
+  quantiles(copy, N_VALUES, probs, nprobs, q);
+  for (i=0; i<nprobs; i++) TEST_ASSERT_EQUAL_FLOAT(7.0f, q[i]);
+}
+
+void test_quantiles_sketch_should_BeExactForUnitBins(void) {
+  qsketch_t sketch;
+  float q[10];
+  int i;
+
+  init_quantile_sketch(&sketch, 1);
+  for (i=0; i<N_VALUES; i++) add_quantile_sketch(&sketch, (short)values[i]);
+  quantiles_sketch(&sketch, probs, nprobs, q);
+
+  for (i=0; i<nprobs; i++){
+    memcpy(copy, values, sizeof(double)*N_VALUES);
+    TEST_ASSERT_EQUAL_FLOAT(quantile(copy, N_VALUES, probs[i]), q[i]);
+  }
+
+  free_quantile_sketch(&sketch);
+}
+
+void test_quantiles_sketch_should_BeWithinHalfBinWidth(void) {
+  qsketch_t sketch;
+  float q[10];
+  int i;
+
+  init_quantile_sketch(&sketch, 11);
+  for (i=0; i<N_VALUES; i++) add_quantile_sketch(&sketch, (short)values[i]);
+  quantiles_sketch(&sketch, probs, nprobs, q);
+
+  for (i=0; i<nprobs; i++){
+    memcpy(copy, values, sizeof(double)*N_VALUES);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, quantile(copy, N_VALUES, probs[i]), q[i]);
+  }
+
+  free_quantile_sketch(&sketch);
+}
+
+void test_quantiles_sketch_should_BeEmptyAfterReset(void) {
+  qsketch_t sketch;
+  float p = 0.5f, q;
+
+  init_quantile_sketch(&sketch, 4);
+  add_quantile_sketch(&sketch, SHRT_MIN);
+  add_quantile_sketch(&sketch, SHRT_MAX);
+  reset_quantile_sketch(&sketch);
+  TEST_ASSERT_EQUAL_INT(0, sketch.n);
+
+  add_quantile_sketch(&sketch, 100);
+  quantiles_sketch(&sketch, &p, 1, &q);
+  TEST_ASSERT_FLOAT_WITHIN(2.0f, 100.0f, q);
+
+  free_quantile_sketch(&sketch);
+}
+
+void test_quantiles_sketch_should_StayInShortRange(void) {
+  qsketch_t sketch;
+  float p[2] = { 0.0f, 1.0f }, q[2];
+  int w, widths[3] = { 3, 4, 11 };
+
+  for (w=0; w<3; w++){
+
+    init_quantile_sketch(&sketch, widths[w]);
+    add_quantile_sketch(&sketch, SHRT_MIN);
+    add_quantile_sketch(&sketch, SHRT_MAX);
+    quantiles_sketch(&sketch, p, 2, q);
+
+    TEST_ASSERT_TRUE(q[0] >= SHRT_MIN);
+    TEST_ASSERT_TRUE(q[1] <= SHRT_MAX);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f*widths[w], (float)SHRT_MIN, q[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f*widths[w], (float)SHRT_MAX, q[1]);
+    TEST_ASSERT_TRUE((short)q[1] > 0);
+
+    free_quantile_sketch(&sketch);
+
+  }
+
+  // partial last bin
+  init_quantile_sketch(&sketch, 3);
+  add_quantile_sketch(&sketch, SHRT_MAX);
+  quantiles_sketch(&sketch, p+1, 1, q);
+  TEST_ASSERT_EQUAL_FLOAT((float)SHRT_MAX, q[0]);
+  free_quantile_sketch(&sketch);
+}
+
+void test_rng_should_BeReproducible(void) {
+  rng_t a, b, c;
+  unsigned long long xa, xb, xc;
+  int i, same = 0;
+
+  init_rng(&a, 42);
+  init_rng(&b, 42);
+  init_rng(&c, 43);
+  for (i=0; i<100; i++){
+    xa = rng_next(&a); xb = rng_next(&b); xc = rng_next(&c);
+    TEST_ASSERT_TRUE(xa == xb);
+    same += (xb == xc);
+  }
+  TEST_ASSERT_EQUAL_INT(0, same);
+}
+
+void test_rng_int_should_StayInRange(void) {
+  rng_t rng;
+  int i, x, count[7] = { 0 };
+
+  init_rng(&rng, 1);
+  for (i=0; i<7000; i++){
+    x = rng_int(&rng, 7);
+    TEST_ASSERT_TRUE(x >= 0 && x < 7);
+    count[x]++;
+  }
+  for (i=0; i<7; i++) TEST_ASSERT_INT_WITHIN(150, 1000, count[i]);
+  TEST_ASSERT_EQUAL_INT(0, rng_int(&rng, 1));
+}
+
+void test_shuffle_should_Permute(void) {
+  rng_t rng;
+  int x[N_VALUES], seen[N_VALUES] = { 0 };
+  int i, moved = 0;
+
+  for (i=0; i<N_VALUES; i++) x[i] = i;
+  init_rng(&rng, 7);
+  shuffle(&rng, x, N_VALUES);
+  for (i=0; i<N_VALUES; i++){
+    seen[x[i]]++;
+    moved += (x[i] != i);
+  }
+  for (i=0; i<N_VALUES; i++) TEST_ASSERT_EQUAL_INT(1, seen[i]);
+  TEST_ASSERT_TRUE(moved > N_VALUES/2);
+}
+
+int main(void) {
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_quantiles_should_MatchQuantile);
+  RUN_TEST(test_quantiles_should_HandleUnsortedProbabilities);
+  RUN_TEST(test_quantiles_should_HandleConstantArray);
+
+  RUN_TEST(test_quantiles_sketch_should_BeExactForUnitBins);
+  RUN_TEST(test_quantiles_sketch_should_BeWithinHalfBinWidth);
+  RUN_TEST(test_quantiles_sketch_should_BeEmptyAfterReset);
+  RUN_TEST(test_quantiles_sketch_should_StayInShortRange);
+
+  RUN_TEST(test_rng_should_BeReproducible);
+  RUN_TEST(test_rng_int_should_StayInRange);
+  RUN_TEST(test_shuffle_should_Permute);
+
+  return UNITY_END();
+
+}
@@ -0,0 +1,109 @@
+#include "unity/unity.h"
+#include "../modules/aux-level/train-aux.h"
+
+par_train_t train;
+int nfeature_grid[2] = { 2, 4 };
+int max_depth_grid[3] = { 5, 10, 20 };
+int zero_grid[1] = { 0 };
+float Cgrid[3];
+float Gammagrid[3];
+
+void setUp(void) {
+  memset(&train, 0, sizeof(par_train_t));
+  train.rf.feature_subset = 7;
+  train.rf.dt.max_depth   = 12;
+  Cgrid[_MIN_] = 1;       Cgrid[_MAX_] = 100; Cgrid[2] = 10;
+  Gammagrid[_MIN_] = 0.5; Gammagrid[_MAX_] = 8; Gammagrid[2] = 2;
+  train.sv.Cgrid = Cgrid;
+  train.sv.Gammagrid = Gammagrid;
+  train.sv.nCgrid = train.sv.nGammagrid = 3;
+}
+
+void tearDown(void) { }
+
+void test_hyper_grid_should_CombineRandomForestGrids(void) {
+  hyper_t *grid = NULL;
+  int i, j, k, n;
+
+  train.method = _ML_RFC_;
+  train.rf.feature_subset_grid  = nfeature_grid;
+  train.rf.nfeature_subset_grid = 2;
+  train.rf.dt.max_depth_grid    = max_depth_grid;
+  train.rf.dt.nmax_depth_grid   = 3;
+
+  n = hyper_grid(&train, &grid);
+  TEST_ASSERT_EQUAL_INT(6, n);
+
+  for (i=0, k=0; i<2; i++){
+  for (j=0; j<3; j++, k++){
+    TEST_ASSERT_EQUAL_INT(nfeature_grid[i],  grid[k].nfeature);
+    TEST_ASSERT_EQUAL_INT(max_depth_grid[j], grid[k].max_depth);
+  }
+  }
+
+  free((void*)grid);
+}
+
+void test_hyper_grid_should_UseScalarIfGridIsZero(void) {
+  hyper_t *grid = NULL;
+  int k, n;
+
+  train.method = _ML_RFR_;
+  train.rf.feature_subset_grid  = zero_grid;
+  train.rf.nfeature_subset_grid = 1;
+  train.rf.dt.max_depth_grid    = max_depth_grid;
+  train.rf.dt.nmax_depth_grid   = 3;
+
+  n = hyper_grid(&train, &grid);
+  TEST_ASSERT_EQUAL_INT(3, n);
+  for (k=0; k<n; k++){
+    TEST_ASSERT_EQUAL_INT(7, grid[k].nfeature);
+    TEST_ASSERT_EQUAL_INT(max_depth_grid[k], grid[k].max_depth);
+  }
+  free((void*)grid);
+
+  train.rf.dt.max_depth_grid  = zero_grid;
+  train.rf.dt.nmax_depth_grid = 1;
+
+  n = hyper_grid(&train, &grid);
+  TEST_ASSERT_EQUAL_INT(1, n);
+  set_hyper(&train, &grid[0]);
+  TEST_ASSERT_EQUAL_INT(7,  train.rf.feature_subset);
+  TEST_ASSERT_EQUAL_INT(12, train.rf.dt.max_depth);
+  free((void*)grid);
+}
+
+void test_hyper_grid_should_ExpandSupportVectorGrids(void) {
+  hyper_t *grid = NULL;
+  int n;
+
+  train.method = _ML_SVC_;
+
+  // C: 1, 10; gamma: 0.5, 1, 2, 4
+  n = hyper_grid(&train, &grid);
+  TEST_ASSERT_EQUAL_INT(8, n);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1,   grid[0].C);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5, grid[0].gamma);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1,   grid[3].C);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 4,   grid[3].gamma);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 10,  grid[5].C);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1,   grid[5].gamma);
+
+  set_hyper(&train, &grid[4]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 10,  train.sv.C);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5, train.sv.gamma);
+
+  free((void*)grid);
+}
+
+int main(void) {
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_hyper_grid_should_CombineRandomForestGrids);
+  RUN_TEST(test_hyper_grid_should_UseScalarIfGridIsZero);
+  RUN_TEST(test_hyper_grid_should_ExpandSupportVectorGrids);
+
+  return UNITY_END();
+
+}